@@ -16,6 +16,7 @@
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <rang.hpp>
 
+#include "../src/Data/ContentStore.h"
 #include "../src/Parsers/BBCodeParser.h"
 #include "../src/Parsers/ParserManager.h"
 #include "../src/Utils/OwlUtils.h"
@@ -263,6 +264,84 @@ void ConsoleApp::doParsers(const QString&)
     std::cout << std::endl;
 }
 
+void ConsoleApp::doSearch(const QString& options)
+{
+    static const std::string usage = "usage: search [-b boardid] [-n limit] [--db file] {query}";
+
+    QCommandLineParser p;
+    p.addPositionalArgument("query", "", "query");
+    p.addOption(QCommandLineOption(QStringList() << "b" << "board", "", "board"));
+    p.addOption(QCommandLineOption(QStringList() << "n" << "limit", "", "limit"));
+    p.addOption(QCommandLineOption(QStringList() << "db" << "database", "", "database"));
+    p.parse(QStringList() << "search" << options.split(' ', Qt::SkipEmptyParts));
+
+    const QString query = p.positionalArguments().join(' ');
+    if (query.isEmpty())
+    {
+        ConsoleApp::printError(usage);
+        return;
+    }
+
+    // the database of the Owl GUI unless one was set with 'set database'
+    QString filename = QDir(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation))
+        .absoluteFilePath(QStringLiteral(ORGANIZATION_NAME "/Owl/owl.sqlite"));
+
+    if (p.isSet("database"))
+    {
+        filename = p.value("database");
+    }
+    else if (_appOptions.has("database"))
+    {
+        filename = _appOptions.getText("database");
+    }
+
+    if (!QFileInfo::exists(filename))
+    {
+        ConsoleApp::printError("The database '{}' does not exist", filename.toStdString());
+        return;
+    }
+
+    if (!_contentStore || _contentStore->filename() != filename)
+    {
+        _contentStore = std::make_shared<ContentStore>(filename);
+    }
+
+    const int limit = p.isSet("limit") ? p.value("limit").toInt() : DEFAULT_SEARCH_LIMIT;
+    const std::uint32_t boardId = p.isSet("board") ? p.value("board").toUInt() : 0;
+
+    try
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        const auto results = _contentStore->search(query, std::max(limit, 1), boardId);
+
+        for (const auto& result : results)
+        {
+            QString snippet = result.snippet;
+            snippet.replace(QString::fromLatin1(SEARCH_MATCH_BEGIN), QStringLiteral("\033[1m\033[33m"));
+            snippet.replace(QString::fromLatin1(SEARCH_MATCH_END), QStringLiteral("\033[0m"));
+
+            const QString header = QString("\033[1m\033[35m#%1\033[0m \033[1m\033[34m%2\033[0m, \033[1m\033[37m%3\033[0m in '%4' (board %5, thread %6)")
+                .arg(result.postIndex)
+                .arg(result.author)
+                .arg(printableDateTime(result.posted, true))
+                .arg(result.threadTitle)
+                .arg(result.boardId)
+                .arg(result.threadId);
+
+            std::cout << header.toStdString() << '\n';
+            std::cout << '\t' << snippet.toStdString() << '\n';
+        }
+
+        ConsoleApp::printStatus("{} result(s) in {}ms", results.size(), timer.elapsed());
+    }
+    catch (const owl::Exception& ex)
+    {
+        ConsoleApp::printError("Search failed: {}", ex.message().toStdString());
+    }
+}
+
 void ConsoleApp::doHistory(const QString& params)
 {
     static const std::string usage = "usage: history [reset]";
@@ -732,6 +811,7 @@ void ConsoleApp::initCommands()
         ConsoleCommand("login", "Login to a remote board", std::bind(&ConsoleApp::doLogin, this, std::placeholders::_1)),
         ConsoleCommand("parsers", "List parsers",std::bind(&ConsoleApp::doParsers, this, std::placeholders::_1)),
         ConsoleCommand("history", "Print history info",std::bind(&ConsoleApp::doHistory, this, std::placeholders::_1)),
+        ConsoleCommand("search", "Search the posts stored by Owl",std::bind(&ConsoleApp::doSearch, this, std::placeholders::_1)),
         ConsoleCommand("quit,exit,q", "", [this](const QString&) { _bDoneApp = true; }),
         ConsoleCommand("version,about", tr("Display version information"),
             [](const QString&)
@@ -19,6 +19,9 @@ namespace owl
 class ParserBase;
 using ParserBasePtr = std::shared_ptr<ParserBase>;
 
+class ContentStore;
+using ContentStorePtr = std::shared_ptr<ContentStore>;
+
 class CommandHistory;
 
 QString printableDateTime(const QDateTime& dt, bool bShowTime);
@@ -252,6 +255,8 @@ private:
     bool                        _bDoneApp = false;
 
     owl::StringMap              _appOptions;
+
+    ContentStorePtr             _contentStore;      // opened by the first 'search'
     
     void parseCommand(const QString& cmdLn);
     
@@ -260,6 +265,7 @@ private:
     void doLogin(const QString&);
     void doParsers(const QString& cmdLn);
     void doHistory(const QString& cmdLn);
+    void doSearch(const QString& cmdLn);
 
     void listForums() { doListForums(QString()); }
     void doListForums(const QString&);
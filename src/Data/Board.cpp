@@ -1,6 +1,10 @@
 // Owl - www.owlclient.com
 // Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
 
+#include <atomic>
+
+#include <QtConcurrent>
+
 #include <boost/functional/hash.hpp>
 
 #include <Utils/Settings.h>
@@ -8,6 +12,7 @@
 #include <Utils/OwlUtils.h>
 
 #include "Board.h"
+#include "ContentStore.h"
 
 namespace owl
 {
@@ -18,6 +23,17 @@ const char* const Board::Options::USE_ENCRYPTION		= "encryption.enabled";;
 const char* const Board::Options::ENCSEED				= "encryption.seed";;
 const char* const Board::Options::ENCKEY				= "encryption.key";
 
+// the number of getForumList() requests in flight while crawling a board,
+// can be overridden with the board's "crawlConcurrency" option
+constexpr std::uint32_t DEFAULT_CRAWL_CONCURRENCY = 4;
+
+// the number of unread threads in a thread list whose first unread page is
+// fetched ahead. Off unless the board's "prefetchUnreadThreads" option is set,
+// since Tapatalk's get_thread_by_unread and most HTML boards mark a thread
+// read on the server when that page is requested, even if the user never
+// opens the thread
+constexpr std::uint32_t DEFAULT_PREFETCH_UNREAD_THREADS = 0;
+
 Board::Board(const QString& url)
     : _url(url),
     _bEnabled(true),
@@ -70,6 +86,10 @@ void Board::setParser(ParserBasePtr parser)
 
 	if (_parser != nullptr)
 	{
+        // pages fetched by the old parser aren't trusted
+        cancelPrefetches();
+        _postPageCache.clear();
+
 		// tell the old parser object to stop sending us signals
 		_parser->disconnect(this);
 
@@ -223,6 +243,13 @@ void Board::requestThreadList(ForumPtr forum, int options)
 	this->setCurrentForum(forum);
     int iPerPage = this->getOptions()->get<std::int32_t>("threadsPerPage");
     forum->setPerPage(iPerPage);
+
+    cancelPrefetches();
+
+    if (!(options & ParserEnums::REQUEST_NOCACHE))
+    {
+        showStoredThreads(forum);
+    }
     
 	getParser()->getThreadListAsync(forum, options);
 }
@@ -238,17 +265,28 @@ void Board::requestPostList(ThreadPtr thread, int options, bool bForceGoto/*=fal
     int iPerPage = this->getOptions()->get<std::int32_t>("postsPerPage");
     thread->setPerPage(iPerPage);
 
-	if (!bForceGoto)
-	{
-        const auto viewOption =
-            static_cast<ParserBase::PostListOptions>(SettingsObject().read("view.threads.action").toInt());
+    const auto listOption = bForceGoto
+        ? ParserBase::PostListOptions::FIRST_POST
+        : static_cast<ParserBase::PostListOptions>(SettingsObject().read("view.threads.action").toInt());
 
-		getParser()->getPostsAsync(thread, viewOption, options);
-	}
-	else
-	{
-		getParser()->getPostsAsync(thread, ParserBase::PostListOptions::FIRST_POST, options);
-	}
+    // the user has moved on, whatever was being fetched ahead is no longer wanted
+    cancelPrefetches();
+
+    if (options & ParserEnums::REQUEST_NOCACHE)
+    {
+        _postPageCache.removeThread(thread->getId());
+    }
+    else if (showCachedPage(thread, listOption))
+    {
+        return;
+    }
+    else if (listOption == ParserBase::PostListOptions::FIRST_POST)
+    {
+        // the server picks the page of the other options
+        showStoredPosts(thread);
+    }
+
+	getParser()->getPostsAsync(thread, listOption, options);
 }
 
 void Board::markForumRead(ForumPtr forum)
@@ -308,6 +346,11 @@ void Board::getThreadListEvent(ForumPtr forum)
         auto sharedFromThis = shared_from_this();
 		ForumPtr current = this->getCurrentForum();
 
+        if (_contentStore)
+        {
+            _contentStore->storeThreads(getDBId(), forum);
+        }
+
 		if (current->getId() == forum->getId())
 		{
             // since the parser has no concept of a Board,
@@ -318,6 +361,8 @@ void Board::getThreadListEvent(ForumPtr forum)
             }
             
             Q_EMIT onGetThreads(sharedFromThis, forum);
+
+            prefetchUnreadThreads(forum);
 		}
         else
         {
@@ -337,6 +382,11 @@ void Board::getPostsEvent(ThreadPtr thread)
 	{
 		ThreadPtr current = this->getCurrentThread();
 
+        if (_contentStore)
+        {
+            _contentStore->storePosts(getDBId(), thread);
+        }
+
 		if (current->getId() == thread->getId())
 		{
 			auto sharedFromThis = shared_from_this();
@@ -350,6 +400,12 @@ void Board::getPostsEvent(ThreadPtr thread)
 			}
 
 			Q_EMIT onGetPosts(shared_from_this(), thread);
+
+            // the next page is the one most likely to be read next
+            if (thread->getPageNumber() < thread->getPageCount())
+            {
+                prefetchPostPage(thread, ParserBase::PostListOptions::FIRST_POST, thread->getPageNumber() + 1);
+            }
 		}
 	}
     else
@@ -363,82 +419,404 @@ void Board::markForumReadEvent(ForumPtr f)
     Q_EMIT onMarkedForumRead(shared_from_this(), f);
 }
 
-void Board::crawlSubForum(ForumPtr parent, ForumIdList* dupList /*= nullptr*/, bool bThrow /*= true*/)
+bool Board::prefetchEnabled() const
 {
-	Q_ASSERT(!parent->getId().isEmpty());
+    return !_options->has("prefetchPages") || _options->getBool("prefetchPages");
+}
 
-	ForumList forums = _parser->getForumList(parent->getId());
-	parent->getForums().clear();
+void Board::prefetchPostPage(ThreadPtr thread, ParserBase::PostListOptions listOption, int pageNumber)
+{
+    if (!prefetchEnabled() || !getParser())
+    {
+        return;
+    }
 
-    for (ForumPtr& forum : forums)
-	{
-		forum->setBoard(shared_from_this());
-		parent->addChild(forum);
-		parent->getForums().push_back(forum);
+    const int perPage = getOptions()->get<std::int32_t>("postsPerPage");
+    const QString key = PostPageCache::makeKey(thread->getId(), listOption, pageNumber, perPage);
 
-        if (dupList != nullptr
-			&& !dupList->contains(forum->getId())
-			&& forum->getForumType() != owl::Forum::LINK)
-		{
-            // _logger->debug("Crawling Sub Forum '{}' ({})",
-            //     forum->getName().toStdString(), forum->getId().toStdString());
+    if (_prefetches.contains(key) || _postPageCache.contains(key))
+    {
+        return;
+    }
 
-			dupList->push_back(forum->getId());
-			crawlSubForum(forum, dupList, bThrow);
-		}
-	}
+    // the parser fills in a copy so the thread on display isn't touched
+    auto page = std::make_shared<Thread>(thread->getId());
+    page->setTitle(thread->getTitle());
+    page->setParent(thread->getParent());
+    page->setPageNumber(pageNumber);
+    page->setPageCount(thread->getPageCount());
+    page->setPerPage(perPage);
+
+    _logger->trace("Prefetching page {} of thread '{}'", pageNumber, thread->getId().toStdString());
+
+    auto watcher = new QFutureWatcher<QVariant>(this);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this,
+        [this, watcher, key]()
+        {
+            watcher->deleteLater();
+
+            if (_prefetches.value(key) == watcher)
+            {
+                _prefetches.remove(key);
+            }
+
+            // a failed request is reported as canceled too
+            const auto future = watcher->future();
+            if (!future.isCanceled() && future.resultCount() > 0)
+            {
+                _postPageCache.insert(key, future.result().value<ThreadPtr>());
+            }
+        });
+
+    _prefetches.insert(key, watcher);
+    watcher->setFuture(getParser()->prefetchPostsAsync(page, listOption));
 }
 
-void Board::crawlRoot(bool bThrow /*= true*/)
+void Board::prefetchUnreadThreads(ForumPtr forum)
 {
-	ForumIdList dupList;
+    std::uint32_t remaining = DEFAULT_PREFETCH_UNREAD_THREADS;
+    if (_options->has("prefetchUnreadThreads"))
+    {
+        remaining = _options->get<std::uint32_t>("prefetchUnreadThreads", false);
+    }
+
+    // the same page that opening the thread would request
+    const auto listOption =
+        static_cast<ParserBase::PostListOptions>(SettingsObject().read("view.threads.action").toInt());
+
+    for (const auto& thread : forum->getThreads())
+    {
+        if (remaining == 0)
+        {
+            break;
+        }
+
+        if (thread->hasUnread())
+        {
+            prefetchPostPage(thread, listOption, thread->getPageNumber());
+            remaining--;
+        }
+    }
+}
+
+void Board::cancelPrefetches()
+{
+    if (_prefetches.isEmpty())
+    {
+        return;
+    }
+
+    // the watchers clean up after themselves once their future is canceled
+    _prefetches.clear();
+
+    if (getParser())
+    {
+        getParser()->cancelPrefetches();
+    }
+}
+
+bool Board::showCachedPage(ThreadPtr thread, ParserBase::PostListOptions listOption)
+{
+    const QString key = PostPageCache::makeKey(
+        thread->getId(), listOption, thread->getPageNumber(), thread->getPerPage());
+
+    const ThreadPtr page = _postPageCache.take(key);
+    if (!page)
+    {
+        return false;
+    }
+
+    _logger->debug("Showing prefetched page {} of thread '{}'", page->getPageNumber(), thread->getId().toStdString());
 
+    // delivered like a reply from the parser so listeners see the usual order of events
+    QMetaObject::invokeMethod(this, [this, thread, page]()
+        {
+            thread->setPageNumber(page->getPageNumber());
+            thread->setPageCount(page->getPageCount());
+            thread->setFirstUnreadPost(page->getFirstUnread().lock());
+
+            auto& posts = thread->getPosts();
+            posts = page->getPosts();
+            for (const auto& post : posts)
+            {
+                post->setParent(thread);
+            }
+
+            getPostsEvent(thread);
+        }, Qt::QueuedConnection);
+
+    return true;
+}
+
+bool Board::instantDisplayEnabled() const
+{
+    return _contentStore
+        && (!_options->has("instantDisplay") || _options->getBool("instantDisplay"));
+}
+
+void Board::showStoredThreads(ForumPtr forum)
+{
+    if (!instantDisplayEnabled())
+    {
+        return;
+    }
+
+    const ThreadList threads = _contentStore->loadThreads(getDBId(), forum);
+    if (threads.isEmpty())
+    {
+        return;
+    }
+
+    // a stand-in for the forum since the parser is about to refill the real one
+    auto stored = std::make_shared<Forum>(forum->getId(), forum->getName(), forum->getForumType());
+    stored->setBoard(shared_from_this());
+    stored->setParent(forum->getParent());
+    stored->setPageNumber(forum->getPageNumber());
+    stored->setPageCount(forum->getPageCount());
+    stored->setPerPage(forum->getPerPage());
+
+    for (const auto& thread : threads)
+    {
+        thread->setBoard(shared_from_this());
+        thread->setParent(stored);
+        stored->getThreads().push_back(thread);
+    }
+
+    _storedForum = stored;
+    _logger->debug("Showing {} stored thread(s) of forum '{}'", threads.size(), forum->getId().toStdString());
+
+    // the reply from the network follows and replaces it
+    QMetaObject::invokeMethod(this, [this, stored]()
+        {
+            if (const auto current = getCurrentForum(); current && current->getId() == stored->getId())
+            {
+                Q_EMIT onGetThreads(shared_from_this(), stored);
+            }
+        }, Qt::QueuedConnection);
+}
+
+void Board::showStoredPosts(ThreadPtr thread)
+{
+    if (!instantDisplayEnabled())
+    {
+        return;
+    }
+
+    const PostList posts = _contentStore->loadPosts(getDBId(), thread);
+    if (posts.empty())
+    {
+        return;
+    }
+
+    // a stand-in for the thread since the parser is about to refill the real one
+    auto stored = std::make_shared<Thread>(thread->getId());
+    stored->setTitle(thread->getTitle());
+    stored->setBoard(shared_from_this());
+    stored->setParent(thread->getParent());
+    stored->setPageNumber(thread->getPageNumber());
+    stored->setPageCount(thread->getPageCount());
+    stored->setPerPage(thread->getPerPage());
+
+    for (const auto& post : posts)
+    {
+        post->setBoard(shared_from_this());
+        post->setParent(stored);
+        stored->getPosts().push_back(post);
+    }
+
+    _storedThread = stored;
+    _logger->debug("Showing {} stored post(s) of thread '{}'", posts.size(), thread->getId().toStdString());
+
+    QMetaObject::invokeMethod(this, [this, stored]()
+        {
+            if (const auto current = getCurrentThread(); current && current->getId() == stored->getId())
+            {
+                Q_EMIT onGetPosts(shared_from_this(), stored);
+            }
+        }, Qt::QueuedConnection);
+}
+
+std::vector<ParserBasePtr> Board::crawlParsers() const
+{
+    std::uint32_t concurrency = DEFAULT_CRAWL_CONCURRENCY;
+    if (_options->has("crawlConcurrency"))
+    {
+        concurrency = std::max<std::uint32_t>(_options->get<std::uint32_t>("crawlConcurrency", false), 1);
+    }
+
+    std::vector<ParserBasePtr> parsers { _parser };
+
+    try
+    {
+        // clones share the session (cookies, login) of the board's parser
+        while (parsers.size() < concurrency)
+        {
+            parsers.push_back(_parser->clone());
+        }
+    }
+    catch (const owl::Exception& e)
+    {
+        _logger->debug("Parser '{}' could not be cloned, crawling with {} connection(s): {}",
+            _parser->getName().toStdString(), parsers.size(), e.message().toStdString());
+    }
+
+    return parsers;
+}
+
+void Board::crawlTree(ForumPtr root, bool bThrow)
+{
+    Q_ASSERT(!root->getId().isEmpty());
+
+    QElapsedTimer crawlTimer;
+    crawlTimer.start();
+
+    const BoardPtr self = shared_from_this();
+    ForumIdSet visited;
+    ForumList frontier;
+
+    ForumList list = _parser->getForumList(root->getId());
+    for (ForumPtr& forum : list)
+    {
+        root->getForums().push_back(forum);
+        root->addChild(forum);
+        forum->setBoard(self);
+
+        // even if this is a Forum::LINK, add it to the visited set
+        // to be double sure we don't crawl it
+        if (!visited.contains(forum->getId()))
+        {
+            visited.insert(forum->getId());
+
+            if (forum->getForumType() != owl::Forum::LINK)
+            {
+                frontier.push_back(forum);
+            }
+        }
+    }
+
+    std::vector<ParserBasePtr> parsers { _parser };
+    if (frontier.size() > 1)
+    {
+        parsers = crawlParsers();
+    }
+
+    std::atomic<int> crawled { 0 };
+    int discovered = frontier.size();
+    int level = 1;
+
+    while (!frontier.isEmpty())
+    {
+        QElapsedTimer levelTimer;
+        levelTimer.start();
+
+        const auto count = static_cast<std::size_t>(frontier.size());
+        std::vector<ForumList> results(count);
+        std::vector<std::exception_ptr> errors(count);
+        std::atomic<std::size_t> next { 0 };
+
+        auto worker = [&](ParserBasePtr parser)
+        {
+            for (std::size_t idx = next++; idx < count; idx = next++)
+            {
+                try
+                {
+                    results[idx] = parser->getForumList(frontier.at(static_cast<int>(idx))->getId());
+                }
+                catch (...)
+                {
+                    errors[idx] = std::current_exception();
+                }
+
+                Q_EMIT onCrawlProgress(self, ++crawled, discovered);
+            }
+        };
+
+        // the calling thread does its share with the board's own parser
+        const std::size_t workers = std::min(parsers.size(), count);
+        QList<QFuture<void>> futures;
+        for (std::size_t w = 1; w < workers; ++w)
+        {
+            futures.push_back(QtConcurrent::run(worker, parsers.at(w)));
+        }
+
+        worker(parsers.front());
+
+        for (auto& future : futures)
+        {
+            future.waitForFinished();
+        }
+
+        ForumList nextFrontier;
+        for (std::size_t idx = 0; idx < count; ++idx)
+        {
+            ForumPtr parent = frontier.at(static_cast<int>(idx));
+
+            if (errors[idx])
+            {
+                if (bThrow)
+                {
+                    std::rethrow_exception(errors[idx]);
+                }
+
+                try
+                {
+                    std::rethrow_exception(errors[idx]);
+                }
+                catch (const owl::Exception& e)
+                {
+                    _logger->warn("Parser error:'{}'", e.message().toStdString());
+                }
+                catch (const std::exception& e)
+                {
+                    _logger->warn("Parser error:'{}'", e.what());
+                }
+
+                continue;
+            }
+
+            parent->getForums().clear();
+
+            for (ForumPtr& forum : results[idx])
+            {
+                forum->setBoard(self);
+                parent->addChild(forum);
+                parent->getForums().push_back(forum);
+
+                if (forum->getForumType() != owl::Forum::LINK
+                    && !visited.contains(forum->getId()))
+                {
+                    visited.insert(forum->getId());
+                    nextFrontier.push_back(forum);
+                }
+            }
+        }
+
+        _logger->debug("Crawled level {} of '{}': expanded {} forum(s) with {} connection(s), found {} new in {} ms",
+            level, _url.toStdString(), count, workers, nextFrontier.size(), levelTimer.elapsed());
+
+        discovered += nextFrontier.size();
+        frontier = std::move(nextFrontier);
+        level++;
+    }
+
+    _logger->info("Crawled {} forum(s) of '{}' in {} level(s), took {} ms",
+        visited.size(), _url.toStdString(), level - 1, crawlTimer.elapsed());
+}
+
+void Board::crawlRoot(bool bThrow /*= true*/)
+{
 	_root.reset(); // release the root
 	_forumHash.clear();
 
 	try
 	{
 		_root = Forum::createRootForum(_parser->getRootForumId());
-		ForumList list = _parser->getForumList(_root->getId());
-
-		for(ForumPtr& forum : list)
-		{
-			try
-			{
-				_root->getForums().push_back(forum);
-				_root->addChild(forum);
-				forum->setBoard(shared_from_this());
-
-				_forumHash.insert(forum->getId(), forum);
-
-				if (forum->getForumType() != owl::Forum::LINK)
-				{
-                    _logger->debug("Crawling Root Forum: {} ({})",
-                        forum->getName().toStdString(), forum->getId().toStdString());
-
-					crawlSubForum(forum, &dupList, bThrow);
-				}
-
-				// even if the this is a Forum::LINK, add it to the duplicate list
-				// to be doule sure we don't crawl it
-				if (!dupList.contains(forum->getId()))
-				{
-					dupList.push_back(forum->getId());
-				}
-			}
-			catch (const owl::Exception& e)
-			{
-				if (bThrow)
-				{
-					throw;
-				}
-				else
-				{
-                    _logger->warn("Parser error:'{}'", e.message().toStdString());
-				}
-			}
-		}
+        crawlTree(_root, bThrow);
 
+        for (const ForumPtr& forum : _root->getForums())
+        {
+            _forumHash.insert(forum->getId(), forum);
+        }
 	}
 	catch (const owl::Exception& e)
 	{
@@ -455,50 +833,13 @@ void Board::crawlRoot(bool bThrow /*= true*/)
 
 ForumPtr Board::getRootStructure(bool bThrow /* = true */)
 {
-    ForumIdList dupList;
     ForumPtr root = Forum::createRootForum();
 
     if (!_parser) return root;
 
 	try
 	{
-        ForumList list = _parser->getForumList(root->getId());
-        for (ForumPtr& forum : list)
-		{
-			try
-			{
-				root->getForums().push_back(forum);
-				root->addChild(forum);
-				forum->setBoard(shared_from_this());
-                
-				if (forum->getForumType() != owl::Forum::LINK)
-				{
-                    _logger->debug("Crawling Root Forum: {} ({})",
-                        forum->getName().toStdString(), forum->getId().toStdString());
-
-					crawlSubForum(forum, &dupList, bThrow);
-				}
-                
-				// even if the this is a Forum::LINK, add it to the duplicate list
-				// to be doule sure we don't crawl it
-				if (!dupList.contains(forum->getId()))
-				{
-					dupList.push_back(forum->getId());
-				}
-			}
-			catch (const owl::Exception& e)
-			{
-				if (bThrow)
-				{
-					throw;
-				}
-				else
-				{
-                    _logger->warn("Parser error:'{}'", e.message().toStdString());
-				}
-			}
-		}
-        
+        crawlTree(root, bThrow);
 	}
 	catch (const owl::Exception& e)
 	{
@@ -521,10 +862,18 @@ void Board::updateUnread()
 	try
 	{
 		updateForumHash();
+        _parser->setForumTree(_root);
+
 		ForumList list = _parser->getUnreadForums();
         _hasUnread = list.size() > 0;
         Q_EMIT onGetUnreadForums(shared_from_this(), list);
 	}
+    catch (const owl::WebException& e)
+    {
+        // let the caller know so it can back off
+        _logger->error("WebException '{}'", e.message().toStdString());
+        throw;
+    }
 	catch (const owl::Exception& e)
 	{
         _logger->error("Exception '{}'", e.message().toStdString());
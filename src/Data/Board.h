@@ -9,6 +9,7 @@
 #include <QSqlQuery>
 #include <Parsers/ParserBase.h>
 #include <Parsers/Forum.h>
+#include <Parsers/PostPageCache.h>
 
 namespace spdlog
 {
@@ -20,6 +21,9 @@ namespace owl
 
 class BoardItemDoc;
 typedef std::shared_ptr<BoardItemDoc> BoardItemDocPtr;
+
+class ContentStore;
+using ContentStorePtr = std::shared_ptr<ContentStore>;
 typedef QHash<QString, ForumPtr> ForumHash;
 
 enum class BoardStatus
@@ -77,7 +81,7 @@ public:
 
 	void crawlRoot(bool bThrow = true);	 // create forum structure
     ForumPtr getRootStructure(bool bThrow = true);
-	void updateUnread(); // crawls the exists tree updating the forum's unread
+	void updateUnread(); // crawls the exists tree updating the forum's unread, rethrows WebException
 
     void requestThreadList(ForumPtr forum);
 	void requestThreadList(ForumPtr forum, int options);
@@ -134,6 +138,12 @@ public:
 	void setParser(ParserBasePtr parser);
 	ParserBasePtr getParser() const { return _parser; }
 
+    // Thread lists and post pages received by the board are written to the
+    // store, and with the "instantDisplay" option on (the default) the stored
+    // copy is shown while they are requested again
+    void setContentStore(ContentStorePtr store) { _contentStore = store; }
+    ContentStorePtr getContentStore() const { return _contentStore; }
+
     void setProtocolName(const QString& var) { _protocolName = var; }
     QString getProtocolName() const { return _protocolName; }
 
@@ -158,6 +168,16 @@ public:
 	QString getFavIcon() const { return _iconBuffer; }
 	QIcon convertIcon();
 
+    // the favicon decoded by BoardManager::loadBoards(), null until the
+    // board is loaded or if it was never loaded by the manager
+    void setIconImage(const QImage& image) { _iconImage = image; }
+    QImage getIconImage() const { return _iconImage; }
+
+    // false while BoardManager::loadBoards() is still loading the board's
+    // forums, icon and parser in the background
+    void setLoaded(bool loaded) { _loaded = loaded; }
+    bool isLoaded() const { return _loaded; }
+
     const BoardItemDocPtr getBoardItemDocument();
     
     void setBoardItemDocument(BoardItemDocPtr doc);
@@ -195,6 +215,10 @@ Q_SIGNALS:
     void onMarkedForumRead(BoardPtr, ForumPtr);
     void onRequestError(const Exception&);
 
+    // emitted from the crawl's worker threads as each forum is expanded,
+    // `discovered` grows as deeper levels of the tree are found
+    void onCrawlProgress(BoardPtr, int crawled, int discovered);
+
 public Q_SLOTS:
     void newThreadEvent(ThreadPtr thread);
     void newPostEvent(PostPtr);
@@ -209,9 +233,27 @@ private Q_SLOTS:
     void markForumReadEvent(ForumPtr);
 
 private:
-    void crawlSubForum(ForumPtr parent, ForumIdList* dupList = nullptr, bool bThrow = true);
+    // breadth-first crawl of the forum tree below `root`, each level is
+    // expanded with up to "crawlConcurrency" parsers (clones of _parser)
+    void crawlTree(ForumPtr root, bool bThrow);
+    std::vector<ParserBasePtr> crawlParsers() const;
 	void doUpdateHash(ForumPtr parent);
 
+    // pages the user is likely to read next are fetched at a low priority
+    // into _postPageCache, anything still in flight is dropped as soon as
+    // the user navigates somewhere else. Fetching a page can mark it read on
+    // the server, so only the next page of the thread being read is fetched
+    // by default, the unread threads of a forum are opt-in
+    bool prefetchEnabled() const;
+    void prefetchPostPage(ThreadPtr thread, ParserBase::PostListOptions listOption, int pageNumber);
+    void prefetchUnreadThreads(ForumPtr forum);
+    void cancelPrefetches();
+    bool showCachedPage(ThreadPtr thread, ParserBase::PostListOptions listOption);
+
+    bool instantDisplayEnabled() const;
+    void showStoredThreads(ForumPtr forum);
+    void showStoredPosts(ThreadPtr thread);
+
 	uint			_boardId;
     std::string     _uuid;
 
@@ -248,9 +290,22 @@ private:
 	QDateTime		_lastUpdate;
     int             _lastForumId = -1;
 
+    QImage          _iconImage;
+    bool            _loaded = true;
+
 	QMutex			_hashMutex;
     QMutex          _itemDocMutex;
 
+    PostPageCache                               _postPageCache;
+
+    ContentStorePtr _contentStore;
+
+    // the stand-ins shown by instant display, the views only hold weak
+    // references to what they show
+    ForumPtr        _storedForum;
+    ThreadPtr       _storedThread;
+    QHash<QString, QFutureWatcher<QVariant>*>   _prefetches;    // by page key
+
     std::shared_ptr<spdlog::logger>  _logger;
 };
     
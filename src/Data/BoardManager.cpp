@@ -1,13 +1,17 @@
 // Owl - www.owlclient.com
 // Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
 
+#include <stack>
+
 #include <QFile>
+#include <QtConcurrent>
 #include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QUuid>
 
+#include <Parsers/ParserManager.h>
 #include <Utils/OwlLogger.h>
 
 #include "BoardManager.h"
@@ -20,7 +24,10 @@ BoardManager::BoardManager()
     : _mutex(QMutex::Recursive),
     _logger(owl::initializeLogger("BoardManager"))
 
-{}	
+{
+    _loaders.setMaxThreadCount(std::min(QThread::idealThreadCount(), BOARD_LOADER_THREADS));
+    _loaders.setExpiryTimeout(-1);
+}
 
 std::size_t BoardManager::getBoardCount() const
 {
@@ -36,7 +43,19 @@ QSqlDatabase BoardManager::getDatabase(bool doOpen) const
     const QString thread_address = QLatin1String("0x") 
         + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()), 16);
 
-    QSqlDatabase db = QSqlDatabase::database(thread_address);
+    QSqlDatabase db = QSqlDatabase::database(thread_address, false);
+    if (db.isValid() && db.databaseName() != QString::fromStdString(_databaseFilename))
+    {
+        // initializeDatabase() was given another file since this connection was made
+        db.close();
+        db.setDatabaseName(QString::fromStdString(_databaseFilename));
+    }
+
+    if (db.isValid() && !db.isOpen())
+    {
+        db.open();
+    }
+
     if (!db.isOpen() || !db.isValid())
     {
         if (_databaseFilename.empty())
@@ -154,7 +173,10 @@ void BoardManager::loadBoards(bool resetdb)
             }
 
 			loadBoardOptions(b);
-			retrieveBoardForums(b);
+            b->setContentStore(_contentStore);
+
+            // the rest of the board is loaded in the background
+            b->setLoaded(false);
 
 			_boardList.push_back(b);
 
@@ -165,9 +187,112 @@ void BoardManager::loadBoards(bool resetdb)
         std::sort(_boardList.begin(), _boardList.end(), &BoardManager::boardDisplayOrderLessThan);
 	}
 
+    _loading.erase(std::remove_if(_loading.begin(), _loading.end(),
+        [](const QFuture<void>& future) { return future.isFinished(); }), _loading.end());
+
+    for (const BoardPtr& b : _boardList)
+    {
+        if (!b->isLoaded())
+        {
+            _loading.push_back(QtConcurrent::run(&_loaders, [this, b]() { loadBoard(b); }));
+        }
+    }
+
     _logger->info("{} board(s) loaded", getBoardCount());
 }
 
+void BoardManager::waitForBoards()
+{
+    QList<QFuture<void>> loading;
+
+    {
+        QMutexLocker locker(&_mutex);
+        loading.swap(_loading);
+    }
+
+    for (auto& future : loading)
+    {
+        future.waitForFinished();
+    }
+
+    applyLoadedBoards();
+}
+
+// runs on a loader thread with its own database connection, the board's
+// metadata and options have already been loaded by loadBoards()
+void BoardManager::loadBoard(BoardPtr b)
+{
+    LoadedBoard loaded { b, ForumPtr(), ParserBasePtr(), QImage() };
+
+    try
+    {
+        loaded.root = retrieveBoardForums(b);
+    }
+    catch (const owl::Exception& ex)
+    {
+        _logger->error("Could not load the forums of board '{}': {}",
+            b->getName().toStdString(), ex.message().toStdString());
+    }
+
+    loaded.icon = QImage::fromData(QByteArray::fromBase64(b->getFavIcon().toLatin1()));
+
+    if (b->isEnabled())
+    {
+        try
+        {
+            loaded.parser = ParserManager::instance()->createParser(b->getProtocolName(), b->getServiceUrl());
+            loaded.parser->setOptions(b->getOptions());
+
+            // the parser's requests are started from the GUI thread
+            loaded.parser->moveToThread(thread());
+        }
+        catch (const owl::Exception& ex)
+        {
+            // the GUI reports the error when it fails to create the parser itself
+            _logger->warn("Failed to create parser of type '{}' for board '{}': {}",
+                b->getProtocolName().toStdString(), b->getName().toStdString(), ex.message().toStdString());
+
+            loaded.parser.reset();
+        }
+    }
+
+    {
+        QMutexLocker locker(&_loadedMutex);
+        _loadedBoards.push_back(loaded);
+    }
+
+    QMetaObject::invokeMethod(this, [this]() { applyLoadedBoards(); }, Qt::QueuedConnection);
+}
+
+// must be called on the GUI thread
+void BoardManager::applyLoadedBoards()
+{
+    QList<LoadedBoard> loadedBoards;
+
+    {
+        QMutexLocker locker(&_loadedMutex);
+        loadedBoards.swap(_loadedBoards);
+    }
+
+    for (const auto& loaded : loadedBoards)
+    {
+        if (loaded.root)
+        {
+            loaded.board->setRoot(loaded.root);
+        }
+
+        loaded.board->setIconImage(loaded.icon);
+
+        if (loaded.parser)
+        {
+            loaded.board->setParser(loaded.parser);
+        }
+
+        loaded.board->setLoaded(true);
+        Q_EMIT onBoardLoaded(loaded.board);
+    }
+}
+
 QSqlDatabase BoardManager::initializeDatabase(const QString& filename)
 {
     if (filename.isEmpty()) return QSqlDatabase{};
@@ -223,7 +348,46 @@ QSqlDatabase BoardManager::initializeDatabase(const QString& filename)
 
     }
 
-    return getDatabase(true);
+    QSqlDatabase db = getDatabase(true);
+
+    // with a write-ahead log a commit doesn't rewrite the database file and
+    // the readers don't wait for the writer. The mode is stored in the file
+    if (QSqlQuery query(db); !query.exec(QStringLiteral("PRAGMA journal_mode=WAL")))
+    {
+        _logger->warn("Could not enable the write-ahead log of '{}': {}",
+            _databaseFilename, query.lastError().text().toStdString());
+    }
+
+    upgradeDatabase(db);
+
+    _contentStore = std::make_shared<ContentStore>(filename);
+
+    return db;
+}
+
+// creates the tables that a database made by an older version of Owl is missing
+void BoardManager::upgradeDatabase(QSqlDatabase& db)
+{
+    QString sqlStatements = QString::fromLatin1(owl::upgradeDatabaseSQLString);
+    for (const QString& statement : sqlStatements.split(';'))
+    {
+        if (!statement.trimmed().isEmpty())
+        {
+            QSqlQuery query(db);
+
+            if (!query.exec(statement.trimmed()))
+            {
+                const QString msg = QString::fromStdString(fmt::format(
+                    "There was a problem upgrading the database at {}: {}",
+                    _databaseFilename, query.lastError().text().toStdString()));
+
+                _logger->error(msg.toStdString());
+                _logger->error("Query failed: '{}'", statement.toStdString());
+
+                OWL_THROW_EXCEPTION(owl::Exception(msg));
+            }
+        }
+    }
 }
 
 owl::BoardPtr BoardManager::getBoardInfo(int boardId)
@@ -294,7 +458,7 @@ owl::BoardPtr BoardManager::getBoardInfo(int boardId)
             }
 
             loadBoardOptions(b);
-            retrieveBoardForums(b);
+            b->setRoot(retrieveBoardForums(b));
 
             _logger->debug("Getting board info of [{}]'{}', last updated '{}'",
                 b->getDBId(), b->getName().toStdString(), b->getLastUpdate().toString().toStdString());
@@ -352,68 +516,102 @@ void BoardManager::sort()
     std::sort(_boardList.begin(), _boardList.end(), &BoardManager::boardDisplayOrderLessThan);
 }
     
-void BoardManager::createForumVars(ForumPtr forum)
+// saves the board's forum tree in a single transaction, parents before their children
+void BoardManager::createForumEntries(BoardPtr board)
 {
-	QSqlDatabase	db = getDatabase();
-	QSqlQuery		query(db);
+    QSqlDatabase    db = getDatabase();
+    const QString   rootId = board->getOptions()->getText("rootId");
 
-	query.prepare("INSERT INTO forumvars "
-		"(forumsid, name, value) "
-		"VALUES (:forumsid, :name, :value)");	
+    QSqlQuery forumQuery(db);
+    forumQuery.prepare("INSERT INTO forums "
+        "(boardId, forumId, parentId, forumName, forumType, forumOrder) "
+        "VALUES (:boardId, :forumId, :parentId, :forumName, :forumType, :forumOrder)");
 
-	query.bindValue(":forumsid", forum->getDBId());
+    QSqlQuery varsQuery(db);
+    varsQuery.prepare("INSERT INTO forumvars "
+        "(forumsid, name, value) "
+        "VALUES (:forumsid, :name, :value)");
 
-    for (const auto& p : forum->getVars())
-	{
-        query.bindValue(":name", p.first);
-        query.bindValue(":value", p.second);
+    if (!db.transaction())
+    {
+        _logger->warn("createForumEntries() could not start a transaction: {}", db.lastError().text().toStdString());
+    }
 
-		if (!query.exec())
-		{
-            _logger->error("createForumVars() failed: {}", query.lastError().text().toStdString());
-            _logger->debug("executed query: {}", query.lastQuery().toStdString());
-		}
-	}
+    std::size_t count = 0;
+    bool ok = true;
+    std::stack<ForumPtr> pending;
 
-	db.commit();
-}
+    const auto pushChildren = [&pending](const ForumPtr& parent)
+    {
+        const auto& children = parent->getForums();
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+        {
+            pending.push(*it);
+        }
+    };
 
-void BoardManager::createForumEntries( ForumPtr forum, BoardPtr board )
-{
-	QSqlDatabase	db = getDatabase();
-	QSqlQuery		query(db);
+    pushChildren(board->getRoot());
 
-	query.prepare("INSERT INTO forums "
-		"(boardId, forumId, parentId, forumName, forumType, forumOrder) "
-		"VALUES (:boardId, :forumId, :parentId, :forumName, :forumType, :forumOrder)");	
+    // the first failed statement stops the save, the tree is either saved
+    // completely or not at all
+    while (ok && !pending.empty())
+    {
+        const ForumPtr forum = pending.top();
+        pending.pop();
 
-	query.bindValue(":boardId", board->getDBId());
-	query.bindValue(":forumId", forum->getId());
-	
-	QString rootId = board->getOptions()->getText("rootId");
-    query.bindValue(":parentId", forum->getParent() != nullptr ? forum->getParent()->getId() : rootId);
-	
-	query.bindValue(":forumName", forum->getName());
-	query.bindValue(":forumType", forum->getForumTypeString());
-	query.bindValue(":forumOrder", forum->getDisplayOrder());
+        forumQuery.bindValue(":boardId", board->getDBId());
+        forumQuery.bindValue(":forumId", forum->getId());
+        forumQuery.bindValue(":parentId", forum->getParent() != nullptr ? forum->getParent()->getId() : rootId);
+        forumQuery.bindValue(":forumName", forum->getName());
+        forumQuery.bindValue(":forumType", forum->getForumTypeString());
+        forumQuery.bindValue(":forumOrder", forum->getDisplayOrder());
 
-	if (query.exec())
-	{
-		db.commit();
-		forum->setDBId(query.lastInsertId().toInt());
+        if (!forumQuery.exec())
+        {
+            _logger->error("createForumEntries() failed: {}", forumQuery.lastError().text().toStdString());
+            _logger->debug("executed query: {}", forumQuery.lastQuery().toStdString());
+            ok = false;
+            break;
+        }
 
-		createForumVars(forum);
-	}
-	else
-	{
-        _logger->error("createForumEntries() failed: {}", query.lastError().text().toStdString());
-        _logger->debug("executed query: {}", query.lastQuery().toStdString());
-	}
+        forum->setDBId(forumQuery.lastInsertId().toInt());
+        count++;
 
-    for (ForumPtr f : forum->getForums())
-	{
-		createForumEntries(f, board);
-	}
+        for (const auto& p : forum->getVars())
+        {
+            varsQuery.bindValue(":forumsid", forum->getDBId());
+            varsQuery.bindValue(":name", p.first);
+            varsQuery.bindValue(":value", p.second);
+
+            if (!varsQuery.exec())
+            {
+                _logger->error("createForumEntries() failed to insert forum variables: {}", varsQuery.lastError().text().toStdString());
+                _logger->debug("executed query: {}", varsQuery.lastQuery().toStdString());
+                ok = false;
+                break;
+            }
+        }
+
+        pushChildren(forum);
+    }
+
+    forumQuery.finish();
+    varsQuery.finish();
+
+    if (!ok)
+    {
+        _logger->error("createForumEntries() did not save the forums of board '{}'", board->getName().toStdString());
+        db.rollback();
+    }
+    else if (db.commit())
+    {
+        _logger->debug("Saved {} forum(s) of board '{}'", count, board->getName().toStdString());
+    }
+    else
+    {
+        _logger->error("createForumEntries() could not commit: {}", db.lastError().text().toStdString());
+        db.rollback();
+    }
 }
 
 void BoardManager::createBoardOptions(BoardPtr board)
@@ -474,6 +672,7 @@ bool BoardManager::createBoard(BoardPtr board)
 	{
 		db.commit();
         board->setDBId(static_cast<std::uint32_t>(query.lastInsertId().toInt()));
+        board->setContentStore(_contentStore);
 		
         // TODO: we probably want to Q_EMIT the index of the new board in the
         // sorted list, but for now this works
@@ -498,93 +697,53 @@ bool BoardManager::createBoard(BoardPtr board)
 	if (bRet)
 	{
 		this->createBoardOptions(board);
-
-        for (ForumPtr forum : board->getRoot()->getForums())
-		{
-			createForumEntries(forum, board);
-		}
+        createForumEntries(board);
 	}
 
 	return bRet;
 }
 
-void BoardManager::retrieveSubForumVars(ForumPtr forum)
+// loads the board's forums and their variables with one query each and
+// links them into a tree by their parentId. Returns the tree's root
+ForumPtr BoardManager::retrieveBoardForums(BoardPtr b)
 {
-	QSqlDatabase	db = getDatabase();
+	bool			bRet(false);
+    QSqlDatabase	db = getDatabase();
 
 	if (!db.isOpen())
 	{
 		db.open();
 	}
 
-	QSqlQuery query(db);
-
-	query.prepare(
-		"SELECT * FROM forumvars "
-		"WHERE forumsid=:forumsid");
-
-	query.bindValue(":forumsid", forum->getDBId());
-
-	if (query.exec())
-	{
-		forum->getVars().clear();
-
-		QSqlRecord rec = query.record();
-
-		int name = rec.indexOf("name");
-		int value = rec.indexOf("value");
-
-		while (query.next())
-		{
-			forum->setVar(query.value(name).toString(), query.value(value).toString());
-		}
-	}
-}
-
-void BoardManager::retrieveSubForumList(BoardPtr board, ForumPtr forum, bool bDeep /*= false*/)
-{
-	ForumList		list; 
-    QSqlDatabase	db = getDatabase();
+	QString rootId = b->getOptions()->getText("rootId");
+	ForumPtr root = Forum::createRootForum(rootId);
 
-	if (!db.isOpen())
-	{
-		db.open();
-	}
+    // the forums in the order they're listed, and their parents' ids
+    std::vector<std::pair<ForumPtr, QString>> forums;
+    QHash<QString, ForumPtr> byForumId;
+    QHash<int, ForumPtr> byDBId;
 
 	QSqlQuery query(db);
-	
+    query.setForwardOnly(true);
+
 	query.prepare(
-		"SELECT * FROM forums "
+		"SELECT id, forumId, parentId, forumName, forumType, forumOrder FROM forums "
 		"WHERE boardId=:boardid "
-		"AND parentId=:parentid "
-		"ORDER BY forumOrder");
-	
-	query.bindValue(":boardid", board->getDBId());
-	query.bindValue(":parentid", forum->getId());
+		"ORDER BY forumOrder, id");
+
+	query.bindValue(":boardid", b->getDBId());
 
 	if (query.exec())
 	{
-		forum->getForums().clear();
-
-		QSqlRecord rec = query.record();
-
-		int id = rec.indexOf("id");
-		int forumId = rec.indexOf("forumId");
-		int forumName = rec.indexOf("forumName");
-		int forumType = rec.indexOf("forumType");
-		int forumOrder = rec.indexOf("forumOrder");
-
 		while (query.next())
 		{
-			ForumPtr newForum(new Forum(query.value(forumId).toString()));
-            newForum->setDBId(static_cast<std::int32_t>(query.value(id).toUInt()));
-			newForum->setName(query.value(forumName).toString());
-            newForum->setDisplayOrder(static_cast<std::int32_t>(query.value(forumOrder).toUInt()));
+			ForumPtr newForum(new Forum(query.value(1).toString()));
+            newForum->setDBId(static_cast<std::int32_t>(query.value(0).toUInt()));
+			newForum->setName(query.value(3).toString());
+            newForum->setDisplayOrder(static_cast<std::int32_t>(query.value(5).toUInt()));
+			newForum->setBoard(b);
 
-			forum->addChild(newForum);
-			newForum->setBoard(board);
-
-			QString typeStr(query.value(forumType).toString());
+			QString typeStr(query.value(4).toString());
 			if (typeStr == "FORUM")
 			{
 				newForum->setForumType(Forum::FORUM);
@@ -597,41 +756,64 @@ void BoardManager::retrieveSubForumList(BoardPtr board, ForumPtr forum, bool bDe
 			{
 				newForum->setForumType(Forum::LINK);
 			}
-			
-			forum->getForums().push_back(newForum);
+
+            forums.emplace_back(newForum, query.value(2).toString());
+            byForumId.insert(newForum->getId(), newForum);
+            byDBId.insert(newForum->getDBId(), newForum);
 		}
+
+        bRet = true;
 	}
 	else
 	{
-        _logger->error("retrieveSubForumList() failed: {}", query.lastError().text().toStdString());
+        _logger->error("retrieveBoardForums() failed: {}", query.lastError().text().toStdString());
         _logger->debug("executed query: {}", query.lastQuery().toStdString());
 	}
 
-    for (ForumPtr current : forum->getForums())
-	{
-		retrieveSubForumVars(current);
-	}
+    query.prepare(
+        "SELECT forumvars.forumsid, forumvars.name, forumvars.value FROM forumvars "
+        "INNER JOIN forums ON forums.id=forumvars.forumsid "
+        "WHERE forums.boardId=:boardid");
 
-	if (bDeep)
-	{
-        for (ForumPtr child : forum->getForums())
-		{
-			retrieveSubForumList(board, child, bDeep);
-		}
-	}
-}
+    query.bindValue(":boardid", b->getDBId());
 
-bool BoardManager::retrieveBoardForums(BoardPtr b)
-{
-	bool			bRet(false);
+    if (bRet && query.exec())
+    {
+        while (query.next())
+        {
+            if (ForumPtr forum = byDBId.value(query.value(0).toInt()); forum)
+            {
+                forum->setVar(query.value(1).toString(), query.value(2).toString());
+            }
+        }
+    }
+    else if (bRet)
+    {
+        _logger->error("retrieveBoardForums() failed to load forum variables: {}", query.lastError().text().toStdString());
+        _logger->debug("executed query: {}", query.lastQuery().toStdString());
+        bRet = false;
+    }
 
-	QString rootId = b->getOptions()->getText("rootId");
+    // a forum whose parent is gone is left out, as it can't be reached from the root
+    for (const auto& [forum, parentId] : forums)
+    {
+        ForumPtr parent = parentId == rootId ? root : byForumId.value(parentId);
+        if (!parent || parent == forum)
+        {
+            _logger->warn("Forum '{}' of board '{}' has no parent", forum->getId().toStdString(), b->getName().toStdString());
+            continue;
+        }
 
-	ForumPtr root = Forum::createRootForum(rootId);
-	retrieveSubForumList(b, root, true);
-	b->setRoot(root);
+        parent->addChild(forum);
+        parent->getForums().push_back(forum);
+    }
 
-	return bRet;
+    if (!bRet)
+    {
+        _logger->warn("The forums of board '{}' could not be loaded completely", b->getName().toStdString());
+    }
+
+	return root;
 }
 
 uint BoardManager::updateBoards()
@@ -752,6 +934,11 @@ bool BoardManager::deleteBoard(BoardPtr board)
             _logger->debug("executed query: {}", query.lastQuery().toStdString());
 		}
 
+        if (_contentStore)
+        {
+            _contentStore->removeBoard(board->getDBId());
+        }
+
         
         db.commit();
         
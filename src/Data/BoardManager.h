@@ -6,12 +6,16 @@
 #include <QString>
 #include <Utils/Exception.h>
 #include "Board.h"
+#include "ContentStore.h"
 
 #define MAX_BOARDS                  32
 #define DBPASSWORD_SEED             "OwlPasswordSeed"
 #define DBPASSWORD_KEY              "OwlPasswordKey"
 #define OWL_DATABASE_NAME           "OwlDB"
 
+// most boards loaded at the same time by loadBoards()
+constexpr int BOARD_LOADER_THREADS = 4;
+
 #define BOARDMANAGER                BoardManager::instance()
 
 namespace spdlog
@@ -46,9 +50,16 @@ public:
 	
     QSqlDatabase initializeDatabase(const QString& filename);
     
+    // Loads the boards' metadata and options, then their forum trees,
+    // icons and parsers on background threads. Each board is marked as
+    // loaded and onBoardLoaded() is emitted on the GUI thread once it's ready
     void loadBoards(bool resetdb);
     void reload();
 
+    // Blocks until the boards started by loadBoards() have been loaded, must
+    // be called on the GUI thread
+    void waitForBoards();
+
     std::size_t getBoardCount() const;
     const BoardList& getBoardList() const { return _boardList; }
 
@@ -67,6 +78,10 @@ public:
 
     BoardPtr boardByIndex(std::size_t index) const;
     BoardPtr boardByUUID(const std::string& uid) const;
+
+    // the local copy of the boards' threads and posts, valid once the
+    // database has been initialized
+    ContentStorePtr contentStore() const { return _contentStore; }
     
     // FORUM - CRUD
     bool deleteForumVars(const QString& forumId) const;
@@ -76,20 +91,31 @@ Q_SIGNALS:
     void onEndAddBoard();
     void onBeginRemoveBoard(int index);
     void onEndRemoveBoard();
+    void onBoardLoaded(BoardPtr board);
 
 
 private:
     BoardManager();
 
     QSqlDatabase getDatabase(bool doOpen = true) const;
+    void upgradeDatabase(QSqlDatabase& db);
 
 	void createBoardOptions(BoardPtr board);	
-	void createForumEntries(ForumPtr forum, BoardPtr board);
-	void createForumVars(ForumPtr forum);
+	void createForumEntries(BoardPtr board);
+
+	ForumPtr retrieveBoardForums(BoardPtr b);
 
-	void retrieveSubForumVars(ForumPtr forum);
-	void retrieveSubForumList(BoardPtr board, ForumPtr forum, bool bDeep = false);
-	bool retrieveBoardForums(BoardPtr b);
+    // the parts of a board loaded in the background by loadBoards()
+    struct LoadedBoard
+    {
+        BoardPtr        board;
+        ForumPtr        root;
+        ParserBasePtr   parser;
+        QImage          icon;
+    };
+
+    void loadBoard(BoardPtr b);
+    void applyLoadedBoards();
     
     void loadBoardOptions(const BoardPtr& b);
 
@@ -110,6 +136,15 @@ private:
 	QMutex _mutex;
     
     std::string                         _databaseFilename;
+    ContentStorePtr                     _contentStore;
+
+    // the loader threads are never retired, so their connections are reused
+    QThreadPool                         _loaders;
+    QList<QFuture<void>>                _loading;
+
+    QMutex                              _loadedMutex;
+    QList<LoadedBoard>                  _loadedBoards;
+
     std::shared_ptr<spdlog::logger>     _logger;
 };
 
@@ -71,4 +71,62 @@ COMMIT;
 
 )SQL";
 
+// Tables added after the first release of the schema. These are run each
+// time the database is opened so they must be safe to run more than once,
+// the same one-statement-per-semicolon rule applies.
+const char* upgradeDatabaseSQLString = R"SQL(
+
+BEGIN TRANSACTION;
+
+CREATE TABLE IF NOT EXISTS threads
+(
+	id INTEGER PRIMARY KEY,	-- PK for the row
+	boardId INTEGER,		-- FK to the boards.boardid
+	forumId TEXT,			-- forumId on the board
+	threadId TEXT,			-- threadId on the board
+	page INTEGER,			-- page of the forum's thread list
+	displayOrder INTEGER,	-- position in the page
+	title TEXT,
+	author TEXT,
+	previewText TEXT,
+	iconUrl TEXT,
+	replyCount INTEGER,
+	views INTEGER,
+	sticky INTEGER,
+	unread INTEGER,
+	lastAuthor TEXT,		-- author of the last post
+	lastPostTime TEXT,		-- ISO date of the last post
+	stored TEXT				-- last time the row was written
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS threads_thread ON threads (boardId, threadId);
+
+CREATE INDEX IF NOT EXISTS threads_page ON threads (boardId, forumId, page, displayOrder);
+
+CREATE TABLE IF NOT EXISTS posts
+(
+	id INTEGER PRIMARY KEY,	-- PK for the row
+	boardId INTEGER,		-- FK to the boards.boardid
+	threadId TEXT,			-- threadId on the board
+	postId TEXT,			-- postId on the board
+	postIndex INTEGER,		-- 1-based position of the post in the thread
+	author TEXT,
+	text TEXT,				-- the post's html
+	dateline TEXT,			-- raw timestamp parsed from the board
+	posted TEXT,			-- ISO date of the post, if it could be parsed
+	stored TEXT				-- last time the row was written
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS posts_post ON posts (boardId, postId);
+
+CREATE INDEX IF NOT EXISTS posts_thread ON posts (boardId, threadId, postIndex);
+
+CREATE INDEX IF NOT EXISTS forums_parent ON forums (boardId, parentId);
+
+CREATE INDEX IF NOT EXISTS forumvars_forum ON forumvars (forumsid);
+
+COMMIT;
+
+)SQL";
+
 }
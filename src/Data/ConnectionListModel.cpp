@@ -43,14 +43,32 @@ ConnectionPtr ConnectionFromJson(const QJsonObject& object)
 
 LegacyBoardConnection::LegacyBoardConnection(std::uint16_t displayOrder, BoardPtr board)
     : Connection{board->uuid(), displayOrder}, _board{board}
+{
+    updateIcon();
+    _roleData[owl::ConnectionRoles::DATA] = QVariant::fromValue(board);
+}
+
+void LegacyBoardConnection::updateIcon()
 {
     constexpr auto ICON_WIDTH = 128;
     constexpr auto ICON_HEIGHT = 128;
-    QByteArray buffer(board->getFavIcon().toLatin1());
-    QImage image = QImage::fromData(QByteArray::fromBase64(buffer));
+
+    // the icon is decoded by the BoardManager while it loads the board
+    if (!_board->isLoaded())
+    {
+        _roleData[Qt::DecorationRole] = QIcon(ZFontIcon::icon(Fa5::FAMILY, Fa5::fa_spinner));
+        return;
+    }
+
+    QImage image = _board->getIconImage();
+    if (image.isNull())
+    {
+        QByteArray buffer(_board->getFavIcon().toLatin1());
+        image = QImage::fromData(QByteArray::fromBase64(buffer));
+    }
+
     image = resizeImage(image, QSize(ICON_WIDTH, ICON_HEIGHT));
     _roleData[Qt::DecorationRole] = QIcon{ QPixmap::fromImage(image) };
-    _roleData[owl::ConnectionRoles::DATA] = QVariant::fromValue(board);
 }
 
 BrowserConnection::BrowserConnection(const std::string& uuid, std::uint16_t displayOrder)
@@ -84,7 +102,21 @@ NewConnectionButton::NewConnectionButton()
 ConnectionListModel::ConnectionListModel(QObject *parent)
     : QAbstractListModel(parent)
 {
-
+    QObject::connect(BOARDMANAGER.get(), &BoardManager::onBoardLoaded, this,
+        [this](BoardPtr board)
+        {
+            for (std::size_t row = 0; row < _connections.size(); row++)
+            {
+                auto connection = std::dynamic_pointer_cast<LegacyBoardConnection>(_connections[row]);
+                if (connection && connection->uuid() == board->uuid())
+                {
+                    connection->updateIcon();
+
+                    const auto idx = index(static_cast<int>(row), 0);
+                    Q_EMIT dataChanged(idx, idx, { Qt::DecorationRole });
+                }
+            }
+        });
 }
 
 bool ConnectionListModel::load(const QString& filename)
@@ -86,6 +86,9 @@ public:
 
     ConnectionType type() const override { return ConnectionType::LEGACY_BOARD; }
 
+    // shows a placeholder until the board has been loaded
+    void updateIcon();
+
 private:
     BoardPtr    _board;
 };
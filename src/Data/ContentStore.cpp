@@ -0,0 +1,667 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <QtConcurrent>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+#include <Parsers/BBCodeParser.h>
+#include <Utils/Exception.h>
+#include <Utils/OwlLogger.h>
+
+#include "ContentStore.h"
+
+namespace owl
+{
+
+// how long a connection waits for the other connections to release the database
+constexpr int CONTENT_STORE_BUSY_TIMEOUT = 5000;
+
+// number of words around the matched terms in a search result's snippet
+constexpr int SEARCH_SNIPPET_WORDS = 16;
+
+namespace
+{
+
+// the values of a thread or post copied on the caller's thread, the
+// objects themselves may be changed by a parser while the write is pending
+struct ThreadRow
+{
+    QString     threadId;
+    QString     title;
+    QString     author;
+    QString     previewText;
+    QString     iconUrl;
+    QString     lastAuthor;
+    QDateTime   lastPostTime;
+    int         replyCount = 0;
+    int         views = 0;
+    bool        sticky = false;
+    bool        unread = false;
+};
+
+struct PostRow
+{
+    QString     postId;
+    int         index = 0;
+    QString     author;
+    QString     text;
+    QString     dateline;
+    QDateTime   posted;
+};
+
+void execQuery(QSqlQuery& query)
+{
+    if (!query.exec())
+    {
+        OWL_THROW_EXCEPTION(Exception(QString("Query '%1' failed: %2")
+            .arg(query.lastQuery())
+            .arg(query.lastError().text())));
+    }
+}
+
+// the range of post indexes on the thread's current page
+std::pair<int, int> pageRange(const ThreadPtr& thread)
+{
+    const int first = ((thread->getPageNumber() - 1) * thread->getPerPage()) + 1;
+    return std::make_pair(first, first + thread->getPerPage() - 1);
+}
+
+// the rows of `postsearch` share the rowid of the post they index
+const char* insertSearchRowSQL = "INSERT INTO postsearch (rowid, text, author, title, boardId, posted) "
+    "VALUES (:rowid, :text, :author, :title, :boardId, :posted)";
+
+// `index` must be prepared with insertSearchRowSQL
+void insertSearchRow(QSqlQuery& index, const QVariant& rowid, std::uint32_t boardId,
+    const QString& text, const QString& author, const QString& title, const QString& posted)
+{
+    index.bindValue(":rowid", rowid);
+    index.bindValue(":text", text);
+    index.bindValue(":author", author);
+    index.bindValue(":title", title);
+    index.bindValue(":boardId", boardId);
+    index.bindValue(":posted", posted);
+    execQuery(index);
+}
+
+} // namespace
+
+ContentStore::ContentStore(const QString& filename)
+    : _filename(filename),
+      _plainText(std::make_unique<BBRegExParser>()),
+      _logger(owl::initializeLogger("ContentStore"))
+{
+    _writer.setMaxThreadCount(1);
+    _writer.setExpiryTimeout(-1);
+
+    initSearchIndex();
+}
+
+ContentStore::~ContentStore()
+{
+    flush();
+}
+
+void ContentStore::storeThreads(std::uint32_t boardId, ForumPtr forum)
+{
+    QList<ThreadRow> rows;
+    for (const auto& thread : forum->getThreads())
+    {
+        ThreadRow row;
+        row.threadId = thread->getId();
+        row.title = thread->getTitle();
+        row.author = thread->getAuthor();
+        row.previewText = thread->getPreviewText(0); // untruncated
+        row.iconUrl = thread->getIconUrl();
+        row.replyCount = static_cast<int>(thread->getReplyCount());
+        row.views = thread->getViews();
+        row.sticky = thread->isSticky();
+        row.unread = thread->hasUnread();
+
+        if (const auto lastPost = thread->getLastPost(); lastPost)
+        {
+            row.lastAuthor = lastPost->getAuthor();
+            row.lastPostTime = lastPost->getDateTime();
+        }
+
+        rows.push_back(row);
+    }
+
+    const QString forumId = forum->getId();
+    const int page = forum->getPageNumber();
+
+    enqueue([boardId, forumId, page, rows](QSqlDatabase& db)
+    {
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM threads WHERE boardId=:boardId AND forumId=:forumId AND page=:page");
+        query.bindValue(":boardId", boardId);
+        query.bindValue(":forumId", forumId);
+        query.bindValue(":page", page);
+        execQuery(query);
+
+        // a thread that moved to this page is replaced
+        query.prepare("INSERT OR REPLACE INTO threads "
+            "(boardId, forumId, threadId, page, displayOrder, title, author, previewText, iconUrl, "
+            "replyCount, views, sticky, unread, lastAuthor, lastPostTime, stored) "
+            "VALUES (:boardId, :forumId, :threadId, :page, :displayOrder, :title, :author, :previewText, :iconUrl, "
+            ":replyCount, :views, :sticky, :unread, :lastAuthor, :lastPostTime, :stored)");
+
+        const QString stored = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        int displayOrder = 0;
+
+        for (const auto& row : rows)
+        {
+            query.bindValue(":boardId", boardId);
+            query.bindValue(":forumId", forumId);
+            query.bindValue(":threadId", row.threadId);
+            query.bindValue(":page", page);
+            query.bindValue(":displayOrder", displayOrder++);
+            query.bindValue(":title", row.title);
+            query.bindValue(":author", row.author);
+            query.bindValue(":previewText", row.previewText);
+            query.bindValue(":iconUrl", row.iconUrl);
+            query.bindValue(":replyCount", row.replyCount);
+            query.bindValue(":views", row.views);
+            query.bindValue(":sticky", row.sticky ? 1 : 0);
+            query.bindValue(":unread", row.unread ? 1 : 0);
+            query.bindValue(":lastAuthor", row.lastAuthor);
+            query.bindValue(":lastPostTime", row.lastPostTime.toString(Qt::ISODate));
+            query.bindValue(":stored", stored);
+            execQuery(query);
+        }
+    });
+}
+
+void ContentStore::storePosts(std::uint32_t boardId, ThreadPtr thread)
+{
+    QList<PostRow> rows;
+    for (const auto& post : thread->getPosts())
+    {
+        if (post->getIndex() < 1)
+        {
+            continue;
+        }
+
+        PostRow row;
+        row.postId = post->getId();
+        row.index = post->getIndex();
+        row.author = post->getAuthor();
+        row.text = post->getText();
+        row.dateline = post->getDatelineString();
+        row.posted = post->getDateTime();
+        rows.push_back(row);
+    }
+
+    if (rows.isEmpty())
+    {
+        return;
+    }
+
+    const QString threadId = thread->getId();
+    const QString threadTitle = thread->getTitle();
+    const auto range = pageRange(thread);
+
+    enqueue([this, boardId, threadId, threadTitle, range, rows](QSqlDatabase& db)
+    {
+        const bool searchEnabled = _searchEnabled;
+
+        QSqlQuery query(db);
+        QString title = threadTitle;
+
+        // the thread may not have been listed with its title
+        if (searchEnabled && title.isEmpty())
+        {
+            query.prepare("SELECT title FROM threads WHERE boardId=:boardId AND threadId=:threadId");
+            query.bindValue(":boardId", boardId);
+            query.bindValue(":threadId", threadId);
+            execQuery(query);
+
+            if (query.next())
+            {
+                title = query.value(0).toString();
+            }
+        }
+
+        if (searchEnabled)
+        {
+            query.prepare("DELETE FROM postsearch WHERE rowid IN (SELECT id FROM posts "
+                "WHERE boardId=:boardId AND threadId=:threadId AND postIndex BETWEEN :first AND :last)");
+            query.bindValue(":boardId", boardId);
+            query.bindValue(":threadId", threadId);
+            query.bindValue(":first", range.first);
+            query.bindValue(":last", range.second);
+            execQuery(query);
+        }
+
+        // posts deleted on the board shift the ones after them
+        query.prepare("DELETE FROM posts WHERE boardId=:boardId AND threadId=:threadId "
+            "AND postIndex BETWEEN :first AND :last");
+        query.bindValue(":boardId", boardId);
+        query.bindValue(":threadId", threadId);
+        query.bindValue(":first", range.first);
+        query.bindValue(":last", range.second);
+        execQuery(query);
+
+        query.prepare("INSERT OR REPLACE INTO posts "
+            "(boardId, threadId, postId, postIndex, author, text, dateline, posted, stored) "
+            "VALUES (:boardId, :threadId, :postId, :postIndex, :author, :text, :dateline, :posted, :stored)");
+
+        // a post that moved to this page gets a new rowid when it's replaced
+        QSqlQuery unindex(db);
+        QSqlQuery index(db);
+
+        if (searchEnabled)
+        {
+            unindex.prepare("DELETE FROM postsearch WHERE rowid IN "
+                "(SELECT id FROM posts WHERE boardId=:boardId AND postId=:postId)");
+            index.prepare(insertSearchRowSQL);
+        }
+
+        const QString stored = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+        for (const auto& row : rows)
+        {
+            const QString posted = row.posted.toString(Qt::ISODate);
+
+            if (searchEnabled)
+            {
+                unindex.bindValue(":boardId", boardId);
+                unindex.bindValue(":postId", row.postId);
+                execQuery(unindex);
+            }
+
+            query.bindValue(":boardId", boardId);
+            query.bindValue(":threadId", threadId);
+            query.bindValue(":postId", row.postId);
+            query.bindValue(":postIndex", row.index);
+            query.bindValue(":author", row.author);
+            query.bindValue(":text", row.text);
+            query.bindValue(":dateline", row.dateline);
+            query.bindValue(":posted", posted);
+            query.bindValue(":stored", stored);
+            execQuery(query);
+
+            if (searchEnabled)
+            {
+                insertSearchRow(index, query.lastInsertId(), boardId,
+                    toSearchText(row.text), row.author, title, posted);
+            }
+        }
+    });
+}
+
+ThreadList ContentStore::loadThreads(std::uint32_t boardId, ForumPtr forum)
+{
+    ThreadList retval;
+
+    try
+    {
+        QSqlQuery query(database());
+        query.prepare("SELECT * FROM threads WHERE boardId=:boardId AND forumId=:forumId AND page=:page "
+            "ORDER BY displayOrder");
+        query.bindValue(":boardId", boardId);
+        query.bindValue(":forumId", forum->getId());
+        query.bindValue(":page", forum->getPageNumber());
+        execQuery(query);
+
+        const QSqlRecord rec = query.record();
+        const int threadId = rec.indexOf("threadId");
+        const int title = rec.indexOf("title");
+        const int author = rec.indexOf("author");
+        const int previewText = rec.indexOf("previewText");
+        const int iconUrl = rec.indexOf("iconUrl");
+        const int replyCount = rec.indexOf("replyCount");
+        const int views = rec.indexOf("views");
+        const int sticky = rec.indexOf("sticky");
+        const int unread = rec.indexOf("unread");
+        const int lastAuthor = rec.indexOf("lastAuthor");
+        const int lastPostTime = rec.indexOf("lastPostTime");
+
+        while (query.next())
+        {
+            auto thread = std::make_shared<Thread>(query.value(threadId).toString());
+            thread->setTitle(query.value(title).toString());
+            thread->setAuthor(query.value(author).toString());
+            thread->setPreviewText(query.value(previewText).toString());
+            thread->setIconUrl(query.value(iconUrl).toString());
+            thread->setReplyCount(query.value(replyCount).toUInt());
+            thread->setViews(query.value(views).toInt());
+            thread->setSticky(query.value(sticky).toBool());
+            thread->setHasUnread(query.value(unread).toBool());
+
+            auto lastPost = std::make_shared<Post>();
+            lastPost->setAuthor(query.value(lastAuthor).toString());
+            lastPost->setDateTime(QDateTime::fromString(query.value(lastPostTime).toString(), Qt::ISODate));
+            thread->setLastPost(lastPost);
+
+            retval.push_back(thread);
+        }
+    }
+    catch (const owl::Exception& ex)
+    {
+        _logger->error("Could not load threads of forum '{}': {}",
+            forum->getId().toStdString(), ex.message().toStdString());
+        retval.clear();
+    }
+
+    return retval;
+}
+
+PostList ContentStore::loadPosts(std::uint32_t boardId, ThreadPtr thread)
+{
+    PostList retval;
+    const auto range = pageRange(thread);
+
+    try
+    {
+        QSqlQuery query(database());
+        query.prepare("SELECT * FROM posts WHERE boardId=:boardId AND threadId=:threadId "
+            "AND postIndex BETWEEN :first AND :last ORDER BY postIndex");
+        query.bindValue(":boardId", boardId);
+        query.bindValue(":threadId", thread->getId());
+        query.bindValue(":first", range.first);
+        query.bindValue(":last", range.second);
+        execQuery(query);
+
+        const QSqlRecord rec = query.record();
+        const int postId = rec.indexOf("postId");
+        const int postIndex = rec.indexOf("postIndex");
+        const int author = rec.indexOf("author");
+        const int text = rec.indexOf("text");
+        const int dateline = rec.indexOf("dateline");
+        const int posted = rec.indexOf("posted");
+
+        while (query.next())
+        {
+            auto post = std::make_shared<Post>(query.value(postId).toString());
+            post->setIndex(query.value(postIndex).toInt());
+            post->setAuthor(query.value(author).toString());
+            post->setText(query.value(text).toString());
+            post->setDatelineString(query.value(dateline).toString());
+            post->setDateTime(QDateTime::fromString(query.value(posted).toString(), Qt::ISODate));
+            retval.push_back(post);
+        }
+    }
+    catch (const owl::Exception& ex)
+    {
+        _logger->error("Could not load posts of thread '{}': {}",
+            thread->getId().toStdString(), ex.message().toStdString());
+        retval.clear();
+    }
+
+    // only the last page of a thread can be short
+    const auto expected = static_cast<std::size_t>(thread->getPerPage());
+    const bool lastPage = thread->getPageNumber() >= thread->getPageCount();
+
+    if (retval.size() != expected && !(lastPage && !retval.empty() && retval.size() < expected))
+    {
+        retval.clear();
+    }
+
+    return retval;
+}
+
+void ContentStore::removeBoard(std::uint32_t boardId)
+{
+    enqueue([this, boardId](QSqlDatabase& db)
+    {
+        QStringList tables { QStringLiteral("threads"), QStringLiteral("posts") };
+        if (_searchEnabled)
+        {
+            tables.push_back(QStringLiteral("postsearch"));
+        }
+
+        QSqlQuery query(db);
+
+        for (const QString& table : tables)
+        {
+            query.prepare(QString("DELETE FROM %1 WHERE boardId=:boardId").arg(table));
+            query.bindValue(":boardId", boardId);
+            execQuery(query);
+        }
+    });
+}
+
+SearchResults ContentStore::search(const QString& text, int limit, std::uint32_t boardId)
+{
+    if (!_searchEnabled)
+    {
+        OWL_THROW_EXCEPTION(Exception("Search is not available"));
+    }
+
+    const QString boardFilter = boardId > 0
+        ? QStringLiteral("AND postsearch.boardId=:boardId ")
+        : QString();
+
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT postsearch.boardId, posts.threadId, postsearch.title, posts.postId, "
+        "posts.postIndex, postsearch.author, postsearch.posted, postsearch.rank, "
+        "snippet(postsearch, 0, :matchBegin, :matchEnd, '...', :words) "
+        "FROM postsearch JOIN posts ON posts.id=postsearch.rowid "
+        "WHERE postsearch MATCH :text %1"
+        "ORDER BY postsearch.rank LIMIT :limit").arg(boardFilter));
+
+    query.bindValue(":matchBegin", QString::fromLatin1(SEARCH_MATCH_BEGIN));
+    query.bindValue(":matchEnd", QString::fromLatin1(SEARCH_MATCH_END));
+    query.bindValue(":words", SEARCH_SNIPPET_WORDS);
+    query.bindValue(":text", text);
+    query.bindValue(":limit", limit);
+
+    if (boardId > 0)
+    {
+        query.bindValue(":boardId", boardId);
+    }
+
+    execQuery(query);
+
+    SearchResults retval;
+    while (query.next())
+    {
+        SearchResult result;
+        result.boardId = query.value(0).toUInt();
+        result.threadId = query.value(1).toString();
+        result.threadTitle = query.value(2).toString();
+        result.postId = query.value(3).toString();
+        result.postIndex = query.value(4).toInt();
+        result.author = query.value(5).toString();
+        result.posted = QDateTime::fromString(query.value(6).toString(), Qt::ISODate);
+        result.rank = query.value(7).toDouble();
+        result.snippet = query.value(8).toString();
+        retval.push_back(result);
+    }
+
+    return retval;
+}
+
+void ContentStore::flush()
+{
+    // the writer runs one task at a time in the order they were started
+    QFuture<void> last;
+
+    {
+        QMutexLocker locker(&_writeMutex);
+        last = _lastWrite;
+    }
+
+    last.waitForFinished();
+}
+
+void ContentStore::enqueue(WriteJob job)
+{
+    QMutexLocker locker(&_writeMutex);
+
+    _pendingWrites.push_back(std::move(job));
+
+    // the writes queued until the writer gets to them share a transaction
+    if (!_writerQueued)
+    {
+        _writerQueued = true;
+        _lastWrite = QtConcurrent::run(&_writer, [this]() { writePending(); });
+    }
+}
+
+void ContentStore::writePending()
+{
+    QList<WriteJob> jobs;
+
+    {
+        QMutexLocker locker(&_writeMutex);
+        jobs.swap(_pendingWrites);
+        _writerQueued = false;
+    }
+
+    if (jobs.isEmpty())
+    {
+        return;
+    }
+
+    try
+    {
+        QSqlDatabase db = database();
+        db.transaction();
+
+        try
+        {
+            for (const auto& job : jobs)
+            {
+                job(db);
+            }
+        }
+        catch (...)
+        {
+            db.rollback();
+            throw;
+        }
+
+        if (!db.commit())
+        {
+            OWL_THROW_EXCEPTION(Exception(QString("Commit failed: %1").arg(db.lastError().text())));
+        }
+
+        _logger->trace("Committed {} queued write(s)", jobs.size());
+    }
+    catch (const owl::Exception& ex)
+    {
+        _logger->error("Could not write {} queued write(s): {}", jobs.size(), ex.message().toStdString());
+    }
+}
+
+void ContentStore::initSearchIndex()
+{
+    try
+    {
+        QSqlQuery query(database());
+        query.prepare("SELECT COUNT(*) FROM sqlite_master WHERE type='table' AND name='postsearch'");
+        execQuery(query);
+
+        const bool exists = query.next() && query.value(0).toInt() > 0;
+        query.finish();
+
+        if (!exists)
+        {
+            query.prepare("CREATE VIRTUAL TABLE postsearch USING fts5"
+                "(text, author, title, boardId UNINDEXED, posted UNINDEXED, "
+                "tokenize='unicode61 remove_diacritics 2')");
+            execQuery(query);
+        }
+
+        _searchEnabled = true;
+
+        if (!exists)
+        {
+            enqueue([this](QSqlDatabase& db) { indexStoredPosts(db); });
+        }
+    }
+    catch (const owl::Exception& ex)
+    {
+        _logger->warn("Search is not available: {}", ex.message().toStdString());
+    }
+}
+
+// indexes the posts stored before the search table was created
+void ContentStore::indexStoredPosts(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT posts.id, posts.boardId, posts.author, posts.text, posts.posted, threads.title "
+        "FROM posts LEFT JOIN threads ON threads.boardId=posts.boardId AND threads.threadId=posts.threadId");
+    execQuery(query);
+
+    QSqlQuery index(db);
+    index.prepare(insertSearchRowSQL);
+
+    int count = 0;
+    while (query.next())
+    {
+        insertSearchRow(index, query.value(0), query.value(1).toUInt(),
+            toSearchText(query.value(3).toString()), query.value(2).toString(),
+            query.value(5).toString(), query.value(4).toString());
+        count++;
+    }
+
+    _logger->debug("Indexed {} stored post(s)", count);
+}
+
+// the text of a post is BBCode or HTML depending on the board
+QString ContentStore::toSearchText(const QString& text)
+{
+    static const QRegularExpression tags(QStringLiteral("<[^>]*>"));
+    static const QRegularExpression whitespace(QStringLiteral("\\s+"));
+
+    static const std::vector<std::pair<QString, QString>> entities
+    {
+        { QStringLiteral("&nbsp;"), QStringLiteral(" ") },
+        { QStringLiteral("&lt;"), QStringLiteral("<") },
+        { QStringLiteral("&gt;"), QStringLiteral(">") },
+        { QStringLiteral("&quot;"), QStringLiteral("\"") },
+        { QStringLiteral("&#39;"), QStringLiteral("'") },
+        { QStringLiteral("&amp;"), QStringLiteral("&") }
+    };
+
+    // posts of different boards may quote differently
+    _plainText->resetQuoteStyle();
+
+    QString retval = _plainText->toPlainText(text);
+    retval.replace(tags, QStringLiteral(" "));
+
+    for (const auto& [entity, character] : entities)
+    {
+        retval.replace(entity, character);
+    }
+
+    return retval.replace(whitespace, QStringLiteral(" ")).trimmed();
+}
+
+// each thread needs its own connection, see BoardManager::getDatabase()
+QSqlDatabase ContentStore::database() const
+{
+    const QString name = QLatin1String("ContentStore-0x")
+        + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()), 16);
+
+    QSqlDatabase db = QSqlDatabase::database(name, false);
+    if (!db.isValid())
+    {
+        db = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), name);
+        db.setDatabaseName(_filename);
+        db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(CONTENT_STORE_BUSY_TIMEOUT));
+    }
+    else if (db.databaseName() != _filename)
+    {
+        // the connection was made by a store of another file on this thread
+        db.close();
+        db.setDatabaseName(_filename);
+    }
+
+    if (!db.isOpen() && !db.open())
+    {
+        OWL_THROW_EXCEPTION(Exception(QString("Could not open database file '%1' because: %2")
+            .arg(_filename)
+            .arg(db.lastError().text())));
+    }
+
+    return db;
+}
+
+} // namespace owl
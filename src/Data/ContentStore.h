@@ -0,0 +1,139 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QtCore>
+#include <QSqlDatabase>
+#include <Parsers/Forum.h>
+
+namespace spdlog
+{
+    class logger;
+}
+
+namespace owl
+{
+
+class BBRegExParser;
+
+class ContentStore;
+using ContentStorePtr = std::shared_ptr<ContentStore>;
+
+// number of results returned by a search unless asked otherwise
+constexpr int DEFAULT_SEARCH_LIMIT = 50;
+
+// the matched terms of a search result's snippet are wrapped in these
+constexpr const char* SEARCH_MATCH_BEGIN = "<b>";
+constexpr const char* SEARCH_MATCH_END = "</b>";
+
+struct SearchResult
+{
+    std::uint32_t   boardId = 0;
+    QString         threadId;
+    QString         threadTitle;
+    QString         postId;
+    int             postIndex = 0;
+    QString         author;
+    QString         snippet;
+    QDateTime       posted;
+
+    // bm25 score of the match, lower is better
+    double          rank = 0.0;
+};
+
+using SearchResults = std::vector<SearchResult>;
+
+// Keeps the thread lists and post pages received from the boards in the
+// `threads` and `posts` tables of Owl's database so they can be shown
+// before the network has answered, and after a restart.
+//
+// Writes are queued and committed on a background thread in batches, one
+// transaction per batch. Reads are synchronous and see everything that was
+// queued before them once flush() has returned. All methods are thread safe.
+//
+// The plain text of every stored post is also kept in the `postsearch` FTS5
+// table, which is updated along with the posts and searched by search(). The
+// table is created the first time a store is opened on a database and filled
+// from the posts already stored. Search is disabled if the SQLite driver was
+// built without FTS5.
+class ContentStore final
+{
+public:
+    // the tables must already exist in `filename`, see BoardManager::initializeDatabase()
+    explicit ContentStore(const QString& filename);
+
+    ContentStore(const ContentStore&) = delete;
+    ContentStore& operator=(const ContentStore&) = delete;
+
+    // waits for the pending writes
+    ~ContentStore();
+
+    const QString& filename() const { return _filename; }
+
+    // Queues the forum's current page of threads, replacing what was stored
+    // for that page
+    void storeThreads(std::uint32_t boardId, ForumPtr forum);
+
+    // Queues the thread's current page of posts. Posts are stored by their
+    // index in the thread so posts without one are skipped
+    void storePosts(std::uint32_t boardId, ThreadPtr thread);
+
+    // Returns the stored threads of the forum's current page, the threads
+    // are not attached to `forum`
+    ThreadList loadThreads(std::uint32_t boardId, ForumPtr forum);
+
+    // Returns the stored posts of the thread's current page, or an empty
+    // list unless the whole page is stored. The posts are not attached to
+    // `thread`
+    PostList loadPosts(std::uint32_t boardId, ThreadPtr thread);
+
+    // Removes everything stored for the board
+    void removeBoard(std::uint32_t boardId);
+
+    bool searchEnabled() const { return _searchEnabled; }
+
+    // Returns the stored posts matching `text`, an FTS5 query such as
+    // `owl AND "night mode"`, best matches first. Searches every board
+    // unless `boardId` is given. Throws an owl::Exception if the query is
+    // malformed or search is disabled
+    SearchResults search(const QString& text,
+        int limit = DEFAULT_SEARCH_LIMIT, std::uint32_t boardId = 0);
+
+    // Blocks until every queued write has been committed
+    void flush();
+
+private:
+    using WriteJob = std::function<void(QSqlDatabase&)>;
+
+    void enqueue(WriteJob job);
+    void writePending();
+
+    void initSearchIndex();
+    void indexStoredPosts(QSqlDatabase& db);
+    QString toSearchText(const QString& text);
+
+    QSqlDatabase database() const;
+
+    const QString                   _filename;
+
+    std::atomic_bool                _searchEnabled { false };
+
+    // only used by the writer
+    std::unique_ptr<BBRegExParser>  _plainText;
+
+    QMutex                          _writeMutex;
+    QList<WriteJob>                 _pendingWrites;
+    bool                            _writerQueued = false;
+    QFuture<void>                   _lastWrite;
+
+    // a single thread that is never retired, so its connection is reused
+    QThreadPool                     _writer;
+
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+} // namespace owl
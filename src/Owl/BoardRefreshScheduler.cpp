@@ -0,0 +1,260 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <algorithm>
+#include <limits>
+#include <QRandomGenerator>
+#include <QtConcurrent>
+
+#include "Data/Board.h"
+#include <Utils/Exception.h>
+#include <Utils/OwlLogger.h>
+
+#include "BoardRefreshScheduler.h"
+
+namespace owl
+{
+
+// the number of boards that can be refreshed at the same time
+constexpr int DEFAULT_MAX_CONCURRENT_REFRESH = 2;
+
+// used if the board's refreshRate option is missing or invalid (in seconds)
+constexpr qint64 DEFAULT_REFRESH_RATE = 60 * 10;
+
+// refreshes are spread by up to +/- this percent of the delay
+constexpr qint64 REFRESH_JITTER_PERCENT = 10;
+
+// boards are staggered over this window when they are first added (in msecs)
+constexpr qint64 INITIAL_STAGGER = 5000;
+
+// a failing board is retried at refreshRate * 2^failures up to this limit (in seconds)
+constexpr qint64 MAX_BACKOFF = 60 * 60;
+constexpr std::uint32_t MAX_BACKOFF_EXPONENT = 6;
+
+BoardRefreshScheduler::BoardRefreshScheduler(QObject* parent)
+    : QObject(parent),
+      _maxConcurrent(DEFAULT_MAX_CONCURRENT_REFRESH),
+      _logger(owl::initializeLogger("BoardRefreshScheduler"))
+{
+    _clock.start();
+    _pool.setMaxThreadCount(_maxConcurrent);
+
+    _timer.setSingleShot(true);
+    QObject::connect(&_timer, &QTimer::timeout, this, &BoardRefreshScheduler::dispatch);
+}
+
+BoardRefreshScheduler::~BoardRefreshScheduler()
+{
+    stop();
+}
+
+void BoardRefreshScheduler::setMaxConcurrent(int max)
+{
+    _maxConcurrent = std::max(max, 1);
+    _pool.setMaxThreadCount(_maxConcurrent);
+    dispatch();
+}
+
+void BoardRefreshScheduler::addBoard(BoardPtr board)
+{
+    const auto key = board->hash();
+    if (_entries.contains(key))
+    {
+        return;
+    }
+
+    Entry& entry = _entries[key];
+    entry.board = board;
+
+    const auto stagger = static_cast<qint64>(QRandomGenerator::global()->bounded(static_cast<int>(INITIAL_STAGGER)));
+    schedule(key, entry, stagger);
+
+    _logger->debug("Board '{}' scheduled for refresh in {} ms", board->getName().toStdString(), stagger);
+}
+
+void BoardRefreshScheduler::removeBoard(const BoardPtr& board)
+{
+    // a refresh that is running will complete but won't be rescheduled,
+    // stale items in the queue are dropped when they come up
+    _entries.remove(board->hash());
+}
+
+void BoardRefreshScheduler::refreshNow(const BoardPtr& board)
+{
+    const auto key = board->hash();
+    auto it = _entries.find(key);
+
+    if (it != _entries.end() && !it->running)
+    {
+        schedule(key, *it, 0);
+    }
+}
+
+void BoardRefreshScheduler::stop()
+{
+    _stopped = true;
+    _timer.stop();
+    _pool.clear();
+    _pool.waitForDone();
+}
+
+void BoardRefreshScheduler::schedule(std::size_t key, Entry& entry, qint64 delay)
+{
+    entry.due = _clock.elapsed() + delay;
+    entry.generation = ++_generation;
+
+    _queue.push(QueueItem { entry.due, key, entry.generation });
+    armTimer();
+}
+
+void BoardRefreshScheduler::armTimer()
+{
+    // drop items that were rescheduled or whose board was removed
+    while (!_queue.empty())
+    {
+        const auto& top = _queue.top();
+        const auto it = _entries.constFind(top.key);
+
+        if (it != _entries.constEnd() && it->generation == top.generation && !it->running)
+        {
+            break;
+        }
+
+        _queue.pop();
+    }
+
+    if (_stopped || _queue.empty() || _running >= _maxConcurrent)
+    {
+        // dispatch() is re-run as refreshes complete
+        _timer.stop();
+        return;
+    }
+
+    const qint64 wait = std::max<qint64>(_queue.top().due - _clock.elapsed(), 0);
+    _timer.start(static_cast<int>(std::min<qint64>(wait, std::numeric_limits<int>::max())));
+}
+
+void BoardRefreshScheduler::dispatch()
+{
+    const qint64 now = _clock.elapsed();
+
+    while (!_stopped && !_queue.empty() && _running < _maxConcurrent && _queue.top().due <= now)
+    {
+        const QueueItem item = _queue.top();
+        _queue.pop();
+
+        auto it = _entries.find(item.key);
+        if (it == _entries.end() || it->generation != item.generation || it->running)
+        {
+            continue;
+        }
+
+        BoardPtr board = it->board.lock();
+        if (!board)
+        {
+            _entries.erase(it);
+            continue;
+        }
+
+        const bool autoRefresh = !board->getOptions()->has("enableAutoRefresh")
+            || board->getOptions()->getBool("enableAutoRefresh", false);
+
+        if (!autoRefresh || board->getStatus() != BoardStatus::ONLINE)
+        {
+            // check again later, the board might get connected or
+            // have auto refresh turned on
+            schedule(item.key, *it, nextDelay(board, *it));
+            continue;
+        }
+
+        it->running = true;
+        _running++;
+
+        const std::size_t key = item.key;
+        QtConcurrent::run(&_pool, [this, board, key]()
+        {
+            bool success = false;
+            bool webError = false;
+
+            try
+            {
+                _logger->debug("Refreshing board '{}'", board->getName().toStdString());
+                board->updateUnread();
+                success = true;
+            }
+            catch (const owl::WebException& ex)
+            {
+                webError = true;
+                _logger->warn("Refresh of board '{}' failed: {}",
+                    board->getName().toStdString(), ex.message().toStdString());
+            }
+            catch (const owl::Exception& ex)
+            {
+                _logger->error("Refresh of board '{}' failed: {}",
+                    board->getName().toStdString(), ex.message().toStdString());
+            }
+
+            QMetaObject::invokeMethod(this,
+                [this, key, success, webError]() { refreshFinished(key, success, webError); },
+                Qt::QueuedConnection);
+        });
+    }
+
+    armTimer();
+}
+
+void BoardRefreshScheduler::refreshFinished(std::size_t key, bool success, bool webError)
+{
+    _running--;
+
+    auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        it->running = false;
+
+        if (BoardPtr board = it->board.lock(); board)
+        {
+            it->failures = success || !webError ? 0 : it->failures + 1;
+
+            const qint64 delay = nextDelay(board, *it);
+            schedule(key, *it, delay);
+
+            if (it->failures > 0)
+            {
+                _logger->info("Board '{}' has failed {} time(s) in a row, next refresh in {} seconds",
+                    board->getName().toStdString(), it->failures, delay / 1000);
+            }
+        }
+        else
+        {
+            _entries.erase(it);
+        }
+    }
+
+    dispatch();
+}
+
+qint64 BoardRefreshScheduler::nextDelay(const BoardPtr& board, const Entry& entry) const
+{
+    qint64 rate = board->getOptions()->get<std::uint32_t>("refreshRate", false);
+    if (rate <= 0)
+    {
+        rate = DEFAULT_REFRESH_RATE;
+    }
+
+    if (entry.failures > 0)
+    {
+        rate = std::max(rate, std::min(rate << std::min(entry.failures, MAX_BACKOFF_EXPONENT), MAX_BACKOFF));
+    }
+
+    const qint64 delay = rate * 1000;
+
+    // QRandomGenerator::bounded() only takes ints in Qt5, the jitter of any
+    // sane refresh rate is far below the limit
+    const int jitter = static_cast<int>(std::min<qint64>(delay * REFRESH_JITTER_PERCENT / 100,
+        std::numeric_limits<int>::max() - 1));
+
+    return delay + QRandomGenerator::global()->bounded(-jitter, jitter + 1);
+}
+
+} // namespace owl
@@ -0,0 +1,97 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace spdlog
+{
+    class logger;
+}
+
+namespace owl
+{
+
+class Board;
+using BoardPtr = std::shared_ptr<Board>;
+using BoardWeakPtr = std::weak_ptr<Board>;
+
+// Periodically refreshes the unread state of every registered board on a
+// small, shared pool of worker threads. Boards are kept in a queue ordered
+// by when they are next due (derived from each board's "refreshRate"
+// option, plus some jitter so boards don't line up), boards that fail with
+// a WebException are backed off, and no more than `maxConcurrent` boards
+// are refreshed at the same time regardless of how many boards there are.
+class BoardRefreshScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BoardRefreshScheduler(QObject* parent = nullptr);
+    virtual ~BoardRefreshScheduler();
+
+    int maxConcurrent() const { return _maxConcurrent; }
+    void setMaxConcurrent(int max);
+
+    void addBoard(BoardPtr board);
+    void removeBoard(const BoardPtr& board);
+
+    // moves the board to the front of the queue
+    void refreshNow(const BoardPtr& board);
+
+    // stops dispatching and waits for running refreshes to complete
+    void stop();
+
+private Q_SLOTS:
+    void dispatch();
+
+private:
+    struct Entry
+    {
+        BoardWeakPtr    board;
+        qint64          due = 0;            // msecs on _clock
+        std::uint32_t   failures = 0;       // consecutive failed refreshes
+        std::uint64_t   generation = 0;     // invalidates stale queue items
+        bool            running = false;
+    };
+
+    struct QueueItem
+    {
+        qint64          due;
+        std::size_t     key;
+        std::uint64_t   generation;
+
+        bool operator>(const QueueItem& other) const { return due > other.due; }
+    };
+
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    void schedule(std::size_t key, Entry& entry, qint64 delay);
+    void refreshFinished(std::size_t key, bool success, bool webError);
+    void armTimer();
+
+    qint64 nextDelay(const BoardPtr& board, const Entry& entry) const;
+
+    QHash<std::size_t, Entry>   _entries;
+    Queue                       _queue;
+    QThreadPool                 _pool;
+    QTimer                      _timer;
+    QElapsedTimer               _clock;
+
+    int                         _maxConcurrent;
+    int                         _running = 0;
+    std::uint64_t               _generation = 0;
+    bool                        _stopped = false;
+
+    std::shared_ptr<spdlog::logger>  _logger;
+};
+
+} // namespace
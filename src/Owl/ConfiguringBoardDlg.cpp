@@ -388,6 +388,13 @@ owl::StringMap ConfiguringBoardDlg::createBoard(const QString& parserName, const
         _logger->info("Crawling new board '{}' ({})",
             _newBoard->getName().toStdString(), _newBoard->getUrl().toStdString());
 
+        QObject::connect(_newBoard.get(), &Board::onCrawlProgress, this,
+            [this](BoardPtr, int crawled, int discovered)
+            {
+                statusLbl->setText(tr("Login successful. Retrieving forum list (%1 of %2)...")
+                    .arg(crawled).arg(discovered));
+            });
+
 		_newBoard->crawlRoot();
 
 		if (_newBoard->getRoot()->getForums().size() > 0)
@@ -1,6 +1,8 @@
 #include <QFrame>
 #include <QHBoxLayout>
 
+#include <Data/BoardManager.h>
+
 #include "ForumView.h"
 #include "ContentView.h"
 #include "ForumConnectionFrame.h"
@@ -19,6 +21,21 @@ ForumConnectionFrame::ForumConnectionFrame(owl::BoardPtr board, QWidget *parent)
 
     if (auto b = _board.lock(); b)
     {
+        // a placeholder until BoardManager has loaded the board's forums and parser
+        if (!b->isLoaded())
+        {
+            _forumContentView->doShowLoading(b);
+
+            QObject::connect(BoardManager::instance().get(), &BoardManager::onBoardLoaded, this,
+                [this](BoardPtr loaded)
+                {
+                    if (loaded == _board.lock())
+                    {
+                        _forumContentView->doShowLogo();
+                    }
+                });
+        }
+
         // _forumContentView->doShowLoading(b);
         // _forumNavigationView->doBoardClicked(b);
     }
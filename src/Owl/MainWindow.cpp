@@ -16,7 +16,7 @@
 #include "NewConnection.h"
 #include "Core.h"
 #include "MainWindow.h"
-#include "BoardUpdateWorker.h"
+#include "BoardRefreshScheduler.h"
 #include "PostTextEditor.h"
 #include "NewThreadDlg.h"
 
@@ -78,6 +78,8 @@ MainWindow::MainWindow(SplashScreen *splash, QWidget *parent)
       _splash(splash),
       _logger(owl::initializeLogger("MainWindow"))
 {
+    _refreshScheduler = new BoardRefreshScheduler(this);
+
     setupUi(this);
     initializeTitleBar(this);
 
@@ -118,13 +120,31 @@ void MainWindow::loadConnections()
 
 void MainWindow::loadBoards()
 {
+    // the boards still being loaded by the BoardManager get their frame now
+    // and are logged in once they're ready
+    QObject::connect(BOARDMANAGER.get(), &BoardManager::onBoardLoaded, this,
+        [this](BoardPtr board)
+        {
+            const auto frame = forumTopStack->findChild<owl::ConnectionFrame*>(
+                QString::fromStdString(board->uuid()));
+
+            if (frame != nullptr && initBoard(board, true))
+            {
+                board->login();
+            }
+        });
+
     const auto& connections = _connectionsModel->connections();
     for (const auto& connection : connections)
     {
         if (connection->type() == owl::ConnectionType::LEGACY_BOARD)
         {
             auto board = connection->data(owl::ConnectionRoles::DATA).value<BoardPtr>();
-            if (board && initBoard(board))
+            if (board && !board->isLoaded())
+            {
+                forumTopStack->addWidget(new ForumConnectionFrame(board, this));
+            }
+            else if (board && initBoard(board, true))
             {
                 board->login();
                 forumTopStack->addWidget(new ForumConnectionFrame(board, this));
@@ -144,7 +164,7 @@ void MainWindow::loadBoards()
     forumTopStack->addWidget(chatframe);
 }
 
-bool MainWindow::initBoard(const BoardPtr& b)
+bool MainWindow::initBoard(const BoardPtr& b, bool reuseParser)
 {
     QString boardItemTemplate = owl::getResourceHtmlFile("boardItem.html");
     Q_ASSERT(!boardItemTemplate.isEmpty());
@@ -155,14 +175,18 @@ bool MainWindow::initBoard(const BoardPtr& b)
     {
         if (b->isEnabled())
         {
-            ParserBasePtr parser = ParserManager::instance()->createParser(b->getProtocolName(), b->getServiceUrl());
-            parser->setOptions(b->getOptions());
+            if (!reuseParser || !b->getParser())
+            {
+                ParserBasePtr parser = ParserManager::instance()->createParser(b->getProtocolName(), b->getServiceUrl());
+                parser->setOptions(b->getOptions());
+
+                b->setParser(parser);
+            }
 
-            b->setParser(parser);
             connectBoard(b);
 
-            // lastly start thr worker thread
-            _workerMap.insert(b->hash(), new QThreadEx());
+            // lastly schedule the board's unread refreshes
+            _refreshScheduler->addBoard(b);
 
             ok = true;
         }
@@ -266,6 +290,11 @@ void MainWindow::onForumStructureChanged(BoardPtr b)
 
 void MainWindow::loginEvent(BoardPtr b, const StringMap& sp)
 {
+    if (sp.getBool("success", false))
+    {
+        _refreshScheduler->refreshNow(b);
+    }
+
     this->connectionView->repaint();
 }
 
@@ -841,14 +870,8 @@ void MainWindow::createBoardPanel()
             BoardPtr board = bwp.lock();
             if (board)
             {
-                QThreadEx* thread = _workerMap.value(board->hash());
-                Q_ASSERT(thread);
-                thread->exit();
-
-                // NOTE: More of Qt's lifetime management, this will, in fact, delete
-                // the `BoardUpdateWorker` and `QThreadEx` objects that are in the
-                // `_workerMap`
-                _workerMap.remove(board->hash());
+                // stop any scheduled refreshes
+                _refreshScheduler->removeBoard(board);
 
                 // remove from the database
                 BOARDMANAGER->deleteBoard(board);
@@ -945,11 +968,8 @@ void MainWindow::onBoardDelete()
     
 void MainWindow::onBoardDelete(BoardPtr b)
 {
-    // stop any pending requests
-    QThread* thread = _workerMap.value(b->hash());
-    thread->exit();
-
-    _workerMap.remove(b->hash());
+    // stop any scheduled refreshes
+    _refreshScheduler->removeBoard(b);
 
     // remove the board from the database
     BOARDMANAGER->deleteBoard(b);
@@ -6,7 +6,6 @@
 
 #include <Parsers/ParserManager.h>
 #include <Utils/Exception.h>
-#include <Utils/QThreadEx.h>
 #include <Data/ConnectionListModel.h>
 #include "Data/BoardManager.h"
 #include "ui_MainWindow.h"
@@ -24,12 +23,10 @@ namespace owl
 class ConnectionListModel;
 using ConnectionListModelPtr = std::unique_ptr<ConnectionListModel>;
 
+class BoardRefreshScheduler;
 class ErrorReportDlg;
 class QuickAddDlg;
 
-// uint - DB Id
-using WorkerMap = QHash<std::size_t, QThreadEx*>;
-
 class SplashScreen : public QSplashScreen
 {
     Q_OBJECT
@@ -88,7 +85,8 @@ private:
     void connectBoard(BoardPtr board);
     void createDebugMenu();
     void updateSelectedThread(ThreadPtr thread = ThreadPtr());
-    bool initBoard(const BoardPtr& b);
+    // `reuseParser` keeps the parser created by BoardManager::loadBoards()
+    bool initBoard(const BoardPtr& b, bool reuseParser = false);
     void openPreferences();
     void loadConnections();
     
@@ -99,8 +97,8 @@ private:
     // TODO: ensure this is a good model for mutexes
     QMutex _updateMutex;
 
-    // map of threads for each board
-    WorkerMap       _workerMap;
+    // refreshes the unread state of all boards
+    BoardRefreshScheduler*  _refreshScheduler = nullptr;
     SplashScreen*   _splash = nullptr;
     std::shared_ptr<spdlog::logger>  _logger;
 
@@ -223,7 +223,10 @@ void OwlApplication::init()
     if (parsersEnabled)
     {
         const auto parsersPath = !_parserFolder.isEmpty() ? _parserFolder : object.read("parsers.path").toString();
-        ParserManager::instance()->init(true, parsersPath);
+
+        // the compiled parsers are cached next to the settings
+        const auto cachePath = QFileInfo(_jsonConfig).absoluteDir().filePath(QStringLiteral("parsercache"));
+        ParserManager::instance()->init(true, parsersPath, cachePath);
     }
     else
     {
@@ -7,51 +7,21 @@ namespace owl
 {
 
 LuaParserBase::LuaParserBase(const QString& url, const QString& luaFile)
+    : LuaParserBase(url, luaFile, LuaChunkPtr())
+{
+}
+
+LuaParserBase::LuaParserBase(const QString& url, const QString& luaFile, LuaChunkPtr chunk)
 	: ParserBase("#luaparser", "#luaparser", url),
 	  _strLuaFile(luaFile),
-	  _stateObjIdx(0),
-      L(luaL_newstate()),
+      _pool(std::make_shared<LuaStatePool>(luaFile, url, MAX_LUA_STATES, chunk)),
       _logger(owl::initializeLogger("LuaParserBase"))
 {
-    _stateMutex = std::make_shared<std::mutex>();
-	luaL_openlibs(L);
-
-	// store a reference to 'this' as a global variable so we
-	// can reference it later
-	lua_newtable(L); 
-	lua_pushlightuserdata(L,(void*)this);
-	lua_setglobal(L, "__parserObj");
-
-	// register Owl interface in the Lua scripts
-	registerFunctions();
-
-	int luaStatus = luaL_loadfile(L, _strLuaFile.toLatin1());
-
-	if (luaStatus || lua_pcall(L, 0, 0, 0))
-	{
-		QString strMsg = QString("could not initialize lua parser '%1': %2")
-			.arg(luaFile)
-			.arg(lua_tostring(L, -1));
-        _logger->error(strMsg.toStdString());
-
-        OWL_THROW_EXCEPTION(LuaException(strMsg));
-	}
+    _pool->setWebClientConfig(createWebClientConfig());
 
-	lua_getglobal(L, "Parser");
-	lua_getfield(L, -1, "create");
-	lua_pushstring(L, this->getBaseUrl().toLatin1());
-
-	if (lua_pcall(L, 1, 1, 0) != 0)
-	{
-		QString strMsg = QString("problem calling 'createParser' in %1: %2")
-			.arg(luaFile)
-			.arg(lua_tostring(L, -1));
-        _logger->error(strMsg.toStdString());
-
-        OWL_THROW_EXCEPTION(LuaException(strMsg));
-	}
-
-	int top = lua_gettop(L);
+    // creating the first state also checks that the script loads
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 
 	lua_getglobal(L,"boardware");
 	_options->add("boardware",luaL_checkstring(L, -1));
@@ -62,113 +32,32 @@ LuaParserBase::LuaParserBase(const QString& url, const QString& luaFile)
 	lua_getglobal(L,"boardwaremin");
 	_options->add("boardwaremin",luaL_checkstring(L, -1));
 
-	// Reset stack
-	lua_settop(L, top);	
-
-	// store the lua state
-	_stateObjIdx = luaL_ref(L, LUA_REGISTRYINDEX);
-}
+	lua_getglobal(L, "parserName");
+	if (lua_isstring(L, -1))
+	{
+		_parserName = QString(lua_tostring(L, -1));
+	}
 
-LuaParserBase::~LuaParserBase()
-{   
-    // HACK: the Lua state needs to be closed when prudent!
-    if (_doCloseState)
-    {
-        lua_close(L);
-    }
+	// Reset stack
+	lua_settop(L, 0);
 }
 
-void LuaParserBase::registerFunctions()
+LuaParserBase::LuaParserBase(const QString& url, LuaStatePoolPtr pool)
+	: ParserBase("#luaparser", "#luaparser", url),
+	  _strLuaFile(pool->luaFile()),
+      _pool(pool),
+      _logger(owl::initializeLogger("LuaParserBase"))
 {
-	// register the webclient object
-	luaL_newmetatable(L, "Owl.webclient");
-	lua_pushliteral(L, "__index");
-	lua_pushvalue(L, -2);
-	lua_settable(L, -3);						// metatable.__index = Owl.webclient
-	lua_pushliteral(L, "__call");			// __call(c)
-	luaL_getmetatable(L, "Owl.webclient");
-	luaL_setfuncs(L, webclientlib, 0);
-	lua_setglobal(L, "webclient");			// global object (ie. `local w = webclient.new()`)
-
-	// register the sgmldoc object
-	luaL_newmetatable(L, "Owl.sgml");
-	lua_pushliteral(L, "__index");
-	lua_pushvalue(L, -2);
-	lua_settable(L, -3);						// metatable.__index = Owl.sgmldoc
-	lua_pushliteral(L, "__call");			// __call(c)
-	luaL_getmetatable(L, "Owl.sgml");
-	luaL_setfuncs(L, sgmllib, 0);
-	lua_setglobal(L, "sgml");				// global object (ie. `local w = sgml.new()`)
-
-	// register the regexp object
-	luaL_newmetatable(L, "Owl.regexp");
-	lua_pushliteral(L, "__index");
-	lua_pushvalue(L, -2);
-	lua_settable(L, -3);						// metatable.__index = Owl.sgmldoc
-	lua_pushliteral(L, "__call");			// __call(c)
-	luaL_getmetatable(L, "Owl.regexp");
-	luaL_setfuncs(L, regexplib, 0);
-	lua_setglobal(L, "regexp");				// global object (ie. `local w = sgml.new()`)
-
-	// register the sgmltag object
-	luaL_newmetatable(L, "Owl.sgmltag");
-	lua_pushliteral(L, "__index");
-	lua_pushvalue(L, -2);
-	lua_settable(L, -3);						// metatable.__index = Owl.sgmldoc
-	lua_pushliteral(L, "__call");			// __call(c)
-	luaL_getmetatable(L, "Owl.sgmltag");
-	luaL_setfuncs(L, sgmltaglib, 0);
-	lua_setglobal(L, "sgmltag");			// global object (ie. `local w = sgml.new()`)
-
-	lua_newtable(L);
-	luaL_setfuncs(L, owlutilslib, 0);
-	lua_setglobal(L, "utils");				// utils object
-
-	lua_newtable(L);
-	luaL_setfuncs(L, errorlib, 0);
-	lua_setglobal(L, "error");
-
-	lua_newtable(L);
-	lua_pushstring(L, "FORUM");
-	lua_pushnumber(L, Forum::FORUM);
-	lua_settable(L, -3);
-	lua_pushstring(L, "CATEGORY");
-	lua_pushnumber(L, Forum::CATEGORY);
-	lua_settable(L, -3);
-	lua_pushstring(L, "LINK");
-	lua_pushnumber(L, Forum::LINK);
-	lua_settable(L, -3);
-	lua_setglobal(L, "ForumType");
 }
 
 QString LuaParserBase::getName() const
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
-
-	QString retval;
-	lua_getglobal(L, "parserName");
-
-	if (lua_isstring(L, -1))
-	{
-		retval = QString(lua_tostring(L, -1));
-	}
-
-	return retval;
+	return _parserName;
 }
 
 QString LuaParserBase::getPrettyName() const
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
-
-	QString retval;
-    lua_getglobal(L, "parserName");
-
-	if (lua_isstring(L, -1))
-	{
-		retval = QString(lua_tostring(L, -1));
-	}
-
-	return retval;
+	return _parserName;
 }
 
 QString LuaParserBase::getItemUrl(ForumPtr forum)
@@ -188,7 +77,8 @@ QString LuaParserBase::getItemUrl(PostPtr post)
 
 QString LuaParserBase::getItemUrlHelper(const QString& funcName, const QString itemId)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 
 	// clear the stack
 	lua_settop(L, 0);
@@ -198,7 +88,7 @@ QString LuaParserBase::getItemUrlHelper(const QString& funcName, const QString i
 	lua_getfield(L, -1, funcName.toLatin1());
 
 	// pass the reference to the created object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
     // push the forumId
     lua_pushstring(L, itemId.toLatin1());
@@ -220,7 +110,8 @@ QString LuaParserBase::getItemUrlHelper(const QString& funcName, const QString i
 
 QString LuaParserBase::getPostQuote(PostPtr post)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 
 	// clear the stack
 	lua_settop(L, 0);
@@ -230,7 +121,7 @@ QString LuaParserBase::getPostQuote(PostPtr post)
 	lua_getfield(L, -1, "getPostQuote");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 	
 	// pass a login table as a param
 	lua_newtable(L);
@@ -259,30 +150,29 @@ QString LuaParserBase::getPostQuote(PostPtr post)
 	return quote;
 }
 
-ParserBasePtr LuaParserBase::clone(ParserBasePtr other)
+ParserBasePtr LuaParserBase::clone(ParserBasePtr)
 {
-    // NOTE: There is no need to set the WebClient's CookieJar since
-    // a clone will use the *SAME* Lua-state as the original object
-    // and therefor the same WebClient object (and cookie jar)
-    LuaParserBasePtr retval = std::make_shared<LuaParserBase>(getBaseUrl(), _strLuaFile);
+    // the clone checks out states from the same pool, whose webclients all
+    // share one cookie jar, so it is logged in as this parser is
+    LuaParserBasePtr retval(new LuaParserBase(getBaseUrl(), _pool));
     ParserBase::clone(retval);
 
     retval->_dtParser = _dtParser;
-    retval->_stateObjIdx = _stateObjIdx;
-    retval->L = L;
+    retval->_parserName = _parserName;
 
-    // make sure we don't close the singleton Lua state when this object is destroryed
-    retval->_doCloseState = false;
-
-    // delete the old LuaState mutex and assign ours
-    retval->_stateMutex.reset();
-    retval->_stateMutex = _stateMutex;
+    for (const char* key : { "boardware", "boardwaremax", "boardwaremin" })
+    {
+        retval->_options->add(key, _options->getText(key, false));
+    }
 
     return retval;
 }
 
 QString LuaParserBase::getLastRequestUrl()
 {
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
+
     // clear the stack
     lua_settop(L, 0);
 
@@ -291,7 +181,7 @@ QString LuaParserBase::getLastRequestUrl()
     lua_getfield(L, -1, "getLastRequestUrl");
 
     // pass the reference to the create object as the 1st param
-    lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
     if (lua_pcall(L, 1, 1, 0) != 0)
     {
@@ -302,9 +192,16 @@ QString LuaParserBase::getLastRequestUrl()
     return QString(lua_tostring(L, -1));
 }
 
+void LuaParserBase::updateClients()
+{
+    ParserBase::updateClients();
+    _pool->setWebClientConfig(createWebClientConfig());
+}
+
 QVariant LuaParserBase::doLogin(const LoginInfo& info)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 
     // clear the stack
     lua_settop(L, 0);
@@ -314,7 +211,7 @@ QVariant LuaParserBase::doLogin(const LoginInfo& info)
 	lua_getfield(L, -1, "doLogin");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 	
 	// pass a login table as a param
 	lua_newtable(L);
@@ -334,7 +231,7 @@ QVariant LuaParserBase::doLogin(const LoginInfo& info)
         OWL_THROW_EXCEPTION(Exception(strMsg));
 	}
 
-	StringMap params = tableToParams(2);
+	StringMap params = tableToParams(L, 2);
 	lua_pop(L, 1);
 	lua_gc(L, LUA_GCCOLLECT, 0);
 
@@ -343,7 +240,8 @@ QVariant LuaParserBase::doLogin(const LoginInfo& info)
 
 QVariant LuaParserBase::doLogout()
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 
 	// clear the stack
 	lua_settop(L, 0);
@@ -353,7 +251,7 @@ QVariant LuaParserBase::doLogout()
 	lua_getfield(L, -1, "doLogout");
 
 	// pass the reference to the created object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 	if (lua_pcall(L, 1, 1, 0) != 0)
 	{
@@ -361,12 +259,13 @@ QVariant LuaParserBase::doLogout()
         OWL_THROW_EXCEPTION(LuaException(lua_tostring(L, -1)));
 	}
 
-	return QVariant::fromValue(tableToParams(2));
+	return QVariant::fromValue(tableToParams(L, 2));
 }
 
 QVariant LuaParserBase::doGetBoardwareInfo()
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	owl::StringMap params;	
 
 	// clear the stack
@@ -377,7 +276,7 @@ QVariant LuaParserBase::doGetBoardwareInfo()
 	lua_getfield(L, -1, "doGetBoardwareInfo");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 	
 	if (lua_pcall(L, 1, 1, 0) != 0)
 	{
@@ -385,12 +284,13 @@ QVariant LuaParserBase::doGetBoardwareInfo()
         OWL_THROW_EXCEPTION(LuaException(lua_tostring(L, -1)));
 	}
 
-	return QVariant::fromValue(tableToParams(2));
+	return QVariant::fromValue(tableToParams(L, 2));
 }
 
 QVariant LuaParserBase::doGetForumList(const QString& forumId)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	ForumList retval;
 
 	// clear the stack
@@ -401,7 +301,7 @@ QVariant LuaParserBase::doGetForumList(const QString& forumId)
 	lua_getfield(L, -1, "doGetForumList");
     
 	// pass the reference to the created object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
     
     // push the forumId
     lua_pushstring(L, forumId.toLatin1());
@@ -422,7 +322,7 @@ QVariant LuaParserBase::doGetForumList(const QString& forumId)
 		while (lua_next(L, tablePos))
 		{
 			lua_gettop(L);
-			StringMap info = tableToParams(lua_gettop(L));
+			StringMap info = tableToParams(L, lua_gettop(L));
 			lua_pop(L, 1);
 
 			if (info.has("forumId") && info.has("forumName") && info.has("forumType"))
@@ -451,7 +351,8 @@ QVariant LuaParserBase::doGetForumList(const QString& forumId)
 
 QVariant LuaParserBase::doThreadList(ForumPtr forumInfo, int options)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
     ThreadList retval;
     
 	// clear the stack
@@ -462,7 +363,7 @@ QVariant LuaParserBase::doThreadList(ForumPtr forumInfo, int options)
 	lua_getfield(L, -1, "doThreadList");
     
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
     
     // push the forumId
     lua_pushstring(L, forumInfo->getId().toLatin1());
@@ -489,7 +390,7 @@ QVariant LuaParserBase::doThreadList(ForumPtr forumInfo, int options)
 			if (lua_isnumber(L, -2))
 			{
 				lua_gettop(L);
-				StringMap info = tableToParams(lua_gettop(L));
+				StringMap info = tableToParams(L, lua_gettop(L));
 				lua_pop(L, 1);
 
 				if (info.has("threadId") && info.has("threadTitle") && info.has("threadAuthor"))
@@ -552,7 +453,7 @@ QVariant LuaParserBase::doThreadList(ForumPtr forumInfo, int options)
 				if (key.compare("#forumInfo") == 0)
 				{
 					lua_gettop(L);
-					StringMap info = tableToParams(lua_gettop(L));
+					StringMap info = tableToParams(L, lua_gettop(L));
 					lua_pop(L, 1);
 
 					if (info.has("pageCount"))
@@ -574,7 +475,8 @@ QVariant LuaParserBase::doThreadList(ForumPtr forumInfo, int options)
 
 QVariant LuaParserBase::doGetPostList(ThreadPtr threadInfo, PostListOptions listOption, int webOptions)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	PostList retval;
 
 	// clear the stack
@@ -588,7 +490,7 @@ QVariant LuaParserBase::doGetPostList(ThreadPtr threadInfo, PostListOptions list
 		lua_getfield(L, -1, "doUnreadPostList");
 
 		// pass the reference to the create object as the 1st param
-		lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+		lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 		// pass the threadId and noReload options to the Lua function
 		lua_pushstring(L, threadInfo->getId().toLatin1());
@@ -607,7 +509,7 @@ QVariant LuaParserBase::doGetPostList(ThreadPtr threadInfo, PostListOptions list
 	{
 		lua_getfield(L, -1, "doPostList");
 		// pass the reference to the create object as the 1st param
-		lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+		lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 		// push the forumId
 		lua_pushstring(L, threadInfo->getId().toLatin1());
@@ -637,7 +539,7 @@ QVariant LuaParserBase::doGetPostList(ThreadPtr threadInfo, PostListOptions list
 			if (lua_isnumber(L, -2))
 			{
 				lua_gettop(L);
-				StringMap info = tableToParams(lua_gettop(L));
+				StringMap info = tableToParams(L, lua_gettop(L));
 				lua_pop(L, 1);
 
 				if (info.has("post.id") && info.has("post.username"))
@@ -670,7 +572,7 @@ QVariant LuaParserBase::doGetPostList(ThreadPtr threadInfo, PostListOptions list
 				if (key.compare("#threadInfo") == 0)
 				{
 					lua_gettop(L);
-					StringMap info = tableToParams(lua_gettop(L));
+					StringMap info = tableToParams(L, lua_gettop(L));
 					lua_pop(L, 1);
 
 					if (info.has("pageCount"))
@@ -720,7 +622,8 @@ QVariant LuaParserBase::doGetPostList(ThreadPtr threadInfo, PostListOptions list
 
 QVariant LuaParserBase::doSubmitNewThread(ThreadPtr threadInfo)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	ThreadPtr ret;
 
 	// clear the stack
@@ -731,7 +634,7 @@ QVariant LuaParserBase::doSubmitNewThread(ThreadPtr threadInfo)
 	lua_getfield(L, -1, "doSubmitNewThread");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 	// pass a login table as a param
 	lua_newtable(L);
@@ -775,7 +678,8 @@ QVariant LuaParserBase::doSubmitNewThread(ThreadPtr threadInfo)
 
 QVariant LuaParserBase::doSubmitNewPost(PostPtr postInfo)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 		
 	// clear the stack
 	lua_settop(L, 0);
@@ -785,7 +689,7 @@ QVariant LuaParserBase::doSubmitNewPost(PostPtr postInfo)
 	lua_getfield(L, -1, "doSubmitNewPost");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 	// pass a login table as a param
 	lua_newtable(L);
@@ -827,7 +731,8 @@ QVariant LuaParserBase::doSubmitNewPost(PostPtr postInfo)
 
 QVariant LuaParserBase::doMarkForumRead(ForumPtr forumInfo)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	owl::StringMap params;	
 
 	// clear the stack
@@ -838,7 +743,7 @@ QVariant LuaParserBase::doMarkForumRead(ForumPtr forumInfo)
 	lua_getfield(L, -1, "doMarkForumRead");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 	lua_pushstring(L, forumInfo->getId().toLatin1());
 	
@@ -859,7 +764,8 @@ QVariant LuaParserBase::doMarkForumRead(ForumPtr forumInfo)
 
 QVariant LuaParserBase::doGetUnreadForums()
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	ForumList retval;
 
 	// clear the stack
@@ -870,7 +776,7 @@ QVariant LuaParserBase::doGetUnreadForums()
 	lua_getfield(L, -1, "doGetUnreadForums");
     
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 	if (lua_pcall(L, 1, 1, 0) != 0)
 	{
@@ -888,7 +794,7 @@ QVariant LuaParserBase::doGetUnreadForums()
 		while (lua_next(L, tablePos))
 		{
 			lua_gettop(L);
-			StringMap info = tableToParams(lua_gettop(L));
+			StringMap info = tableToParams(L, lua_gettop(L));
 			lua_pop(L, 1);
 
 			if (info.has("forumId") && info.has("forumName") && info.has("forumType"))
@@ -914,7 +820,7 @@ QVariant LuaParserBase::doGetUnreadForums()
 	return QVariant::fromValue(retval);
 }
 
-StringMap LuaParserBase::tableToParams(int tablePos)
+StringMap LuaParserBase::tableToParams(lua_State* L, int tablePos)
 {
 	StringMap params;
 
@@ -956,7 +862,8 @@ StringMap LuaParserBase::tableToParams(int tablePos)
 
 QVariant LuaParserBase::doGetEncryptionSettings()
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	owl::StringMap params;	
 
 	// clear the stack
@@ -967,7 +874,7 @@ QVariant LuaParserBase::doGetEncryptionSettings()
 	lua_getfield(L, -1, "doGetEncryptionSettings");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 
 	if (lua_pcall(L, 1, 1, 0) != 0)
 	{
@@ -975,12 +882,13 @@ QVariant LuaParserBase::doGetEncryptionSettings()
         OWL_THROW_EXCEPTION(LuaException(lua_tostring(L, -1)));
 	}
 
-	return QVariant::fromValue(tableToParams(2));
+	return QVariant::fromValue(tableToParams(L, 2));
 }
 
 QVariant LuaParserBase::doTestParser(const QString& html)
 {
-    std::lock_guard<std::mutex> locker(*_stateMutex);
+    const auto state = _pool->acquire();
+    lua_State* L = state.state();
 	owl::StringMap params;	
 
 	// clear the stack
@@ -991,7 +899,7 @@ QVariant LuaParserBase::doTestParser(const QString& html)
 	lua_getfield(L, -1, "doTestParser");
 
 	// pass the reference to the create object as the 1st param
-	lua_rawgeti(L, LUA_REGISTRYINDEX, _stateObjIdx);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state.object());
 	lua_pushstring(L, html.toLatin1());
 
 	if (lua_pcall(L, 2, 1, 0) != 0)
@@ -1000,7 +908,7 @@ QVariant LuaParserBase::doTestParser(const QString& html)
         OWL_THROW_EXCEPTION(LuaException(lua_tostring(L, -1)));
 	}
 
-	return QVariant::fromValue(tableToParams(2));;
+	return QVariant::fromValue(tableToParams(L, 2));;
 }
 
 } // namespace
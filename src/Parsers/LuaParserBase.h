@@ -1,10 +1,10 @@
 #pragma once
-#include <mutex>
 #include <setjmp.h>
 #include <QtCore>
 #include <lua.hpp>
 #include "../Utils/DateTimeParser.h"
 #include "../Utils/StringMap.h"
+#include "LuaStatePool.h"
 #include "ParserBase.h"
 
 namespace spdlog
@@ -23,7 +23,6 @@ class LuaParserException;
 
 using LuaParserBasePtr = std::shared_ptr<LuaParserBase>;
 using LuaParserExceptionPtr = std::shared_ptr<LuaParserException>;
-using MutexPtr = std::shared_ptr<std::mutex>;
 
 // TODO: see if we need to pass the lua_State
 class LuaParserException : public Exception
@@ -43,6 +42,9 @@ public:
     QString luaFile() const { return _luaFile; }
     std::int32_t luaLine() const { return _luaLine; }
 
+    void raise() const override { throw *this; }
+    LuaParserException* clone() const override { return new LuaParserException(*this); }
+
     QString details() const override
     {
         std::stringstream ss;
@@ -66,13 +68,19 @@ private:
     std::int32_t    _luaLine;
 };
    
+// A parser implemented by a Lua script. The script runs in a pool of Lua
+// states shared with the parser's clones, each request checks out a state
+// so the clones do not wait for each other
 class LuaParserBase : public ParserBase
 {
 	Q_OBJECT
 
 public:
 	Q_INVOKABLE LuaParserBase(const QString& url, const QString& luaFile);
-	virtual ~LuaParserBase();
+
+	// the states load `chunk`, the compiled `luaFile`, when it is given
+	LuaParserBase(const QString& url, const QString& luaFile, LuaChunkPtr chunk);
+	virtual ~LuaParserBase() = default;
 
     virtual QString getName() const override;
     virtual QString getPrettyName() const override;
@@ -85,8 +93,11 @@ public:
 
     virtual ParserBasePtr clone(ParserBasePtr other = ParserBasePtr()) override;
 
+    // the last url requested by the state that was used last
     virtual QString getLastRequestUrl() override;
 
+    virtual void updateClients() override;
+
 protected:
     /* ParserBase implementation */
     virtual QVariant doLogin(const LoginInfo&) override;
@@ -110,18 +121,18 @@ protected:
     virtual QVariant doGetEncryptionSettings() override;
 
 private:
-	void registerFunctions();
-	StringMap tableToParams(int tablePos);
+    // used by clone()
+    LuaParserBase(const QString& url, LuaStatePoolPtr pool);
+
+	StringMap tableToParams(lua_State* L, int tablePos);
     QString getItemUrlHelper(const QString &funcName, const QString itemId);
 
 	DateTimeParser	_dtParser;
 
     QString         _strLuaFile;
-    int             _stateObjIdx;
-    bool            _doCloseState = true;
+    QString         _parserName;
 
-    lua_State*      L;
-    MutexPtr        _stateMutex;
+    LuaStatePoolPtr _pool;
 
     std::shared_ptr<spdlog::logger>  _logger;
 };
@@ -0,0 +1,391 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <lua.hpp>
+#include "../Utils/Exception.h"
+#include "../Utils/OwlLogger.h"
+#include "LuaScriptCache.h"
+
+namespace owl
+{
+
+namespace
+{
+
+// bumped when the layout of the manifest changes
+constexpr int MANIFEST_VERSION = 1;
+
+const char* MANIFEST_FILENAME = "manifest.json";
+const char* CHUNK_SUFFIX = ".luac";
+
+// lua_Writer that appends the compiled chunk to a QByteArray
+int appendChunk(lua_State*, const void* data, std::size_t size, void* userdata)
+{
+    static_cast<QByteArray*>(userdata)->append(static_cast<const char*>(data), static_cast<int>(size));
+    return 0;
+}
+
+QByteArray chunkName(const QString& filename)
+{
+    return QString("@%1").arg(filename).toLatin1();
+}
+
+QString globalString(lua_State* L, const char* name)
+{
+    QString value;
+
+    lua_getglobal(L, name);
+    if (lua_isstring(L, -1))
+    {
+        value = QString(lua_tostring(L, -1));
+    }
+    lua_pop(L, 1);
+
+    return value;
+}
+
+} // namespace
+
+LuaScriptCache::LuaScriptCache(const QString& folder)
+    : _folder(folder),
+      _logger(owl::initializeLogger("LuaScriptCache"))
+{
+    if (!_folder.isEmpty())
+    {
+        loadManifest();
+    }
+}
+
+LuaScriptInfo LuaScriptCache::scriptInfo(const QString& filename)
+{
+    const QFileInfo file(filename);
+    Lock lock(_mutex);
+
+    const auto it = _entries.find(file.absoluteFilePath());
+    if (it != _entries.end() && it->hasInfo && isCurrent(*it, file))
+    {
+        return it->info;
+    }
+
+    Entry& entry = compile(file);
+
+    // run the script once to read its globals
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+
+    const QByteArray name = chunkName(file.absoluteFilePath());
+    if (luaL_loadbufferx(L, entry.chunk->constData(), static_cast<std::size_t>(entry.chunk->size()), name.constData(), "b")
+        || lua_pcall(L, 0, 0, 0))
+    {
+        const QString error = QString("could not run lua parser '%1': %2")
+            .arg(filename)
+            .arg(lua_tostring(L, -1));
+        lua_close(L);
+
+        OWL_THROW_EXCEPTION(LuaException(error));
+    }
+
+    entry.info.name = globalString(L, "parserName");
+    entry.info.prettyName = globalString(L, "parserPrettyName");
+    entry.info.url = globalString(L, "boardUrl");
+    lua_close(L);
+
+    if (entry.info.prettyName.isEmpty())
+    {
+        entry.info.prettyName = entry.info.name;
+    }
+
+    entry.hasInfo = true;
+    _dirty = true;
+
+    return entry.info;
+}
+
+LuaChunkPtr LuaScriptCache::chunk(const QString& filename)
+{
+    const QFileInfo file(filename);
+    Lock lock(_mutex);
+
+    LuaChunkPtr retval;
+
+    const auto it = _entries.find(file.absoluteFilePath());
+    if (it != _entries.end() && isCurrent(*it, file))
+    {
+        if (!it->chunk)
+        {
+            it->chunk = readChunk(it.key());
+        }
+
+        retval = it->chunk;
+    }
+
+    if (!retval)
+    {
+        retval = compile(file).chunk;
+    }
+
+    writeManifest();
+    return retval;
+}
+
+void LuaScriptCache::save()
+{
+    Lock lock(_mutex);
+
+    if (_folder.isEmpty())
+    {
+        return;
+    }
+
+    for (auto it = _entries.begin(); it != _entries.end(); )
+    {
+        if (!QFileInfo::exists(it.key()))
+        {
+            it = _entries.erase(it);
+            _dirty = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    writeManifest();
+
+    QSet<QString> chunks;
+    for (auto it = _entries.cbegin(); it != _entries.cend(); ++it)
+    {
+        chunks.insert(QFileInfo(chunkPath(it.key())).fileName());
+    }
+
+    QDir dir(_folder);
+    for (const QString& name : dir.entryList({ QString("*%1").arg(CHUNK_SUFFIX) }, QDir::Files))
+    {
+        if (!chunks.contains(name))
+        {
+            dir.remove(name);
+        }
+    }
+}
+
+void LuaScriptCache::loadManifest()
+{
+    QFile file(QDir(_folder).filePath(MANIFEST_FILENAME));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != MANIFEST_VERSION
+        || root.value("lua").toString() != QString(LUA_RELEASE))
+    {
+        // the chunks of another Lua version might not load
+        _logger->info("Ignoring parser cache '{}' written by another version", file.fileName().toStdString());
+        return;
+    }
+
+    const QJsonObject scripts = root.value("scripts").toObject();
+    for (auto it = scripts.begin(); it != scripts.end(); ++it)
+    {
+        const QJsonObject object = it.value().toObject();
+
+        Entry entry;
+        entry.modified = static_cast<qint64>(object.value("modified").toDouble());
+        entry.size = static_cast<qint64>(object.value("size").toDouble());
+        entry.hash = object.value("hash").toString().toLatin1();
+
+        if (object.contains("name"))
+        {
+            entry.hasInfo = true;
+            entry.info.name = object.value("name").toString();
+            entry.info.prettyName = object.value("prettyName").toString();
+            entry.info.url = object.value("url").toString();
+        }
+
+        _entries.insert(it.key(), entry);
+    }
+
+    _logger->debug("Loaded {} cached parser script(s) from '{}'", _entries.size(), _folder.toStdString());
+}
+
+// must be called with _mutex locked
+void LuaScriptCache::writeManifest()
+{
+    if (_folder.isEmpty() || !_dirty)
+    {
+        return;
+    }
+
+    QJsonObject scripts;
+    for (auto it = _entries.cbegin(); it != _entries.cend(); ++it)
+    {
+        QJsonObject object;
+        object.insert("modified", static_cast<double>(it->modified));
+        object.insert("size", static_cast<double>(it->size));
+        object.insert("hash", QString::fromLatin1(it->hash));
+
+        if (it->hasInfo)
+        {
+            object.insert("name", it->info.name);
+            object.insert("prettyName", it->info.prettyName);
+            object.insert("url", it->info.url);
+        }
+
+        scripts.insert(it.key(), object);
+    }
+
+    QJsonObject root;
+    root.insert("version", MANIFEST_VERSION);
+    root.insert("lua", QString(LUA_RELEASE));
+    root.insert("scripts", scripts);
+
+    QDir().mkpath(_folder);
+
+    QSaveFile file(QDir(_folder).filePath(MANIFEST_FILENAME));
+    if (file.open(QIODevice::WriteOnly)
+        && file.write(QJsonDocument(root).toJson()) >= 0
+        && file.commit())
+    {
+        _dirty = false;
+    }
+    else
+    {
+        _logger->warn("Could not write parser cache manifest '{}': {}",
+            file.fileName().toStdString(), file.errorString().toStdString());
+    }
+}
+
+// must be called with _mutex locked
+bool LuaScriptCache::isCurrent(Entry& entry, const QFileInfo& file)
+{
+    const qint64 modified = file.lastModified().toMSecsSinceEpoch();
+    if (entry.modified == modified && entry.size == file.size())
+    {
+        return true;
+    }
+
+    // the file was touched or copied, it only has to be compiled again if
+    // its contents have changed
+    QFile source(file.absoluteFilePath());
+    if (!source.open(QIODevice::ReadOnly)
+        || QCryptographicHash::hash(source.readAll(), QCryptographicHash::Sha1).toHex() != entry.hash)
+    {
+        return false;
+    }
+
+    entry.modified = modified;
+    entry.size = file.size();
+    _dirty = true;
+
+    return true;
+}
+
+// must be called with _mutex locked
+LuaScriptCache::Entry& LuaScriptCache::compile(const QFileInfo& file)
+{
+    const QString filename = file.absoluteFilePath();
+
+    QByteArray hash;
+    QFile source(filename);
+    if (source.open(QIODevice::ReadOnly))
+    {
+        hash = QCryptographicHash::hash(source.readAll(), QCryptographicHash::Sha1).toHex();
+    }
+    else
+    {
+        OWL_THROW_EXCEPTION(LuaException(QString("could not read lua parser '%1'").arg(filename)));
+    }
+
+    auto chunk = std::make_shared<QByteArray>();
+
+    lua_State* L = luaL_newstate();
+    if (luaL_loadfile(L, filename.toLatin1()) != LUA_OK)
+    {
+        const QString error = QString("could not compile lua parser '%1': %2")
+            .arg(filename)
+            .arg(lua_tostring(L, -1));
+        lua_close(L);
+
+        OWL_THROW_EXCEPTION(LuaException(error));
+    }
+
+    lua_dump(L, &appendChunk, chunk.get(), 0);
+    lua_close(L);
+
+    Entry& entry = _entries[filename];
+    if (entry.hash != hash)
+    {
+        entry.hasInfo = false;
+        entry.info = LuaScriptInfo();
+    }
+
+    entry.modified = file.lastModified().toMSecsSinceEpoch();
+    entry.size = file.size();
+    entry.hash = hash;
+    entry.chunk = chunk;
+    _dirty = true;
+
+    writeChunk(filename, *chunk);
+
+    _logger->trace("Compiled parser script '{}'", filename.toStdString());
+    return entry;
+}
+
+QString LuaScriptCache::chunkPath(const QString& filename) const
+{
+    const QByteArray name = QCryptographicHash::hash(filename.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(_folder).filePath(QString::fromLatin1(name) + CHUNK_SUFFIX);
+}
+
+LuaChunkPtr LuaScriptCache::readChunk(const QString& filename) const
+{
+    if (_folder.isEmpty())
+    {
+        return LuaChunkPtr();
+    }
+
+    QFile file(chunkPath(filename));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return LuaChunkPtr();
+    }
+
+    auto chunk = std::make_shared<QByteArray>(file.readAll());
+
+    // make sure this build of Lua can load it
+    lua_State* L = luaL_newstate();
+    const QByteArray name = chunkName(filename);
+    const bool loaded = luaL_loadbufferx(L, chunk->constData(), static_cast<std::size_t>(chunk->size()),
+        name.constData(), "b") == LUA_OK;
+    lua_close(L);
+
+    if (!loaded)
+    {
+        _logger->debug("Discarding unusable compiled chunk of '{}'", filename.toStdString());
+        return LuaChunkPtr();
+    }
+
+    return chunk;
+}
+
+void LuaScriptCache::writeChunk(const QString& filename, const QByteArray& chunk) const
+{
+    if (_folder.isEmpty())
+    {
+        return;
+    }
+
+    QDir().mkpath(_folder);
+
+    QSaveFile file(chunkPath(filename));
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(chunk) != chunk.size()
+        || !file.commit())
+    {
+        _logger->warn("Could not write compiled parser script '{}': {}",
+            file.fileName().toStdString(), file.errorString().toStdString());
+    }
+}
+
+} // namespace owl
@@ -0,0 +1,91 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <mutex>
+#include <QtCore>
+#include "LuaStatePool.h"
+
+namespace spdlog
+{
+    class logger;
+}
+
+namespace owl
+{
+
+// the globals of a parser script that ParserManager needs to list it
+struct LuaScriptInfo
+{
+    QString name;           // `parserName`
+    QString prettyName;     // `parserPrettyName`, or the name
+    QString url;            // `boardUrl`
+};
+
+// Keeps the compiled chunks of the parser scripts and the globals read from
+// them so the scripts do not have to be run, or compiled, at every startup.
+//
+// A manifest in the cache folder records the path, modification time, size
+// and SHA-1 of each script along with its globals. The compiled chunk of a
+// script is kept next to it. A script whose time or size has changed is
+// only recompiled if its hash has changed too. All methods are thread safe.
+class LuaScriptCache final
+{
+    using Mutex = std::mutex;
+    using Lock  = std::lock_guard<std::mutex>;
+
+public:
+    // nothing is written to disk if `folder` is empty
+    explicit LuaScriptCache(const QString& folder = QString());
+
+    LuaScriptCache(const LuaScriptCache&) = delete;
+    LuaScriptCache& operator=(const LuaScriptCache&) = delete;
+
+    const QString& folder() const { return _folder; }
+
+    // Returns the globals of the script, which is only run if it is not
+    // cached or has changed. Throws an owl::LuaException if the script
+    // cannot be loaded
+    LuaScriptInfo scriptInfo(const QString& filename);
+
+    // Returns the compiled script, compiling it if it is not cached or has
+    // changed. Throws an owl::LuaException if it does not compile
+    LuaChunkPtr chunk(const QString& filename);
+
+    // Writes the manifest if it has changed and removes the chunks of the
+    // scripts that are no longer in it
+    void save();
+
+private:
+    struct Entry
+    {
+        qint64          modified = 0;       // msecs since epoch
+        qint64          size = 0;
+        QByteArray      hash;               // hex SHA-1 of the source
+        bool            hasInfo = false;
+        LuaScriptInfo   info;
+        LuaChunkPtr     chunk;              // loaded on first use
+    };
+
+    void loadManifest();
+    void writeManifest();
+
+    bool isCurrent(Entry& entry, const QFileInfo& file);
+    Entry& compile(const QFileInfo& file);
+
+    QString chunkPath(const QString& filename) const;
+    LuaChunkPtr readChunk(const QString& filename) const;
+    void writeChunk(const QString& filename, const QByteArray& chunk) const;
+
+    const QString                   _folder;
+
+    Mutex                           _mutex;
+    QHash<QString, Entry>           _entries;   // by absolute path
+    bool                            _dirty = false;
+
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+using LuaScriptCachePtr = std::shared_ptr<LuaScriptCache>;
+
+} // namespace owl
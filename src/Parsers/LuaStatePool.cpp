@@ -0,0 +1,337 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include "../Utils/Exception.h"
+#include "../Utils/OwlLogger.h"
+#include "Forum.h"
+#include "OwlLua.h"
+#include "LuaStatePool.h"
+
+namespace owl
+{
+
+namespace
+{
+
+// the address of this is the registry key of the state's page client
+char PAGE_CLIENT_KEY = 0;
+
+// lua_Writer that appends the compiled chunk to a QByteArray
+int writeChunk(lua_State*, const void* data, std::size_t size, void* userdata)
+{
+    static_cast<QByteArray*>(userdata)->append(static_cast<const char*>(data), static_cast<int>(size));
+    return 0;
+}
+
+} // namespace
+
+LuaStatePool::Lease::Lease(LuaStatePool* pool, State* state)
+    : _pool(pool),
+      _state(state)
+{
+}
+
+LuaStatePool::Lease::Lease(Lease&& other) noexcept
+    : _pool(other._pool),
+      _state(other._state)
+{
+    other._state = nullptr;
+}
+
+LuaStatePool::Lease::~Lease()
+{
+    if (_state)
+    {
+        _pool->release(_state);
+    }
+}
+
+LuaStatePool::LuaStatePool(const QString& luaFile, const QString& baseUrl,
+        std::size_t maxStates, LuaChunkPtr chunk)
+    : _luaFile(luaFile),
+      _baseUrl(baseUrl),
+      _maxStates(std::max<std::size_t>(maxStates, 1)),
+      _chunk(chunk),
+      _cookieJar(std::make_shared<CookieJar>()),
+      _config {},
+      _logger(owl::initializeLogger("LuaStatePool"))
+{
+}
+
+LuaStatePool::~LuaStatePool()
+{
+    Q_ASSERT(_idle.size() == _states.size());
+
+    // closing a state collects its webclients, which unregister themselves
+    _idle.clear();
+    for (StatePtr& state : _states)
+    {
+        lua_close(state->L);
+        removeClient(state->pageClient.get());
+    }
+    _states.clear();
+}
+
+LuaStatePool::Lease LuaStatePool::acquire()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _released.wait(lock, [this]
+        {
+            return !_idle.empty() || _states.size() + _creating < _maxStates;
+        });
+
+    if (!_idle.empty())
+    {
+        State* state = _idle.back();
+        _idle.pop_back();
+        return Lease(this, state);
+    }
+
+    // loading the script can take a while, let the other states be used meanwhile
+    _creating++;
+    lock.unlock();
+
+    StatePtr state;
+    try
+    {
+        state = createState();
+    }
+    catch (...)
+    {
+        lock.lock();
+        _creating--;
+        lock.unlock();
+
+        _released.notify_one();
+        throw;
+    }
+
+    lock.lock();
+    _creating--;
+    _states.push_back(std::move(state));
+
+    _logger->debug("Created Lua state {} of {} for '{}'",
+        _states.size(), _maxStates, _luaFile.toStdString());
+
+    return Lease(this, _states.back().get());
+}
+
+std::size_t LuaStatePool::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _states.size();
+}
+
+WebClientConfig LuaStatePool::getWebClientConfig() const
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+    return _config;
+}
+
+void LuaStatePool::setWebClientConfig(const WebClientConfig& config)
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+
+    _config = config;
+    for (WebClient* client : _clients)
+    {
+        client->setConfig(_config);
+    }
+}
+
+void LuaStatePool::addClient(WebClient* client)
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+
+    if (!_clients.contains(client))
+    {
+        _clients.push_back(client);
+    }
+}
+
+void LuaStatePool::removeClient(WebClient* client)
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+    _clients.removeOne(client);
+}
+
+WebClient* LuaStatePool::pageClient(lua_State* L)
+{
+    // the registry is shared by the coroutines of the state
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &PAGE_CLIENT_KEY);
+    WebClient* client = static_cast<WebClient*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+
+    return client;
+}
+
+LuaStatePool::StatePtr LuaStatePool::createState()
+{
+    lua_State* L = luaL_newstate();
+    if (!L)
+    {
+        OWL_THROW_EXCEPTION(LuaException("could not create a Lua state"));
+    }
+
+    auto state = std::make_unique<State>();
+    state->L = L;
+    state->pageClient = std::make_unique<WebClient>(_cookieJar);
+    state->pageClient->setConfig(getWebClientConfig());
+    addClient(state->pageClient.get());
+
+    try
+    {
+        luaL_openlibs(L);
+
+        // the webclient library finds the cookie jar and settings through
+        // this global
+        lua_pushlightuserdata(L, static_cast<void*>(this));
+        lua_setglobal(L, "__statePool");
+
+        lua_pushlightuserdata(L, state->pageClient.get());
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &PAGE_CLIENT_KEY);
+
+        // register Owl interface in the Lua scripts
+        registerFunctions(L);
+
+        loadScript(L);
+
+        lua_getglobal(L, "Parser");
+        lua_getfield(L, -1, "create");
+        lua_pushstring(L, _baseUrl.toLatin1());
+
+        if (lua_pcall(L, 1, 1, 0) != 0)
+        {
+            QString strMsg = QString("problem calling 'createParser' in %1: %2")
+                .arg(_luaFile)
+                .arg(lua_tostring(L, -1));
+            _logger->error(strMsg.toStdString());
+
+            OWL_THROW_EXCEPTION(LuaException(strMsg));
+        }
+
+        // store the lua object
+        state->object = luaL_ref(L, LUA_REGISTRYINDEX);
+        lua_settop(L, 0);
+    }
+    catch (...)
+    {
+        lua_close(L);
+        removeClient(state->pageClient.get());
+        throw;
+    }
+
+    return state;
+}
+
+void LuaStatePool::loadScript(lua_State* L)
+{
+    int luaStatus = LUA_OK;
+
+    std::unique_lock<std::mutex> lock(_chunkMutex);
+    if (!_chunk)
+    {
+        // the first state compiles the script and keeps the chunk for the others
+        luaStatus = luaL_loadfile(L, _luaFile.toLatin1());
+        if (luaStatus == LUA_OK)
+        {
+            auto chunk = std::make_shared<QByteArray>();
+            lua_dump(L, &writeChunk, chunk.get(), 0);
+            _chunk = chunk;
+        }
+    }
+    else
+    {
+        const LuaChunkPtr chunk = _chunk;
+        lock.unlock();
+
+        const QByteArray chunkName = QString("@%1").arg(_luaFile).toLatin1();
+        luaStatus = luaL_loadbufferx(L, chunk->constData(), static_cast<std::size_t>(chunk->size()),
+            chunkName.constData(), "b");
+    }
+
+    if (luaStatus || lua_pcall(L, 0, 0, 0))
+    {
+        QString strMsg = QString("could not initialize lua parser '%1': %2")
+            .arg(_luaFile)
+            .arg(lua_tostring(L, -1));
+        _logger->error(strMsg.toStdString());
+
+        OWL_THROW_EXCEPTION(LuaException(strMsg));
+    }
+}
+
+void LuaStatePool::release(State* state)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _idle.push_back(state);
+    }
+
+    _released.notify_one();
+}
+
+void LuaStatePool::registerFunctions(lua_State* L)
+{
+	// register the webclient object
+	luaL_newmetatable(L, "Owl.webclient");
+	lua_pushliteral(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);						// metatable.__index = Owl.webclient
+	lua_pushliteral(L, "__call");			// __call(c)
+	luaL_getmetatable(L, "Owl.webclient");
+	luaL_setfuncs(L, webclientlib, 0);
+	lua_setglobal(L, "webclient");			// global object (ie. `local w = webclient.new()`)
+
+	// register the sgmldoc object
+	luaL_newmetatable(L, "Owl.sgml");
+	lua_pushliteral(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);						// metatable.__index = Owl.sgmldoc
+	lua_pushliteral(L, "__call");			// __call(c)
+	luaL_getmetatable(L, "Owl.sgml");
+	luaL_setfuncs(L, sgmllib, 0);
+	lua_setglobal(L, "sgml");				// global object (ie. `local w = sgml.new()`)
+
+	// register the regexp object
+	luaL_newmetatable(L, "Owl.regexp");
+	lua_pushliteral(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);						// metatable.__index = Owl.sgmldoc
+	lua_pushliteral(L, "__call");			// __call(c)
+	luaL_getmetatable(L, "Owl.regexp");
+	luaL_setfuncs(L, regexplib, 0);
+	lua_setglobal(L, "regexp");				// global object (ie. `local w = sgml.new()`)
+
+	// register the sgmltag object
+	luaL_newmetatable(L, "Owl.sgmltag");
+	lua_pushliteral(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);						// metatable.__index = Owl.sgmldoc
+	lua_pushliteral(L, "__call");			// __call(c)
+	luaL_getmetatable(L, "Owl.sgmltag");
+	luaL_setfuncs(L, sgmltaglib, 0);
+	lua_setglobal(L, "sgmltag");			// global object (ie. `local w = sgml.new()`)
+
+	lua_newtable(L);
+	luaL_setfuncs(L, owlutilslib, 0);
+	lua_setglobal(L, "utils");				// utils object
+
+	lua_newtable(L);
+	luaL_setfuncs(L, errorlib, 0);
+	lua_setglobal(L, "error");
+
+	lua_newtable(L);
+	lua_pushstring(L, "FORUM");
+	lua_pushnumber(L, Forum::FORUM);
+	lua_settable(L, -3);
+	lua_pushstring(L, "CATEGORY");
+	lua_pushnumber(L, Forum::CATEGORY);
+	lua_settable(L, -3);
+	lua_pushstring(L, "LINK");
+	lua_pushnumber(L, Forum::LINK);
+	lua_settable(L, -3);
+	lua_setglobal(L, "ForumType");
+}
+
+} // namespace owl
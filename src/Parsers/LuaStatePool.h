@@ -0,0 +1,142 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <QtCore>
+#include <lua.hpp>
+#include "../Utils/WebClient.h"
+
+namespace spdlog
+{
+    class logger;
+}
+
+namespace owl
+{
+
+// most Lua states a parser script runs at once, requests beyond that wait
+// for a state to be returned
+constexpr std::size_t MAX_LUA_STATES = 4;
+
+class LuaStatePool;
+using LuaStatePoolPtr = std::shared_ptr<LuaStatePool>;
+
+// a compiled Lua script, as written by lua_dump()
+using LuaChunkPtr = std::shared_ptr<const QByteArray>;
+
+// Independent Lua states running the same parser script, each with its own
+// `Parser` object. A LuaParserBase and its clones share a pool and check out
+// a state for each request so they can run at the same time.
+//
+// Each state keeps a webclient for the `getWebPage()` helper, so the fetches
+// of a script reuse the connections of the previous ones.
+//
+// The script is compiled by the first state unless it is given compiled (see
+// LuaScriptCache), the other states load the compiled chunk. The webclients
+// created by the states share the pool's cookie jar, so the session of a
+// board is the same whichever state serves a request.
+class LuaStatePool final
+{
+    struct State
+    {
+        lua_State*                  L = nullptr;
+        int                         object = LUA_NOREF;     // registry reference of the `Parser` object
+        std::unique_ptr<WebClient>  pageClient;             // used by getWebPage()
+    };
+
+    using StatePtr = std::unique_ptr<State>;
+
+public:
+    // A checked out state, which is returned to the pool on destruction
+    class Lease
+    {
+    public:
+        Lease(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        lua_State* state() const { return _state->L; }
+
+        // the registry reference of the state's `Parser` object
+        int object() const { return _state->object; }
+
+    private:
+        friend class LuaStatePool;
+        Lease(LuaStatePool* pool, State* state);
+
+        LuaStatePool*   _pool;
+        State*          _state;
+    };
+
+    LuaStatePool(const QString& luaFile, const QString& baseUrl,
+        std::size_t maxStates = MAX_LUA_STATES, LuaChunkPtr chunk = LuaChunkPtr());
+
+    LuaStatePool(const LuaStatePool&) = delete;
+    LuaStatePool& operator=(const LuaStatePool&) = delete;
+
+    // every lease must have been returned
+    ~LuaStatePool();
+
+    const QString& luaFile() const { return _luaFile; }
+
+    // Returns the idle state that was used last, or a new state if they
+    // are all busy, or waits for one if the pool is full. Throws an
+    // owl::LuaException if the script cannot be loaded
+    Lease acquire();
+
+    // the number of states created so far
+    std::size_t size() const;
+
+    CookieJarPtr getCookieJar() const { return _cookieJar; }
+
+    WebClientConfig getWebClientConfig() const;
+
+    // applies `config` to every webclient created by the states
+    void setWebClientConfig(const WebClientConfig& config);
+
+    // called by the webclient library of the states
+    void addClient(WebClient* client);
+    void removeClient(WebClient* client);
+
+    // the webclient kept by the state running `L`, nullptr if `L` does not
+    // belong to a pool
+    static WebClient* pageClient(lua_State* L);
+
+private:
+    StatePtr createState();
+    void loadScript(lua_State* L);
+    void release(State* state);
+
+    static void registerFunctions(lua_State* L);
+
+    const QString                   _luaFile;
+    const QString                   _baseUrl;
+    const std::size_t               _maxStates;
+
+    mutable std::mutex              _mutex;
+    std::condition_variable         _released;
+    std::vector<StatePtr>           _states;
+    std::vector<State*>             _idle;          // the last one was returned last
+    std::size_t                     _creating = 0;  // states being created outside the lock
+
+    std::mutex                      _chunkMutex;
+    LuaChunkPtr                     _chunk;         // the compiled script
+
+    const CookieJarPtr              _cookieJar;
+
+    mutable std::mutex              _clientsMutex;
+    WebClientConfig                 _config;
+    QList<WebClient*>               _clients;
+
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+} // namespace owl
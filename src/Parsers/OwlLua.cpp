@@ -1,12 +1,397 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <new>
 #include "../Utils/QSgml.h"
 #include "../Utils/WebClient.h"
 #include "../Utils/StringMap.h"
 #include "LuaParserBase.h"
+#include "LuaStatePool.h"
 #include "OwlLua.h"
 
 namespace owl
 {
+
+namespace
+{
+
+// the address of this is the registry key of the table mapping the
+// coroutines run by utils.parallel() to their TaskSignal
+char PARALLEL_TASKS_KEY = 0;
+
+// the address of this is yielded by the webclient bindings along with the
+// PendingRequest the task waits for
+char PENDING_REQUEST_KEY = 0;
+
+// Wakes up utils.parallel() when a transfer started by one of its tasks
+// has completed
+struct TaskSignal : public std::enable_shared_from_this<TaskSignal>
+{
+    std::mutex              mutex;
+    std::condition_variable completed;
+    std::uint64_t           count = 0;      // transfers completed so far
+
+    WebClient::ReplyCallback notifier()
+    {
+        return [self = shared_from_this()](WebClient::ReplyPtr)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(self->mutex);
+                    self->count++;
+                }
+
+                self->completed.notify_all();
+            };
+    }
+};
+
+// The transfers a task is waiting for, the results of getAll() are
+// returned as one table
+struct PendingRequest
+{
+    std::vector<std::future<WebClient::ReplyPtr>> replies;
+    bool many = false;
+
+    bool isReady() const
+    {
+        return std::all_of(replies.begin(), replies.end(),
+            [](const std::future<WebClient::ReplyPtr>& reply)
+            {
+                return reply.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            });
+    }
+};
+
+using PendingRequestPtr = std::unique_ptr<PendingRequest>;
+
+// Pushes the body of `reply` as is, a Lua string can hold any bytes so
+// pages that are not Latin-1 reach the script intact
+void pushBody(lua_State* L, const WebClient::ReplyPtr& reply)
+{
+    if (reply)
+    {
+        const auto data = reply->data();
+        lua_pushlstring(L, data.data(), data.size());
+    }
+    else
+    {
+        lua_pushliteral(L, "");
+    }
+}
+
+// Pushes the html, status and isError of the reply returned by `request`
+template<typename RequestT>
+int pushRequest(lua_State* L, RequestT request)
+{
+	WebClient::ReplyPtr	reply;
+	int			status = 200;
+	bool		bIsError = false;
+
+	try
+	{
+		reply = request();
+		if (reply)
+		{
+			status = static_cast<int>(reply->status());
+		}
+	}
+	catch (const WebException& ex)
+	{
+		bIsError = true;
+		status = ex.statuscode();
+	}
+
+	pushBody(L, reply);
+	lua_pushinteger(L, status);
+	lua_pushboolean(L, bIsError);
+
+	return 3;
+}
+
+// Pushes the html, status and isError of a transfer, waiting for it if needed
+void pushReply(lua_State* L, std::future<WebClient::ReplyPtr>& reply)
+{
+	pushRequest(L, [&reply]() { return reply.get(); });
+}
+
+// Pushes the results of a request and returns how many there are
+int pushResults(lua_State* L, PendingRequest& request)
+{
+    if (!request.many)
+    {
+        pushReply(L, request.replies.front());
+        return 3;
+    }
+
+    lua_createtable(L, static_cast<int>(request.replies.size()), 0);
+    for (std::size_t i = 0; i < request.replies.size(); i++)
+    {
+        lua_createtable(L, 0, 3);
+        pushReply(L, request.replies[i]);
+        lua_setfield(L, -4, "isError");
+        lua_setfield(L, -3, "status");
+        lua_setfield(L, -2, "html");
+        lua_rawseti(L, -2, static_cast<int>(i + 1));
+    }
+
+    return 1;
+}
+
+// Returns the TaskSignal of the utils.parallel() call running `L`, or
+// nullptr if `L` is not one of its tasks
+TaskSignal* currentTask(lua_State* L)
+{
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &PARALLEL_TASKS_KEY);
+    if (!lua_istable(L, -1))
+    {
+        lua_pop(L, 1);
+        return nullptr;
+    }
+
+    lua_pushthread(L);
+    lua_rawget(L, -2);
+
+    auto task = static_cast<TaskSignal*>(lua_touserdata(L, -1));
+    lua_pop(L, 2);
+
+    return task;
+}
+
+// Makes the coroutine at `index` a task of `signal`
+void addTask(lua_State* L, int index, TaskSignal* signal)
+{
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &PARALLEL_TASKS_KEY);
+    if (!lua_istable(L, -1))
+    {
+        lua_pop(L, 1);
+
+        // the coroutines are weak keys so that finished tasks are collected
+        lua_newtable(L);
+        lua_newtable(L);
+        lua_pushliteral(L, "k");
+        lua_setfield(L, -2, "__mode");
+        lua_setmetatable(L, -2);
+
+        lua_pushvalue(L, -1);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &PARALLEL_TASKS_KEY);
+    }
+
+    lua_pushvalue(L, index);
+    lua_pushlightuserdata(L, signal);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+}
+
+// Suspends the calling task until the transfers of `request` have
+// completed, runTasks() resumes it with their results. Yielding unwinds the
+// C stack, so the caller must not hold anything that owns memory
+int yieldRequest(lua_State* L, PendingRequestPtr request)
+{
+    lua_pushlightuserdata(L, &PENDING_REQUEST_KEY);
+    lua_pushlightuserdata(L, request.release());
+    return lua_yield(L, 2);
+}
+
+int yieldRequest(lua_State* L, std::future<WebClient::ReplyPtr> reply)
+{
+    auto request = std::make_unique<PendingRequest>();
+    request->replies.push_back(std::move(reply));
+    return yieldRequest(L, std::move(request));
+}
+
+// Runs the functions at 1..count of the stack as coroutines until they have
+// all returned, storing the first result of each in the table at `results`.
+// A task waiting on a transfer is resumed once the transfer has completed,
+// the others run meanwhile. Returns false with the error on top of the
+// stack if a task fails
+bool runTasks(lua_State* L, int count, int results)
+{
+    struct Task
+    {
+        lua_State*          co = nullptr;
+        bool                done = false;
+        PendingRequestPtr   pending;
+    };
+
+    auto signal = std::make_shared<TaskSignal>();
+    std::vector<Task> tasks(static_cast<std::size_t>(count));
+
+    // the coroutines stay on the stack so they are not collected
+    for (int i = 0; i < count; i++)
+    {
+        tasks[i].co = lua_newthread(L);
+        addTask(L, lua_gettop(L), signal.get());
+
+        lua_pushvalue(L, i + 1);
+        lua_xmove(L, tasks[i].co, 1);
+    }
+
+    int running = count;
+    while (running > 0)
+    {
+        std::uint64_t seen = 0;
+        {
+            std::lock_guard<std::mutex> lock(signal->mutex);
+            seen = signal->count;
+        }
+
+        bool resumed = false;
+        for (int i = 0; i < count; i++)
+        {
+            Task& task = tasks[i];
+            if (task.done || (task.pending && !task.pending->isReady()))
+            {
+                continue;
+            }
+
+            int nargs = 0;
+            if (task.pending)
+            {
+                nargs = pushResults(task.co, *task.pending);
+                task.pending.reset();
+            }
+
+            resumed = true;
+
+            // the values yielded or returned are the top `nresults` of the stack
+            int nresults = 0;
+            const int status = lua_resume(task.co, L, nargs, &nresults);
+
+            if (status == LUA_YIELD)
+            {
+                if (nresults != 2 || lua_touserdata(task.co, -2) != &PENDING_REQUEST_KEY)
+                {
+                    lua_pushliteral(L, "utils.parallel: tasks can only yield on webclient requests");
+                    return false;
+                }
+
+                task.pending.reset(static_cast<PendingRequest*>(lua_touserdata(task.co, -1)));
+                lua_pop(task.co, nresults);
+            }
+            else if (status == LUA_OK)
+            {
+                task.done = true;
+                running--;
+
+                if (nresults > 0)
+                {
+                    // keep the first result
+                    lua_pop(task.co, nresults - 1);
+                    lua_xmove(task.co, L, 1);
+                }
+                else
+                {
+                    lua_pushnil(L);
+                }
+
+                lua_rawseti(L, results, i + 1);
+            }
+            else
+            {
+                lua_xmove(task.co, L, 1);
+                return false;
+            }
+        }
+
+        if (!resumed)
+        {
+            std::unique_lock<std::mutex> lock(signal->mutex);
+            signal->completed.wait(lock, [&signal, seen] { return signal->count != seen; });
+        }
+    }
+
+    return true;
+}
+
+// Pushes `text` as UTF-8, which is how the bindings read strings back
+void pushString(lua_State* L, const QString& text)
+{
+    const QByteArray bytes = text.toUtf8();
+    lua_pushlstring(L, bytes.constData(), static_cast<std::size_t>(bytes.size()));
+}
+
+// The elements matched by doc:each() and doc:first(), the same ones as
+// doc:getElementsByName() with the same arguments. Like QSgml, the name is
+// only lower cased when no attribute is given, and a value or regexp
+// without an attribute matches nothing
+struct ElementFilter
+{
+    QString     name;           // nothing matches an empty name
+    QString     attribute;      // the element must have it, unless empty
+    QString     value;          // that the attribute must have, if hasValue
+    bool        hasValue = false;
+    QRegExp*    exp = nullptr;  // that the attribute must match, owned by its Lua userdata
+
+    bool matches(const QSgmlTag& tag) const
+    {
+        if (name.isEmpty() || tag.Name != name)
+        {
+            return false;
+        }
+
+        if (attribute.isEmpty() && !hasValue && exp == nullptr)
+        {
+            return true;
+        }
+
+        const auto it = tag.Attributes.constFind(attribute);
+        if (it == tag.Attributes.constEnd())
+        {
+            return false;
+        }
+
+        if (exp != nullptr)
+        {
+            return exp->indexIn(it.value()) != -1;
+        }
+
+        return !hasValue || it.value() == value;
+    }
+};
+
+// Reads the name, attribute and value (a string or a regexp) arguments
+// starting at `index`
+ElementFilter checkElementFilter(lua_State* L, int index)
+{
+    // checked before any QString is created since a failed check longjmps
+    const char* name = luaL_checkstring(L, index);
+    const char* attribute = lua_tostring(L, index + 1);
+    const char* value = nullptr;
+    QRegExp* exp = nullptr;
+
+    if (lua_isuserdata(L, index + 2))
+    {
+        exp = *static_cast<QRegExp**>(luaL_checkudata(L, index + 2, "Owl.regexp"));
+    }
+    else
+    {
+        value = lua_tostring(L, index + 2);
+    }
+
+    ElementFilter filter;
+    filter.attribute = QString(attribute);
+    filter.name = filter.attribute.isEmpty() ? QString(name).toLower() : QString(name);
+    filter.value = QString(value);
+    filter.hasValue = value != nullptr;
+    filter.exp = exp;
+
+    return filter;
+}
+
+// The state of a doc:each() loop
+struct ElementIterator
+{
+    QSgmlTag*       next = nullptr;     // where the search resumes, nullptr once done
+    ElementFilter   filter;
+};
+
+} // namespace
 	
+int OwlLua::pushResponse(lua_State* L, const WebClient::ReplyPtr& reply)
+{
+	return pushRequest(L, [&reply]() { return reply; });
+}
+
 StringMap OwlLua::tableToParams(lua_State* L, int tablePos)
 {
 	StringMap params;
@@ -81,48 +466,91 @@ int OwlLua::doCDebug(lua_State* L)
 	return 0;
 }
 
+// utils.getWebPage(url,method,postData)
+// url			- (string) of the page
+// [method]		- (string) "GET" or "POST", defaults to "GET"
+// [postData]	- (string) the payload of a POST
+// Returns:
+// html			- (string) the body of the page, as sent by the server
+// stats		- (int) HTTP status code
+// isError		- (boolean) true if there was an error
+// The page is fetched with the webclient kept by the Lua state, which shares
+// the cookies of the parser's webclients and keeps its connections open
 int OwlLua::getWebPage(lua_State* L)
 {
-    WebClient	client;
-	QString		pageSrc;
-	int			status = 200;
-	bool		bIsError = false;
+	WebClient* client = LuaStatePool::pageClient(L);
+	if (!client)
+	{
+		return luaL_error(L, "getWebPage: the Lua state has no webclient");
+	}
+
 	QString strUrl(luaL_checkstring(L, 1));
 	QString strMethod(lua_tostring(L, 2));
-	QString strPostData(lua_tostring(L, 3));
+
+	std::size_t length = 0;
+	const char* postData = lua_tolstring(L, 3, &length);
+	QByteArray payload(postData, postData ? static_cast<int>(length) : 0);
 	
 	if (strMethod.isEmpty())
 	{
 		strMethod.append("GET");
 	}
 
-	try
+	const bool bIsPost = strMethod == "POST";
+	if (!bIsPost && strMethod != "GET")
 	{
-		if (strMethod == "GET")
-		{
-			pageSrc = client.DownloadString(strUrl);
-		}
-		else if (strMethod == "POST")
-		{
-			pageSrc = client.UploadString(strUrl, strPostData);
-		}
-		else
+		QString strError = QString("invalid #2 param 'method' in getWebPage: '%1'").arg(strMethod);
+		OWL_THROW_EXCEPTION(LuaException(strError));
+	}
+
+	if (TaskSignal* task = currentTask(L))
+	{
+		auto reply = bIsPost
+			? client->PostUrlAsync(strUrl, payload, WebClient::DEFAULT, task->notifier())
+			: client->GetUrlAsync(strUrl, WebClient::DEFAULT, task->notifier());
+		strUrl.clear();
+		strMethod.clear();
+		payload.clear();
+		return yieldRequest(L, std::move(reply));
+	}
+
+	return pushRequest(L, [&]()
 		{
-			QString strError = QString("invalid #2 param 'method' in getWebPage: '%1'").arg(strMethod);
-            OWL_THROW_EXCEPTION(LuaException(strError));
-		}
+			return bIsPost ? client->PostUrl(strUrl, payload) : client->GetUrl(strUrl);
+		});
+}
+
+// utils.parallel(fn1,fn2,...)
+// fn			- (function) run as a coroutine, a webclient request made by it
+//				  suspends it until the transfer has completed and lets the
+//				  other functions run meanwhile
+// Returns:
+// the first result of each function, in order
+int OwlLua::runParallel(lua_State* L)
+{
+	const int count = lua_gettop(L);
+	for (int i = 1; i <= count; i++)
+	{
+		luaL_checktype(L, i, LUA_TFUNCTION);
 	}
-	catch (const WebException& ex)
+
+	luaL_checkstack(L, count + LUA_MINSTACK, "too many functions");
+
+	lua_createtable(L, count, 0);
+	const int results = lua_gettop(L);
+
+	if (!runTasks(L, count, results))
 	{
-		bIsError = true;
-		status = ex.statuscode();
+		return lua_error(L);
 	}
 
-	lua_pushstring(L, pageSrc.toLatin1());
-	lua_pushnumber(L, status);
-	lua_pushboolean(L, bIsError);
+	lua_settop(L, results);
+	for (int i = 1; i <= count; i++)
+	{
+		lua_rawgeti(L, results, i);
+	}
 
-	return 3;
+	return count;
 }
 
 int OwlLua::getMD5String(lua_State* L)
@@ -184,24 +612,22 @@ int OwlLua::SgmlErrorThrow(lua_State* L)
 
 int OwlLua::newWebClient(lua_State* L)
 {
-	lua_getglobal(L, "__parserObj");
+	lua_getglobal(L, "__statePool");
 	Q_ASSERT(lua_islightuserdata(L, -1));
 
-	ParserBase* parser = static_cast<ParserBase*>(lua_touserdata(L, -1));
-	Q_ASSERT(parser != nullptr);    
+	LuaStatePool* pool = static_cast<LuaStatePool*>(lua_touserdata(L, -1));
+	Q_ASSERT(pool != nullptr);
 
     std::size_t size = sizeof(WebClient*);
 
-	// create the new WebClient
+	// create the new WebClient, the webclients of every state of the pool
+	// share its cookie jar
     WebClient** data = static_cast<WebClient**>(lua_newuserdata(L, size));
-    *data = new WebClient();
-	(*data)->setConfig(parser->createWebClientConfig());
+    *data = new WebClient(pool->getCookieJar());
+	(*data)->setConfig(pool->getWebClientConfig());
 
 	// register the webclient object as a watcher of the parser settings
-	parser->addWatcher(*data);
-
-//    // set the cookie jar for our new webobject
-//    (*data)->setCookieJar(parser->getCookieJar());
+	pool->addClient(*data);
 
 	// set the metatable
 	luaL_setmetatable(L, "Owl.webclient");
@@ -231,23 +657,14 @@ int OwlLua::WebClientGet(lua_State* L)
         options = WebClient::NOCACHE;
 	}
 
-	QString		pageSrc;
-	int			status = 200;
-	bool		bIsError = false;
-
-	try
+	if (TaskSignal* task = currentTask(L))
 	{
-		pageSrc = client->DownloadString(url, options);
-	}
-	catch (const WebException& ex)
-	{
-		bIsError = true;
-		status = ex.statuscode();
+		auto reply = client->GetUrlAsync(url, options, task->notifier());
+		url.clear();
+		return yieldRequest(L, std::move(reply));
 	}
 
-	lua_pushstring(L, pageSrc.toLatin1());
-	lua_pushnumber(L, status);
-	lua_pushboolean(L, bIsError);
+	pushRequest(L, [&]() { return client->GetUrl(url, options); });
 	lua_gc(L, LUA_GCCOLLECT, 0);
 		
 	return 3;
@@ -260,25 +677,21 @@ int OwlLua::WebClientGetRaw(lua_State* L)
 
 	url = luaL_checkstring(L, -1);
 
-	QString		pageSrc;
-	int			status = 200;
-	bool		bIsError = false;
-
-	try
+	if (TaskSignal* task = currentTask(L))
 	{
-        pageSrc = client->DownloadString(url, WebClient::NOTIDY |
-                                         WebClient::NOENCRYPT |
-                                         WebClient::NOCACHE);
-	}
-	catch (const WebException& ex)
-	{
-		bIsError = true;
-		status = ex.statuscode();
+		auto reply = client->GetUrlAsync(url,
+            WebClient::NOTIDY | WebClient::NOENCRYPT | WebClient::NOCACHE,
+            task->notifier());
+		url.clear();
+		return yieldRequest(L, std::move(reply));
 	}
 
-	lua_pushstring(L, pageSrc.toLatin1());
-	lua_pushnumber(L, status);
-	lua_pushboolean(L, bIsError);
+	pushRequest(L, [&]()
+		{
+			return client->GetUrl(url, WebClient::NOTIDY |
+                                       WebClient::NOENCRYPT |
+                                       WebClient::NOCACHE);
+		});
 	lua_gc(L, LUA_GCCOLLECT, 0);
 
 	return 3;
@@ -316,23 +729,15 @@ int OwlLua::WebClientPost(lua_State* L)
         options = WebClient::NOCACHE;
 	}
 
-	QString		pageSrc;
-	int			status = 200;
-	bool		bIsError = false;
-
-	try
+	if (TaskSignal* task = currentTask(L))
 	{
-		pageSrc = client->UploadString(url, payload, options);
-	}
-	catch (const WebException& ex)
-	{
-		bIsError = true;
-		status = ex.statuscode();
+		auto reply = client->PostUrlAsync(url, payload, options, task->notifier());
+		url.clear();
+		payload.clear();
+		return yieldRequest(L, std::move(reply));
 	}
 
-	lua_pushstring(L, pageSrc.toLatin1());
-	lua_pushnumber(L, status);
-	lua_pushboolean(L, bIsError);
+	pushRequest(L, [&]() { return client->PostUrl(url, payload, options); });
 	lua_gc(L, LUA_GCCOLLECT, 0);
 
 	return 3;
@@ -345,29 +750,75 @@ int OwlLua::WebClientPostRaw(lua_State* L)
 	QString payload = luaL_checkstring(L, -1);
 	QString url = luaL_checkstring(L, -2);
 
-	QString		pageSrc;
-	int			status = 200;
-	bool		bIsError = false;
+	if (TaskSignal* task = currentTask(L))
+	{
+		auto reply = client->PostUrlAsync(url, payload,
+            WebClient::NOTIDY | WebClient::NOENCRYPT | WebClient::NOCACHE,
+            task->notifier());
+		url.clear();
+		payload.clear();
+		return yieldRequest(L, std::move(reply));
+	}
 
-	try
+	pushRequest(L, [&]()
+		{
+			return client->PostUrl(url, payload,
+                WebClient::NOTIDY |
+                WebClient::NOENCRYPT |
+                WebClient::NOCACHE);
+		});
+	lua_gc(L, LUA_GCCOLLECT, 0);
+
+	return 3;
+}
+
+// webclient:getAll(urls,skipCache)
+// urls			- (table) array of the urls to get
+// [skipCache]	- (boolean) whether or not to skip the webClient cache
+// Returns:
+// pages		- (table) array of {html, status, isError} tables, in the order
+//				  of `urls`
+// The pages are downloaded concurrently
+int OwlLua::WebClientGetAll(lua_State* L)
+{
+    WebClient* client = checkWebClient(L);
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+    WebClient::Options options = WebClient::DEFAULT;
+	if (lua_toboolean(L, 3))
 	{
-		pageSrc = client->UploadString(url, payload, 
-            WebClient::NOTIDY |
-            WebClient::NOENCRYPT |
-            WebClient::NOCACHE);
+        options = WebClient::NOCACHE;
 	}
-	catch (const WebException& ex)
+
+	QStringList urls;
+	const int count = static_cast<int>(lua_rawlen(L, 2));
+	for (int i = 1; i <= count; i++)
 	{
-		bIsError = true;
-		status = ex.statuscode();
+		lua_rawgeti(L, 2, i);
+		urls.push_back(QString(luaL_checkstring(L, -1)));
+		lua_pop(L, 1);
 	}
 
-	lua_pushstring(L, pageSrc.toLatin1());
-	lua_pushnumber(L, status);
-	lua_pushboolean(L, bIsError);
+	TaskSignal* task = currentTask(L);
+
+	auto request = std::make_unique<PendingRequest>();
+	request->many = true;
+	for (const QString& url : urls)
+	{
+		request->replies.push_back(client->GetUrlAsync(url, options,
+			task ? task->notifier() : WebClient::ReplyCallback()));
+	}
+
+	if (task)
+	{
+		urls.clear();
+		return yieldRequest(L, std::move(request));
+	}
+
+	const int nresults = pushResults(L, *request);
 	lua_gc(L, LUA_GCCOLLECT, 0);
 
-	return 3;
+	return nresults;
 }
 
 int OwlLua::WebClientGetLastUrl(lua_State* L)
@@ -381,13 +832,13 @@ int OwlLua::WebClientDestructor(lua_State* L)
 {
     WebClient* client = checkWebClient(L);
 
-	lua_getglobal(L, "__parserObj");
+	lua_getglobal(L, "__statePool");
 	Q_ASSERT(lua_islightuserdata(L, -1));
 
-	ParserBase* parser = static_cast<ParserBase*>(lua_touserdata(L, -1));
-	Q_ASSERT(parser != nullptr);
+	LuaStatePool* pool = static_cast<LuaStatePool*>(lua_touserdata(L, -1));
+	Q_ASSERT(pool != nullptr);
 
-	parser->removeWatcher(client);
+	pool->removeClient(client);
 	
 	delete client;
 
@@ -533,12 +984,12 @@ int OwlLua::SgmlGetElementsByName(lua_State* L)
 
 	if (lua_isstring(L, -3))
 	{
-		element = QString::fromLatin1(lua_tostring(L, -3));
+		element = QString::fromUtf8(lua_tostring(L, -3));
 	}
 
 	if (lua_isstring(L, -2))
 	{
-		attribute = QString::fromLatin1(lua_tostring(L, -2));
+		attribute = QString::fromUtf8(lua_tostring(L, -2));
 	}
 
 	// the first arg is required
@@ -568,7 +1019,7 @@ int OwlLua::SgmlGetElementsByName(lua_State* L)
 			if (!attribute.isEmpty())
 			{
 				// doc:getElementsByName("foo","bar",nil)
-				attribute = QString::fromLatin1(lua_tostring(L, -2));
+				attribute = QString::fromUtf8(lua_tostring(L, -2));
 				exp->getElementsByName(element, attribute, &tags);
 			}
 			else
@@ -624,7 +1075,7 @@ int OwlLua::SgmlDocGetText(lua_State* L)
     if (doc != nullptr && tag != nullptr)
 	{
 		doc->getText(tag, &strText);
-		lua_pushstring(L, strText.toLatin1());
+		pushString(L, strText);
 	}
 	else
 	{
@@ -640,7 +1091,7 @@ int OwlLua::SgmlGetDocText(lua_State* L)
 
 	QString strHtml; 
 	doc->ExportString(&strHtml);
-	lua_pushstring(L, strHtml.toLatin1());
+	pushString(L, strHtml);
 
 	return 1;
 }
@@ -658,6 +1109,155 @@ QSgml* OwlLua::checkSgml(lua_State* L, int index)
 	return *(QSgml**)luaL_checkudata(L, index, "Owl.sgml");
 }
 
+SgmlSelectorPtr OwlLua::checkSelector(lua_State* L, int index)
+{
+	const QString text(luaL_checkstring(L, index));
+	SgmlSelectorPtr selector;
+	QString error;
+
+	try
+	{
+		selector = SgmlSelector::compile(text);
+	}
+	catch (const Exception& ex)
+	{
+		error = ex.message();
+	}
+
+	if (!selector)
+	{
+		// raised outside of the catch block since it longjmps
+		luaL_argerror(L, index, error.toLatin1().constData());
+	}
+
+	return selector;
+}
+
+void OwlLua::pushSgmlTag(lua_State* L, QSgmlTag* tag)
+{
+	if (tag != nullptr)
+	{
+		*((QSgmlTag**)lua_newuserdata(L, sizeof(QSgmlTag**))) = tag;
+		luaL_setmetatable(L, "Owl.sgmltag");
+	}
+	else
+	{
+		lua_pushnil(L);
+	}
+}
+
+void OwlLua::pushSgmlTags(lua_State* L, const QList<QSgmlTag*>& tags)
+{
+	lua_createtable(L, tags.size(), 0);
+
+	int i = 1;
+	for (QSgmlTag* tag : tags)
+	{
+		pushSgmlTag(L, tag);
+		lua_rawseti(L, -2, i++);
+	}
+}
+
+// local posts = doc:select("ol#messageList li.message")
+int OwlLua::SgmlSelect(lua_State* L)
+{
+	QSgml* doc = checkSgml(L);
+	const auto selector = checkSelector(L);
+
+	pushSgmlTags(L, selector->select(*doc));
+	return 1;
+}
+
+// local title = doc:selectFirst("h1.title")
+int OwlLua::SgmlSelectFirst(lua_State* L)
+{
+	QSgml* doc = checkSgml(L);
+	const auto selector = checkSelector(L);
+
+	pushSgmlTag(L, selector->selectFirst(*doc));
+	return 1;
+}
+
+// for tag in doc:each("a", "class", "username") do ... end
+// Iterates over the elements doc:getElementsByName() would return, each one
+// is only searched for when the loop asks for it so a loop that breaks early
+// does not go through the rest of the document. The document must not be
+// parsed again during the loop
+int OwlLua::SgmlEach(lua_State* L)
+{
+	QSgml* doc = checkSgml(L);
+	lua_settop(L, 4);
+
+	ElementFilter filter = checkElementFilter(L, 2);
+
+	auto iterator = static_cast<ElementIterator*>(lua_newuserdata(L, sizeof(ElementIterator)));
+	new (iterator) ElementIterator { doc->DocTag, std::move(filter) };
+
+	if (luaL_newmetatable(L, "Owl.sgmliterator"))
+	{
+		lua_pushcfunction(L, &OwlLua::SgmlEachDestructor);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_setmetatable(L, -2);
+
+	// the document and the regexp are kept alive by the loop
+	lua_pushvalue(L, 1);
+	lua_pushvalue(L, 4);
+	lua_pushcclosure(L, &OwlLua::SgmlEachNext, 3);
+
+	return 1;
+}
+
+int OwlLua::SgmlEachNext(lua_State* L)
+{
+	auto iterator = static_cast<ElementIterator*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+	while (iterator->next != nullptr && iterator->next->Type != QSgmlTag::eVirtualEndTag)
+	{
+		QSgmlTag* tag = iterator->next;
+		iterator->next = &tag->getNextElement();
+
+		if (iterator->filter.matches(*tag))
+		{
+			pushSgmlTag(L, tag);
+			return 1;
+		}
+	}
+
+	iterator->next = nullptr;
+	lua_pushnil(L);
+
+	return 1;
+}
+
+int OwlLua::SgmlEachDestructor(lua_State* L)
+{
+	auto iterator = static_cast<ElementIterator*>(luaL_checkudata(L, 1, "Owl.sgmliterator"));
+	iterator->~ElementIterator();
+
+	return 0;
+}
+
+// local link = doc:first("link", "rel", "next")
+// Returns the first element doc:getElementsByName() would return, or nil,
+// without searching the rest of the document
+int OwlLua::SgmlFirst(lua_State* L)
+{
+	QSgml* doc = checkSgml(L);
+	lua_settop(L, 4);
+
+	const ElementFilter filter = checkElementFilter(L, 2);
+
+	QSgmlTag* tag = doc->DocTag;
+	while (tag->Type != QSgmlTag::eVirtualEndTag && !filter.matches(*tag))
+	{
+		tag = &tag->getNextElement();
+	}
+
+	pushSgmlTag(L, tag->Type != QSgmlTag::eVirtualEndTag ? tag : nullptr);
+	return 1;
+}
+
 /////////////////////////////////////////////////////////////////////
 // QSgmlTag methods
 /////////////////////////////////////////////////////////////////////
@@ -665,7 +1265,7 @@ QSgml* OwlLua::checkSgml(lua_State* L, int index)
 int OwlLua::SgmlTagName(lua_State* L)
 {
 	QSgmlTag* tag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
-	lua_pushstring(L, tag->Name.toLatin1());
+	pushString(L, tag->Name);
 	return 1;
 }
 
@@ -681,7 +1281,47 @@ int OwlLua::SgmlTagAttribute(lua_State* L)
 		attrVal = tag->Attributes.value(attrName);
 	}
 
-	lua_pushstring(L, attrVal.toLatin1());
+	pushString(L, attrVal);
+	return 1;
+}
+
+// local attrs = tag:attributes{ "href", "title" }
+// Returns a table with the value of each named attribute, or "" if the tag
+// does not have it like tag:attribute(). Without a table, all of the
+// attributes of the tag are returned
+int OwlLua::SgmlTagAttributes(lua_State* L)
+{
+	QSgmlTag* tag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
+
+	if (lua_istable(L, 2))
+	{
+		const int count = static_cast<int>(lua_rawlen(L, 2));
+		lua_createtable(L, 0, count);
+
+		for (int i = 1; i <= count; i++)
+		{
+			lua_rawgeti(L, 2, i);
+			if (lua_type(L, -1) != LUA_TSTRING)
+			{
+				return luaL_argerror(L, 2, "attribute names must be strings");
+			}
+
+			pushString(L, tag->Attributes.value(QString(lua_tostring(L, -1))));
+			lua_rawset(L, -3);
+		}
+	}
+	else
+	{
+		lua_createtable(L, 0, tag->Attributes.size());
+
+		for (auto it = tag->Attributes.constBegin(); it != tag->Attributes.constEnd(); ++it)
+		{
+			pushString(L, it.key());
+			pushString(L, it.value());
+			lua_rawset(L, -3);
+		}
+	}
+
 	return 1;
 }
 
@@ -736,38 +1376,22 @@ int OwlLua::SgmlTagEndTagLength(lua_State* L)
 int OwlLua::SgmlTagChildren(lua_State* L)
 {
     QSgmlTag* sgmltag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
-	lua_newtable(L);
-	int i = 1;
-	int size = sizeof(QSgmlTag**);
-
-    for (QSgmlTag* tag : sgmltag->Children)
-	{
-		lua_pushnumber(L, i);
-		*((QSgmlTag**)lua_newuserdata(L, size)) = tag;
-		luaL_setmetatable(L, "Owl.sgmltag");
-		lua_settable(L, -3);
-		i++;
-	}
-
+	pushSgmlTags(L, sgmltag->Children);
 	return 1;
 }
 
+// the previous and next tags on the same level, or nil
 int OwlLua::SgmlTagPrevious(lua_State* L)
 {
 	QSgmlTag* tag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
-	QSgmlTag* prev = tag->getPrevious();
-
-    if (prev != nullptr)
-	{
-		int size = sizeof(QSgmlTag**);
-		*((QSgmlTag**)lua_newuserdata(L, size)) = prev;
-		luaL_setmetatable(L, "Owl.sgmltag");
-	}
-	else
-	{
-		lua_pushnil(L);
-	}
+	pushSgmlTag(L, tag->getPreviousSibling());
+	return 1;
+}
 
+int OwlLua::SgmlTagNext(lua_State* L)
+{
+	QSgmlTag* tag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
+	pushSgmlTag(L, tag->getNextSibling());
 	return 1;
 }
 
@@ -804,7 +1428,7 @@ int OwlLua::SgmlTagValue(lua_State* L)
 
     if (tag != nullptr)
 	{
-		lua_pushstring(L, tag->Value.toLatin1());
+		pushString(L, tag->Value);
 	}
 	else
 	{
@@ -814,6 +1438,25 @@ int OwlLua::SgmlTagValue(lua_State* L)
 	return 1;
 }
 
+// local links = tag:select("a[href%=showthread]")
+int OwlLua::SgmlTagSelect(lua_State* L)
+{
+	QSgmlTag* tag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
+	const auto selector = checkSelector(L);
+
+	pushSgmlTags(L, selector->select(tag));
+	return 1;
+}
+
+int OwlLua::SgmlTagSelectFirst(lua_State* L)
+{
+	QSgmlTag* tag = *((QSgmlTag**)luaL_checkudata(L, 1, "Owl.sgmltag"));
+	const auto selector = checkSelector(L);
+
+	pushSgmlTag(L, selector->selectFirst(tag));
+	return 1;
+}
+
 namespace lua
 {
 
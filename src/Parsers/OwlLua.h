@@ -2,6 +2,8 @@
 
 #include <string>
 #include <lua.hpp>
+#include "../Utils/SgmlSelector.h"
+#include "../Utils/WebClient.h"
 
 class QSgml;
 
@@ -9,7 +11,6 @@ namespace owl
 {
 
 class StringMap;
-class WebClient;
 
 class OwlLua 
 {
@@ -18,6 +19,10 @@ public:
 	// helper methods
     static StringMap tableToParams(lua_State* L, int tablePos);
 
+	// pushes the html, status and isError of `reply` the way the webclient
+	// methods return them and returns how many values were pushed
+	static int pushResponse(lua_State* L, const WebClient::ReplyPtr& reply);
+
 	// utils object
 	static int doBreak(lua_State* L);
 	static int doCDebug(lua_State* L);
@@ -25,6 +30,7 @@ public:
 	static int getMD5String(lua_State* L);
 	static int percentEncode(lua_State* L);
 	static int stripHtml(lua_State* L);
+	static int runParallel(lua_State* L);
 
 	// webclient object
 	static int newWebClient(lua_State* L);
@@ -32,6 +38,7 @@ public:
 	static int WebClientGetRaw(lua_State* L);
 	static int WebClientPost(lua_State* L);
 	static int WebClientPostRaw(lua_State* L);
+	static int WebClientGetAll(lua_State* L);
 	static int WebClientGetLastUrl(lua_State* L);
 	static int WebClientDestructor(lua_State* L);
 	
@@ -49,11 +56,16 @@ public:
 	static int SgmlDocTag(lua_State* L);
 	static int SgmlDocGetText(lua_State* L);
 	static int SgmlGetDocText(lua_State* L);
+	static int SgmlSelect(lua_State* L);
+	static int SgmlSelectFirst(lua_State* L);
+	static int SgmlEach(lua_State* L);
+	static int SgmlFirst(lua_State* L);
 	static int SgmlDestructor(lua_State* L);
 
 	// sgmltag object
 	static int SgmlTagName(lua_State* L);
 	static int SgmlTagAttribute(lua_State* L);
+	static int SgmlTagAttributes(lua_State* L);
 	static int SgmlTagHasAttribute(lua_State* L);
 	static int SgmlTagSetAttribute(lua_State* L);
 	static int SgmlTagStartTagPos(lua_State* L);
@@ -62,15 +74,24 @@ public:
 	static int SgmlTagEndTagLength(lua_State* L);
 	static int SgmlTagChildren(lua_State* L);	
 	static int SgmlTagPrevious(lua_State* L);
+	static int SgmlTagNext(lua_State* L);
 	static int SgmlTagParent(lua_State* L);
 	static int SgmlTagCompare(lua_State* L);
 	static int SgmlTagValue(lua_State* L);
+	static int SgmlTagSelect(lua_State* L);
+	static int SgmlTagSelectFirst(lua_State* L);
 	
     static int SgmlErrorWarn(lua_State* L);
 	static int SgmlErrorThrow(lua_State* L);	
 
 private:
+	static int SgmlEachNext(lua_State* L);
+	static int SgmlEachDestructor(lua_State* L);
+
 	static QSgml* checkSgml(lua_State* L, int index = 1);
+    static SgmlSelectorPtr checkSelector(lua_State* L, int index = 2);
+    static void pushSgmlTag(lua_State* L, QSgmlTag* tag);
+    static void pushSgmlTags(lua_State* L, const QList<QSgmlTag*>& tags);
     static QRegExp* checkRegExp(lua_State* L, int index = 1);
     static WebClient* checkWebClient(lua_State* L, int index = 1);
 };
@@ -82,6 +103,7 @@ static const struct luaL_Reg webclientlib[] =
 	{"getRaw", OwlLua::WebClientGetRaw},
 	{"post", OwlLua::WebClientPost},
 	{"postRaw", OwlLua::WebClientPostRaw},	
+	{"getAll", OwlLua::WebClientGetAll},
 	{"getLastUrl", OwlLua::WebClientGetLastUrl},
 	{"__gc", OwlLua::WebClientDestructor},
     {nullptr, nullptr}
@@ -101,6 +123,7 @@ static const struct luaL_Reg sgmltaglib[] =
 {
 	{"name", OwlLua::SgmlTagName},
 	{"attribute", OwlLua::SgmlTagAttribute},
+	{"attributes", OwlLua::SgmlTagAttributes},
 	{"hasAttribute", OwlLua::SgmlTagHasAttribute},
 	{"setAttribute", OwlLua::SgmlTagSetAttribute},
 	{"startPos", OwlLua::SgmlTagStartTagPos},
@@ -109,9 +132,12 @@ static const struct luaL_Reg sgmltaglib[] =
 	{"endLen", OwlLua::SgmlTagEndTagLength},
 	{"children", OwlLua::SgmlTagChildren},
 	{"previous", OwlLua::SgmlTagPrevious},
+	{"next", OwlLua::SgmlTagNext},
 	{"parent", OwlLua::SgmlTagParent},
 	{"compare", OwlLua::SgmlTagCompare},
 	{"value", OwlLua::SgmlTagValue},
+	{"select", OwlLua::SgmlTagSelect},
+	{"selectFirst", OwlLua::SgmlTagSelectFirst},
     {nullptr, nullptr}
 };
 
@@ -123,6 +149,10 @@ static const struct luaL_Reg sgmllib[] =
 	{"doctag", OwlLua::SgmlDocTag},
 	{"getText", OwlLua::SgmlDocGetText},
 	{"docText", OwlLua::SgmlGetDocText },
+	{"select", OwlLua::SgmlSelect},
+	{"selectFirst", OwlLua::SgmlSelectFirst},
+	{"each", OwlLua::SgmlEach},
+	{"first", OwlLua::SgmlFirst},
 	{"__gc", OwlLua::SgmlDestructor},
     {nullptr, nullptr}
 };
@@ -134,6 +164,8 @@ static const struct luaL_Reg owlutilslib[] =
 	{"md5", OwlLua::getMD5String},
 	{"stripHtml", OwlLua::stripHtml},
 	{"percentEncode", OwlLua::percentEncode},
+	{"getWebPage", OwlLua::getWebPage},
+	{"parallel", OwlLua::runParallel},
     {nullptr, nullptr}
 };
     
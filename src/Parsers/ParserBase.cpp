@@ -12,13 +12,15 @@ ParserBase::ParserBase(const QString& name, const QString& prettyName, const QSt
       _name(name),
 	  _description(prettyName),
       _baseUrl(baseUrl),
-	  _requestFuture(nullptr), 
-      _requestWatcher(nullptr),
       _logger(owl::initializeLogger("ParserBase"))
 {}
 
 ParserBase::~ParserBase()
 {
+    cancelRequests();
+
+    // the running request calls back into this object
+    _runningTask.waitForFinished();
 }
 
 QString ParserBase::getPrettyName() const
@@ -36,10 +38,7 @@ void ParserBase::setUserAgent(const QString &agent)
     if (!agent.trimmed().isEmpty())
     {
         _userAgent = agent;
-        for (WebClient* client : _clientWatchers)
-        {
-            client->setUserAgent(_userAgent);
-        }
+        updateClients();
     }
 }
 
@@ -65,6 +64,11 @@ void ParserBase::setOptions(StringMapPtr var)
     updateClients();
 }
 
+void ParserBase::clearCache()
+{
+    HTTPCACHE->clear(getBaseUrl());
+}
+
 bool ParserBase::canParse(const QString& html)
 {
     bool bRetVal = false;
@@ -85,63 +89,16 @@ StringMap ParserBase::login(LoginInfo& info)
     return this->doLogin(info).value<StringMap>();
 }
 
-void ParserBase::loginAsync(LoginInfo& info)
+QFuture<QVariant> ParserBase::loginAsync(LoginInfo& info)
 {
-	if (!_future.isRunning())
-	{
-		QObject::connect(&_watcher, SIGNAL(finished()), this, SLOT(loginSlot()));
-		_future = QtConcurrent::run(std::function<QVariant(void)>(
-			[this, info]
-			{
-				return doLogin(info);
-			}));
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QStringLiteral("login");
+    request->priority = RequestPriority::USER;
+    request->work = [this, info] { return doLogin(info); };
+    request->completed = [this](const QVariant& result) { Q_EMIT loginCompleted(result.value<StringMap>()); };
+    request->unknownError = QString("There was an error connecting to ") + this->getBaseUrl() + QString(". Please check your login credentials, firewall/proxy settings or your Internet connection.");
 
-	    _watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("loginAsync: ParserBase::_future.isRunning() == true");
-	}
-}
-
-void ParserBase::loginSlot()
-{
-    StringMap params;
-
-	// TODO: make a generic templated slot-handler for these (see submitNewThreadSlot() too)
-	// something like: void ParserBase<T>::futureSlot()
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-            params = w->future().result().value<StringMap>();
-            Q_EMIT loginCompleted(params);
-		}
-		catch (const owl::Exception& owe)
-		{
-            params.setOrAdd("success", false);
-            params.setOrAdd("error", owe.message());
-            _logger->warn("loginSlot() error: {}", owe.message().toStdString());
-            Q_EMIT errorNotification(owe);
-		}
-		catch (...)
-		{
-            const auto errorMessage = QString("There was an error connecting to ") + this->getBaseUrl() + QString(". Please check your login credentials, firewall/proxy settings or your Internet connection.");
-            params.setOrAdd("success", false);
-            params.setOrAdd("error", errorMessage);
-            _logger->warn("loginSlot() error: {}", errorMessage.toStdString());
-            Q_EMIT errorNotification(Exception(errorMessage));
-        }
-	}
-	else
-	{
-        _logger->error("loginSlot() could not cast sender() to QFutureWatcher<StringMap>*");
-        params.setOrAdd("success", false);
-        params.setOrAdd("error", "There was an unknown login error");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+    return enqueueRequest(request);
 }
 
 StringMap ParserBase::logout(LoginInfo&)
@@ -149,18 +106,14 @@ StringMap ParserBase::logout(LoginInfo&)
     return this->doLogout().value<StringMap>();
 }
 
-void ParserBase::logoutAsync(LoginInfo&)
+QFuture<QVariant> ParserBase::logoutAsync(LoginInfo&)
 {
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, SIGNAL(finished()), this, SLOT(logoutSlot()));
-		_future = QtConcurrent::run(this, &ParserBase::doLogout);
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("logoutAsync: ParserBase::_future.isRunning() == true");
-	}
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QStringLiteral("logout");
+    request->work = [this] { return doLogout(); };
+    request->completed = [this](const QVariant&) { Q_EMIT logoutCompleted(); };
+
+    return enqueueRequest(request);
 }
 
 ForumList ParserBase::getRootSubForumList()
@@ -168,33 +121,9 @@ ForumList ParserBase::getRootSubForumList()
     return getForumList(getRootForumId());
 }
 
-void ParserBase::getRootSubForumListAsync()
-{
-    getForumListAsync(getRootForumId());
-}
-
-void ParserBase::logoutSlot()
+QFuture<QVariant> ParserBase::getRootSubForumListAsync()
 {
-    QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-            StringMap params = w->future().result().value<StringMap>();
-
-			Q_EMIT logoutCompleted();
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-		}
-	}
-	else
-	{
-        _logger->error("logoutSlot() could not cast sender() to QFutureWatcher<StringMap>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+    return getForumListAsync(getRootForumId());
 }
 
 StringMap ParserBase::getBoardwareInfo()
@@ -202,44 +131,14 @@ StringMap ParserBase::getBoardwareInfo()
     return this->doGetBoardwareInfo().value<StringMap>();
 }
 
-void ParserBase::getBoardwareInfoAsync()
+QFuture<QVariant> ParserBase::getBoardwareInfoAsync()
 {
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, SIGNAL(finished()), this, SLOT(boardInfoSlot()));
-		_future = QtConcurrent::run(this, &ParserBase::doGetBoardwareInfo);
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("getBoardwareInfoAsync: ParserBase::_future.isRunning() == true");
-	}
-}
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QStringLiteral("boardwareInfo");
+    request->work = [this] { return doGetBoardwareInfo(); };
+    request->completed = [this](const QVariant& result) { Q_EMIT boardwareInfoCompleted(result.value<StringMap>()); };
 
-void ParserBase::boardInfoSlot()
-{
-
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-            StringMap params = w->future().result().value<StringMap>();
-
-			Q_EMIT boardwareInfoCompleted(params);
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-			return;
-		}
-	}
-	else
-	{
-        _logger->error("boardInfoSlot() could not cast sender() to QFutureWatcher<StringMap>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}
+    return enqueueRequest(request);
 }
 
 ForumList ParserBase::getForumList(const QString& id)
@@ -254,47 +153,14 @@ ForumList ParserBase::getForumList(const QString& id)
 	return ForumList();
 }
 
-void ParserBase::getForumListAsync(const QString& id)
-{
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, SIGNAL(finished()), this, SLOT(getForumListSlot()));
-		_future = QtConcurrent::run(this, &ParserBase::doGetForumList, (const QString&)(id));
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("getForumListAsync: ParserBase::_future.isRunning() == true");
-	}
-}
-
-void ParserBase::getForumListSlot()
+QFuture<QVariant> ParserBase::getForumListAsync(const QString& id)
 {
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
-
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-			ForumList list = w->future().result().value<ForumList>();
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QString("forumList:%1").arg(id);
+    request->work = [this, id] { return doGetForumList(id); };
+    request->completed = [this](const QVariant& result) { Q_EMIT forumListCompleted(result.value<ForumList>()); };
 
-			Q_EMIT forumListCompleted(list);
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-		}
-		catch (...)
-		{
-            Q_EMIT errorNotification(Exception("There was an unknown error."));
-		}
-	}
-	else
-	{
-        _logger->error("getForumListSlot() could not cast sender() to QFutureWatcher<QVariant>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+    return enqueueRequest(request);
 }
 
 ForumList ParserBase::getUnreadForums()
@@ -309,47 +175,15 @@ ForumList ParserBase::getUnreadForums()
 	return ForumList();
 }
 
-void ParserBase::getUnreadForumsAsync()
-{
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, SIGNAL(finished()), this, SLOT(getUnreadForumsSlot()));
-		_future = QtConcurrent::run(this, &ParserBase::doGetUnreadForums);
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("getUnreadForumsAsync: ParserBase::_future.isRunning() == true");
-	}
-}
-
-void ParserBase::getUnreadForumsSlot()
+QFuture<QVariant> ParserBase::getUnreadForumsAsync()
 {
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QStringLiteral("unreadForums");
+    request->priority = RequestPriority::BACKGROUND;
+    request->work = [this] { return doGetUnreadForums(); };
+    request->completed = [this](const QVariant& result) { Q_EMIT getUnreadForumsCompleted(result.value<ForumList>()); };
 
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-			ForumList list = w->future().result().value<ForumList>();
-
-			Q_EMIT getUnreadForumsCompleted(list);
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-		}
-		catch (...)
-		{
-            Q_EMIT errorNotification(Exception("There was an unknown error."));
-		}
-	}
-	else
-	{
-        _logger->error("getUnreadForumsSlot() could not cast sender() to QFutureWatcher<QVariant>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+    return enqueueRequest(request);
 }
     
 ThreadList ParserBase::getThreadList(ForumPtr forumInfo)
@@ -365,94 +199,89 @@ ThreadList ParserBase::getThreadList(ForumPtr forumInfo, int options)
 	return forum->getThreads();
 }
 
-void ParserBase::getThreadListAsync(ForumPtr forumInfo)
+QFuture<QVariant> ParserBase::getThreadListAsync(ForumPtr forumInfo)
 {
-    getThreadListAsync(forumInfo, ParserEnums::REQUEST_DEFAULT);
+    return getThreadListAsync(forumInfo, ParserEnums::REQUEST_DEFAULT);
 }
     
-void ParserBase::getThreadListAsync(ForumPtr forumInfo, int options)
+QFuture<QVariant> ParserBase::getThreadListAsync(ForumPtr forumInfo, int options)
 {
-	if (!_future.isFinished())
-	{
-        _logger->debug("ParserBase::getThreadListAsync(): _future.isFinished() is FALSE, cancelling.");
-
-        _watcher.disconnect();
-        _future.cancel();
-    }
+    // the user has moved on to another thread list so an older one
+    // still waiting for its turn is no longer wanted
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QString("threadList:%1:%2:%3:%4")
+        .arg(forumInfo->getId())
+        .arg(forumInfo->getPageNumber())
+        .arg(forumInfo->getPerPage())
+        .arg(options);
+    request->group = QStringLiteral("threadList");
+    request->priority = RequestPriority::USER;
+    request->work = [this, forumInfo, options] { return doThreadList(forumInfo, options); };
+    request->completed = [this](const QVariant& result) { Q_EMIT getThreadsCompleted(result.value<ForumPtr>()); };
 
-    connect(&_watcher, SIGNAL(finished()), this, SLOT(getThreadListSlot()));
-    _future = QtConcurrent::run(this, &ParserBase::doThreadList, (ForumPtr)(forumInfo),(int)(options));
-    _watcher.setFuture(_future);
+    return enqueueRequest(request);
 }
 
-void ParserBase::getThreadListSlot()
+PostList ParserBase::getPosts(ThreadPtr t, PostListOptions listOption, int webOptions)
 {
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
+	return doGetPostList(t, listOption, webOptions).value<ThreadPtr>()->getPosts();
+}
 
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-			ForumPtr forum = w->future().result().value<ForumPtr>();
+QFuture<QVariant> ParserBase::getPostsAsync(ThreadPtr t, PostListOptions listOption, int webOptions)
+{
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QString("postList:%1:%2:%3:%4:%5")
+        .arg(t->getId())
+        .arg(t->getPageNumber())
+        .arg(t->getPerPage())
+        .arg(listOption)
+        .arg(webOptions);
+    request->group = QStringLiteral("postList");
+    request->priority = RequestPriority::USER;
+    request->work = [this, t, listOption, webOptions] { return doGetPostList(t, listOption, webOptions); };
+    request->completed = [this](const QVariant& result) { Q_EMIT getPostsCompleted(result.value<ThreadPtr>()); };
 
-			Q_EMIT getThreadsCompleted(forum);
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-			return;
-		}
-		catch (...)
-		{
-            Q_EMIT errorNotification(Exception("There was an unknown error."));
-			return;
-		}
-	}
-	else
-	{
-        _logger->error("getThreadListSlot() could not cast sender() to QFutureWatcher<QVariant>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+    return enqueueRequest(request);
 }
 
-PostList ParserBase::getPosts(ThreadPtr t, PostListOptions listOption, int webOptions)
+QFuture<QVariant> ParserBase::prefetchPostsAsync(ThreadPtr t, PostListOptions listOption, int webOptions)
 {
-	return doGetPostList(t, listOption, webOptions).value<ThreadPtr>()->getPosts();
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QString("prefetch:postList:%1:%2:%3:%4:%5")
+        .arg(t->getId())
+        .arg(t->getPageNumber())
+        .arg(t->getPerPage())
+        .arg(listOption)
+        .arg(webOptions);
+    request->priority = RequestPriority::BACKGROUND;
+    request->prefetch = true;
+    request->work = [this, t, listOption, webOptions] { return doGetPostList(t, listOption, webOptions); };
+
+    return enqueueRequest(request);
 }
 
-void ParserBase::getPostsAsync(ThreadPtr t, PostListOptions listOption, int webOptions)
+void ParserBase::cancelPrefetches()
 {
-	if (!_future.isFinished())
-	{
-        _logger->debug("ParserBase::getPostsAsync(): _future.isFinished() is FALSE, cancelling.");
-        
-        _watcher.disconnect();
-        _future.cancel();
-    }
-    
-    connect(&_watcher, &QFutureWatcherBase::finished, [this]
-    {
-        try
-        {
-            _watcher.disconnect();
-            ThreadPtr thread = this->_future.result().value<ThreadPtr>();
+    QMutexLocker locker(&_requestMutex);
 
-            Q_EMIT getPostsCompleted(thread);
-        }
-        catch (const owl::Exception& owe)
+    for (auto it = _pendingRequests.begin(); it != _pendingRequests.end();)
+    {
+        if ((*it)->prefetch)
         {
-            Q_EMIT errorNotification(owe);
+            (*it)->promise.reportCanceled();
+            (*it)->promise.reportFinished();
+            it = _pendingRequests.erase(it);
         }
-        catch (...)
+        else
         {
-            Q_EMIT errorNotification(Exception("There was an unknown error."));
+            ++it;
         }
-    });
+    }
 
-    _future = QtConcurrent::run(this, &ParserBase::doGetPostList, (ThreadPtr)(t), (PostListOptions)listOption, (int)webOptions);
-    
-    _watcher.setFuture(_future);
+    if (_runningRequest && _runningRequest->prefetch)
+    {
+        _runningRequest->superseded = true;
+    }
 }
     
 void ParserBase::markForumRead(ForumPtr forumInfo)
@@ -460,47 +289,15 @@ void ParserBase::markForumRead(ForumPtr forumInfo)
     doMarkForumRead(forumInfo);
 }
 
-void ParserBase::markForumReadAsync(ForumPtr forumInfo)
+QFuture<QVariant> ParserBase::markForumReadAsync(ForumPtr forumInfo)
 {
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, SIGNAL(finished()), this, SLOT(markForumReadSlot()));
-		_future = QtConcurrent::run(this, &ParserBase::doMarkForumRead,(ForumPtr)(forumInfo));
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("markForumReadAsync: ParserBase::_future.isRunning() == true");
-	}
-}
-
-void ParserBase::markForumReadSlot()
-{
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
-
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-			ForumPtr forumPtr = w->future().result().value<ForumPtr>();
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QString("markForumRead:%1").arg(forumInfo->getId());
+    request->priority = RequestPriority::USER;
+    request->work = [this, forumInfo] { return doMarkForumRead(forumInfo); };
+    request->completed = [this](const QVariant& result) { Q_EMIT markForumReadCompleted(result.value<ForumPtr>()); };
 
-			Q_EMIT markForumReadCompleted(forumPtr);
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-		}
-		catch (...)
-		{
-            Q_EMIT errorNotification(Exception("There was an unknown error."));
-		}
-	}
-	else
-	{
-        _logger->error("markForumReadSlot() could not cast sender() to QFutureWatcher<QVariant>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+    return enqueueRequest(request);
 }
 
 ThreadPtr ParserBase::submitNewThread(ThreadPtr threadInfo)
@@ -508,36 +305,15 @@ ThreadPtr ParserBase::submitNewThread(ThreadPtr threadInfo)
 	return doSubmitNewThread(threadInfo).value<ThreadPtr>();
 }
 
-void ParserBase::submitNewThreadAsync(ThreadPtr threadInfo)
+QFuture<QVariant> ParserBase::submitNewThreadAsync(ThreadPtr threadInfo)
 {
-    if (!_future.isRunning())
-    {
-        connect(&_watcher, &QFutureWatcherBase::finished, [this]
-        {
-            try
-            {
-                _watcher.disconnect();
-                const auto thread = this->_future.result().value<ThreadPtr>();
-
-                Q_EMIT submitNewThreadCompleted(thread);
-            }
-            catch (const owl::Exception& owe)
-            {
-                Q_EMIT errorNotification(owe);
-            }
-            catch (...)
-            {
-                Q_EMIT errorNotification(Exception("There was an unknown error."));
-            }
-        });
+    // every submission is unique so these are never coalesced
+    auto request = std::make_shared<AsyncRequest>();
+    request->priority = RequestPriority::USER;
+    request->work = [this, threadInfo] { return doSubmitNewThread(threadInfo); };
+    request->completed = [this](const QVariant& result) { Q_EMIT submitNewThreadCompleted(result.value<ThreadPtr>()); };
 
-        _future = QtConcurrent::run(this, &ParserBase::doSubmitNewThread, (ThreadPtr)(threadInfo));
-        _watcher.setFuture(_future);
-    }
-    else
-    {
-        _logger->debug("submitNewThreadAsync: ParserBase::_future.isRunning() == true");
-    }
+    return enqueueRequest(request);
 }
 
 PostPtr ParserBase::submitNewPost(PostPtr postInfo)
@@ -545,36 +321,14 @@ PostPtr ParserBase::submitNewPost(PostPtr postInfo)
 	return doSubmitNewPost(postInfo).value<PostPtr>();
 }
 
-void ParserBase::submitNewPostAsync(PostPtr postInfo)
+QFuture<QVariant> ParserBase::submitNewPostAsync(PostPtr postInfo)
 {
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, &QFutureWatcherBase::finished, [this]
-		{
-			try
-			{
-                _watcher.disconnect();
-				PostPtr post = this->_future.result().value<PostPtr>();
+    auto request = std::make_shared<AsyncRequest>();
+    request->priority = RequestPriority::USER;
+    request->work = [this, postInfo] { return doSubmitNewPost(postInfo); };
+    request->completed = [this](const QVariant& result) { Q_EMIT submitNewPostCompleted(result.value<PostPtr>()); };
 
-				Q_EMIT submitNewPostCompleted(post);
-			}
-			catch (const owl::Exception& owe)
-			{
-                Q_EMIT errorNotification(owe);
-			}
-			catch (...)
-			{
-                Q_EMIT errorNotification(Exception("There was an unknown error."));
-			}
-		});
-
-		_future = QtConcurrent::run(this, &ParserBase::doSubmitNewPost, (PostPtr)(postInfo));
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("submitNewPostAsync: ParserBase::_future.isRunning() == true");
-	}
+    return enqueueRequest(request);
 }
 
 QString ParserBase::getItemUrl(ForumPtr forum)
@@ -624,11 +378,11 @@ void ParserBase::getFavIconBuffer(QByteArray* buffer, const QStringList& iconFil
                 client.setThrowOnFail(false);
 
                 auto reply = client.GetUrl(url.toString(), owl::WebClient::NOTIDY);
-                if (reply->status() == 200)
+                if (reply && reply->status() == 200)
                 {
+                    const auto data = reply->data();
                     buffer->clear();
-                    buffer->append(reply->data().c_str(),
-                        static_cast<uint>(reply->data().size()));
+                    buffer->append(data.data(), static_cast<int>(data.size()));
 
                 	QImage image = QImage::fromData(*buffer);
                 	if (!image.isNull())
@@ -661,8 +415,40 @@ void ParserBase::getFavIconBuffer(QByteArray* buffer, const QStringList& iconFil
 	}
 }
 
+void ParserBase::setForumTree(ForumPtr root)
+{
+    QMutexLocker locker(&_unreadMutex);
+
+    if (root == _forumTree)
+    {
+        return;
+    }
+
+    _forumTree = root;
+    _forumTreeIndex.clear();
+    _unreadState.clear();
+
+    if (_forumTree)
+    {
+        indexForumTree(_forumTree);
+    }
+}
+
+void ParserBase::indexForumTree(ForumPtr forum)
+{
+    for (const ForumPtr& child : forum->getForums())
+    {
+        if (!_forumTreeIndex.contains(child->getId()))
+        {
+            _forumTreeIndex.insert(child->getId(), child);
+            indexForumTree(child);
+        }
+    }
+}
+
 QVariant ParserBase::doGetUnreadForums()
 {
+    QMutexLocker locker(&_unreadMutex);
     ForumList retList;
 
     for (auto subForum : getRootSubForumList())
@@ -673,42 +459,79 @@ QVariant ParserBase::doGetUnreadForums()
 	return QVariant::fromValue(retList);
 }
 
+// `parent` is the forum as it appears in its parent's forum list, so its
+// hasUnread() flag and getLastUpdated() timestamp are fresh
 void ParserBase::getUnreadSubForums(ForumPtr parent, ForumList* pList)
 {
 	const int PAGENUM = 1;
 	const int PERPAGE = 50;
 
-    // unread threats aren't necessarily the first threads listed,
-    // so we look at the first 50 threads. it is possible that old unread
-    // threads will not show up if they are further down
-	ForumList childList = getForumList(parent->getId());
-
-	if (parent->hasUnread() || parent->getForumType() == Forum::CATEGORY)
+	if (!parent->hasUnread() && parent->getForumType() != Forum::CATEGORY)
 	{
+        // nothing to see here, and the next time this forum has something
+        // unread it should get a full look
+        _unreadState.remove(parent->getId());
+		return;
+	}
+
+    const QDateTime lastUpdated = parent->getLastUpdated();
+    const auto stateIt = _unreadState.constFind(parent->getId());
+
+    if (stateIt != _unreadState.constEnd()
+        && lastUpdated.isValid()
+        && stateIt->lastUpdated == lastUpdated
+        && stateIt->hasUnread == parent->hasUnread())
+    {
+        // nothing has been posted anywhere in this subtree since it was last
+        // scanned so the previous result still stands
+        pList->append(stateIt->unread);
+        return;
+    }
+
+    UnreadScanState state;
+    state.hasUnread = parent->hasUnread();
+    state.lastUpdated = lastUpdated;
+
+    // categories don't hold threads, only forums
+    if (parent->getForumType() != Forum::CATEGORY)
+    {
+        // unread threats aren't necessarily the first threads listed,
+        // so we look at the first 50 threads. it is possible that old unread
+        // threads will not show up if they are further down
         ForumPtr info(new Forum(parent->getId()));
         info->setPageNumber(PAGENUM);
         info->setPerPage(PERPAGE);
-        
+
 		ThreadList threadList = getThreadList(info);
+        bool bThreadsUnread = false;
 
         for (auto thread : threadList)
 		{
-			if (thread->hasUnread())
-			{
-				pList->push_back(parent);
-				break;
-			}
+            bThreadsUnread = bThreadsUnread || thread->hasUnread();
 		}
 
-		// now search the children
-        for (ForumPtr subChild : childList)
+        if (bThreadsUnread)
+        {
+            state.unread.push_back(parent);
+        }
+    }
+
+    // leaf forums in the crawled tree have no children whose unread
+    // flags we would need, so skip requesting their (empty) forum list
+    const auto knownForum = _forumTreeIndex.value(parent->getId());
+    if (!knownForum || !knownForum->getForums().isEmpty())
+    {
+        for (ForumPtr subChild : getForumList(parent->getId()))
 		{
-			if (subChild->hasUnread() || subChild->getForumType() == Forum::CATEGORY)
-			{
-				getUnreadSubForums(subChild, pList);
-			}
+            getUnreadSubForums(subChild, &state.unread);
 		}
-	}
+    }
+
+    _logger->trace("Scanned forum '{}' for unread, {} unread in subtree",
+        parent->getId().toStdString(), state.unread.size());
+
+    pList->append(state.unread);
+    _unreadState.insert(parent->getId(), std::move(state));
 }
 
 QVariant ParserBase::doMarkForumRead(ForumPtr)
@@ -754,42 +577,228 @@ StringMap ParserBase::getEncryptionSettings()
     return this->doGetEncryptionSettings().value<StringMap>();
 }
 
-void ParserBase::getEncryptionSettingsAsync()
+QFuture<QVariant> ParserBase::getEncryptionSettingsAsync()
 {
-	if (!_future.isRunning())
-	{
-		connect(&_watcher, SIGNAL(finished()), this, SLOT(getEncryptionSettingsSlot()));
-		_future = QtConcurrent::run(this, &ParserBase::doGetEncryptionSettings);
-		_watcher.setFuture(_future);
-	}
-	else
-	{
-        _logger->debug("getEncryptionSettingsAsync: ParserBase::_future.isRunning() == true");
-	}
+    auto request = std::make_shared<AsyncRequest>();
+    request->key = QStringLiteral("encryptionSettings");
+    request->work = [this] { return doGetEncryptionSettings(); };
+    request->completed = [this](const QVariant& result) { Q_EMIT getEncryptionSettingsCompleted(result.value<StringMap>()); };
+
+    return enqueueRequest(request);
 }
 
-void ParserBase::getEncryptionSettingsSlot()
+QFuture<QVariant> ParserBase::enqueueRequest(AsyncRequestPtr request)
 {
-	QFutureWatcher<QVariant>* w = reinterpret_cast<QFutureWatcher<QVariant>* >(sender());
-	if (w != nullptr)
-	{
-		try
-		{
-            _watcher.disconnect();
-            StringMap params = w->future().result().value<StringMap>();
+    {
+        QMutexLocker locker(&_requestMutex);
 
-			Q_EMIT getEncryptionSettingsCompleted(params);
-		}
-		catch (const owl::Exception& owe)
-		{
-            Q_EMIT errorNotification(owe);
-		}
-	}
-	else
-	{
-        _logger->error("getEncryptionSettingsSlot() could not cast sender() to QFutureWatcher<StringMap>*");
-        Q_EMIT errorNotification(Exception("There was an unknown error."));
-	}	
+        if (!request->key.isEmpty())
+        {
+            // an identical request that is already queued or running
+            // answers this one too
+            if (_runningRequest
+                && !_runningRequest->superseded
+                && _runningRequest->key == request->key)
+            {
+                _logger->trace("Request '{}' coalesced with running request", request->key.toStdString());
+                return _runningRequest->promise.future();
+            }
+
+            const auto dup = std::find_if(_pendingRequests.begin(), _pendingRequests.end(),
+                [&request](const AsyncRequestPtr& other) { return other->key == request->key; });
+
+            if (dup != _pendingRequests.end())
+            {
+                _logger->trace("Request '{}' coalesced with queued request", request->key.toStdString());
+
+                AsyncRequestPtr existing = *dup;
+
+                // it gets the more urgent priority of the two
+                if (request->priority > existing->priority)
+                {
+                    _pendingRequests.erase(dup);
+                    existing->priority = request->priority;
+                    insertRequest(existing);
+                }
+
+                return existing->promise.future();
+            }
+        }
+
+        if (!request->group.isEmpty())
+        {
+            // drop the requests this one supersedes, they've either not
+            // started yet or their result will be ignored
+            for (auto it = _pendingRequests.begin(); it != _pendingRequests.end();)
+            {
+                if ((*it)->group == request->group)
+                {
+                    _logger->trace("Request '{}' superseded by '{}'",
+                        (*it)->key.toStdString(), request->key.toStdString());
+
+                    (*it)->promise.reportCanceled();
+                    (*it)->promise.reportFinished();
+                    it = _pendingRequests.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            if (_runningRequest && _runningRequest->group == request->group)
+            {
+                _runningRequest->superseded = true;
+            }
+        }
+
+        request->promise.reportStarted();
+        insertRequest(request);
+    }
+
+    if (QThread::currentThread() == thread())
+    {
+        runNextRequest();
+    }
+    else
+    {
+        QMetaObject::invokeMethod(this, [this]() { runNextRequest(); }, Qt::QueuedConnection);
+    }
+
+    return request->promise.future();
+}
+
+// keeps _pendingRequests ordered by priority and FIFO within a priority,
+// must be called with _requestMutex locked
+void ParserBase::insertRequest(AsyncRequestPtr request)
+{
+    const auto pos = std::find_if(_pendingRequests.begin(), _pendingRequests.end(),
+        [&request](const AsyncRequestPtr& other) { return other->priority < request->priority; });
+
+    _pendingRequests.insert(pos, std::move(request));
+}
+
+void ParserBase::runNextRequest()
+{
+    AsyncRequestPtr request;
+
+    {
+        QMutexLocker locker(&_requestMutex);
+
+        if (_runningRequest || _pendingRequests.empty())
+        {
+            return;
+        }
+
+        request = _pendingRequests.front();
+        _pendingRequests.pop_front();
+        _runningRequest = request;
+    }
+
+    auto watcher = new QFutureWatcher<void>(this);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this,
+        [this, watcher, request]()
+        {
+            watcher->deleteLater();
+            finishRequest(request);
+        });
+
+    _runningTask = QtConcurrent::run([request]()
+        {
+            try
+            {
+                request->result = request->work();
+            }
+            catch (...)
+            {
+                request->error = std::current_exception();
+            }
+        });
+
+    watcher->setFuture(_runningTask);
+}
+
+void ParserBase::finishRequest(AsyncRequestPtr request)
+{
+    {
+        QMutexLocker locker(&_requestMutex);
+        _runningRequest.reset();
+    }
+
+    if (request->superseded)
+    {
+        _logger->debug("Dropping result of superseded request '{}'", request->key.toStdString());
+        request->promise.reportCanceled();
+    }
+    else if (request->error)
+    {
+        try
+        {
+            std::rethrow_exception(request->error);
+        }
+        catch (const owl::Exception& owe)
+        {
+            _logger->warn("Request '{}' failed: {}", request->key.toStdString(), owe.message().toStdString());
+            request->promise.reportException(owe);
+
+            // the user never asked for a prefetch so they aren't told it failed
+            if (!request->prefetch)
+            {
+                Q_EMIT errorNotification(owe);
+            }
+        }
+        catch (...)
+        {
+            const Exception ex(request->unknownError.isEmpty()
+                ? QStringLiteral("There was an unknown error.")
+                : request->unknownError);
+
+            _logger->warn("Request '{}' failed: {}", request->key.toStdString(), ex.message().toStdString());
+            request->promise.reportException(ex);
+
+            if (!request->prefetch)
+            {
+                Q_EMIT errorNotification(ex);
+            }
+        }
+    }
+    else
+    {
+        request->promise.reportResult(request->result);
+
+        if (request->completed)
+        {
+            try
+            {
+                request->completed(request->result);
+            }
+            catch (const owl::Exception& owe)
+            {
+                Q_EMIT errorNotification(owe);
+            }
+        }
+    }
+
+    request->promise.reportFinished();
+    runNextRequest();
+}
+
+void ParserBase::cancelRequests()
+{
+    QMutexLocker locker(&_requestMutex);
+
+    for (const auto& request : _pendingRequests)
+    {
+        request->promise.reportCanceled();
+        request->promise.reportFinished();
+    }
+
+    _pendingRequests.clear();
+
+    if (_runningRequest)
+    {
+        _runningRequest->superseded = true;
+    }
 }
 
 } // namespace owl
@@ -1,4 +1,5 @@
 #pragma once
+#include <deque>
 #include <QtCore>
 #include "../Parsers/Forum.h"
 #include "../Utils/WebClient.h"
@@ -21,7 +22,7 @@ struct ParserEnums
 	};
 };
 
-typedef QVector<QString> ForumIdList;
+using ForumIdSet = QSet<QString>;
 typedef std::pair<QString, QString> LoginInfo;
 
 class ParserBase;
@@ -82,6 +83,11 @@ public:
     void setOptions(StringMapPtr var);
 
 	void clearCache();
+
+    // The forum tree the board has already crawled. When set, the default
+    // unread scan uses it to avoid re-fetching the structure of leaf forums.
+    // Setting a different tree forgets everything remembered by the scan
+    void setForumTree(ForumPtr root);
     
     WebClientConfig createWebClientConfig();
 //	WebClientPtr createWebClient();
@@ -96,43 +102,54 @@ public:
 
 	//****************************************************************************//
 	// API
+    //
+    // The *Async methods are queued and run one at a time on a worker thread.
+    // Identical requests are coalesced into one and a new thread or post list
+    // request supersedes older ones. The returned future carries the same
+    // result as the matching *Completed signal.
     virtual StringMap getBoardwareInfo();
-	virtual void getBoardwareInfoAsync();
+	virtual QFuture<QVariant> getBoardwareInfoAsync();
 
     virtual bool canParse(const QString&);
 
     virtual StringMap login(LoginInfo&);
-	virtual void loginAsync(LoginInfo&);
+	virtual QFuture<QVariant> loginAsync(LoginInfo&);
 
     virtual StringMap logout(LoginInfo&);
-	virtual void logoutAsync(LoginInfo&);
+	virtual QFuture<QVariant> logoutAsync(LoginInfo&);
 
     virtual ForumList getRootSubForumList();
 
-    virtual void getRootSubForumListAsync();
+    virtual QFuture<QVariant> getRootSubForumListAsync();
 
 	virtual ForumList getForumList(const QString& id);
-	virtual void getForumListAsync(const QString& id);
+	virtual QFuture<QVariant> getForumListAsync(const QString& id);
 
 	virtual ForumList getUnreadForums();
-	virtual void getUnreadForumsAsync();
+	virtual QFuture<QVariant> getUnreadForumsAsync();
 
 	virtual ThreadList getThreadList(ForumPtr forumInfo);
 	virtual ThreadList getThreadList(ForumPtr forumInfo, int options);
-    virtual void getThreadListAsync(ForumPtr forumInfo);
-	virtual void getThreadListAsync(ForumPtr forumInfo, int options);
+    virtual QFuture<QVariant> getThreadListAsync(ForumPtr forumInfo);
+	virtual QFuture<QVariant> getThreadListAsync(ForumPtr forumInfo, int options);
 
 	virtual PostList getPosts(ThreadPtr t, PostListOptions listOption, int webOptions = ParserEnums::REQUEST_DEFAULT);
-	virtual void getPostsAsync(ThreadPtr t, PostListOptions listOptions, int webOptions = ParserEnums::REQUEST_DEFAULT);
+	virtual QFuture<QVariant> getPostsAsync(ThreadPtr t, PostListOptions listOptions, int webOptions = ParserEnums::REQUEST_DEFAULT);
+
+    // Speculatively fetches a post page into `t`. The request runs after
+    // everything else in the queue, doesn't emit getPostsCompleted() or
+    // errorNotification() and is dropped by cancelPrefetches()
+    virtual QFuture<QVariant> prefetchPostsAsync(ThreadPtr t, PostListOptions listOptions, int webOptions = ParserEnums::REQUEST_DEFAULT);
+    void cancelPrefetches();
 
     virtual void markForumRead(ForumPtr forumInfo);
-    virtual void markForumReadAsync(ForumPtr forumInfo);
+    virtual QFuture<QVariant> markForumReadAsync(ForumPtr forumInfo);
 
 	virtual ThreadPtr submitNewThread(ThreadPtr threadInfo);
-	virtual void submitNewThreadAsync(ThreadPtr threadInfo);
+	virtual QFuture<QVariant> submitNewThreadAsync(ThreadPtr threadInfo);
 
 	virtual PostPtr submitNewPost(PostPtr postInfo);
-	virtual void submitNewPostAsync(PostPtr postInfo);
+	virtual QFuture<QVariant> submitNewPostAsync(PostPtr postInfo);
 
 	virtual QString getItemUrl(ForumPtr forum);
 	virtual QString getItemUrl(ThreadPtr thread);
@@ -141,7 +158,7 @@ public:
 	virtual QString getPostQuote(PostPtr post);
 
     virtual StringMap getEncryptionSettings();
-	virtual void getEncryptionSettingsAsync();
+	virtual QFuture<QVariant> getEncryptionSettingsAsync();
 
 	//****************************************************************************//
 
@@ -166,17 +183,6 @@ Q_SIGNALS:
     void getEncryptionSettingsCompleted(StringMap settings);
     void errorNotification(const Exception& ex);
 
-private Q_SLOTS:
-	void loginSlot();
-	void logoutSlot();
-	void boardInfoSlot();		
-	void getUnreadForumsSlot();
-	void getForumListSlot();
-	void getThreadListSlot();	
-	//void getPostListSlot();
-	void getEncryptionSettingsSlot();
-	void markForumReadSlot();
-	
 protected:
 
 	////////////////////////////////////////////////////////////////
@@ -218,6 +224,22 @@ protected:
     StringMapPtr _options;
 
 private:
+    // what the default unread scan saw of a forum the last time it was
+    // visited, used to skip subtrees in which nothing has changed
+    struct UnreadScanState
+    {
+        bool        hasUnread = false;      // the forum's flag in its parent's listing
+        QDateTime   lastUpdated;            // the forum's timestamp in its parent's listing
+        ForumList   unread;                 // unread forums found in the subtree
+    };
+
+    void indexForumTree(ForumPtr forum);
+
+    ForumPtr                        _forumTree;
+    QHash<QString, ForumPtr>        _forumTreeIndex;
+    QHash<QString, UnreadScanState> _unreadState;
+    QMutex                          _unreadMutex;
+
     QString _name;
     QString _description; 
 
@@ -226,11 +248,42 @@ private:
 
     QList<WebClient*>			_clientWatchers;
 
-	QFuture<QVariant>*			_requestFuture;
-	QFutureWatcher<QVariant>*	_requestWatcher;
-	
-	QFuture<QVariant>			_future;
-    QFutureWatcher<QVariant>	_watcher;
+    // requests issued from the UI are served before background ones
+    enum class RequestPriority
+    {
+        BACKGROUND,
+        NORMAL,
+        USER
+    };
+
+    struct AsyncRequest
+    {
+        QString                             key;        // identical requests share a key and are coalesced
+        QString                             group;      // a new request supersedes older ones in its group
+        RequestPriority                     priority = RequestPriority::NORMAL;
+        std::function<QVariant()>           work;
+        std::function<void(const QVariant&)> completed;
+        QString                             unknownError;
+        bool                                prefetch = false;   // speculative, nobody is waiting on it
+
+        QFutureInterface<QVariant>          promise;
+        QVariant                            result;
+        std::exception_ptr                  error;
+        bool                                superseded = false;
+    };
+
+    using AsyncRequestPtr = std::shared_ptr<AsyncRequest>;
+
+    QFuture<QVariant> enqueueRequest(AsyncRequestPtr request);
+    void insertRequest(AsyncRequestPtr request);
+    void runNextRequest();
+    void finishRequest(AsyncRequestPtr request);
+    void cancelRequests();
+
+    QMutex                          _requestMutex;
+    std::deque<AsyncRequestPtr>     _pendingRequests;
+    AsyncRequestPtr                 _runningRequest;
+    QFuture<void>                   _runningTask;
 
     std::shared_ptr<spdlog::logger>  _logger;
 };
@@ -30,7 +30,7 @@ ParserManager::~ParserManager()
 	// do nothing
 }
 
-void ParserManager::init(bool bLoadLuaParsers, QString luaParserFolder)
+void ParserManager::init(bool bLoadLuaParsers, QString luaParserFolder, QString cacheFolder)
 {
 	if (_isInitialized)
 	{
@@ -42,6 +42,7 @@ void ParserManager::init(bool bLoadLuaParsers, QString luaParserFolder)
 
 	if (bLoadLuaParsers)
 	{
+		_scriptCache = std::make_shared<LuaScriptCache>(cacheFolder);
 		loadLuaParsers(luaParserFolder);
 	}
     else
@@ -68,7 +69,7 @@ owl::ParserBasePtr ParserManager::createParser(const QString& name, const QStrin
 	else if (_luaTypes.contains(name))
 	{
 		ParserInfo info = _luaTypes.value(name);
-		ret = LuaParserBasePtr(new LuaParserBase(baseUrl, info.filename));
+		ret = LuaParserBasePtr(new LuaParserBase(baseUrl, info.filename, _scriptCache->chunk(info.filename)));
 	}
 	else if (bDoThrow)
 	{
@@ -106,10 +107,13 @@ void ParserManager::loadLuaParsers(QString parserFolder)
     QStringList filters;
     filters << "*.lua" << "*.owl" << "*.parser";
     parserDir.setNameFilters(filters);
-    
-	ParserInfo parserInfo;
+
+    QElapsedTimer timer;
+    timer.start();
+
     for (QFileInfo info : parserDir.entryInfoList())
 	{
+		ParserInfo parserInfo;
 		if (ignoredParsers.contains(info.fileName(), Qt::CaseInsensitive))
 		{
             _logger->trace("Skipping parser file '{}' on ignore list", info.fileName().toStdString());
@@ -136,63 +140,45 @@ void ParserManager::loadLuaParsers(QString parserFolder)
             _logger->error("Failed to load parser `{}`", filePath.toStdString());
 		}
 	}
+
+	_scriptCache->save();
+
+    _logger->debug("Found {} Lua parser(s) in {}ms", _luaTypes.size(), timer.elapsed());
 }
 
 void ParserManager::initLuaParser(const QString& filename, ParserInfo& info)
 {
-	lua_State* L = luaL_newstate();
-	luaL_openlibs(L);
+	LuaScriptInfo script;
 
-	int luaStatus = luaL_loadfile(L, filename.toLatin1());
+	try
+	{
+		// only runs the script if it is not cached or has changed
+		script = _scriptCache->scriptInfo(filename);
+	}
+	catch (const LuaException& ex)
+	{
+        _logger->error("Invalid parser file ({}): {}", filename.toStdString(), ex.message().toStdString());
+		return;
+	}
 
-	if (!luaStatus && !lua_pcall(L, 0, 0, 0))
+	if (script.name.isEmpty())
 	{
-		lua_getglobal(L, "parserName");
-		if (lua_isstring(L, -1))
-		{
-			info.name = QString(lua_tostring(L, -1));
-		}
-		else
-		{
-            _logger->warn("Invalid parser file ({}): 'parserName' should be a string", filename.toStdString());
-		}
-        
-        if (_luaTypes.contains(info.name))
-        {
-            auto otherInfo = _luaTypes[info.name];
-            
-            _logger->warn("Parser with name '{}' already loaded from '{}'. Not loading from file '{}'",
-                info.name.toStdString(), otherInfo.filename.toStdString(), filename.toStdString());
-            info.name.clear();
-        }
-        else
-        {
-            lua_getglobal(L, "parserPrettyName");
-            if (lua_isstring(L, -1))
-            {
-                info.prettyName = QString(lua_tostring(L, -1));
-            }
-            else
-            {
-                info.prettyName = info.name;
-            }
-
-            lua_getglobal(L, "boardUrl");
-            if (lua_isstring(L, -1))
-            {
-                info.url = QString(lua_tostring(L, -1));
-            }
-
-            info.filename = filename;
-        }
+        _logger->warn("Invalid parser file ({}): 'parserName' should be a string", filename.toStdString());
+	}
+	else if (_luaTypes.contains(script.name))
+	{
+		auto otherInfo = _luaTypes[script.name];
+
+		_logger->warn("Parser with name '{}' already loaded from '{}'. Not loading from file '{}'",
+			script.name.toStdString(), otherInfo.filename.toStdString(), filename.toStdString());
 	}
 	else
 	{
-		QString strError(lua_tostring(L, -1));
-        _logger->error("Invalid parser file ({}): {}", filename.toStdString(), strError.toStdString());
+		info.name = script.name;
+		info.prettyName = script.prettyName;
+		info.url = script.url;
+		info.filename = filename;
 	}
-
-	lua_close(L);
 }
 
 QStringList ParserManager::ignoredParserFiles(const QDir& luaPath)
@@ -2,6 +2,7 @@
 
 #include <QtCore>
 #include "LuaParserBase.h"
+#include "LuaScriptCache.h"
 
 #define PARSERMGR		ParserManager::instance()
 
@@ -51,7 +52,10 @@ public:
     ParserManager (const ParserManager&) = delete;
 	virtual ~ParserManager(); 
 	
-	void init(bool bLoadLuaParsers, QString luaParserFolder = QString());
+	// The compiled Lua parsers and what was read from them are kept in
+	// `cacheFolder` so that the scripts are not run at every startup. Nothing
+	// is cached on disk if it is empty
+	void init(bool bLoadLuaParsers, QString luaParserFolder = QString(), QString cacheFolder = QString());
 
 	size_t getParserTypeCount() const 
 	{ 
@@ -82,6 +86,8 @@ private:
 	QHash<QString, ParserInfo> _nativeParsers;
 	QHash<QString, ParserInfo> _luaTypes;
 
+	LuaScriptCachePtr _scriptCache;
+
 	bool _isInitialized;
 
 	static ParserManagerPtr _instance;
@@ -0,0 +1,140 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include "PostPageCache.h"
+#include "ParserBase.h"
+
+namespace owl
+{
+
+PostPageCache::PostPageCache(int capacity, qint64 maxAge)
+    : _capacity(std::max(capacity, 1)),
+      _maxAge(maxAge)
+{
+}
+
+QString PostPageCache::makeKey(const QString& threadId, int listOption, int pageNumber, int perPage)
+{
+    if (listOption == ParserBase::PostListOptions::FIRST_UNREAD)
+    {
+        pageNumber = 0;
+    }
+
+    return QString("%1:%2:%3:%4").arg(threadId).arg(listOption).arg(pageNumber).arg(perPage);
+}
+
+int PostPageCache::capacity() const
+{
+    Lock lock(_mutex);
+    return _capacity;
+}
+
+void PostPageCache::setCapacity(int capacity)
+{
+    Lock lock(_mutex);
+    _capacity = std::max(capacity, 1);
+    trim();
+}
+
+int PostPageCache::size() const
+{
+    Lock lock(_mutex);
+    return _entries.size();
+}
+
+bool PostPageCache::contains(const QString& key) const
+{
+    Lock lock(_mutex);
+
+    const auto it = _entries.constFind(key);
+    return it != _entries.constEnd() && !isExpired(*it);
+}
+
+void PostPageCache::insert(const QString& key, ThreadPtr page)
+{
+    if (!page)
+    {
+        return;
+    }
+
+    Lock lock(_mutex);
+
+    remove(key);
+
+    _lru.push_front(key);
+    _entries.insert(key, Entry{ page->getId(), page, QDateTime::currentDateTimeUtc(), _lru.begin() });
+
+    trim();
+}
+
+ThreadPtr PostPageCache::take(const QString& key)
+{
+    Lock lock(_mutex);
+
+    const auto it = _entries.find(key);
+    if (it == _entries.end())
+    {
+        return ThreadPtr();
+    }
+
+    const ThreadPtr page = isExpired(*it) ? ThreadPtr() : it->page;
+    remove(key);
+
+    return page;
+}
+
+void PostPageCache::removeThread(const QString& threadId)
+{
+    Lock lock(_mutex);
+
+    QStringList keys;
+    for (auto it = _entries.cbegin(); it != _entries.cend(); ++it)
+    {
+        if (it->threadId == threadId)
+        {
+            keys.push_back(it.key());
+        }
+    }
+
+    for (const auto& key : keys)
+    {
+        remove(key);
+    }
+}
+
+void PostPageCache::clear()
+{
+    Lock lock(_mutex);
+
+    _entries.clear();
+    _lru.clear();
+}
+
+// must be called with _mutex locked
+bool PostPageCache::isExpired(const Entry& entry) const
+{
+    return entry.stored.secsTo(QDateTime::currentDateTimeUtc()) > _maxAge;
+}
+
+// must be called with _mutex locked
+void PostPageCache::remove(const QString& key)
+{
+    const auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        _lru.erase(it->lru);
+        _entries.erase(it);
+    }
+}
+
+// must be called with _mutex locked
+void PostPageCache::trim()
+{
+    while (_entries.size() > _capacity)
+    {
+        const QString key = _lru.back();
+        remove(key);
+    }
+}
+
+} // namespace
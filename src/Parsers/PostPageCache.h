@@ -0,0 +1,79 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <list>
+#include <mutex>
+#include <QtCore>
+#include "Forum.h"
+
+namespace owl
+{
+
+// number of post pages kept for a board
+constexpr int DEFAULT_POST_PAGE_CACHE_SIZE = 16;
+
+// how long a prefetched page is considered fresh enough to be shown
+constexpr qint64 DEFAULT_POST_PAGE_MAX_AGE = 5 * 60;
+
+// A bounded, least recently used cache of post pages that were fetched
+// before the user asked for them. Each page is a Thread object holding the
+// page's posts and pagination. All methods are thread safe.
+class PostPageCache final
+{
+    using Mutex = std::mutex;
+    using Lock  = std::lock_guard<std::mutex>;
+
+public:
+    explicit PostPageCache(int capacity = DEFAULT_POST_PAGE_CACHE_SIZE,
+                           qint64 maxAge = DEFAULT_POST_PAGE_MAX_AGE);
+
+    PostPageCache(const PostPageCache&) = delete;
+    PostPageCache& operator=(const PostPageCache&) = delete;
+
+    // `listOption` is one of ParserBase::PostListOptions. The page of a
+    // FIRST_UNREAD request is chosen by the server so it isn't part of its key
+    static QString makeKey(const QString& threadId, int listOption, int pageNumber, int perPage);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    int size() const;
+
+    bool contains(const QString& key) const;
+
+    void insert(const QString& key, ThreadPtr page);
+
+    // Removes the page from the cache and returns it, or nullptr if there
+    // is no page or it has expired
+    ThreadPtr take(const QString& key);
+
+    // Removes every page of the thread
+    void removeThread(const QString& threadId);
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        QString                         threadId;
+        ThreadPtr                       page;
+        QDateTime                       stored;
+        std::list<QString>::iterator    lru;
+    };
+
+    bool isExpired(const Entry& entry) const;
+    void remove(const QString& key);
+    void trim();
+
+    mutable Mutex           _mutex;
+
+    int                     _capacity;
+    const qint64            _maxAge;
+
+    // most recently inserted keys are at the front
+    std::list<QString>      _lru;
+    QHash<QString, Entry>   _entries;
+};
+
+} // namespace
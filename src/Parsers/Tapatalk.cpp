@@ -1,6 +1,9 @@
 #include "../Utils/QSgml.h"
 #include "Tapatalk.h"
+#include "XmlRpcDecoder.h"
 #include <cmath>
+#include <functional>
+#include <QtConcurrent>
 
 #include <Utils/OwlLogger.h>
 #include <Utils/OwlLiterals.h>
@@ -11,6 +14,65 @@ namespace owl
 {
 
 const uint Tapatalk4x::LOGINTIMEOUT = 60 * 15; // 15 minutes
+const uint Tapatalk4x::LOGINREFRESH = 60 * 12; // 12 minutes
+
+namespace
+{
+
+// the members of a topic struct that makeThreadObject() reads
+const QSet<QString> THREAD_FIELDS
+{
+    "topic_id", "topic_title", "topic_author_name", "short_content", "new_post",
+    "icon_url", "view_number", "last_reply_user", "last_reply_author_name",
+    "reply_number", "last_reply_time", "post_time", "timestamp"
+};
+
+// the members of a post struct that makePostObject() reads
+const QSet<QString> POST_FIELDS
+{
+    "post_id", "post_content", "post_author_name", "icon_url", "timestamp"
+};
+
+// Collects the wanted members of each streamed topic or post and hands them
+// over one record at a time, so a response is never held as a whole
+class RecordCollector final : public XmlRpcRecordVisitor
+{
+public:
+    using Handler = std::function<void(const QVariantMap&)>;
+
+    RecordCollector(const QSet<QString>& fields, Handler handler)
+        : _fields(fields),
+          _handler(std::move(handler))
+    {
+    }
+
+    void beginRecord() override
+    {
+        _record.clear();
+    }
+
+    bool wantsField(const QString& name) const override
+    {
+        return _fields.contains(name);
+    }
+
+    void field(const QString& name, QVariant value) override
+    {
+        _record.insert(name, std::move(value));
+    }
+
+    void endRecord() override
+    {
+        _handler(_record);
+    }
+
+private:
+    const QSet<QString>&    _fields;
+    Handler                 _handler;
+    QVariantMap             _record;
+};
+
+} // namespace
 
 Tapatalk4x::Tapatalk4x(const QString& baseUrl)
     : ParserBase(TAPATALK_NAME, TAPATALK_PRETTYNAME, baseUrl),
@@ -43,7 +105,8 @@ Tapatalk4x::Tapatalk4x(const QString& baseUrl)
 
 Tapatalk4x::~Tapatalk4x()
 {
-    // do nothing
+    // the refresh uses this object
+    _sessionRefresh.waitForFinished();
 }
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -51,6 +114,9 @@ Tapatalk4x::~Tapatalk4x()
 
 QVariant Tapatalk4x::doLogin(const LoginInfo& info)
 {
+    // the session may also be refreshed from a background thread
+    QMutexLocker locker(&_mutex);
+
     loadConfig();
 
     _loginInfo = info;
@@ -80,7 +146,7 @@ QVariant Tapatalk4x::doLogin(const LoginInfo& info)
     // session stays logged in for over 15 minutes.
     paramList.append(TapaTalkParam(ParamType::STRING, QVariant::fromValue(QString("1"))));
 
-    QString strLoginData(getRequestXml("login", paramList));
+    const QByteArray strLoginData(getRequestXml("login", paramList));
 
     // BUG #117: Tapatalk's API docs specifically say not to submit any cookies with the
     // login-request, so we need to explicitly delete any previously set cookies when
@@ -122,7 +188,7 @@ QVariant Tapatalk4x::doLogin(const LoginInfo& info)
 
             if (!_rootIdRealized)
             {
-                QString strPostData(getRequestXml("get_forum"));
+                const QByteArray strPostData(getRequestXml("get_forum"));
                 const QString ldata = uploadString(strPostData);
                 getRootId(ldata);
             }
@@ -142,7 +208,7 @@ QVariant Tapatalk4x::doLogin(const LoginInfo& info)
 QVariant Tapatalk4x::doLogout()
 {
 	QMutexLocker	locker(&_mutex);
-	QString			strPostData(getRequestXml("logout_user"));
+	const QByteArray			strPostData(getRequestXml("logout_user"));
 
     uploadString(strPostData);
 
@@ -156,7 +222,7 @@ QVariant Tapatalk4x::doLogout()
 QVariant Tapatalk4x::doGetBoardwareInfo()
 {
    StringMap result;
-    const QString strPostData(getRequestXml("get_config"));
+    const QByteArray strPostData(getRequestXml("get_config"));
     const QString data = uploadString(strPostData);
 
     XRVariant response(data);
@@ -210,8 +276,7 @@ QVariant Tapatalk4x::doTestParser(const QString& html)
     StringMap result;
 	result.add("success", false); // assume failure!
 
-	QDomDocument xmlDoc;
-	if (xmlDoc.setContent(html))
+	try
 	{
 		XRVariant infoVar(html);
 		if (infoVar.canConvert(QVariant::Map) && infoVar.toMap().contains("version"))
@@ -223,6 +288,10 @@ QVariant Tapatalk4x::doTestParser(const QString& html)
 			}
 		}	
 	}
+	catch (const Exception&)
+	{
+		// not XML, so not a Tapatalk response
+	}
 
 	return QVariant::fromValue(result);
 }
@@ -234,7 +303,7 @@ QVariant Tapatalk4x::doGetForumList(const QString& forumId)
 
 	if (!_forumMapInitialized)
 	{
-		QString strPostData(getRequestXml("get_forum"));
+		const QByteArray strPostData(getRequestXml("get_forum"));
 
         const QString data = uploadString(strPostData);
 		getRootId(data);
@@ -294,32 +363,37 @@ QVariant Tapatalk4x::doThreadList(ForumPtr forumInfo, int)
 	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(iEnd)));
 	paramList.append(TapaTalkParam(ParamType::STRING, QVariant::fromValue(QString("TOP"))));
 
-	QString strPostData(getRequestXml("get_topic", paramList));
+	const QByteArray stickyPostData(getRequestXml("get_topic", paramList));
 
-    QString data = uploadString(strPostData);
-	XRVariant responseData(data);
+	// the non-sticky threads
+	paramList.removeLast();
+	paramList.removeLast();
+	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(iEnd)));
 
-	if (!responseData.canConvert(QVariant::Map))
-	{
-        OWL_THROW_EXCEPTION(Exception("Cannot convert 'get_topic' response to QVariant::Map"));
-	}
+	const QByteArray threadPostData(getRequestXml("get_topic", paramList));
+
+	// neither call depends on the other so both go out at once
+	const QStringList responses = uploadStrings({ stickyPostData, threadPostData });
 
-	auto responseMap = responseData.toMap();
-	if (responseMap.contains("topics") && responseMap["topics"].canConvert(QVariant::List))
+	RecordCollector stickyCollector(THREAD_FIELDS, [this, &forumInfo, &retval](const QVariantMap& topic)
 	{
-		auto topicList = responseMap["topics"].toList();
-		for (auto topic : topicList)
+		ThreadPtr newThread = makeThreadObject(topic);
+		if (newThread.get() != nullptr)
 		{
-			ThreadPtr newThread = makeThreadObject(&topic);
-			if (newThread.get() != nullptr)
-			{
-				newThread->setParent(forumInfo);
-				newThread->setSticky(true);
-				retval.push_back(newThread);
-			}
+			newThread->setParent(forumInfo);
+			newThread->setSticky(true);
+			retval.push_back(newThread);
 		}
+	});
+
+	const auto responseData = XmlRpcDecoder(responses.at(0)).decodeStruct("topics", stickyCollector);
+	if (!responseData)
+	{
+        OWL_THROW_EXCEPTION(Exception("Cannot convert 'get_topic' response to QVariant::Map"));
 	}
-    else
+
+	const auto& responseMap = *responseData;
+	if (!responseMap.contains("topics"))
 	{
 		QString strError("Call to 'get_topic' for sticky-threads failed.");
 
@@ -331,39 +405,24 @@ QVariant Tapatalk4x::doThreadList(ForumPtr forumInfo, int)
         _logger->error(strError.toStdString());
 	}
 
-	// load the non-sticky threads
-	paramList.removeLast();
-	paramList.removeLast();
-	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(iEnd)));
-
-	strPostData.clear();
-	strPostData = getRequestXml("get_topic", paramList);
-
-	data.clear();
-    data = uploadString(strPostData);
-
-	XRVariant responseData2(data);
+	RecordCollector threadCollector(THREAD_FIELDS, [this, &forumInfo, &retval](const QVariantMap& topic)
+	{
+		ThreadPtr newThread = makeThreadObject(topic);
+		if (newThread.get() != nullptr)
+		{
+			newThread->setParent(forumInfo);
+			retval.push_back(newThread);
+		}
+	});
 
-	if (!responseData2.canConvert(QVariant::Map))
+	const auto responseData2 = XmlRpcDecoder(responses.at(1)).decodeStruct("topics", threadCollector);
+	if (!responseData2)
 	{
         OWL_THROW_EXCEPTION(Exception("Cannot convert 'get_topic' response to QVariant::Map"));
 	}
 
-	auto responseMap2 = responseData2.toMap();
-	if (responseMap2.contains("topics") && responseMap2["topics"].canConvert(QVariant::List))
-	{
-		auto topicList = responseMap2["topics"].toList();
-		for (auto topic : topicList)
-		{
-			ThreadPtr newThread = makeThreadObject(&topic);
-			if (newThread.get() != nullptr)
-			{
-				newThread->setParent(forumInfo);
-				retval.push_back(newThread);
-			}
-		}
-	}
-    else
+	const auto& responseMap2 = *responseData2;
+	if (!responseMap2.contains("topics"))
 	{
 		QString strError("Call to 'get_topic' for threads failed.");
 
@@ -376,7 +435,7 @@ QVariant Tapatalk4x::doThreadList(ForumPtr forumInfo, int)
 	}
 
 	int iTotalTopics = 0;
-	if (responseMap.contains("total_topic_num"))
+	if (responseMap2.contains("total_topic_num"))
 	{
         iTotalTopics = responseMap2["total_topic_num"].toInt();
 	}
@@ -403,18 +462,28 @@ QVariant Tapatalk4x::doPostList(ThreadPtr threadInfo, int)
 	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(threadInfo->getPerPage())));
     paramList.append(TapaTalkParam(ParamType::BOOLEAN, QVariant::fromValue(false)));
 
-	QString strPostData(getRequestXml("get_thread_by_unread", paramList));
+	const QByteArray strPostData(getRequestXml("get_thread_by_unread", paramList));
 
     const QString data = uploadString(strPostData);
-	XRVariant responseData(data);
 
-	if (!responseData.canConvert(QVariant::Map))
+	// the posts are streamed before 'position' is necessarily known, so
+	// they're collected first and the page is worked out afterwards
+	RecordCollector collector(POST_FIELDS, [this, &retval](const QVariantMap& post)
+	{
+		PostPtr newPost = makePostObject(post);
+		if (newPost.get() != nullptr)
+		{
+			retval.push_back(newPost);
+		}
+	});
+
+	const auto responseData = XmlRpcDecoder(data).decodeStruct("posts", collector);
+	if (!responseData)
 	{
         OWL_THROW_EXCEPTION(Exception("Cannot convert 'get_thread_by_unread' response to QVariant::Map"));
 	}
 
-	// convert the response map
-	auto responseMap = responseData.toMap();
+	const auto& responseMap = *responseData;
 
 	// we have been handed back the 'position' which is the 1-based index position
 	// of the first unread post and 'posts_per_request' which should equal 
@@ -448,29 +517,20 @@ QVariant Tapatalk4x::doPostList(ThreadPtr threadInfo, int)
 	threadInfo->setFirstUnreadPost(PostPtr());
 	threadInfo->getPosts().clear();	
 	
-	if (responseMap.contains("posts") && responseMap["posts"].canConvert(QVariant::List))
+	auto iCount = 1 + ((iCurrentPage - 1) * iPerPage);
+    int index = ((threadInfo->getPageNumber() - 1) * threadInfo->getPerPage())+1;
+
+	for (const auto& newPost : retval)
 	{
-		auto iCount = 1 + ((iCurrentPage - 1) * iPerPage);
-		auto topicList = responseMap["posts"].toList();
-        int index = ((threadInfo->getPageNumber() - 1) * threadInfo->getPerPage())+1;
+        newPost->setIndex(index++);
+		newPost->setParent(threadInfo);
 
-		for (auto topic : topicList)
+        if (iCount == (int)iPosition)
 		{
-			PostPtr newPost = makePostObject(&topic);
-			if (newPost.get() != nullptr)
-			{
-                newPost->setIndex(index++);
-				newPost->setParent(threadInfo);
-
-				retval.push_back(newPost);
-                if (iCount == (int)iPosition)
-				{
-					threadInfo->setFirstUnreadPost(newPost);
-				}
-			}
-
-			iCount++;
+			threadInfo->setFirstUnreadPost(newPost);
 		}
+
+		iCount++;
 	}
 
     auto& posts = threadInfo->getPosts();
@@ -502,31 +562,28 @@ QVariant Tapatalk4x::doPostList1(ThreadPtr threadInfo, int)
 	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(iEnd)));
 	paramList.append(TapaTalkParam(ParamType::BOOLEAN, QVariant::fromValue(false)));
 
-	QString strPostData(getRequestXml("get_thread", paramList));
+	const QByteArray strPostData(getRequestXml("get_thread", paramList));
 
     const QString data = uploadString(strPostData);
-	XRVariant responseData(data);
 
-	if (!responseData.canConvert(QVariant::Map))
+	RecordCollector collector(POST_FIELDS, [this, &threadInfo, &retval](const QVariantMap& post)
 	{
-        OWL_THROW_EXCEPTION(Exception("Cannot convert 'get_thread' response to QVariant::Map"));
-	}
-
-	auto responseMap = responseData.toMap();
-	if (responseMap.contains("posts") && responseMap["posts"].canConvert(QVariant::List))
-	{
-		auto topicList = responseMap["posts"].toList();
-		for (auto topic : topicList)
+		PostPtr newPost = makePostObject(post);
+		if (newPost.get() != nullptr)
 		{
-			PostPtr newPost = makePostObject(&topic);
 			newPost->setParent(threadInfo);
-			if (newPost.get() != nullptr)
-			{
-				retval.push_back(newPost);
-			}
+			retval.push_back(newPost);
 		}
+	});
+
+	const auto responseData = XmlRpcDecoder(data).decodeStruct("posts", collector);
+	if (!responseData)
+	{
+        OWL_THROW_EXCEPTION(Exception("Cannot convert 'get_thread' response to QVariant::Map"));
 	}
 
+	const auto& responseMap = *responseData;
+
 	int iTotalTopics = 0;
 	if (responseMap.contains("total_post_num"))
 	{
@@ -578,7 +635,7 @@ QVariant Tapatalk4x::doSubmitNewThread(ThreadPtr threadInfo)
 	strTemp = threadInfo->getPosts().at(0)->getText().toLatin1().toBase64();
 	paramList.append(TapaTalkParam(ParamType::BASE64, QVariant::fromValue(strTemp)));
 
-    QString strNewThreadData(getRequestXml("new_topic", paramList));
+    const QByteArray strNewThreadData(getRequestXml("new_topic", paramList));
 
     const QString data = uploadString(strNewThreadData);
 	XRVariant response(data);
@@ -634,7 +691,7 @@ QVariant Tapatalk4x::doSubmitNewPost(PostPtr postInfo)
 	strTemp = postInfo->getText().toLatin1().toBase64();
 	paramList.append(TapaTalkParam(ParamType::BASE64, QVariant::fromValue(strTemp)));
 
-    const QString strNewPostData(getRequestXml("reply_post", paramList));
+    const QByteArray strNewPostData(getRequestXml("reply_post", paramList));
     const QString data = uploadString(strNewPostData);
 	XRVariant response(data);
 
@@ -688,7 +745,7 @@ QVariant Tapatalk4x::doMarkForumRead(ForumPtr forumInfo)
 		paramList.append(TapaTalkParam(ParamType::STRING, QVariant::fromValue(forumInfo->getId())));
 	}
 
-    const QString strPostData(getRequestXml("mark_all_as_read", paramList));
+    const QByteArray strPostData(getRequestXml("mark_all_as_read", paramList));
     const QString data = uploadString(strPostData);
 	XRVariant response(data);
 
@@ -723,7 +780,7 @@ QVariant Tapatalk4x::doGetUnreadForums()
 	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(0)));
 	paramList.append(TapaTalkParam(ParamType::INT, QVariant::fromValue(50)));
 
-    const QString strPostData(getRequestXml("get_unread_topic", paramList));
+    const QByteArray strPostData(getRequestXml("get_unread_topic", paramList));
     const QString data = uploadString(strPostData);
 	XRVariant response(data);
 
@@ -794,7 +851,7 @@ QString Tapatalk4x::getPostQuote(PostPtr postinfo)
     ParamList paramList;
     paramList.append(TapaTalkParam(ParamType::STRING, QVariant::fromValue(postinfo->getId())));
 
-    const QString strPostData(getRequestXml("get_quote_post", paramList));
+    const QByteArray strPostData(getRequestXml("get_quote_post", paramList));
     const QString data = uploadString(strPostData);
     XRVariant responseData(data);
 
@@ -850,100 +907,130 @@ void Tapatalk4x::walkForum( QVariant* variant )
 	}
 }
 
-QString Tapatalk4x::getRequestXml(const QString& methodName, ParamList params)
+QByteArray Tapatalk4x::getRequestXml(const QString& methodName, const ParamList& params)
 {
 	if (methodName.isEmpty())
 	{
         OWL_THROW_EXCEPTION(Exception("Invalid arugment, methodName cannot be empty"));
 	}
 
-	QString retXml;
-	QXmlStreamWriter writer(&retXml);
-	writer.setAutoFormatting(true);
-
-	writer.writeStartDocument("1.0");
-	writer.writeStartElement("methodCall");
-	writer.writeTextElement("methodName", methodName);
-
-	QString strRet = 
-		QString("<?xml version=\"1.0\"?><methodCall><methodName>%1</methodName>")
-		.arg(methodName);
+	// the writer's buffer is shared by every request
+	QMutexLocker locker(&_mutex);
+	_requestWriter.begin(methodName);
 
-	if (params.size() > 0)
+	for (const TapaTalkParam& param : params)
 	{
-		writer.writeStartElement("params");
-
-		for (TapaTalkParam param : params)
+		XmlRpcWriter::Type type = XmlRpcWriter::Type::STRING;
+		if (param.type == ParamType::BASE64)
 		{
-			writer.writeStartElement("param");
+			type = XmlRpcWriter::Type::BASE64;
+		}
+		else if (param.type == ParamType::STRING)
+		{
+			type = XmlRpcWriter::Type::STRING;
+		}
+		else if (param.type == ParamType::BOOLEAN)
+		{
+			type = XmlRpcWriter::Type::BOOLEAN;
+		}
+		else if (param.type == ParamType::INT)
+		{
+			type = XmlRpcWriter::Type::INT;
+		}
+		else
+		{
+			QString strError = QString("Unknown Tapatalk param type: '%1'").arg(param.type);
+            OWL_THROW_EXCEPTION(Exception(strError));
+		}
 
-			if (!param.name.isEmpty())
-			{
-				writer.writeTextElement("name", param.name);
-			}
+		_requestWriter.addParam(type, param.value, param.name);
+	}
 
-			writer.writeStartElement("value");
+    return _requestWriter.finish();
+}
 
-			QString typeStr;
-			QString strValue = param.value.toString();
-			if (param.type == ParamType::BASE64)
-			{
-				typeStr = "base64";
-			}
-			else if (param.type == ParamType::STRING)
-			{
-				typeStr = "string";
-			}
-			else if (param.type == ParamType::BOOLEAN)
-			{
-				typeStr = "boolean";
-				if (param.value.toBool())
-				{
-                    strValue = "true";
-				}
-				else
-				{
-                    strValue = "false";
-				}
-			}
-			else if (param.type == ParamType::INT)
-			{
-				typeStr = "int";
-				strValue = QString::number(param.value.toInt());
-			}
+const QString Tapatalk4x::uploadString(const QByteArray& payload)
+{
+    ensureSession();
 
-			if (typeStr.isEmpty())
-			{
-				QString strError = QString("Unknown Tapatalk param type: '%1'").arg(param.type);
-                OWL_THROW_EXCEPTION(Exception(strError));
-			}
+    return _webclient.UploadString(getBaseUrl(), payload,
+        WebClient::NOTIDY |
+        WebClient::NOENCRYPT |
+        WebClient::NOCACHE);
+}
+
+QStringList Tapatalk4x::uploadStrings(const QList<QByteArray>& payloads)
+{
+    ensureSession();
 
-			writer.writeTextElement(typeStr, strValue);
+    const uint options = WebClient::NOTIDY | WebClient::NOENCRYPT | WebClient::NOCACHE;
 
-			writer.writeEndElement();
-			writer.writeEndElement();
-		}
+    std::vector<std::future<WebClient::ReplyPtr>> futures;
+    futures.reserve(static_cast<std::size_t>(payloads.size()));
 
-		writer.writeEndElement();
-	}
+    for (const auto& payload : payloads)
+    {
+        futures.push_back(_webclient.PostUrlAsync(getBaseUrl(), payload, options));
+    }
 
-	writer.writeEndElement();
-	writer.writeEndDocument();
+    QStringList retval;
+    for (auto& future : futures)
+    {
+        const auto reply = future.get();
+        retval.push_back(reply ? reply->text() : QString());
+    }
 
-    return retXml;
+    return retval;
 }
 
-const QString Tapatalk4x::uploadString(const QString& payload)
+// must be called with _mutex locked
+void Tapatalk4x::ensureSession()
 {
-    if (_lastLogin.secsTo(QDateTime::currentDateTime()) >= Tapatalk4x::LOGINTIMEOUT)
+    const auto age = _lastLogin.secsTo(QDateTime::currentDateTime());
+
+    if (age >= Tapatalk4x::LOGINTIMEOUT)
     {
+        // too late for the background refresh, the request would fail
         doLogin(_loginInfo);
     }
+    else if (age >= Tapatalk4x::LOGINREFRESH)
+    {
+        scheduleSessionRefresh();
+    }
+}
 
-    return _webclient.UploadString(getBaseUrl(), payload,
-        WebClient::NOTIDY |
-        WebClient::NOENCRYPT |
-        WebClient::NOCACHE);
+// must be called with _mutex locked
+void Tapatalk4x::scheduleSessionRefresh()
+{
+    if (_sessionRefresh.isRunning())
+    {
+        return;
+    }
+
+    _logger->debug("Refreshing the Tapatalk session for '{}' in the background", getBaseUrl().toStdString());
+
+    _sessionRefresh = QtConcurrent::run([this]()
+    {
+        // waits for the request that scheduled it to finish
+        QMutexLocker locker(&_mutex);
+
+        // a request may have logged in while this was waiting
+        if (_lastLogin.secsTo(QDateTime::currentDateTime()) < Tapatalk4x::LOGINREFRESH)
+        {
+            return;
+        }
+
+        try
+        {
+            doLogin(_loginInfo);
+        }
+        catch (const std::exception& ex)
+        {
+            // the next request logs in inline once the session has expired
+            _logger->warn("Background session refresh for '{}' failed: {}",
+                getBaseUrl().toStdString(), ex.what());
+        }
+    });
 }
 
 owl::ForumPtr Tapatalk4x::makeForumObject( QVariant* variant )
@@ -979,14 +1066,12 @@ owl::ForumPtr Tapatalk4x::makeForumObject( QVariant* variant )
 	return newForum;
 }
 
-owl::ThreadPtr Tapatalk4x::makeThreadObject( QVariant* variant )
+owl::ThreadPtr Tapatalk4x::makeThreadObject(const QVariantMap& topicMap)
 {
 	ThreadPtr newThread;
 
-	if (variant->canConvert(QVariant::Map))
+	if (!topicMap.isEmpty())
 	{
-		auto topicMap = variant->toMap();
-		
 		newThread = ThreadPtr(new Thread(topicMap["topic_id"].toString()));
 		newThread->setTitle(topicMap["topic_title"].toString());
 		newThread->setAuthor(topicMap["topic_author_name"].toString());
@@ -1045,14 +1130,12 @@ owl::ThreadPtr Tapatalk4x::makeThreadObject( QVariant* variant )
 	return newThread;
 }
 
-owl::PostPtr Tapatalk4x::makePostObject( QVariant* variant )
+owl::PostPtr Tapatalk4x::makePostObject(const QVariantMap& postMap)
 {
 	PostPtr newPost;
 
-	if (variant->canConvert(QVariant::Map))
+	if (!postMap.isEmpty())
 	{
-		auto postMap = variant->toMap();
-
 		newPost = PostPtr(new Post(postMap["post_id"].toString()));
 		newPost->setText(postMap["post_content"].toString());
 		newPost->setAuthor(postMap["post_author_name"].toString());
@@ -1123,7 +1206,7 @@ void Tapatalk4x::loadConfig()
 {
 	if (!_configLoaded)
 	{
-        const QString strPostData(getRequestXml(QStringLiteral("get_config")));
+        const QByteArray strPostData(getRequestXml(QStringLiteral("get_config")));
         const QString data = uploadString(strPostData);
 		XRVariant response(data);
 
@@ -2,6 +2,7 @@
 #include <QtCore>
 #include "../Utils/StringMap.h"
 #include "xrvariant.h"
+#include "XmlRpcWriter.h"
 #include "ParserBase.h"
 
 namespace spdlog
@@ -32,6 +33,10 @@ class Tapatalk4x : public ParserBase
 public:
     static const uint LOGINTIMEOUT;
 
+    // sessions older than this are refreshed in the background, ahead of
+    // LOGINTIMEOUT, so that requests don't have to wait on a login
+    static const uint LOGINREFRESH;
+
 	enum ParamType
 	{
 		STRING,
@@ -132,14 +137,21 @@ protected:
 private:
 	void loadConfig();
 
-	QString getRequestXml(const QString&, ParamList = ParamList());
-    const QString uploadString(const QString& payload);
+	QByteArray getRequestXml(const QString&, const ParamList& = ParamList());
+    const QString uploadString(const QByteArray& payload);
+
+    // posts every payload concurrently on the current session, the
+    // responses are in the same order as the payloads
+    QStringList uploadStrings(const QList<QByteArray>& payloads);
+
+    void ensureSession();
+    void scheduleSessionRefresh();
 
 	void walkForum(QVariant* variant);
 
 	ForumPtr makeForumObject(QVariant* variant);
-	ThreadPtr makeThreadObject(QVariant* variant);
-	PostPtr makePostObject(QVariant* variant);
+	ThreadPtr makeThreadObject(const QVariantMap& topicMap);
+	PostPtr makePostObject(const QVariantMap& postMap);
 
 	void getRootId(QString data);
 	QString getForumName();	
@@ -167,6 +179,8 @@ private:
     QDateTime               _lastLogin;
 
 	QMutex					_mutex;
+    XmlRpcWriter            _requestWriter;     // guarded by _mutex
+    QFuture<void>           _sessionRefresh;
 
     std::shared_ptr<spdlog::logger>  _logger;
 };
@@ -4,6 +4,7 @@
 #include "../Utils/OwlUtils.h"
 #include "../Utils/QSgml.h"
 #include "../Utils/QSgmlTag.h"
+#include "../Utils/SgmlSelector.h"
 #include "../Utils/WebClient.h"
 #include "Xenforo.h"
 #include <cmath>
@@ -319,16 +320,16 @@ QVariant Xenforo::doThreadList(ForumPtr forumInfo, int options)
     QSgml doc;
     if (doc.parse(data))
     {
-        const auto listItems = doc.getElementsByName("li", "class", QRegExp{"discussionListItem"});
+        const auto listItems = owl::select(doc, "li.discussionListItem");
         for (QSgmlTag* liChild : listItems)
         {
-            auto titleInfo = liChild->getFirstElementByName("a", "class", QRegExp{"PreviewTooltip"});
-            auto authorInfo = liChild->getFirstElementByName("a", "class", QRegExp{"username"});
-            QSgmlTag* lastPostDiv = liChild->getFirstElementByName("div", "class", QRegExp{"lastPost"});
+            auto titleInfo = owl::selectFirst(liChild, "a.PreviewTooltip");
+            auto authorInfo = owl::selectFirst(liChild, "a.username");
+            QSgmlTag* lastPostDiv = owl::selectFirst(liChild, "div.lastPost");
 
             if (titleInfo && authorInfo && lastPostDiv)
             {
-                const auto lastAuthorNode = lastPostDiv->getFirstElementByName("a", "class", QRegExp{"username"});
+                const auto lastAuthorNode = owl::selectFirst(lastPostDiv, "a.username");
                 if (lastAuthorNode)
                 {
                     bool bHasUnread = false;
@@ -351,10 +352,10 @@ QVariant Xenforo::doThreadList(ForumPtr forumInfo, int options)
                     lastpost->setAuthor(doc.getText(lastAuthorNode));
 
                     // try to get the user's avatar
-                    QSgmlTag* avatarEl = liChild->getFirstElementByName("div","class",QRegExp{"posterAvatar"});
+                    QSgmlTag* avatarEl = owl::selectFirst(liChild, "div.posterAvatar");
                     if (avatarEl)
                     {
-                        QSgmlTag* imgEl = avatarEl->getFirstElementByName("img","src",QRegExp{});
+                        QSgmlTag* imgEl = owl::selectFirst(avatarEl, "img[src]");
                         if (imgEl)
                         {
                             const QString src = imgEl->getArgValue("src");
@@ -384,17 +385,17 @@ QVariant Xenforo::doThreadList(ForumPtr forumInfo, int options)
 
                     newthread->setLastPost(lastpost);
 
-                    QSgmlTag* subTitle = liChild->getFirstElementByName("h4", "class", QRegExp{"subtitle"});
+                    QSgmlTag* subTitle = owl::selectFirst(liChild, "h4.subtitle");
                     if (subTitle)
                     {
                         newthread->setPreviewText(doc.getText(subTitle));
                     }
 
                     // get the number of replies
-                    const auto repliesnode = liChild->getFirstElementByName("div", "class", QRegExp{"stats"});
+                    const auto repliesnode = owl::selectFirst(liChild, "div.stats");
                     if (repliesnode)
                     {
-                        const auto dlclass = repliesnode->getFirstElementByName("dl", "class", QRegExp {"major"});
+                        const auto dlclass = owl::selectFirst(repliesnode, "dl.major");
                         if (dlclass && dlclass->Children.size() > 1 && dlclass->Children.at(1)->Name == "dd")
                         {
                             bool bok = false;
@@ -431,7 +432,7 @@ QVariant Xenforo::doThreadList(ForumPtr forumInfo, int options)
             }
         }
 
-        const auto pagenav = doc.getElementsByName("div", "class", QRegExp{"PageNav"});
+        const auto pagenav = owl::select(doc, "div.PageNav");
         if (pagenav.size() > 0)
         {
             bool ok;
@@ -524,7 +525,7 @@ QVariant Xenforo::doGetPostList(ThreadPtr threadInfo, ParserBase::PostListOption
             }
         }
 
-        const auto pagenav = doc.getElementsByName("div", "class", QRegExp{"PageNav"});
+        const auto pagenav = owl::select(doc, "div.PageNav");
         if (pagenav.size() > 0)
         {
             bool ok;
@@ -544,7 +545,7 @@ QVariant Xenforo::doGetPostList(ThreadPtr threadInfo, ParserBase::PostListOption
         int index = ((threadInfo->getPageNumber() - 1) * threadInfo->getPerPage()) + 1;
 
         // <li id="post-1352017"
-        const auto linodes = doc.getElementsByName("li", "id", QRegExp{"post\\-\\d+"});
+        const auto linodes = owl::select(doc, "li[id%=post-\\d+]");
         for (const auto node : linodes)
         {
             // NOTE: XenForo postIDs are formatted like "post-XXX", however this can't
@@ -561,7 +562,7 @@ QVariant Xenforo::doGetPostList(ThreadPtr threadInfo, ParserBase::PostListOption
             newpost->setAuthor(strAuthor);
             newpost->setParent(threadInfo);
 
-            const auto textnode = node->getFirstElementByName("blockquote", "class", QRegExp{"messageText"});
+            const auto textnode = owl::selectFirst(node, "blockquote.messageText");
             if (textnode)
             {
                 const auto rawtext = extractMessageText(doc.getInnerHtml(textnode));
@@ -580,10 +581,10 @@ QVariant Xenforo::doGetPostList(ThreadPtr threadInfo, ParserBase::PostListOption
                 }
 
                 // extract the user avatar
-                QSgmlTag* avatarEl = node->getFirstElementByName("div","class",QRegExp{"avatarHolder"});
+                QSgmlTag* avatarEl = owl::selectFirst(node, "div.avatarHolder");
                 if (avatarEl)
                 {
-                    QSgmlTag* imgEl = avatarEl->getFirstElementByName("img","src",QRegExp{});
+                    QSgmlTag* imgEl = owl::selectFirst(avatarEl, "img[src]");
                     if (imgEl)
                     {
                         const QString src = imgEl->getArgValue("src");
@@ -716,7 +717,7 @@ QVariant Xenforo::doSubmitNewPost(PostPtr postInfo)
                 // NOTE: There's no real way to discern the postID of the post we just submitted from the rest of the posts
                 // on the page. What we do instead is get a list of all the posts on reponse and assume that the last one is
                 // the post we just submitted. This should work *most* of the time.
-                const QList<QSgmlTag*> linodes = replyDoc.getElementsByName("li", "id", QRegExp{"post\\-\\d+"});
+                const QList<QSgmlTag*> linodes = owl::select(replyDoc, "li[id%=post-\\d+]");
                 if (linodes.size() > 0)
                 {
                     // As noted above, the postID needs to be numeric. It probably isn't too important here but
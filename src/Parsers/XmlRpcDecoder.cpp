@@ -0,0 +1,331 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include "../Utils/Exception.h"
+#include "XmlRpcDecoder.h"
+#include "xrbase64.h"
+
+namespace owl
+{
+
+XmlRpcDecoder::XmlRpcDecoder(const QString& xml)
+    : _reader(xml)
+{
+}
+
+template<typename Handler>
+void XmlRpcDecoder::readMembers(Handler&& handler)
+{
+    while (_reader.readNextStartElement())
+    {
+        if (_reader.name() != QLatin1String("member"))
+        {
+            _reader.skipCurrentElement();
+            continue;
+        }
+
+        QString name;
+        bool haveName = false;
+
+        while (_reader.readNextStartElement())
+        {
+            if (_reader.name() == QLatin1String("name"))
+            {
+                name = _reader.readElementText();
+                haveName = true;
+            }
+            else if (_reader.name() == QLatin1String("value") && haveName)
+            {
+                handler(name);
+                haveName = false;
+            }
+            else
+            {
+                _reader.skipCurrentElement();
+            }
+        }
+    }
+}
+
+QVariant XmlRpcDecoder::decode()
+{
+    if (!findFirstValue())
+    {
+        return QVariant();
+    }
+
+    QVariant retval = readValue();
+    checkError();
+
+    return retval;
+}
+
+std::optional<QVariantMap> XmlRpcDecoder::decodeStruct(const QString& arrayMember, XmlRpcRecordVisitor& visitor)
+{
+    if (!findFirstValue())
+    {
+        return std::nullopt;
+    }
+
+    std::optional<QVariantMap> retval;
+
+    while (_reader.readNextStartElement())
+    {
+        if (_reader.name() != QLatin1String("struct") || retval)
+        {
+            _reader.skipCurrentElement();
+            continue;
+        }
+
+        QVariantMap map;
+        readMembers([this, &map, &arrayMember, &visitor](const QString& name)
+        {
+            if (name == arrayMember)
+            {
+                readRecords(visitor);
+                map.insert(name, QVariantList());
+            }
+            else
+            {
+                map.insert(name, readValue());
+            }
+        });
+
+        retval = std::move(map);
+    }
+
+    checkError();
+    return retval;
+}
+
+// moves the reader onto the first <value> of the document
+bool XmlRpcDecoder::findFirstValue()
+{
+    while (!_reader.atEnd())
+    {
+        if (_reader.readNext() == QXmlStreamReader::StartElement
+            && _reader.name() == QLatin1String("value"))
+        {
+            return true;
+        }
+    }
+
+    checkError();
+    return false;
+}
+
+void XmlRpcDecoder::checkError()
+{
+    if (_reader.hasError())
+    {
+        OWL_THROW_EXCEPTION(Exception(QString("Could not parse XML from XML-RPC call: %1 at line %2")
+            .arg(_reader.errorString())
+            .arg(_reader.lineNumber())));
+    }
+}
+
+// positioned on <value>, consumes everything up to and including </value>
+QVariant XmlRpcDecoder::readValue()
+{
+    QVariant retval;
+    QString text;
+    bool typed = false;
+
+    while (!_reader.atEnd())
+    {
+        switch (_reader.readNext())
+        {
+            case QXmlStreamReader::Characters:
+                if (!typed)
+                {
+                    text += _reader.text();
+                }
+            break;
+
+            case QXmlStreamReader::StartElement:
+                // a value has a single type element, any other is ignored
+                if (typed)
+                {
+                    _reader.skipCurrentElement();
+                }
+                else
+                {
+                    typed = true;
+                    retval = readTypedValue();
+                }
+            break;
+
+            case QXmlStreamReader::EndElement:
+                // a value without a type element is a string
+                return typed ? retval : QVariant(text);
+
+            default:
+            break;
+        }
+    }
+
+    return QVariant();
+}
+
+// positioned on the type element inside of a <value>
+QVariant XmlRpcDecoder::readTypedValue()
+{
+    const auto type = _reader.name();
+
+    if (type == QLatin1String("string"))
+    {
+        return _reader.readElementText();
+    }
+    else if (type == QLatin1String("int") || type == QLatin1String("i4"))
+    {
+        return _reader.readElementText().toInt();
+    }
+    else if (type == QLatin1String("boolean"))
+    {
+        const QString text = _reader.readElementText();
+        if (text == QLatin1String("0"))
+        {
+            return false;
+        }
+        else if (text == QLatin1String("1"))
+        {
+            return true;
+        }
+        return QVariant();
+    }
+    else if (type == QLatin1String("double"))
+    {
+        return _reader.readElementText().toDouble();
+    }
+    else if (type == QLatin1String("dateTime.iso8601"))
+    {
+        // "yyyyMMddThh:mm:ss" needs the dashes for Qt to recognize it
+        QString text = _reader.readElementText();
+        text.insert(4, '-');
+        text.insert(7, '-');
+
+        const QDateTime dt = QDateTime::fromString(text, Qt::ISODate);
+        return dt.isValid() ? QVariant(dt) : QVariant();
+    }
+    else if (type == QLatin1String("base64"))
+    {
+        return XRBase64::decode(_reader.readElementText());
+    }
+    else if (type == QLatin1String("array"))
+    {
+        return readArray();
+    }
+    else if (type == QLatin1String("struct"))
+    {
+        return readStruct();
+    }
+
+    _reader.skipCurrentElement();
+    return QVariant();
+}
+
+// positioned on <array>. Like XRVariant an array with an invalid value, or
+// without <data>, is invalid as a whole
+QVariant XmlRpcDecoder::readArray()
+{
+    QVariantList list;
+    bool haveData = false;
+    bool failed = false;
+
+    while (_reader.readNextStartElement())
+    {
+        if (_reader.name() != QLatin1String("data") || haveData)
+        {
+            _reader.skipCurrentElement();
+            continue;
+        }
+
+        haveData = true;
+        while (_reader.readNextStartElement())
+        {
+            if (_reader.name() != QLatin1String("value"))
+            {
+                failed = true;
+                _reader.skipCurrentElement();
+                continue;
+            }
+
+            QVariant value = readValue();
+            if (!value.isValid())
+            {
+                failed = true;
+            }
+            else if (!failed)
+            {
+                list.push_back(std::move(value));
+            }
+        }
+    }
+
+    if (!haveData || failed)
+    {
+        return QVariant();
+    }
+
+    return list;
+}
+
+QVariantMap XmlRpcDecoder::readStruct()
+{
+    QVariantMap map;
+
+    readMembers([this, &map](const QString& name)
+    {
+        map.insert(name, readValue());
+    });
+
+    return map;
+}
+
+// positioned on the <value> holding an array of structs
+void XmlRpcDecoder::readRecords(XmlRpcRecordVisitor& visitor)
+{
+    // <value><array><data><value><struct>...
+    const auto readChildren = [this](const QLatin1String& element, const auto& onElement)
+    {
+        while (_reader.readNextStartElement())
+        {
+            if (_reader.name() == element)
+            {
+                onElement();
+            }
+            else
+            {
+                _reader.skipCurrentElement();
+            }
+        }
+    };
+
+    readChildren(QLatin1String("array"), [&]()
+    {
+        readChildren(QLatin1String("data"), [&]()
+        {
+            readChildren(QLatin1String("value"), [&]()
+            {
+                readChildren(QLatin1String("struct"), [&]()
+                {
+                    visitor.beginRecord();
+                    readMembers([this, &visitor](const QString& name)
+                    {
+                        if (visitor.wantsField(name))
+                        {
+                            visitor.field(name, readValue());
+                        }
+                        else
+                        {
+                            _reader.skipCurrentElement();
+                        }
+                    });
+                    visitor.endRecord();
+                });
+            });
+        });
+    });
+}
+
+} // namespace
@@ -0,0 +1,81 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <optional>
+#include <QtCore>
+#include <QXmlStreamReader>
+
+namespace owl
+{
+
+// Receives the structs of a streamed XML-RPC array one member at a time,
+// see XmlRpcDecoder::decodeStruct()
+class XmlRpcRecordVisitor
+{
+public:
+    virtual ~XmlRpcRecordVisitor() = default;
+
+    virtual void beginRecord() { }
+
+    // Members for which this returns false are skipped without being decoded
+    virtual bool wantsField(const QString& name) const
+    {
+        Q_UNUSED(name);
+        return true;
+    }
+
+    virtual void field(const QString& name, QVariant value) = 0;
+
+    virtual void endRecord() = 0;
+};
+
+// A single pass XML-RPC decoder built on QXmlStreamReader. Values are
+// mapped to the same QVariant types as XRVariant:
+//
+//      int, i4             int
+//      boolean             bool
+//      double              double
+//      string, untyped     QString
+//      dateTime.iso8601    QDateTime
+//      base64              QByteArray
+//      array               QVariantList
+//      struct              QVariantMap
+//
+// Only the first <value> of the document is decoded (the response's param or
+// its fault) and reading stops after it. Malformed XML before the end of that
+// value throws owl::Exception.
+class XmlRpcDecoder final
+{
+public:
+    explicit XmlRpcDecoder(const QString& xml);
+
+    // Returns the first value of the document, or an invalid QVariant if
+    // there is none
+    QVariant decode();
+
+    // Decodes a response whose value is a struct. The array stored under
+    // `arrayMember` is not collected, each of its structs is handed to
+    // `visitor` instead, and the member is left in the result as an empty
+    // list. Returns std::nullopt if the value is not a struct.
+    std::optional<QVariantMap> decodeStruct(const QString& arrayMember, XmlRpcRecordVisitor& visitor);
+
+private:
+    bool findFirstValue();
+    void checkError();
+
+    QVariant readValue();
+    QVariant readTypedValue();
+    QVariant readArray();
+    QVariantMap readStruct();
+    void readRecords(XmlRpcRecordVisitor& visitor);
+
+    // calls `handler(name)` for every named member of the current struct,
+    // positioned on the member's <value> which the handler must consume
+    template<typename Handler>
+    void readMembers(Handler&& handler);
+
+    QXmlStreamReader    _reader;
+};
+
+} // namespace
@@ -0,0 +1,147 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include "XmlRpcWriter.h"
+
+namespace owl
+{
+
+// enough for every Tapatalk request except new posts with long messages
+constexpr int REQUEST_BUFFER_SIZE = 1024;
+
+XmlRpcWriter::XmlRpcWriter()
+{
+    _buffer.reserve(REQUEST_BUFFER_SIZE);
+}
+
+void XmlRpcWriter::begin(const QString& methodName)
+{
+    // keeps the allocation unless a previous request is still referenced
+    _buffer.resize(0);
+    if (_buffer.capacity() < REQUEST_BUFFER_SIZE)
+    {
+        _buffer.reserve(REQUEST_BUFFER_SIZE);
+    }
+
+    auto prefix = _prefixes.constFind(methodName);
+    if (prefix == _prefixes.constEnd())
+    {
+        QByteArray text("<?xml version=\"1.0\"?><methodCall><methodName>");
+        appendEscaped(text, methodName);
+        text.append("</methodName>");
+
+        prefix = _prefixes.insert(methodName, text);
+    }
+
+    _buffer.append(*prefix);
+    _hasParams = false;
+}
+
+void XmlRpcWriter::addParam(Type type, const QVariant& value, const QString& name)
+{
+    if (!_hasParams)
+    {
+        _buffer.append("<params>");
+        _hasParams = true;
+    }
+
+    _buffer.append("<param>");
+
+    if (!name.isEmpty())
+    {
+        _buffer.append("<name>");
+        appendEscaped(_buffer, name);
+        _buffer.append("</name>");
+    }
+
+    _buffer.append("<value>");
+
+    switch (type)
+    {
+        case Type::STRING:
+            _buffer.append("<string>");
+            appendEscaped(_buffer, value.toString());
+            _buffer.append("</string>");
+        break;
+
+        case Type::BASE64:
+            _buffer.append("<base64>");
+            appendEscaped(_buffer, value.toString());
+            _buffer.append("</base64>");
+        break;
+
+        case Type::INT:
+            _buffer.append("<int>");
+            _buffer.append(QByteArray::number(value.toInt()));
+            _buffer.append("</int>");
+        break;
+
+        case Type::BOOLEAN:
+            _buffer.append("<boolean>");
+            _buffer.append(value.toBool() ? "true" : "false");
+            _buffer.append("</boolean>");
+        break;
+    }
+
+    _buffer.append("</value></param>");
+}
+
+QByteArray XmlRpcWriter::finish()
+{
+    if (_hasParams)
+    {
+        _buffer.append("</params>");
+        _hasParams = false;
+    }
+
+    _buffer.append("</methodCall>");
+    return _buffer;
+}
+
+// appends `text` as UTF-8 with the XML special characters escaped, without
+// going through a temporary QByteArray
+void XmlRpcWriter::appendEscaped(QByteArray& buffer, const QString& text)
+{
+    const QChar* data = text.constData();
+    const int length = text.size();
+
+    for (int i = 0; i < length; i++)
+    {
+        const ushort c = data[i].unicode();
+
+        if (c < 0x80)
+        {
+            switch (c)
+            {
+                case '<': buffer.append("&lt;"); break;
+                case '>': buffer.append("&gt;"); break;
+                case '&': buffer.append("&amp;"); break;
+                case '\r': buffer.append("&#13;"); break;
+                default: buffer.append(static_cast<char>(c)); break;
+            }
+        }
+        else if (c < 0x800)
+        {
+            buffer.append(static_cast<char>(0xc0 | (c >> 6)));
+            buffer.append(static_cast<char>(0x80 | (c & 0x3f)));
+        }
+        else if (QChar::isHighSurrogate(c) && i + 1 < length && data[i + 1].isLowSurrogate())
+        {
+            const uint ucs4 = QChar::surrogateToUcs4(c, data[++i].unicode());
+            buffer.append(static_cast<char>(0xf0 | (ucs4 >> 18)));
+            buffer.append(static_cast<char>(0x80 | ((ucs4 >> 12) & 0x3f)));
+            buffer.append(static_cast<char>(0x80 | ((ucs4 >> 6) & 0x3f)));
+            buffer.append(static_cast<char>(0x80 | (ucs4 & 0x3f)));
+        }
+        else
+        {
+            // a lone surrogate is written as U+FFFD
+            const ushort code = QChar::isSurrogate(c) ? 0xfffd : c;
+            buffer.append(static_cast<char>(0xe0 | (code >> 12)));
+            buffer.append(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+            buffer.append(static_cast<char>(0x80 | (code & 0x3f)));
+        }
+    }
+}
+
+} // namespace
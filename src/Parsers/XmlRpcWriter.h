@@ -0,0 +1,44 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <QtCore>
+
+namespace owl
+{
+
+// Serializes XML-RPC method calls as compact UTF-8, ready to be posted as
+// is. The buffer is reused from one call to the next and the
+// "<?xml ...><methodCall><methodName>..." prefix is rendered once per method.
+class XmlRpcWriter final
+{
+public:
+    enum class Type
+    {
+        STRING,
+        BASE64,
+        INT,
+        BOOLEAN
+    };
+
+    XmlRpcWriter();
+
+    // Starts a new call, discarding anything that was not finished
+    void begin(const QString& methodName);
+
+    // `value` is written as text, so a BASE64 value must already be encoded
+    void addParam(Type type, const QVariant& value, const QString& name = QString());
+
+    // Returns the request. It shares the writer's buffer, which is only
+    // reused by the next begin() once every copy of it has been released
+    QByteArray finish();
+
+private:
+    static void appendEscaped(QByteArray& buffer, const QString& text);
+
+    QByteArray                  _buffer;
+    QHash<QString, QByteArray>  _prefixes;
+    bool                        _hasParams = false;
+};
+
+} // namespace
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
 #include "xrvariant.h"
+#include "XmlRpcDecoder.h"
 
 XRVariant::XRVariant(const QVariant& aqv)
 {
@@ -33,21 +34,8 @@ XRVariant::XRVariant(QDomElement& xrv)
 
 XRVariant::XRVariant( const QString& xml )
 {
-	QDomDocument doc;
-	if (doc.setContent(xml))
-	{
-		QDomNodeList nodeList = doc.elementsByTagName("value");
-
-		if (nodeList.count() > 0)
-		{
-            QDomElement tempElement = nodeList.at(0).toElement();
-			fromDomElement(tempElement);
-		}
-	}
-	else
-	{
-		throw std::logic_error("Could not parse XML from XML-RPC call");
-	}
+	// decoded in a single pass without building a DOM, see XmlRpcDecoder
+	this->QVariant::operator=( owl::XmlRpcDecoder(xml).decode() );
 }
 
 
@@ -86,6 +86,10 @@ class XRVariant : public QVariant
 	 */
         XRVariant(QDomElement& a_xml_rpc_value);
 
+	/**
+	 * read the first XML-RPC value of a response, throws owl::Exception
+	 * if the XML cannot be parsed
+	 */
 		XRVariant(const QString& xml);
 
 	/**
@@ -61,6 +61,11 @@ public:
           _message(other._message)
     {}
 
+    // QFuture copies a reported exception through clone() and rethrows it
+    // with raise(), so every subclass overrides both to keep its type
+    void raise() const override { throw *this; }
+    Exception* clone() const override { return new Exception(*this); }
+
     virtual QString message() const noexcept { return _message; }
 
     virtual QString details() const;
@@ -82,6 +87,9 @@ public:
     virtual ~NotImplementedException() = default;
 
     using Exception::Exception;
+
+    void raise() const override { throw *this; }
+    NotImplementedException* clone() const override { return new NotImplementedException(*this); }
 };
 
 class WebException : public Exception
@@ -95,6 +103,9 @@ public:
     std::int32_t statuscode() const { return _statusCode; }
 
     QString details() const override;
+
+    void raise() const override { throw *this; }
+    WebException* clone() const override { return new WebException(*this); }
     
 private:
     QString         _lastUrl;
@@ -111,6 +122,9 @@ public:
 
     QString luaError() const { return _luaError; }
 
+    void raise() const override { throw *this; }
+    LuaException* clone() const override { return new LuaException(*this); }
+
 private:
 	QString _luaError;
 };
@@ -0,0 +1,432 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include "HttpCache.h"
+
+#include <Utils/OwlLogger.h>
+
+namespace owl
+{
+
+// identifies an Owl cache file, "OWLC"
+constexpr quint32 CACHE_FILE_MAGIC = 0x4f574c43;
+
+// bump when the file layout changes, older files are then discarded
+constexpr quint16 CACHE_FILE_VERSION = 1;
+
+const QString CACHE_FILE_SUFFIX = QStringLiteral(".cache");
+
+HttpCachePtr HttpCache::instance()
+{
+    static HttpCachePtr _instance = std::make_shared<HttpCache>(
+        QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath("http"));
+
+    return _instance;
+}
+
+HttpCache::HttpCache(const QString& directory, qint64 maxDiskSize, qint64 maxMemorySize)
+    : _directory(directory),
+      _maxDiskSize(maxDiskSize),
+      _maxMemorySize(maxMemorySize),
+      _logger(owl::initializeLogger("HttpCache"))
+{
+}
+
+QString HttpCache::makeKey(const QString& method, const QString& url)
+{
+    return QString("%1 %2").arg(method.toUpper(), url);
+}
+
+qint64 HttpCache::getMaxDiskSize() const
+{
+    Lock lock(_mutex);
+    return _maxDiskSize;
+}
+
+void HttpCache::setMaxDiskSize(qint64 size)
+{
+    Lock lock(_mutex);
+    _maxDiskSize = size;
+
+    loadIndex();
+    trimDisk();
+}
+
+qint64 HttpCache::getMaxMemorySize() const
+{
+    Lock lock(_mutex);
+    return _maxMemorySize;
+}
+
+void HttpCache::setMaxMemorySize(qint64 size)
+{
+    Lock lock(_mutex);
+    _maxMemorySize = size;
+    trimMemory();
+}
+
+qint64 HttpCache::diskSize() const
+{
+    Lock lock(_mutex);
+    return _diskSize;
+}
+
+qint64 HttpCache::memorySize() const
+{
+    Lock lock(_mutex);
+    return _memorySize;
+}
+
+HttpCache::EntryPtr HttpCache::find(const QString& key)
+{
+    const QString file = fileName(key);
+
+    {
+        Lock lock(_mutex);
+
+        if (auto it = _memory.find(key); it != _memory.end())
+        {
+            auto entry = it->entry;
+            touchMemory(key, entry);
+            touchDisk(file);
+
+            return entry;
+        }
+
+        loadIndex();
+
+        if (!_disk.contains(file))
+        {
+            return nullptr;
+        }
+    }
+
+    // read without holding the lock, writeEntry() replaces files atomically
+    // so a concurrent store() never exposes a partially written file
+    auto entry = readEntry(file);
+
+    Lock lock(_mutex);
+
+    if (!entry || entry->key != key)
+    {
+        // unreadable, or a (very unlikely) hash collision
+        removeDisk(file);
+        return nullptr;
+    }
+
+    // don't bring back an entry that was removed while it was being read
+    if (touchDisk(file))
+    {
+        touchMemory(key, entry);
+    }
+
+    return entry;
+}
+
+void HttpCache::store(const Entry& entry)
+{
+    auto copy = std::make_shared<Entry>(entry);
+    if (!copy->stored.isValid())
+    {
+        copy->stored = QDateTime::currentDateTimeUtc();
+    }
+
+    const QString file = fileName(copy->key);
+
+    {
+        Lock lock(_mutex);
+
+        touchMemory(copy->key, copy);
+
+        if (_directory.isEmpty())
+        {
+            return;
+        }
+
+        loadIndex();
+
+        if (static_cast<qint64>(copy->body.size()) > _maxDiskSize)
+        {
+            removeDisk(file);
+            return;
+        }
+    }
+
+    // write without holding the lock so that lookups aren't blocked on the disk
+    if (!writeEntry(file, *copy))
+    {
+        return;
+    }
+
+    const qint64 size = QFileInfo(QDir(_directory).absoluteFilePath(file)).size();
+
+    Lock lock(_mutex);
+
+    auto disk = _disk.find(file);
+    if (disk == _disk.end())
+    {
+        _diskLru.push_front(file);
+        disk = _disk.insert(file, DiskEntry{ copy->key, 0, _diskLru.begin() });
+    }
+    else
+    {
+        touchDisk(file);
+    }
+
+    _diskSize += size - disk->size;
+    disk->key = copy->key;
+    disk->size = size;
+
+    trimDisk();
+}
+
+void HttpCache::remove(const QString& key)
+{
+    Lock lock(_mutex);
+
+    removeMemory(key);
+
+    loadIndex();
+    removeDisk(fileName(key));
+}
+
+void HttpCache::clear(const QString& urlPrefix)
+{
+    Lock lock(_mutex);
+
+    // keys are "METHOD url"
+    const auto matches = [&urlPrefix](const QString& key)
+    {
+        return urlPrefix.isEmpty()
+            || key.midRef(key.indexOf(' ') + 1).startsWith(urlPrefix, Qt::CaseInsensitive);
+    };
+
+    for (auto it = _memoryLru.begin(); it != _memoryLru.end();)
+    {
+        const QString key = *it++;
+        if (matches(key))
+        {
+            removeMemory(key);
+        }
+    }
+
+    loadIndex();
+
+    QStringList files;
+    for (auto it = _disk.cbegin(); it != _disk.cend(); ++it)
+    {
+        if (matches(it->key))
+        {
+            files.push_back(it.key());
+        }
+    }
+
+    for (const auto& file : files)
+    {
+        removeDisk(file);
+    }
+
+    _logger->debug("Cleared {} cached responses for '{}'", files.size(), urlPrefix.toStdString());
+}
+
+QString HttpCache::fileName(const QString& key) const
+{
+    return QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex())
+        + CACHE_FILE_SUFFIX;
+}
+
+// must be called with _mutex locked
+void HttpCache::loadIndex()
+{
+    if (_indexLoaded || _directory.isEmpty())
+    {
+        return;
+    }
+
+    _indexLoaded = true;
+
+    QDir dir(_directory);
+    if (!dir.exists() && !dir.mkpath("."))
+    {
+        _logger->warn("Could not create HTTP cache directory '{}'", _directory.toStdString());
+        return;
+    }
+
+    // oldest first so that the most recently written files end up at the
+    // front of the LRU list
+    const auto files = dir.entryInfoList(QStringList{ "*" + CACHE_FILE_SUFFIX },
+        QDir::Files, QDir::Time | QDir::Reversed);
+
+    for (const auto& info : files)
+    {
+        QFile file(info.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+
+        // only the header is needed for the index
+        QDataStream in(&file);
+        quint32 magic = 0;
+        quint16 version = 0;
+        QString key;
+        in >> magic >> version >> key;
+
+        if (in.status() != QDataStream::Ok
+            || magic != CACHE_FILE_MAGIC
+            || version != CACHE_FILE_VERSION)
+        {
+            file.close();
+            QFile::remove(info.absoluteFilePath());
+            continue;
+        }
+
+        _diskLru.push_front(info.fileName());
+        _disk.insert(info.fileName(), DiskEntry{ key, info.size(), _diskLru.begin() });
+        _diskSize += info.size();
+    }
+
+    _logger->debug("Loaded {} cached responses ({} bytes) from '{}'",
+        _disk.size(), _diskSize, _directory.toStdString());
+
+    trimDisk();
+}
+
+HttpCache::EntryPtr HttpCache::readEntry(const QString& fileName) const
+{
+    QFile file(QDir(_directory).absoluteFilePath(fileName));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return nullptr;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint16 version = 0;
+    auto entry = std::make_shared<Entry>();
+    QByteArray body;
+
+    in >> magic >> version >> entry->key;
+    if (magic != CACHE_FILE_MAGIC || version != CACHE_FILE_VERSION)
+    {
+        return nullptr;
+    }
+
+    in >> entry->finalUrl >> entry->etag >> entry->lastModified >> entry->stored >> body;
+    if (in.status() != QDataStream::Ok)
+    {
+        _logger->warn("Could not read cached response '{}'", fileName.toStdString());
+        return nullptr;
+    }
+
+    entry->body.assign(body.constData(), static_cast<std::size_t>(body.size()));
+    return entry;
+}
+
+bool HttpCache::writeEntry(const QString& fileName, const Entry& entry) const
+{
+    // QSaveFile so that a crash never leaves a truncated entry behind
+    QSaveFile file(QDir(_directory).absoluteFilePath(fileName));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        _logger->warn("Could not write cached response '{}'", fileName.toStdString());
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << CACHE_FILE_MAGIC << CACHE_FILE_VERSION
+        << entry.key << entry.finalUrl << entry.etag << entry.lastModified << entry.stored
+        << QByteArray::fromRawData(entry.body.data(), static_cast<int>(entry.body.size()));
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+// must be called with _mutex locked
+void HttpCache::touchMemory(const QString& key, EntryPtr entry)
+{
+    removeMemory(key);
+
+    if (static_cast<qint64>(entry->body.size()) > _maxMemorySize)
+    {
+        return;
+    }
+
+    _memoryLru.push_front(key);
+    _memory.insert(key, MemoryEntry{ entry, _memoryLru.begin() });
+    _memorySize += static_cast<qint64>(entry->body.size());
+
+    trimMemory();
+}
+
+// must be called with _mutex locked
+void HttpCache::removeMemory(const QString& key)
+{
+    auto it = _memory.find(key);
+    if (it == _memory.end())
+    {
+        return;
+    }
+
+    _memorySize -= static_cast<qint64>(it->entry->body.size());
+    _memoryLru.erase(it->lru);
+    _memory.erase(it);
+}
+
+// must be called with _mutex locked
+void HttpCache::trimMemory()
+{
+    while (_memorySize > _maxMemorySize && !_memoryLru.empty())
+    {
+        removeMemory(_memoryLru.back());
+    }
+}
+
+// must be called with _mutex locked, returns false if `fileName` isn't cached
+bool HttpCache::touchDisk(const QString& fileName)
+{
+    auto it = _disk.find(fileName);
+    if (it == _disk.end())
+    {
+        return false;
+    }
+
+    _diskLru.splice(_diskLru.begin(), _diskLru, it->lru);
+    return true;
+}
+
+// must be called with _mutex locked
+void HttpCache::removeDisk(const QString& fileName)
+{
+    auto it = _disk.find(fileName);
+    if (it == _disk.end())
+    {
+        return;
+    }
+
+    // `fileName` may refer to the key being erased
+    const QString path = QDir(_directory).absoluteFilePath(fileName);
+
+    _diskSize -= it->size;
+    _diskLru.erase(it->lru);
+    _disk.erase(it);
+
+    QFile::remove(path);
+}
+
+// must be called with _mutex locked
+void HttpCache::trimDisk()
+{
+    while (_diskSize > _maxDiskSize && !_diskLru.empty())
+    {
+        // copied, removeDisk() erases the list node
+        const QString file = _diskLru.back();
+
+        _logger->trace("Evicting cached response '{}'", _disk.value(file).key.toStdString());
+        removeDisk(file);
+    }
+}
+
+} // namespace
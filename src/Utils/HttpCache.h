@@ -0,0 +1,137 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <QtCore>
+
+#define HTTPCACHE       HttpCache::instance()
+
+namespace spdlog
+{
+    class logger;
+}
+
+namespace owl
+{
+
+// upper bound of the bodies kept on disk
+constexpr qint64 DEFAULT_HTTP_CACHE_DISK_SIZE = 64 * 1024 * 1024;
+
+// upper bound of the bodies kept in memory in front of the disk cache
+constexpr qint64 DEFAULT_HTTP_CACHE_MEMORY_SIZE = 8 * 1024 * 1024;
+
+class HttpCache;
+using HttpCachePtr = std::shared_ptr<HttpCache>;
+
+// A size-bounded HTTP response cache shared by all WebClient instances.
+// Responses are stored on disk with their validators (ETag and
+// Last-Modified) so that they can be revalidated with a conditional
+// request, and the most recently used ones are also kept in memory.
+// All methods are thread safe.
+class HttpCache final
+{
+    using Mutex = std::mutex;
+    using Lock  = std::lock_guard<std::mutex>;
+
+public:
+    struct Entry
+    {
+        QString         key;
+        QString         finalUrl;
+        QString         etag;
+        QString         lastModified;
+        QDateTime       stored;
+        std::string     body;           // the raw (untidied) response body
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    // the process wide cache stored under the user's cache directory
+    static HttpCachePtr instance();
+
+    // An empty `directory` keeps the cache in memory only
+    HttpCache(const QString& directory,
+              qint64 maxDiskSize = DEFAULT_HTTP_CACHE_DISK_SIZE,
+              qint64 maxMemorySize = DEFAULT_HTTP_CACHE_MEMORY_SIZE);
+
+    HttpCache(const HttpCache&) = delete;
+    HttpCache& operator=(const HttpCache&) = delete;
+    ~HttpCache() = default;
+
+    static QString makeKey(const QString& method, const QString& url);
+
+    const QString& directory() const { return _directory; }
+
+    qint64 getMaxDiskSize() const;
+    void setMaxDiskSize(qint64 size);
+
+    qint64 getMaxMemorySize() const;
+    void setMaxMemorySize(qint64 size);
+
+    // total size of the bodies currently held on disk and in memory
+    qint64 diskSize() const;
+    qint64 memorySize() const;
+
+    // Returns the cached response or nullptr
+    EntryPtr find(const QString& key);
+
+    void store(const Entry& entry);
+
+    void remove(const QString& key);
+
+    // Removes every entry, or only those whose url starts with `urlPrefix`
+    void clear(const QString& urlPrefix = QString());
+
+private:
+    struct MemoryEntry
+    {
+        EntryPtr                        entry;
+        std::list<QString>::iterator    lru;
+    };
+
+    struct DiskEntry
+    {
+        QString                         key;
+        qint64                          size = 0;
+        std::list<QString>::iterator    lru;
+    };
+
+    QString fileName(const QString& key) const;
+
+    void loadIndex();
+    EntryPtr readEntry(const QString& fileName) const;
+    bool writeEntry(const QString& fileName, const Entry& entry) const;
+
+    void touchMemory(const QString& key, EntryPtr entry);
+    void removeMemory(const QString& key);
+    void trimMemory();
+
+    bool touchDisk(const QString& fileName);
+    void removeDisk(const QString& fileName);
+    void trimDisk();
+
+    mutable Mutex                   _mutex;
+
+    const QString                   _directory;
+    qint64                          _maxDiskSize;
+    qint64                          _maxMemorySize;
+
+    // most recently used keys are at the front
+    std::list<QString>              _memoryLru;
+    QHash<QString, MemoryEntry>     _memory;
+    qint64                          _memorySize = 0;
+
+    // on-disk entries by file name, loaded lazily from `_directory`,
+    // the most recently used file names are at the front of `_diskLru`
+    std::list<QString>              _diskLru;
+    QHash<QString, DiskEntry>       _disk;
+    qint64                          _diskSize = 0;
+    bool                            _indexLoaded = false;
+
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+} // namespace
@@ -1,6 +1,7 @@
 // Owl - www.owlclient.com
 // Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
 
+#include <mutex>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include "OwlLogger.h"
 
@@ -31,6 +32,10 @@ static const char* GLOBAL_LOGGER = "Owl";
 
 SpdLogPtr initializeLogger(const std::string& name)
 {
+    // objects with the same logger can be created on several threads at once
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
     owl::rootLogger();
 
     SpdLogPtr logger = spdlog::get(name);
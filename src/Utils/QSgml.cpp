@@ -21,41 +21,76 @@ This is free software, and you are welcome to redistribute it
 under certain conditions.
 ------------------------------------------------------------------------------------------*/ 
  
+#include <algorithm>
+#include <vector>
 #include "QSgml.h"
 
-// find the start of a tag
-void QSgml::FindStart(const QString &HtmlString,int &iPos)
+// a character that may be part of a tag name
+static inline bool IsNameChar(QChar c)
 {
-   iPos=HtmlString.indexOf("<",iPos);
+   return c.isLetterOrNumber() || c=='-' || c=='_' || c==':' || c=='.';
 }
 
-// find the end of a tag
+static inline bool IsSpace(QChar c)
+{
+   return c==' ' || c=='\t' || c=='\n' || c=='\r' || c=='\f';
+}
+
+// find the end of the tag starting at iPos
 // make sure the '>' is not in a quote
-void QSgml::FindEnd(const QString &HtmlString,int &iPos)
+int QSgml::FindTagEnd(int iPos) const
 {
-   for( ; iPos<HtmlString.length() ; iPos++ )
+   const QChar *pData = sSgmlString.constData();
+   const int iLength = sSgmlString.length();
+
+   for( ; iPos<iLength ; iPos++ )
    {
+      const QChar c = pData[iPos];
+
       // Its a tag end
-      if( HtmlString.at(iPos)=='>' )
+      if( c=='>' )
       {
-         return;
+         return iPos;
       }
-      if( HtmlString.at(iPos)=='\'' )
+      if( c=='\'' || c=='\"' )
       {
-         iPos=HtmlString.indexOf("\'",iPos+1);
-      }
-      if( HtmlString.at(iPos)=='\"' )
-      {
-         iPos=HtmlString.indexOf("\"",iPos+1);
+         // a quote that is never closed is taken literally
+         const int iClose = sSgmlString.indexOf(c,iPos+1);
+         if( iClose!=-1 )
+         {
+            iPos = iClose;
+         }
       }
    }
-   iPos = -1;
+
+   return -1;
 }
 
-// find and of a comment
-void QSgml::FindEndComment(const QString &HtmlString,int &iPos)
+// find the end-tag of an exception-tag (script, style) whose content is
+// not parsed, the name is matched without regard to case
+int QSgml::FindExceptionEnd(int iPos,const QString &Name) const
 {
-   iPos = HtmlString.indexOf("-->",iPos);
+   const QChar *pData = sSgmlString.constData();
+   const int iLength = sSgmlString.length();
+   const int iNameLength = Name.length();
+
+   while( (iPos = sSgmlString.indexOf(QLatin1String("</"),iPos))!=-1 )
+   {
+      int i = 0;
+      while( i<iNameLength && iPos+2+i<iLength && pData[iPos+2+i].toLower()==Name.at(i) )
+      {
+         i++;
+      }
+
+      if( i==iNameLength && (iPos+2+i>=iLength || !IsNameChar(pData[iPos+2+i])) )
+      {
+         return iPos;
+      }
+
+      iPos += 2;
+   }
+
+   return -1;
 }
 
 // create a html-file as string with default optimization
@@ -208,174 +243,412 @@ QString QSgml::getText(QSgmlTag *pTag)
 }
 
 // move all children (with children) to an other parent
+// the caller is responsible for resetting the levels
 void QSgml::MoveChildren(QSgmlTag *Source, QSgmlTag *Dest)
 {
-    int i;
-   int iCount = Source->Children.count();
+   for( QSgmlTag *pChild : Source->Children )
+   {
+      pChild->Parent = Dest;
+      pChild->SiblingIndex = Dest->Children.count();
+      Dest->Children.append(pChild);
+   }
+
+   Source->Children.clear();
+}
+
+// create a tag in the arena and add it to its parent
+QSgmlTag* QSgml::NewTag(QSgmlTag::TagType eType,QSgmlTag *pParent)
+{
+   TagArena.emplace_back();
+
+   QSgmlTag *pTag = &TagArena.back();
+   pTag->Type = eType;
+   pTag->Parent = pParent;
+   pTag->Level = pParent->Level+1;
+   pTag->InArena = true;
+   pTag->SiblingIndex = pParent->Children.count();
 
-   for( i=0 ; i<iCount ; i++ )
+   pParent->Children.append(pTag);
+   return pTag;
+}
+
+// get the shared lower case copy of a tag or attribute name
+QString QSgml::InternName(const QChar *pName,int iLength)
+{
+   // look up without copying the name out of the document
+   auto i = NameTable.constFind(QString::fromRawData(pName,iLength));
+   if( i==NameTable.constEnd() )
    {
-      Source->Children[0]->Parent = Dest;
-      //Source->Children[0]->Level = Dest->Level+1;  // ToDo: Level von allen Kindern auch decrementieren!
-      Dest->resetLevel();
-      Dest->Children.append( Source->Children[0] );
-      Source->Children.removeFirst();
+      const QString Name(pName,iLength);
+      i = NameTable.insert(Name,Name.toLower());
    }
+
+   return i.value();
 }
 
 // include a CDATA in to the QSgml-class
-void QSgml::HandleCdata(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos)
+void QSgml::HandleCdata(QSgmlTag *pParent,int iStart,int iEnd)
 {
-   QString sDummy;
-   QRegExp qNoWhitSpace("(\\S)");
-   QSgmlTag *pTag;
+   const QChar *pData = sSgmlString.constData();
+
+   int iFirst = iStart;
+   while( iFirst<iEnd && pData[iFirst].isSpace() )
+   {
+      iFirst++;
+   }
+
+   // only white space
+   if( iFirst==iEnd )
+   {
+      return;
+   }
 
-   iStart = iEnd+1;
-   iEnd = iPos;
-   sDummy = SgmlString.mid(iStart,iEnd-iStart).trimmed();
-   // set tag
-   if( sDummy.contains(qNoWhitSpace)  )
+   int iLast = iEnd;
+   while( pData[iLast-1].isSpace() )
    {
-      pTag = new QSgmlTag(sDummy,QSgmlTag::eCdata,pLastTag);
-      pTag->StartTagPos = iStart;
-      pTag->StartTagLength = iEnd-iStart;
-      pTag->EndTagPos = iStart;
-      pTag->EndTagLength = iEnd-iStart;
-      pLastTag->Children.append( pTag );
+      iLast--;
    }
+
+   QSgmlTag *pTag = NewTag(QSgmlTag::eCdata,pParent);
+   pTag->Value = sSgmlString.mid(iFirst,iLast-iFirst);
+   pTag->StartTagPos = iStart;
+   pTag->StartTagLength = iEnd-iStart;
+   pTag->EndTagPos = iStart;
+   pTag->EndTagLength = iEnd-iStart;
 }
 
-// include a comment in to the QSgml-class
-void QSgml::HandleComment(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos)
+// include a comment in to the QSgml-class, returns the position after it
+int QSgml::HandleComment(QSgmlTag *pParent,int iPos)
 {
-   QString sDummy;
-   QSgmlTag *pTag;
+   const int iStart = iPos+4;
+   int iEnd = sSgmlString.indexOf(QLatin1String("-->"),iStart);
 
-   iPos+=4;
-   iStart = iPos;
-   FindEndComment(SgmlString,iPos);
-   iEnd = iPos;
+   // an unterminated comment runs to the end of the document
+   if( iEnd==-1 )
+   {
+      iEnd = sSgmlString.length();
+   }
 
-   sDummy = SgmlString.mid(iStart,iEnd-iStart).trimmed();
-   pTag = new QSgmlTag(sDummy,QSgmlTag::eComment,pLastTag);
-   pTag->StartTagPos = iStart-4;
-   pTag->StartTagLength = iEnd-iStart+7;
-   pTag->EndTagPos = iStart-4;
-   pTag->EndTagLength = iEnd-iStart+7;
-   pLastTag->Children.append( pTag );
-   iEnd+=2;
-   iPos=iEnd;
+   QSgmlTag *pTag = NewTag(QSgmlTag::eComment,pParent);
+   pTag->Value = sSgmlString.mid(iStart,iEnd-iStart).trimmed();
+   pTag->StartTagPos = iPos;
+   pTag->StartTagLength = iEnd-iPos+3;
+   pTag->EndTagPos = iPos;
+   pTag->EndTagLength = iEnd-iPos+3;
+
+   return iEnd+3;
 }
 
-// include a doctype in to the QSgml-class
-void QSgml::HandleDoctype(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos)
+// include a doctype (or processing instruction) in to the QSgml-class
+int QSgml::HandleDoctype(QSgmlTag *pParent,int iPos)
 {
-   QString sDummy;
-   QSgmlTag *pTag;
-
-   iStart = iPos;
-   FindEnd(SgmlString,iPos);
-   iEnd = iPos;
-   sDummy = SgmlString.mid(iStart+2,iEnd-iStart-2).trimmed();
+   const int iEnd = FindTagEnd(iPos);
+   if( iEnd==-1 )
+   {
+      return -1;
+   }
 
-   pTag = new QSgmlTag(sDummy,QSgmlTag::eDoctype,pLastTag);
-   pTag->StartTagPos = iStart;
-   pTag->StartTagLength = iEnd-iStart+1;
-   pTag->EndTagPos = iStart;
-   pTag->EndTagLength = iEnd-iStart+1;
+   QSgmlTag *pTag = NewTag(QSgmlTag::eDoctype,pParent);
+   pTag->Value = sSgmlString.mid(iPos+2,iEnd-iPos-2).trimmed();
+   pTag->StartTagPos = iPos;
+   pTag->StartTagLength = iEnd-iPos+1;
+   pTag->EndTagPos = iPos;
+   pTag->EndTagLength = iEnd-iPos+1;
 
-   pLastTag->Children.append( pTag );
+   return iEnd+1;
 }
 
 // include a endtag in to the QSgml-class
-void QSgml::HandleEndTag(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos)
+int QSgml::HandleEndTag(QSgmlTag* &pLastTag,int iPos)
 {
-   QString sDummy;
-   QSgmlTag *pTag;
-   QSgmlTag *pDummyTag;
+   const QChar *pData = sSgmlString.constData();
 
-   iStart = iPos;
-   FindEnd(SgmlString,iPos);
-   iEnd = iPos;
-   sDummy = SgmlString.mid(iStart+1,iEnd-iStart-1).trimmed();
+   const int iEnd = FindTagEnd(iPos);
+   if( iEnd==-1 )
+   {
+      return -1;
+   }
+
+   int iName = iPos+2;
+   while( iName<iEnd && IsSpace(pData[iName]) )
+   {
+      iName++;
+   }
+
+   int iNameEnd = iName;
+   while( iNameEnd<iEnd && IsNameChar(pData[iNameEnd]) )
+   {
+      iNameEnd++;
+   }
 
-   pTag = new QSgmlTag(sDummy,QSgmlTag::eEndTag,pLastTag);
+   const QString Name = InternName(pData+iName,iNameEnd-iName);
 
    // find a fitting start-tag
-   pDummyTag = pLastTag;
-   while( (pDummyTag->Name!=pTag->Name)&&(pDummyTag->Parent!=nullptr) )
+   QSgmlTag *pStartTag = pLastTag;
+   while( (pStartTag->Parent!=nullptr)&&(pStartTag->Name!=Name) )
+   {
+      pStartTag = pStartTag->Parent;
+   }
+
+   if( pStartTag->Parent==nullptr )
    {
-      pDummyTag = pDummyTag->Parent;
+      // no start-tag, ignore the stray end-tag
+      return iEnd+1;
    }
-   delete pTag;
 
-   if( pDummyTag->Parent!=nullptr )
-   {  // start-tag found
-      while( pLastTag!=pDummyTag )
-      {  // all tags in between are standalone tags
-         pLastTag->Type=QSgmlTag::eStandalone;
-         MoveChildren( pLastTag,pLastTag->Parent );
+   if( pLastTag!=pStartTag )
+   {
+      // all tags in between are standalone tags
+      while( pLastTag!=pStartTag )
+      {
+         pLastTag->Type = QSgmlTag::eStandalone;
+         MoveChildren(pLastTag,pLastTag->Parent);
          pLastTag = pLastTag->Parent;
       }
-      // set data in start-tag
-      pLastTag->EndTagPos = iStart;
-      pLastTag->EndTagLength = iEnd-iStart+1;
-      // tags which have no children are special (script can't be a standalone-tag)
-      if( pLastTag->Children.count()==0 )
-      {  pLastTag->Type = QSgmlTag::eStartEmpty;  }
-      pLastTag = pLastTag->Parent;
+
+      pStartTag->resetLevel();
    }
-   else
-   {  // no start-tag -> end
-      pLastTag->Children.append( EndTag );
-      iPos=-1;
+
+   // set data in start-tag
+   pStartTag->EndTagPos = iPos;
+   pStartTag->EndTagLength = iEnd-iPos+1;
+   // tags which have no children are special (script can't be a standalone-tag)
+   if( pStartTag->Children.count()==0 )
+   {
+      pStartTag->Type = QSgmlTag::eStartEmpty;
    }
+
+   pLastTag = pStartTag->Parent;
+   return iEnd+1;
 }
 
 // include a start-tag in to the QSgml-class
-void QSgml::HandleStartTag(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos)
+int QSgml::HandleStartTag(QSgmlTag* &pLastTag,int iPos)
+{
+   const QChar *pData = sSgmlString.constData();
+
+   const int iEnd = FindTagEnd(iPos);
+   if( iEnd==-1 )
+   {
+      return -1;
+   }
+
+   int iNameEnd = iPos+1;
+   while( iNameEnd<iEnd && IsNameChar(pData[iNameEnd]) )
+   {
+      iNameEnd++;
+   }
+
+   const bool bStandalone = pData[iEnd-1]=='/';
+
+   QSgmlTag *pTag = NewTag(bStandalone ? QSgmlTag::eStandalone : QSgmlTag::eStartTag,pLastTag);
+   pTag->Name = InternName(pData+iPos+1,iNameEnd-iPos-1);
+   pTag->StartTagPos = iPos;
+   pTag->StartTagLength = iEnd-iPos+1;
+   pTag->EndTagPos = iPos;
+   pTag->EndTagLength = iEnd-iPos+1;
+
+   ParseAttributes(pTag,iNameEnd,bStandalone ? iEnd-1 : iEnd);
+
+   if( !bStandalone )
+   {
+      pLastTag = pTag;
+   }
+
+   return iEnd+1;
+}
+
+// parse the attributes between iStart and iEnd in one pass
+void QSgml::ParseAttributes(QSgmlTag *pTag,int iStart,int iEnd)
+{
+   const QChar *pData = sSgmlString.constData();
+   int i = iStart;
+
+   for( ;; )
+   {
+      while( i<iEnd && (IsSpace(pData[i]) || pData[i]=='/') )
+      {
+         i++;
+      }
+
+      if( i>=iEnd )
+      {
+         break;
+      }
+
+      const int iNameStart = i;
+      while( i<iEnd && !IsSpace(pData[i]) && pData[i]!='=' && pData[i]!='/' )
+      {
+         i++;
+      }
+
+      if( i==iNameStart )
+      {
+         // a stray '='
+         i++;
+         continue;
+      }
+
+      const QString Name = InternName(pData+iNameStart,i-iNameStart);
+
+      while( i<iEnd && IsSpace(pData[i]) )
+      {
+         i++;
+      }
+
+      QString Value;
+      if( i<iEnd && pData[i]=='=' )
+      {
+         i++;
+         while( i<iEnd && IsSpace(pData[i]) )
+         {
+            i++;
+         }
+
+         if( i<iEnd && (pData[i]=='\"' || pData[i]=='\'') )
+         {
+            const QChar cQuote = pData[i];
+            const int iValueStart = ++i;
+            while( i<iEnd && pData[i]!=cQuote )
+            {
+               i++;
+            }
+
+            Value = sSgmlString.mid(iValueStart,i-iValueStart);
+            i++;
+         }
+         else
+         {
+            const int iValueStart = i;
+            while( i<iEnd && !IsSpace(pData[i]) )
+            {
+               i++;
+            }
+
+            Value = sSgmlString.mid(iValueStart,i-iValueStart);
+         }
+      }
+
+      pTag->Attributes.insert(Name,Value);
+   }
+}
+
+// release the parsed tags
+// DocTag and EndTag are kept, tags created with addChild() are deleted by
+// their parent
+void QSgml::ReleaseTags(void)
+{
+   // unlink the arena tags first so that the destructors below only see
+   // the children they own
+   const auto bNotOwned = [this](QSgmlTag *pTag) { return pTag->InArena || pTag==EndTag; };
+
+   DocTag->Children.erase(
+      std::remove_if(DocTag->Children.begin(),DocTag->Children.end(),bNotOwned),
+      DocTag->Children.end());
+
+   for( QSgmlTag &Tag : TagArena )
+   {
+      Tag.Children.erase(
+         std::remove_if(Tag.Children.begin(),Tag.Children.end(),bNotOwned),
+         Tag.Children.end());
+   }
+
+   TagArena.clear();
+
+   IndexBuilt = false;
+   ClassIndex.clear();
+   IdIndex.clear();
+}
+
+// walk the document once and record every element under each of its class
+// tokens and its id
+void QSgml::BuildIndex(void)
 {
-   QString sDummy;
-   QSgmlTag *pTag;
+   ClassIndex.clear();
+   IdIndex.clear();
+
+   std::vector<QSgmlTag*> Stack;
+   Stack.push_back(DocTag);
+
+   while( !Stack.empty() )
+   {
+      QSgmlTag *pTag = Stack.back();
+      Stack.pop_back();
 
-   iStart = iPos;
-   FindEnd(SgmlString,iPos);
-   iEnd = iPos;
-   sDummy = SgmlString.mid(iStart+1,iEnd-iStart-1).trimmed();
+      if( pTag->Type==QSgmlTag::eStartTag || pTag->Type==QSgmlTag::eStandalone
+         || pTag->Type==QSgmlTag::eStartEmpty )
+      {
+         const auto Id = pTag->Attributes.constFind(QStringLiteral("id"));
+         if( Id!=pTag->Attributes.constEnd() && !Id->isEmpty() )
+         {
+            IdIndex[*Id].append(pTag);
+         }
+
+         const auto Class = pTag->Attributes.constFind(QStringLiteral("class"));
+         if( Class!=pTag->Attributes.constEnd() )
+         {
+            const QChar *pData = Class->constData();
+            const int iLength = Class->length();
+            int iPos = 0;
+
+            while( iPos<iLength )
+            {
+               while( iPos<iLength && IsSpace(pData[iPos]) ) iPos++;
+               const int iStart = iPos;
+               while( iPos<iLength && !IsSpace(pData[iPos]) ) iPos++;
+
+               if( iPos>iStart )
+               {
+                  QList<QSgmlTag*> &Tags = ClassIndex[QString(pData+iStart,iPos-iStart)];
+
+                  // class="a a" lists the tag once
+                  if( Tags.isEmpty() || Tags.last()!=pTag )
+                  {
+                     Tags.append(pTag);
+                  }
+               }
+            }
+         }
+      }
 
-   if( SgmlString.at(iEnd-1)=='/' )
+      // push in reverse so the children are visited in document order
+      for( int i=pTag->Children.count()-1 ; i>=0 ; i-- )
+      {
+         Stack.push_back(pTag->Children[i]);
+      }
+   }
+
+   IndexBuilt = true;
+}
+
+const QHash<QString,QList<QSgmlTag*>>& QSgml::getClassIndex(void)
+{
+   if( !IndexBuilt )
    {
-      // this is a standalone-tag
-      sDummy = sDummy.left( sDummy.count()-1 );
-      pTag = new QSgmlTag(sDummy,QSgmlTag::eStandalone,pLastTag);
-      pTag->StartTagPos = iStart;
-      pTag->StartTagLength = iEnd-iStart+1;
-      pTag->EndTagPos = iStart;
-      pTag->EndTagLength = iEnd-iStart+1;
-      pLastTag->Children.append( pTag );
+      BuildIndex();
    }
-   else
+   return ClassIndex;
+}
+
+const QHash<QString,QList<QSgmlTag*>>& QSgml::getIdIndex(void)
+{
+   if( !IndexBuilt )
    {
-      // this is a start-tag
-      pTag = new QSgmlTag(sDummy,QSgmlTag::eStartTag,pLastTag);
-      pTag->StartTagPos = iStart;
-      pTag->StartTagLength = iEnd-iStart+1;
-      pTag->EndTagPos = iStart;
-      pTag->EndTagLength = iEnd-iStart+1;
-      pLastTag->Children.append( pTag );
-      pLastTag=pTag;
+      BuildIndex();
    }
+   return IdIndex;
 }
 
 // find an element with a defined name
 void QSgml::getElementsByName(QString Name,QList<QSgmlTag*> *Elements)
 {
    QSgmlTag *Tag = DocTag;
+   const QString LowerName = Name.toLower();
 
    Elements->clear();
    while( Tag->Type!=QSgmlTag::eVirtualEndTag )
    {
-      if( Tag->Name==Name.toLower() )
+      if( Tag->Name==LowerName )
       {
          Elements->append(Tag);
       }
@@ -501,8 +774,9 @@ bool QSgml::load(QString sFileName)
    bool qExists=fileText.exists();
 
    // delete old elements
+   ReleaseTags();
    delete DocTag;
-   //delete EndTag;
+   delete EndTag;
    // create new doc-tag
    DocTag = new QSgmlTag("DocTag",QSgmlTag::eVirtualBeginTag,nullptr);
    EndTag = new QSgmlTag("EndTag",QSgmlTag::eVirtualEndTag,DocTag);
@@ -527,8 +801,9 @@ bool QSgml::load(QString sFileName)
 bool QSgml::parse(const QString& html)
 {
 	// delete old elements
+	ReleaseTags();
 	delete DocTag;
-	//delete EndTag;
+	delete EndTag;
 	// create new doc-tag
 	DocTag = new QSgmlTag("DocTag",QSgmlTag::eVirtualBeginTag,nullptr);
 	EndTag = new QSgmlTag("EndTag",QSgmlTag::eVirtualEndTag,DocTag);
@@ -621,81 +896,99 @@ QSgml::QSgml(QFile &SgmlFile)
 }
 
 // convert a String to QSgml
-void QSgml::String2Sgml(const QString SgmlString)
+// a single pass over the document, tags are created in the arena
+void QSgml::String2Sgml(const QString& SgmlString)
 {
-   QSgmlTag *LastTag;
-   QSgmlTag *Tag;
-   QString sDummy;
-   int iPos = 0;
-   int iStart = 0;
-   int iEnd = 0;
-   QList<QString>::iterator i;
+   ReleaseTags();
+   qDeleteAll(DocTag->Children);
+   DocTag->Children.clear();
 
-   sSgmlString=SgmlString;
+   sSgmlString = SgmlString;
 
-   DocTag->Children.clear();
+   const QChar *pData = sSgmlString.constData();
+   const int iLength = sSgmlString.length();
 
-   Tag=DocTag;
-   LastTag=DocTag;
+   QSgmlTag *pLastTag = DocTag;
+   int iPos = 0;
+   int iText = 0;   // start of the text that is not part of a tag yet
 
-   do
+   while( iPos<iLength )
    {
-      // Handle exception-tags
-      for( i=tagExeption.begin() ; i!=tagExeption.end() ; ++i )
+      // the content of exception-tags is not parsed
+      if( tagExeption.contains(pLastTag->Name) )
       {
-         QString sName=*i;
-         if( LastTag->Name.toLower()==sName )
-         {  // its an exception-tag
-            iPos = SgmlString.toLower().indexOf("</"+sName,iPos);
-            iPos--;
-         }
+         iPos = FindExceptionEnd(iPos,pLastTag->Name);
+      }
+      else
+      {
+         iPos = sSgmlString.indexOf(QLatin1Char('<'),iPos);
       }
 
-      FindStart(SgmlString,iPos);
       // no new start
       if( iPos==-1 )
       {
-         LastTag->Children.append( EndTag );
          break;
       }
 
+      const QChar cNext = (iPos+1<iLength) ? pData[iPos+1] : QChar();
+
+      // a '<' that does not start a tag is text
+      if( !cNext.isLetter() && cNext!='/' && cNext!='!' && cNext!='?' )
+      {
+         iPos++;
+         continue;
+      }
+
       // there was CDATA
-      else if( iPos > iEnd+1 )
+      if( iPos>iText )
       {
-         HandleCdata(SgmlString,LastTag,iStart,iEnd,iPos);
+         HandleCdata(pLastTag,iText,iPos);
       }
 
       // this is a comment
-      if( (SgmlString.at(iPos+1)=='!')&&(SgmlString.at(iPos+2)=='-')&&(SgmlString.at(iPos+3)=='-') )
+      if( (cNext=='!')&&(iPos+3<iLength)&&(pData[iPos+2]=='-')&&(pData[iPos+3]=='-') )
       {
-         HandleComment(SgmlString,LastTag,iStart,iEnd,iPos);
+         iPos = HandleComment(pLastTag,iPos);
       }
-      // this is a PI
-//      else if( SgmlString.at(iPos+1)=='?' )
-//      {
-//         HandleDoctype(SgmlString,LastTag,iStart,iEnd,iPos);
-//      }
-      // this is a Doctype
-      else if( SgmlString.at(iPos+1)=='!' )
+      // this is a Doctype or a PI
+      else if( (cNext=='!')||(cNext=='?') )
       {
-         HandleDoctype(SgmlString,LastTag,iStart,iEnd,iPos);
+         iPos = HandleDoctype(pLastTag,iPos);
       }
       // this is an Endtag
-      else if( SgmlString.at(iPos+1)=='/' )
+      else if( cNext=='/' )
       {
-         HandleEndTag(SgmlString,LastTag,iStart,iEnd,iPos);
+         iPos = HandleEndTag(pLastTag,iPos);
       }
       // this is an Starttag of Standalone
       else
       {
-         HandleStartTag(SgmlString,LastTag,iStart,iEnd,iPos);
+         iPos = HandleStartTag(pLastTag,iPos);
       }
-   } while( iPos!=-1 );
+
+      // an unterminated tag
+      if( iPos==-1 )
+      {
+         break;
+      }
+
+      iText = iPos;
+   }
+
+   // whatever follows the last tag
+   if( iText<iLength )
+   {
+      HandleCdata(pLastTag,iText,iLength);
+   }
+
+   pLastTag->Children.append( EndTag );
 }
 
 // destructor
 QSgml::~QSgml(void)
 {
+   ReleaseTags();
    delete DocTag;
+   delete EndTag;
 }
 
@@ -24,6 +24,7 @@ under certain conditions.
 #ifndef QSGML_H
 #define QSGML_H
 
+#include <deque>
 #include <QString>
 #include <QRegExp>
 #include <QList>
@@ -87,7 +88,7 @@ public:
    void ExportString(QString *HtmlString);
    void ExportString(QString *HtmlString,char Optimze,int Tabsize);
    void ExportString(QSgmlTag* pTag, QString *HtmlString,char Optimze,int Tabsize);
-   void String2Sgml(const QString SgmlString);
+   void String2Sgml(const QString& SgmlString);
 
    void getText(QSgmlTag* pTag, QString* html);
    QString getText(QSgmlTag* pTag);
@@ -95,19 +96,42 @@ public:
    QString getInnerHtml(QSgmlTag* tag);
    QString getOuterHtml(QSgmlTag* tag);
 
+   // elements by class token and by id, in document order. Both tables are
+   // built on first use and dropped when the document is parsed again
+   const QHash<QString,QList<QSgmlTag*>>& getClassIndex(void);
+   const QHash<QString,QList<QSgmlTag*>>& getIdIndex(void);
+
 protected:
    QDir dirPath;
 
+   // the parsed tags, allocated in bulk instead of one by one
+   std::deque<QSgmlTag> TagArena;
+
+   // tag and attribute names as written in the document mapped to a single
+   // shared lower case copy, so each distinct name is only allocated once
+   QHash<QString,QString> NameTable;
+
+   bool IndexBuilt = false;
+   QHash<QString,QList<QSgmlTag*>> ClassIndex;
+   QHash<QString,QList<QSgmlTag*>> IdIndex;
+
+   void BuildIndex(void);
+
+   void ReleaseTags(void);
    void MoveChildren(QSgmlTag *Source, QSgmlTag *Dest);
-   void FindStart(const QString &HtmlString,int &iPos);
-   void FindEnd(const QString &HtmlString,int &iPos);
-   void FindEndComment(const QString &HtmlString,int &iPos);
-   void HandleCdata(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos);
-   void HandleComment(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos);
-
-   void HandleDoctype(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos);
-   void HandleEndTag(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos);
-   void HandleStartTag(QString SgmlString,QSgmlTag* &pLastTag,int &iStart,int &iEnd,int &iPos);
+
+   QSgmlTag* NewTag(QSgmlTag::TagType eType,QSgmlTag *pParent);
+   QString InternName(const QChar *pName,int iLength);
+
+   int FindTagEnd(int iPos) const;
+   int FindExceptionEnd(int iPos,const QString &Name) const;
+
+   void HandleCdata(QSgmlTag *pParent,int iStart,int iEnd);
+   int HandleComment(QSgmlTag *pParent,int iPos);
+   int HandleDoctype(QSgmlTag *pParent,int iPos);
+   int HandleEndTag(QSgmlTag* &pLastTag,int iPos);
+   int HandleStartTag(QSgmlTag* &pLastTag,int iPos);
+   void ParseAttributes(QSgmlTag *pTag,int iStart,int iEnd);
 };
 
 #endif // QSGML_H
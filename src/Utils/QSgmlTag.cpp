@@ -140,69 +140,65 @@ bool QSgmlTag::checkAttribute(QString AtrName,QString AtrValue)
    {  return false;  }
 }
 
-// get the next tag on the same lefel
-QSgmlTag* QSgmlTag::getNextSibling(void)
+// get the position of this tag in Parent->Children, -1 if it has none.
+// SiblingIndex is used when it still points at this tag, otherwise the
+// positions of all the siblings are refreshed at once so that walking
+// through them is linear even after the list was changed
+int QSgmlTag::getSiblingIndex(void)
 {
-    int  i;
-
-    for( i=0 ; i<Parent->Children.count() ; i++ )
-    {
-        if( (Parent->Children[i])==this )
-        {
-            break;
-        }
-    }
-
-    if( i==(Parent->Children.count()-1) )
-    {
-        return nullptr;
-    }
-    else
-    {
-        return Parent->Children[i+1];
-    }
+   if( Parent==nullptr )
+   {
+      return -1;
+   }
+
+   const QSgmlTaglist &Siblings = Parent->Children;
+   if( (SiblingIndex<0)||(SiblingIndex>=Siblings.count())||(Siblings.at(SiblingIndex)!=this) )
+   {
+      SiblingIndex = -1;
+      for( int i=0 ; i<Siblings.count() ; i++ )
+      {
+         Siblings.at(i)->SiblingIndex = i;
+      }
+   }
+
+   return SiblingIndex;
 }
 
-// get the previous tag on the same lefel
-QSgmlTag* QSgmlTag::getPreviousSibling(void)
+// get the next tag on the same lefel
+QSgmlTag* QSgmlTag::getNextSibling(void)
 {
-   int  i;
+   const int i = getSiblingIndex();
 
-   for( i=0 ; i<Parent->Children.count() ; i++ )
-   {
-      if( (Parent->Children[i])==this )
-         break;
-   }
-   if( i==0 )
+   if( (i<0)||(i==(Parent->Children.count()-1)) )
    {
-      //return( *((QSgmlTag*)nullptr) );
-       return nullptr;
+      return nullptr;
    }
    else
    {
-      return Parent->Children[i-1];
+      return Parent->Children.at(i+1);
    }
 }
 
-QSgmlTag* QSgmlTag::getPrevious()
+// get the previous tag on the same lefel
+QSgmlTag* QSgmlTag::getPreviousSibling(void)
 {
-   int  i;
+   const int i = getSiblingIndex();
 
-   for( i=0 ; i<Parent->Children.count() ; i++ )
+   if( i<=0 )
    {
-      if( (Parent->Children[i])==this )
-         break;
-   }
-   if( i==0 )
-   {
-      return( nullptr) ;
+      return nullptr;
    }
    else
    {
-      return( Parent->Children[i-1] );
+      return Parent->Children.at(i-1);
    }
 }
 
+QSgmlTag* QSgmlTag::getPrevious()
+{
+   return getPreviousSibling();
+}
+
 // get the next tag
 QSgmlTag& QSgmlTag::getNextElement(void)
 {
@@ -289,17 +285,20 @@ QSgmlTag* QSgmlTag::getFirstElementByName(const QString& Name,
 	const QString& AtrName, 
 	const QRegExp& atrExp)
 {
-	QSgmlTag* ret = nullptr;
-	QList<QSgmlTag*> list;
-
-	getElementsByName(Name, AtrName, atrExp, &list);
+   QSgmlTag *Tag = this;
 
-	if (list.size() > 0)
-	{
-		ret = list.at(0);
-	}
+   // same walk as getElementsByName() but stop at the first match
+   while( Tag->Type!=QSgmlTag::eVirtualEndTag )
+   {
+      if((Tag->Name==Name) && (Tag->hasAttribute(AtrName) ==true ) &&
+		  (atrExp.indexIn(Tag->Attributes.value(AtrName)) != -1))
+      {
+         return Tag;
+      }
+      Tag = &Tag->getNextElement();
+   }
 
-	return ret;
+   return nullptr;
 }
 
 // reset the level of the tag
@@ -376,7 +375,10 @@ QSgmlTag* QSgmlTag::addChild(QString InnerTag, TagType eType)
       if( Level==0 )
          this->Children.insert(Children.count()-1,pnewTag);
       else
+      {
+         pnewTag->SiblingIndex = Children.count();
          this->Children.append(pnewTag);
+      }
    }
 
    return(tagRet);
@@ -384,8 +386,14 @@ QSgmlTag* QSgmlTag::addChild(QString InnerTag, TagType eType)
 
 // constructor
 QSgmlTag::QSgmlTag(void)
+	: Level(0),
+	  Parent(nullptr),
+	  Type(eNoTag),
+	  StartTagPos(0),
+	  StartTagLength(0),
+	  EndTagPos(0),
+	  EndTagLength(0)
 {
-	Parent = nullptr;
 }
 
 // constructor
@@ -423,7 +431,10 @@ QSgmlTag::~QSgmlTag(void)
 {
 	for (int i = 0; i < Children.count(); i++)
 	{
-		delete Children[i];
+		if (!Children[i]->InArena)
+		{
+			delete Children[i];
+		}
 	}
 
 	Children.clear();
@@ -60,6 +60,14 @@ public:
    int EndTagPos;
    int EndTagLength;
 
+   // tags created by QSgml's parser live in its arena and are released with
+   // it, all other tags are owned (and deleted) by their parent
+   bool InArena = false;
+
+   // the position of the tag in Parent->Children, only a hint since the list
+   // can be changed directly, see getSiblingIndex()
+   int SiblingIndex = -1;
+
    QSgmlTag(void);
    QSgmlTag(const QString &InnerTag);
    QSgmlTag(const QString &InnerTag,TagType eType,QSgmlTag *tParent);
@@ -98,6 +106,7 @@ public:
    QSgmlTag* addChild(QString InnerTag, TagType eType);
 
 private:
+   int getSiblingIndex(void);
    void SetType(const QString &InnerTag);
    void SetNameAttributes(const QString &InnerTag);
 };
@@ -0,0 +1,484 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <mutex>
+#include "Exception.h"
+#include "QSgml.h"
+#include "SgmlSelector.h"
+
+namespace owl
+{
+
+// selectors usually come from string literals in the parsers, this only
+// guards against scripts that build them on the fly
+constexpr int MAX_CACHED_SELECTORS = 512;
+
+namespace
+{
+
+std::mutex g_selectorCacheMutex;
+QHash<QString, SgmlSelectorPtr> g_selectorCache;
+
+bool isElement(const QSgmlTag* tag)
+{
+    return tag->Type == QSgmlTag::eStartTag
+        || tag->Type == QSgmlTag::eStandalone
+        || tag->Type == QSgmlTag::eStartEmpty;
+}
+
+bool isIdentChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '-' || c == '_' || c == ':';
+}
+
+// true if `token` is one of the whitespace separated words of `list`
+bool hasToken(const QString& list, const QString& token)
+{
+    const int length = token.length();
+    int pos = 0;
+
+    while ((pos = list.indexOf(token, pos)) != -1)
+    {
+        const bool startOk = pos == 0 || list.at(pos - 1).isSpace();
+        const bool endOk = pos + length == list.length() || list.at(pos + length).isSpace();
+
+        if (startOk && endOk)
+        {
+            return true;
+        }
+
+        pos += length;
+    }
+
+    return false;
+}
+
+} // namespace
+
+SgmlSelectorPtr SgmlSelector::compile(const QString& selector)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_selectorCacheMutex);
+        if (auto it = g_selectorCache.constFind(selector); it != g_selectorCache.constEnd())
+        {
+            return *it;
+        }
+    }
+
+    // parse outside of the lock, a parse error throws
+    auto compiled = std::make_shared<const SgmlSelector>(selector);
+
+    std::lock_guard<std::mutex> lock(g_selectorCacheMutex);
+    if (g_selectorCache.size() >= MAX_CACHED_SELECTORS)
+    {
+        g_selectorCache.clear();
+    }
+
+    g_selectorCache.insert(selector, compiled);
+    return compiled;
+}
+
+SgmlSelector::SgmlSelector(const QString& selector)
+    : _text(selector)
+{
+    parse();
+}
+
+void SgmlSelector::parse()
+{
+    const QString& text = _text;
+    const int length = text.length();
+    int pos = 0;
+
+    const auto fail = [this, &pos](const QString& reason)
+    {
+        OWL_THROW_EXCEPTION(Exception(QString("Invalid selector '%1' at %2: %3")
+            .arg(_text).arg(pos).arg(reason)));
+    };
+
+    const auto skipSpaces = [&]()
+    {
+        while (pos < length && text.at(pos).isSpace()) pos++;
+    };
+
+    const auto readIdent = [&]()
+    {
+        const int start = pos;
+        while (pos < length && isIdentChar(text.at(pos))) pos++;
+
+        if (pos == start)
+        {
+            fail("expected a name");
+        }
+
+        return text.mid(start, pos - start);
+    };
+
+    // a quoted value runs to the closing quote, otherwise up to the ']'
+    const auto readValue = [&]()
+    {
+        if (pos < length && (text.at(pos) == '"' || text.at(pos) == '\''))
+        {
+            const QChar quote = text.at(pos++);
+            const int end = text.indexOf(quote, pos);
+            if (end == -1)
+            {
+                fail("unterminated quote");
+            }
+
+            const QString value = text.mid(pos, end - pos);
+            pos = end + 1;
+            return value;
+        }
+
+        const int end = text.indexOf(']', pos);
+        if (end == -1)
+        {
+            fail("expected ']'");
+        }
+
+        const QString value = text.mid(pos, end - pos).trimmed();
+        pos = end;
+        return value;
+    };
+
+    bool newCompound = true;
+
+    while (pos < length)
+    {
+        const QChar c = text.at(pos);
+
+        if (c.isSpace())
+        {
+            newCompound = true;
+            pos++;
+            continue;
+        }
+
+        if (newCompound)
+        {
+            _compounds.emplace_back();
+            newCompound = false;
+        }
+
+        Compound& compound = _compounds.back();
+        const bool compoundEmpty = compound.tag.isEmpty() && compound.id.isEmpty()
+            && compound.classes.isEmpty() && compound.attributes.empty();
+
+        if (c == '.')
+        {
+            pos++;
+            compound.classes.append(readIdent());
+        }
+        else if (c == '#')
+        {
+            pos++;
+            compound.id = readIdent();
+        }
+        else if (c == '[')
+        {
+            pos++;
+            skipSpaces();
+
+            AttributeTest test;
+            test.name = readIdent().toLower();
+            skipSpaces();
+
+            if (pos < length && text.at(pos) != ']')
+            {
+                const QChar op = text.at(pos);
+                if (op == '=')
+                {
+                    test.op = AttributeTest::Op::EQUALS;
+                    pos++;
+                }
+                else if (pos + 1 < length && text.at(pos + 1) == '=')
+                {
+                    switch (op.toLatin1())
+                    {
+                        case '~': test.op = AttributeTest::Op::WORD; break;
+                        case '^': test.op = AttributeTest::Op::PREFIX; break;
+                        case '$': test.op = AttributeTest::Op::SUFFIX; break;
+                        case '*': test.op = AttributeTest::Op::CONTAINS; break;
+                        case '%': test.op = AttributeTest::Op::REGEX; break;
+                        default: fail(QString("unknown operator '%1='").arg(op));
+                    }
+                    pos += 2;
+                }
+                else
+                {
+                    fail("expected an operator");
+                }
+
+                skipSpaces();
+                test.value = readValue();
+                skipSpaces();
+            }
+
+            if (pos >= length || text.at(pos) != ']')
+            {
+                fail("expected ']'");
+            }
+            pos++;
+
+            if (test.op == AttributeTest::Op::REGEX)
+            {
+                test.regex.setPattern(test.value);
+                if (!test.regex.isValid())
+                {
+                    fail(test.regex.errorString());
+                }
+                test.regex.optimize();
+            }
+
+            compound.attributes.push_back(std::move(test));
+        }
+        else if (c == '*' && compoundEmpty)
+        {
+            // the same as no tag at all
+            pos++;
+        }
+        else if (isIdentChar(c) && compoundEmpty)
+        {
+            compound.tag = readIdent().toLower();
+        }
+        else
+        {
+            fail(QString("unexpected '%1'").arg(c));
+        }
+    }
+
+    if (_compounds.empty())
+    {
+        fail("empty selector");
+    }
+}
+
+bool SgmlSelector::matchesCompound(const QSgmlTag* tag, const Compound& compound) const
+{
+    if (!compound.tag.isEmpty() && tag->Name != compound.tag)
+    {
+        return false;
+    }
+
+    if (!compound.id.isEmpty() && tag->Attributes.value(QStringLiteral("id")) != compound.id)
+    {
+        return false;
+    }
+
+    if (!compound.classes.isEmpty())
+    {
+        const QString classes = tag->Attributes.value(QStringLiteral("class"));
+        for (const auto& name : compound.classes)
+        {
+            if (!hasToken(classes, name))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (const auto& test : compound.attributes)
+    {
+        const auto it = tag->Attributes.constFind(test.name);
+        if (it == tag->Attributes.constEnd())
+        {
+            return false;
+        }
+
+        bool matched = true;
+        switch (test.op)
+        {
+            case AttributeTest::Op::EXISTS:
+                break;
+            case AttributeTest::Op::EQUALS:
+                matched = *it == test.value;
+                break;
+            case AttributeTest::Op::WORD:
+                matched = hasToken(*it, test.value);
+                break;
+            case AttributeTest::Op::PREFIX:
+                matched = it->startsWith(test.value);
+                break;
+            case AttributeTest::Op::SUFFIX:
+                matched = it->endsWith(test.value);
+                break;
+            case AttributeTest::Op::CONTAINS:
+                matched = it->contains(test.value);
+                break;
+            case AttributeTest::Op::REGEX:
+                matched = test.regex.match(*it).hasMatch();
+                break;
+        }
+
+        if (!matched)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SgmlSelector::matches(const QSgmlTag* tag) const
+{
+    if (tag == nullptr || !isElement(tag) || !matchesCompound(tag, _compounds.back()))
+    {
+        return false;
+    }
+
+    // with only descendant combinators the closest matching ancestor is
+    // always the best choice, so no backtracking is needed
+    const QSgmlTag* ancestor = tag->Parent;
+    for (int i = static_cast<int>(_compounds.size()) - 2; i >= 0; --i)
+    {
+        while (ancestor != nullptr
+            && !(isElement(ancestor) && matchesCompound(ancestor, _compounds[i])))
+        {
+            ancestor = ancestor->Parent;
+        }
+
+        if (ancestor == nullptr)
+        {
+            return false;
+        }
+
+        ancestor = ancestor->Parent;
+    }
+
+    return true;
+}
+
+QList<QSgmlTag*> SgmlSelector::selectDocument(QSgml& doc, int limit) const
+{
+    const Compound& subject = _compounds.back();
+    const QList<QSgmlTag*>* candidates = nullptr;
+
+    // take the candidates from the index when the rightmost selector has an
+    // id or a class, the shortest list wins
+    if (!subject.id.isEmpty())
+    {
+        const auto& index = doc.getIdIndex();
+        const auto it = index.constFind(subject.id);
+        if (it == index.constEnd())
+        {
+            return {};
+        }
+        candidates = &(*it);
+    }
+    else if (!subject.classes.isEmpty())
+    {
+        const auto& index = doc.getClassIndex();
+        for (const auto& name : subject.classes)
+        {
+            const auto it = index.constFind(name);
+            if (it == index.constEnd())
+            {
+                return {};
+            }
+
+            if (candidates == nullptr || it->size() < candidates->size())
+            {
+                candidates = &(*it);
+            }
+        }
+    }
+
+    if (candidates == nullptr)
+    {
+        return selectTree(doc.DocTag, limit);
+    }
+
+    QList<QSgmlTag*> retval;
+    for (QSgmlTag* tag : *candidates)
+    {
+        if (matches(tag))
+        {
+            retval.append(tag);
+            if (retval.size() == limit)
+            {
+                break;
+            }
+        }
+    }
+
+    return retval;
+}
+
+QList<QSgmlTag*> SgmlSelector::selectTree(QSgmlTag* root, int limit) const
+{
+    QList<QSgmlTag*> retval;
+    if (root == nullptr)
+    {
+        return retval;
+    }
+
+    std::vector<QSgmlTag*> stack(root->Children.rbegin(), root->Children.rend());
+
+    while (!stack.empty())
+    {
+        QSgmlTag* tag = stack.back();
+        stack.pop_back();
+
+        if (matches(tag))
+        {
+            retval.append(tag);
+            if (retval.size() == limit)
+            {
+                break;
+            }
+        }
+
+        // in reverse so the children are visited in document order
+        for (int i = tag->Children.size() - 1; i >= 0; --i)
+        {
+            stack.push_back(tag->Children[i]);
+        }
+    }
+
+    return retval;
+}
+
+QList<QSgmlTag*> SgmlSelector::select(QSgml& doc) const
+{
+    return selectDocument(doc, 0);
+}
+
+QList<QSgmlTag*> SgmlSelector::select(QSgmlTag* root) const
+{
+    return selectTree(root, 0);
+}
+
+QSgmlTag* SgmlSelector::selectFirst(QSgml& doc) const
+{
+    const auto tags = selectDocument(doc, 1);
+    return tags.isEmpty() ? nullptr : tags.front();
+}
+
+QSgmlTag* SgmlSelector::selectFirst(QSgmlTag* root) const
+{
+    const auto tags = selectTree(root, 1);
+    return tags.isEmpty() ? nullptr : tags.front();
+}
+
+QList<QSgmlTag*> select(QSgml& doc, const QString& selector)
+{
+    return SgmlSelector::compile(selector)->select(doc);
+}
+
+QList<QSgmlTag*> select(QSgmlTag* root, const QString& selector)
+{
+    return SgmlSelector::compile(selector)->select(root);
+}
+
+QSgmlTag* selectFirst(QSgml& doc, const QString& selector)
+{
+    return SgmlSelector::compile(selector)->selectFirst(doc);
+}
+
+QSgmlTag* selectFirst(QSgmlTag* root, const QString& selector)
+{
+    return SgmlSelector::compile(selector)->selectFirst(root);
+}
+
+} // namespace
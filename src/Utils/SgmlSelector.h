@@ -0,0 +1,108 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <QtCore>
+
+class QSgml;
+class QSgmlTag;
+
+namespace owl
+{
+
+class SgmlSelector;
+using SgmlSelectorPtr = std::shared_ptr<const SgmlSelector>;
+
+// A compiled CSS-like selector for QSgml documents. The supported syntax is
+//
+//      tag                 element name, or '*' for any element
+//      .name               a token of the class attribute
+//      #name               the id attribute
+//      [attr]              the attribute is present
+//      [attr=value]        the attribute equals `value`
+//      [attr~=value]       `value` is one of the attribute's space separated tokens
+//      [attr^=value]       the attribute starts with `value`
+//      [attr$=value]       the attribute ends with `value`
+//      [attr*=value]       the attribute contains `value`
+//      [attr%=regex]       the regular expression matches somewhere in the attribute
+//
+// Simple selectors can be chained ("li.message[id%=^post-\d+$]") and
+// separated by whitespace for a descendant match ("ol#messageList a.username").
+// Values may be quoted with ' or ".
+//
+// Selectors are compiled once and cached by their text, so a parser can pass
+// the same string on every call.
+class SgmlSelector final
+{
+public:
+    // Returns the compiled selector for `selector`, throws owl::Exception if
+    // it cannot be parsed
+    static SgmlSelectorPtr compile(const QString& selector);
+
+    explicit SgmlSelector(const QString& selector);
+
+    const QString& text() const { return _text; }
+
+    // true if `tag` is an element that matches the whole selector
+    bool matches(const QSgmlTag* tag) const;
+
+    // every matching element of the document, in document order
+    QList<QSgmlTag*> select(QSgml& doc) const;
+
+    // every matching descendant of `root`, in document order
+    QList<QSgmlTag*> select(QSgmlTag* root) const;
+
+    QSgmlTag* selectFirst(QSgml& doc) const;
+    QSgmlTag* selectFirst(QSgmlTag* root) const;
+
+private:
+    struct AttributeTest
+    {
+        enum class Op
+        {
+            EXISTS,
+            EQUALS,
+            WORD,
+            PREFIX,
+            SUFFIX,
+            CONTAINS,
+            REGEX
+        };
+
+        QString             name;
+        Op                  op = Op::EXISTS;
+        QString             value;
+        QRegularExpression  regex;
+    };
+
+    struct Compound
+    {
+        QString                     tag;        // empty matches any element
+        QString                     id;
+        QStringList                 classes;
+        std::vector<AttributeTest>  attributes;
+    };
+
+    void parse();
+
+    bool matchesCompound(const QSgmlTag* tag, const Compound& compound) const;
+
+    // `limit` of 1 stops at the first match, 0 collects all of them
+    QList<QSgmlTag*> selectDocument(QSgml& doc, int limit) const;
+    QList<QSgmlTag*> selectTree(QSgmlTag* root, int limit) const;
+
+    QString                 _text;
+
+    // the descendant chain, outermost first
+    std::vector<Compound>   _compounds;
+};
+
+// Convenience wrappers that compile (or fetch from the cache) `selector`
+QList<QSgmlTag*> select(QSgml& doc, const QString& selector);
+QList<QSgmlTag*> select(QSgmlTag* root, const QString& selector);
+QSgmlTag* selectFirst(QSgml& doc, const QString& selector);
+QSgmlTag* selectFirst(QSgmlTag* root, const QString& selector);
+
+} // namespace
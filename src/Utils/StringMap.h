@@ -17,6 +17,9 @@ class StringMapException : public Exception
 public:
     virtual ~StringMapException() = default;
     using Exception::Exception;
+
+    void raise() const override { throw *this; }
+    StringMapException* clone() const override { return new StringMapException(*this); }
 };
 
 class StringMap
@@ -1,6 +1,10 @@
 // Owl - www.owlclient.com
 // Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <tidy.h>
 #include <tidybuffio.h>
 #include "WebClient.h"
@@ -32,12 +36,76 @@ CURLcode curlGlobalInit()
     return curl_global_init(CURL_GLOBAL_ALL);
 }
 
-WebClient::WebClient()
-    : _logger(owl::initializeLogger("WebClient"))
+// how long the transfer thread waits for socket activity before re-checking the queue
+constexpr int MULTI_POLL_TIMEOUT = 1000;
+
+// see getTidyMetrics()
+static std::atomic<std::uint64_t> g_tidyCount { 0 };
+static std::atomic<std::uint64_t> g_tidySkipped { 0 };
+static std::atomic<std::uint64_t> g_tidyMicroseconds { 0 };
+static std::atomic<std::uint64_t> g_tidyMaxMicroseconds { 0 };
+
+struct WebClient::AsyncRequest
+{
+    QString                     url;
+    uint                        options = Options::DEFAULT;
+    bool                        throwOnFail = true;
+    ReplyCallback               callback;
+    std::promise<ReplyPtr>      promise;
+    CacheLookup                 cache;
+
+    CURL*                       handle = nullptr;
+    curl_slist*                 headers = nullptr;
+    std::string                 buffer;
+    char                        errbuf[CURL_ERROR_SIZE] = { 0 };
+    QElapsedTimer               timer;
+
+    ~AsyncRequest()
+    {
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(handle);
+    }
+};
+
+void CookieJar::lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr)
+{
+    static_cast<CookieJar*>(userptr)->_mutexes.at(data).lock();
+}
+
+void CookieJar::unlock(CURL*, curl_lock_data data, void* userptr)
+{
+    static_cast<CookieJar*>(userptr)->_mutexes.at(data).unlock();
+}
+
+CookieJar::CookieJar()
 {
     static CURLcode _global = curlGlobalInit();
     Q_UNUSED(_global)
 
+    _share = curl_share_init();
+    if (!_share)
+    {
+        OWL_THROW_EXCEPTION(Exception("Could not create CURL share instance"));
+    }
+
+    curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &CookieJar::lock);
+    curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &CookieJar::unlock);
+    curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CookieJar::~CookieJar()
+{
+    curl_share_cleanup(_share);
+}
+
+WebClient::WebClient(CookieJarPtr cookieJar)
+    : _cache(HttpCache::instance()),
+      _cookieJar(cookieJar ? cookieJar : std::make_shared<CookieJar>()),
+      _logger(owl::initializeLogger("WebClient"))
+{
     _curl = curl_easy_init();
 
     if (_curl)
@@ -55,36 +123,75 @@ WebClient::WebClient()
 
 WebClient::~WebClient()
 {
+    {
+        Lock lock(_multiMutex);
+        _multiStop = true;
+    }
+
+    if (_multiThread.joinable())
+    {
+        curl_multi_wakeup(_multi);
+        _multiThread.join();
+    }
+
+    if (_multi)
+    {
+        curl_multi_cleanup(_multi);
+    }
+
+    // the cookie jar can only be released once no handle uses it anymore,
+    // which holds since it is a member
     curl_easy_cleanup(_curl);
 }
 
+HttpCachePtr WebClient::getCache() const
+{
+    Lock lock(_settingsMutex);
+    return _cache;
+}
+
+void WebClient::setCache(HttpCachePtr cache)
+{
+    Lock lock(_settingsMutex);
+    _cache = std::move(cache);
+}
+
 void WebClient::setUserAgent(const QString& agent)
 {
     Lock lock(_curlMutex);
-    curl_easy_setopt(_curl, CURLOPT_USERAGENT, agent.toLocal8Bit().data());
+    Lock settingsLock(_settingsMutex);
+
+    _userAgent = agent.toStdString();
+    curl_easy_setopt(_curl, CURLOPT_USERAGENT, _userAgent.c_str());
 }
 
 void WebClient::setHeader(const QString &key, const QString val)
 {
+    Lock lock(_settingsMutex);
     _headers.setOrAdd(key, val);
 }
 
 void WebClient::clearHeaders()
 {
+    Lock lock(_settingsMutex);
     _headers.clear();
 }
 
 void WebClient::addSendCookie(const QString &key, const QString &value)
 {
     Lock lock(_curlMutex);
+    Lock settingsLock(_settingsMutex);
 
-    const QString data = QString("%1=%2").arg(key, value);
-    curl_easy_setopt(_curl, CURLOPT_COOKIE, data.toLatin1().data());
+    _sendCookie = QString("%1=%2").arg(key, value).toLatin1().toStdString();
+    curl_easy_setopt(_curl, CURLOPT_COOKIE, _sendCookie.c_str());
 }
 
 void WebClient::eraseSendCookies()
 {
     Lock lock(_curlMutex);
+    Lock settingsLock(_settingsMutex);
+
+    _sendCookie.clear();
     curl_easy_setopt(_curl, CURLOPT_COOKIE, "");
 }
 
@@ -161,6 +268,7 @@ const QString WebClient::getLastRequestUrl() const
 void WebClient::setConfig(const WebClientConfig &config)
 {
     Lock lock(_curlMutex);
+    Lock settingsLock(_settingsMutex);
 
     _useEncryption = config.useEncryption;
     _strEncryptionSeed = config.encryptSeed;
@@ -168,7 +276,8 @@ void WebClient::setConfig(const WebClientConfig &config)
 
     // use the actual call instead of setUserAgent() to avoid deadlock and having to
     // use a recursive mutex
-    curl_easy_setopt(_curl, CURLOPT_USERAGENT, config.userAgent.toLocal8Bit().data());
+    _userAgent = config.userAgent.toStdString();
+    curl_easy_setopt(_curl, CURLOPT_USERAGENT, _userAgent.c_str());
 }
 
 QString WebClient::DownloadString(const QString &url, uint options /*=Options::DEFAULT*/)
@@ -185,10 +294,15 @@ QString WebClient::DownloadString(const QString &url, uint options /*=Options::D
 
 WebClient::ReplyPtr WebClient::GetUrl(const QString &url, uint options)
 {
-    return doRequest(url, QString(), Method::GET, options);
+    return doRequest(url, QByteArray(), Method::GET, options);
 }
 
 QString WebClient::UploadString(const QString& url, const QString &payload, uint options)
+{
+    return UploadString(url, payload.toLocal8Bit(), options);
+}
+
+QString WebClient::UploadString(const QString& url, const QByteArray& payload, uint options)
 {
     const auto reply = PostUrl(url, payload, options);
 
@@ -201,12 +315,17 @@ QString WebClient::UploadString(const QString& url, const QString &payload, uint
 }
 
 WebClient::ReplyPtr WebClient::PostUrl(const QString& url, const QString &payload, uint options)
+{
+    return doRequest(url, payload.toLocal8Bit(), Method::POST, options);
+}
+
+WebClient::ReplyPtr WebClient::PostUrl(const QString& url, const QByteArray& payload, uint options)
 {
     return doRequest(url, payload, Method::POST, options);
 }
 
 WebClient::ReplyPtr WebClient::doRequest(const QString& url,
-                                   const QString& payload /*= QString()*/,
+                                   const QByteArray& payload /*= QByteArray()*/,
                                    Method method /*= Method::GET*/,
                                    uint options /*= Options::DEFAULT*/)
 {
@@ -216,8 +335,23 @@ WebClient::ReplyPtr WebClient::doRequest(const QString& url,
 
     bool bThrowOnFail = getThrowOnFail();
 
+    setRequestMethod(_curl, url, payload, method);
+
+    const auto cache = lookupCache(url, method, options);
+    auto headers = setHeaders(cache);
+
+    _buffer.clear();
+    CURLcode result = curl_easy_perform(_curl);
+
+    unsetHeaders(headers);
+
+    return makeReply(_curl, result, _buffer, _errbuf, url, options, bThrowOnFail, timer.elapsed(), cache, &_lastUrl);
+}
+
+void WebClient::setRequestMethod(CURL* curl, const QString& url, const QByteArray& payload, Method method)
+{
     // set the URL we're getting
-    curl_easy_setopt(_curl, CURLOPT_URL, url.toLatin1().data());
+    curl_easy_setopt(curl, CURLOPT_URL, url.toLatin1().data());
 
     // set up a GET or POST, if not a GET assume a POST
     if (method == Method::GET)
@@ -228,8 +362,8 @@ WebClient::ReplyPtr WebClient::doRequest(const QString& url,
             urlObj.scheme().toUpper().toStdString(),
             url.toStdString());
 
-        curl_easy_setopt(_curl, CURLOPT_HTTPGET, 1L);
-        curl_easy_setopt(_curl, CURLOPT_POST, 0L);
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl, CURLOPT_POST, 0L);
     }
     else if (method == Method::POST)
     {
@@ -240,44 +374,53 @@ WebClient::ReplyPtr WebClient::doRequest(const QString& url,
             url.toStdString(),
             payload.size());
 
-        curl_easy_setopt(_curl, CURLOPT_HTTPGET, 0L);
-        curl_easy_setopt(_curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 0L);
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
 
         if (payload.size() > 0)
         {
-            curl_easy_setopt(_curl, CURLOPT_POSTFIELDSIZE, payload.size());
-            curl_easy_setopt(_curl, CURLOPT_COPYPOSTFIELDS, payload.toLocal8Bit().data());
+            // the size is in bytes, set before COPYPOSTFIELDS so the copy isn't strlen()'d
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(payload.size()));
+            curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, payload.constData());
         }
         else
         {
-            curl_easy_setopt(_curl, CURLOPT_POSTFIELDSIZE, 0L);
-            curl_easy_setopt(_curl, CURLOPT_POSTFIELDS, nullptr);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, nullptr);
         }
     }
     else
     {
         OWL_THROW_EXCEPTION(owl::WebException("Unsupported HTTP method"));
     }
+}
 
-    auto headers = setHeaders();
-
-    _buffer.clear();
-    CURLcode result = curl_easy_perform(_curl);
-
-    unsetHeaders(headers);
-
+WebClient::ReplyPtr WebClient::makeReply(CURL* curl, CURLcode result,
+                                         std::string& buffer,
+                                         const char* errbuf,
+                                         const QString& url,
+                                         uint options,
+                                         bool bThrowOnFail,
+                                         qint64 elapsed,
+                                         const CacheLookup& cache,
+                                         QString* lastUrl /*= nullptr*/)
+{
     long status = 0;
-    curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    // the body either comes from the wire or, if the server says our copy
+    // is still good, from the cache
+    const std::string* body = &buffer;
 
     if (result != CURLE_OK)
     {
         QString errorText;
 
-        size_t len = strlen(_errbuf);
+        size_t len = strlen(errbuf);
         if (len > 0)
         {
             errorText = QString("Request error: %1")
-                .arg(_errbuf);
+                .arg(errbuf);
         }
         else
         {
@@ -296,31 +439,79 @@ WebClient::ReplyPtr WebClient::doRequest(const QString& url,
     }
 
     char *finalUrl;
-    curl_easy_getinfo(_curl, CURLINFO_EFFECTIVE_URL, &finalUrl);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &finalUrl);
+
+    if (lastUrl)
+    {
+        *lastUrl = QString::fromLatin1(finalUrl);
+    }
 
-    _lastUrl = QString::fromLatin1(finalUrl);
+    if (status == 304l && cache.entry)
+    {
+        _logger->trace("HTTP Response from '{}' not modified, using cached copy", finalUrl);
+
+        status = 200l;
+        body = &cache.entry->body;
+    }
+    else if (status == 200l && !cache.key.isEmpty())
+    {
+        storeCache(curl, cache, buffer, finalUrl);
+    }
+
+    // the receive buffer is handed over to the reply, only a cached body
+    // has to be copied since the cache keeps its own
+    const auto takeBody = [&buffer, body]() -> std::string
+    {
+        if (body == &buffer)
+        {
+            return std::move(buffer);
+        }
+
+        return *body;
+    };
 
     auto retval = std::make_shared<Reply>(status);
     retval->setFinalUrl(finalUrl);
 
     if (status == 200l)
     {
-        if (!(options & Options::NOTIDY))
+        const std::size_t length = body->size();
+        qint64 tidyElapsed = -1;
+
+        if (options & Options::NOTIDY)
         {
-            std::string temp{ owl::tidyHTML(_buffer.c_str()) };
-            retval->setData(temp, temp.size());
+            retval->setData(takeBody());
+        }
+        else if (!(options & Options::FORCETIDY) && isWellFormedHtml(*body))
+        {
+            // nothing for tidy to repair
+            g_tidySkipped++;
+            retval->setData(takeBody());
         }
         else
         {
-            retval->setData(_buffer, _buffer.size());
+            QElapsedTimer tidyTimer;
+            tidyTimer.start();
+
+            retval->setData(owl::tidyHTML(*body));
+
+            tidyElapsed = tidyTimer.elapsed();
         }
 
-        _logger->trace("HTTP Response from '{}' with length of '{}' took {} milliseconds",
-            finalUrl, _buffer.size(), timer.elapsed());
+        if (tidyElapsed >= 0)
+        {
+            _logger->trace("HTTP Response from '{}' with length of '{}' took {} milliseconds, tidy took {} milliseconds",
+                finalUrl, length, elapsed, tidyElapsed);
+        }
+        else
+        {
+            _logger->trace("HTTP Response from '{}' with length of '{}' took {} milliseconds",
+                finalUrl, length, elapsed);
+        }
     }
     else
     {
-        QString errorText = QString("Unhandled HTTP response code '%1' from %2 took %3 milliseconds").arg(status).arg(finalUrl).arg(timer.elapsed());
+        QString errorText = QString("Unhandled HTTP response code '%1' from %2 took %3 milliseconds").arg(status).arg(finalUrl).arg(elapsed);
         _logger->debug(errorText.toStdString());
         if (bThrowOnFail)
         {
@@ -330,17 +521,366 @@ WebClient::ReplyPtr WebClient::doRequest(const QString& url,
         {
             // sometimes the data is still needed even if we don't get
             // a 200 result, but we can safely NOT tidy it
-            retval->setData(_buffer, _buffer.size());
+            retval->setData(std::move(buffer));
         }
     }
 
     return retval;
 }
 
-curl_slist* WebClient::setHeaders()
+std::size_t WebClient::getMaxConcurrentRequests() const
+{
+    Lock lock(_multiMutex);
+    return _maxConcurrent;
+}
+
+void WebClient::setMaxConcurrentRequests(std::size_t max)
+{
+    Lock lock(_multiMutex);
+    _maxConcurrent = std::max<std::size_t>(max, 1);
+
+    if (_multi)
+    {
+        // let the transfer thread pick up more pending requests right away
+        curl_multi_wakeup(_multi);
+    }
+}
+
+std::future<WebClient::ReplyPtr> WebClient::GetUrlAsync(const QString& url, uint options, ReplyCallback callback)
+{
+    return submitAsync(url, QByteArray(), Method::GET, options, std::move(callback));
+}
+
+std::future<WebClient::ReplyPtr> WebClient::PostUrlAsync(const QString& url, const QString& payload, uint options, ReplyCallback callback)
+{
+    return submitAsync(url, payload.toLocal8Bit(), Method::POST, options, std::move(callback));
+}
+
+std::future<WebClient::ReplyPtr> WebClient::PostUrlAsync(const QString& url, const QByteArray& payload, uint options, ReplyCallback callback)
+{
+    return submitAsync(url, payload, Method::POST, options, std::move(callback));
+}
+
+std::vector<WebClient::ReplyPtr> WebClient::GetUrls(const QStringList& urls, uint options)
+{
+    std::vector<std::future<ReplyPtr>> futures;
+    futures.reserve(static_cast<std::size_t>(urls.size()));
+
+    for (const auto& url : urls)
+    {
+        futures.push_back(GetUrlAsync(url, options));
+    }
+
+    // wait for everything before get() so that a throwing request does
+    // not leave the remaining ones running unobserved
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+
+    std::vector<ReplyPtr> replies;
+    replies.reserve(futures.size());
+
+    for (auto& future : futures)
+    {
+        replies.push_back(future.get());
+    }
+
+    return replies;
+}
+
+std::future<WebClient::ReplyPtr> WebClient::submitAsync(const QString& url, const QByteArray& payload,
+                                                        Method method, uint options, ReplyCallback callback)
+{
+    auto request = std::make_unique<AsyncRequest>();
+    request->url = url;
+    request->options = options;
+    request->throwOnFail = getThrowOnFail();
+    request->callback = std::move(callback);
+
+    request->handle = curl_easy_init();
+    if (!request->handle)
+    {
+        OWL_THROW_EXCEPTION(Exception("Could not create CURL instance"));
+    }
+
+    initCurlDefaults(request->handle);
+    curl_easy_setopt(request->handle, CURLOPT_WRITEDATA, &request->buffer);
+    curl_easy_setopt(request->handle, CURLOPT_ERRORBUFFER, request->errbuf);
+
+    {
+        Lock lock(_settingsMutex);
+
+        if (!_userAgent.empty())
+        {
+            curl_easy_setopt(request->handle, CURLOPT_USERAGENT, _userAgent.c_str());
+        }
+
+        if (!_sendCookie.empty())
+        {
+            curl_easy_setopt(request->handle, CURLOPT_COOKIE, _sendCookie.c_str());
+        }
+    }
+
+    setRequestMethod(request->handle, url, payload, method);
+
+    request->cache = lookupCache(url, method, options);
+    request->headers = buildHeaders(request->cache);
+    curl_easy_setopt(request->handle, CURLOPT_HTTPHEADER, request->headers);
+
+    auto future = request->promise.get_future();
+
+    {
+        Lock lock(_multiMutex);
+
+        if (_multiStop)
+        {
+            OWL_THROW_EXCEPTION(owl::WebException("WebClient is shutting down", url));
+        }
+
+        if (!_multi)
+        {
+            _multi = curl_multi_init();
+            if (!_multi)
+            {
+                OWL_THROW_EXCEPTION(Exception("Could not create CURL multi instance"));
+            }
+
+            _multiThread = std::thread(&WebClient::runMulti, this);
+        }
+
+        request->timer.start();
+        _pendingRequests.push_back(std::move(request));
+
+        curl_multi_wakeup(_multi);
+    }
+
+    return future;
+}
+
+void WebClient::runMulti()
+{
+    for (;;)
+    {
+        {
+            Lock lock(_multiMutex);
+            if (_multiStop)
+            {
+                break;
+            }
+
+            while (!_pendingRequests.empty() && _activeRequests.size() < _maxConcurrent)
+            {
+                auto request = std::move(_pendingRequests.front());
+                _pendingRequests.pop_front();
+
+                curl_multi_add_handle(_multi, request->handle);
+                _activeRequests.emplace(request->handle, std::move(request));
+            }
+        }
+
+        int running = 0;
+        curl_multi_perform(_multi, &running);
+
+        int remaining = 0;
+        while (CURLMsg* msg = curl_multi_info_read(_multi, &remaining))
+        {
+            if (msg->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            // `msg` is invalidated by curl_multi_remove_handle()
+            CURL* handle = msg->easy_handle;
+            const CURLcode result = msg->data.result;
+
+            curl_multi_remove_handle(_multi, handle);
+
+            auto it = _activeRequests.find(handle);
+            if (it == _activeRequests.end())
+            {
+                continue;
+            }
+
+            AsyncRequestPtr request = std::move(it->second);
+            _activeRequests.erase(it);
+
+            finishAsync(*request, result);
+        }
+
+        curl_multi_poll(_multi, nullptr, 0, MULTI_POLL_TIMEOUT, nullptr);
+    }
+
+    // we're shutting down so fail whatever has not completed
+    for (auto& [handle, request] : _activeRequests)
+    {
+        curl_multi_remove_handle(_multi, handle);
+        failAsync(*request, QStringLiteral("Request cancelled"));
+    }
+    _activeRequests.clear();
+
+    std::deque<AsyncRequestPtr> pending;
+    {
+        Lock lock(_multiMutex);
+        pending.swap(_pendingRequests);
+    }
+
+    for (auto& request : pending)
+    {
+        failAsync(*request, QStringLiteral("Request cancelled"));
+    }
+}
+
+void WebClient::finishAsync(AsyncRequest& request, CURLcode result)
 {
+    ReplyPtr reply;
+
+    try
+    {
+        reply = makeReply(request.handle, result, request.buffer, request.errbuf,
+            request.url, request.options, request.throwOnFail, request.timer.elapsed(), request.cache);
+
+        request.promise.set_value(reply);
+    }
+    catch (...)
+    {
+        request.promise.set_exception(std::current_exception());
+    }
+
+    notifyAsync(request, reply);
+}
+
+void WebClient::failAsync(AsyncRequest& request, const QString& error)
+{
+    try
+    {
+        OWL_THROW_EXCEPTION(owl::WebException(error, request.url));
+    }
+    catch (...)
+    {
+        request.promise.set_exception(std::current_exception());
+    }
+
+    notifyAsync(request, nullptr);
+}
+
+// runs on the runMulti() thread, where an escaping exception would terminate
+void WebClient::notifyAsync(AsyncRequest& request, ReplyPtr reply)
+{
+    if (!request.callback)
+    {
+        return;
+    }
+
+    try
+    {
+        request.callback(reply);
+    }
+    catch (const owl::Exception& ex)
+    {
+        _logger->error("Async request callback for '{}' failed: {}",
+            request.url.toStdString(), ex.message().toStdString());
+    }
+    catch (const std::exception& ex)
+    {
+        _logger->error("Async request callback for '{}' failed: {}",
+            request.url.toStdString(), ex.what());
+    }
+}
+
+WebClient::CacheLookup WebClient::lookupCache(const QString& url, Method method, uint options)
+{
+    CacheLookup lookup;
+
+    // only GETs are cached, POSTs (logins, submissions, XML-RPC calls) are
+    // never safe to replay
+    if (method != Method::GET || (options & Options::NOCACHE))
+    {
+        return lookup;
+    }
+
+    lookup.cache = getCache();
+    if (lookup.cache)
+    {
+        lookup.key = HttpCache::makeKey(QStringLiteral("GET"), url);
+        lookup.entry = lookup.cache->find(lookup.key);
+    }
+
+    return lookup;
+}
+
+void WebClient::storeCache(CURL* curl, const CacheLookup& cache, const std::string& buffer, const char* finalUrl)
+{
+    const auto header = [curl](const char* name) -> QString
+    {
+        // -1 is the last request in the case of redirects
+        curl_header* h = nullptr;
+        if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &h) == CURLHE_OK && h)
+        {
+            return QString::fromLatin1(h->value).trimmed();
+        }
+
+        return QString();
+    };
+
+    if (header("Cache-Control").contains(QStringLiteral("no-store"), Qt::CaseInsensitive))
+    {
+        cache.cache->remove(cache.key);
+        return;
+    }
+
+    HttpCache::Entry entry;
+    entry.key = cache.key;
+    entry.finalUrl = QString::fromLatin1(finalUrl);
+    entry.etag = header("ETag");
+    entry.lastModified = header("Last-Modified");
+
+    // without a validator the response could never be revalidated
+    if (entry.etag.isEmpty() && entry.lastModified.isEmpty())
+    {
+        if (cache.entry)
+        {
+            cache.cache->remove(cache.key);
+        }
+
+        return;
+    }
+
+    entry.body = buffer;
+    cache.cache->store(entry);
+}
+
+curl_slist* WebClient::setHeaders(const CacheLookup& cache)
+{
+    curl_slist* headers = buildHeaders(cache);
+
+    /* pass our list of custom made headers */
+    curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, headers);
+
+    return headers;
+}
+
+curl_slist* WebClient::buildHeaders(const CacheLookup& cache)
+{
+    Lock lock(_settingsMutex);
 	curl_slist* headers = nullptr;
 
+    // make the request conditional so the server can answer with a 304
+    if (cache.entry)
+    {
+        if (!cache.entry->etag.isEmpty())
+        {
+            const QString header = QString("If-None-Match: %1").arg(cache.entry->etag);
+            headers = curl_slist_append(headers, header.toLatin1().data());
+        }
+
+        if (!cache.entry->lastModified.isEmpty())
+        {
+            const QString header = QString("If-Modified-Since: %1").arg(cache.entry->lastModified);
+            headers = curl_slist_append(headers, header.toLatin1().data());
+        }
+    }
+
     // add out content type
     const QString contentType = QString("Content-Type: %1").arg(_contentType);
     headers = curl_slist_append(headers, contentType.toLatin1().data());
@@ -353,9 +893,6 @@ curl_slist* WebClient::setHeaders()
         headers = curl_slist_append(headers, header.toLatin1().data());
     }
 
-    /* pass our list of custom made headers */
-    curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, headers);
-
     return headers;
 }
 
@@ -366,6 +903,14 @@ void WebClient::unsetHeaders(curl_slist* headers)
 }
 
 void WebClient::initCurlSettings()
+{
+    initCurlDefaults(_curl);
+
+    curl_easy_setopt(_curl, CURLOPT_WRITEDATA, &_buffer);
+    curl_easy_setopt(_curl, CURLOPT_ERRORBUFFER, _errbuf);
+}
+
+void WebClient::initCurlDefaults(CURL* curl)
 {
     curl_version_info_data *vinfo = curl_version_info(CURLVERSION_NOW);
     if (!(vinfo->features & CURL_VERSION_SSL))
@@ -374,73 +919,91 @@ void WebClient::initCurlSettings()
     }
 
     // set up our writer
-    curl_easy_setopt(_curl, CURLOPT_WRITEFUNCTION, CURLwriter);
-    curl_easy_setopt(_curl, CURLOPT_WRITEDATA, &_buffer);
-    curl_easy_setopt(_curl, CURLOPT_ERRORBUFFER, _errbuf);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CURLwriter);
 
     // set the redirects and the max number
-    curl_easy_setopt(_curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(_curl, CURLOPT_MAXREDIRS, DEFAULT_MAX_REDIRECTS);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, DEFAULT_MAX_REDIRECTS);
 
-    // start cookie engine
-    curl_easy_setopt(_curl, CURLOPT_COOKIEFILE, "");
+    // start cookie engine, the cookie jar itself lives in the share handle
+    curl_easy_setopt(curl, CURLOPT_COOKIEFILE, "");
+    curl_easy_setopt(curl, CURLOPT_SHARE, _cookieJar->handle());
 
     // <SSL CONFIG>
     // since PEM is default, we needn't set it for PEM
-    curl_easy_setopt(_curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
     //curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
 
     // need to disable this otherwise SSL does not work on Windows 7
-    curl_easy_setopt(_curl, CURLOPT_SSL_ENABLE_ALPN, 0);
+    curl_easy_setopt(curl, CURLOPT_SSL_ENABLE_ALPN, 0);
 
     // tell libcurl to redirect a post with a post after a 301, 302 or 303
-    curl_easy_setopt(_curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
+    curl_easy_setopt(curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
 
     // disable all curl's signal handling
-    curl_easy_setopt(_curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
 //#ifdef _DEBUG
-//    curl_easy_setopt(_curl, CURLOPT_VERBOSE, 1);
-//    curl_easy_setopt(_curl, CURLOPT_DEBUGFUNCTION, trace);
+//    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
+//    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, trace);
 //#endif
 }
 
+// libtidy documents are expensive to create and configure, so each thread
+// keeps one around and reuses it for every page it tidies
+struct ThreadTidyDoc
+{
+    TidyDoc     doc = nullptr;
+    TidyBuffer  errbuf = {};
+    bool        valid = false;
+
+    ThreadTidyDoc()
+    {
+        doc = tidyCreate();
+
+        tidyOptSetBool(doc, TidyMark, no);
+        tidyOptSetInt(doc, TidyWrapLen, 0);
+
+        valid = tidyOptSetBool(doc, TidyXhtmlOut, yes)          // Convert to XHTML
+            && tidySetErrorBuffer(doc, &errbuf) >= 0;           // Capture diagnostics (required!)
+    }
+
+    ~ThreadTidyDoc()
+    {
+        tidyBufFree(&errbuf);
+        tidyRelease(doc);
+    }
+
+    ThreadTidyDoc(const ThreadTidyDoc&) = delete;
+    ThreadTidyDoc& operator=(const ThreadTidyDoc&) = delete;
+};
+
 const std::string tidyHTML(const std::string& html)
 {
     // see:http://tidy.sourceforge.net/libintro.html
-    TidyDoc tdoc = tidyCreate();
+    thread_local ThreadTidyDoc tidy;
+
+    const auto start = std::chrono::steady_clock::now();
+
     TidyBuffer output = {0};
-    TidyBuffer errbuf = {0};
-    Bool ok;
     int rc = -1;
     std::string retStr;
 
-    tidyOptSetBool(tdoc, TidyMark, no);
-    tidyOptSetInt(tdoc, TidyWrapLen, 0);
-
-    ok = tidyOptSetBool( tdoc, TidyXhtmlOut, yes );  // Convert to XHTML
-    if (ok)
-        rc = tidySetErrorBuffer( tdoc, &errbuf );      // Capture diagnostics (required!)
-
-    if ( rc >= 0 )
-        rc = tidyParseString( tdoc, html.data() );           // Parse the input
+    if (tidy.valid)
+    {
+        tidyBufClear(&tidy.errbuf);
+        rc = tidyParseString(tidy.doc, html.data());            // Parse the input
+    }
 
     if ( rc >= 0 )
-        rc = tidyCleanAndRepair( tdoc );               // Tidy it up!
-
-    //if ( rc >= 0 )
-    //    rc = tidyRunDiagnostics( tdoc );               // Kvetch
-
-    //if ( rc > 1 )                                    // If error, force output.
-    //    rc = ( tidyOptSetBool(tdoc, TidyForceOutput, yes) ? rc : -1 );
+        rc = tidyCleanAndRepair(tidy.doc);                      // Tidy it up!
 
     if ( rc >= 0 )
-        rc = tidySaveBuffer( tdoc, &output );          // Pretty Print
+        rc = tidySaveBuffer(tidy.doc, &output);                 // Pretty Print
 
     if ( rc >= 0 )
     {
-        std::string str(reinterpret_cast<char const*>(output.bp), output.size);
-        retStr = std::move(str);
+        retStr.assign(reinterpret_cast<char const*>(output.bp), output.size);
     }
     else
     {
@@ -451,10 +1014,223 @@ const std::string tidyHTML(const std::string& html)
     }
 
     tidyBufFree(&output);
-    tidyBufFree(&errbuf);
-    tidyRelease(tdoc);
+
+    const auto elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    g_tidyCount++;
+    g_tidyMicroseconds += elapsed;
+
+    auto slowest = g_tidyMaxMicroseconds.load();
+    while (elapsed > slowest && !g_tidyMaxMicroseconds.compare_exchange_weak(slowest, elapsed))
+    {
+        // `slowest` was reloaded, try again
+    }
 
     return retStr;
 }
 
+// elements that never have content and must therefore be self-closed
+static bool isVoidElement(std::string_view name)
+{
+    static constexpr std::array<std::string_view, 16> voidElements
+    {
+        "area", "base", "br", "col", "embed", "hr", "img", "input",
+        "keygen", "link", "meta", "param", "source", "track", "wbr", "frame"
+    };
+
+    return std::any_of(voidElements.begin(), voidElements.end(),
+        [name](std::string_view element)
+        {
+            return element.size() == name.size()
+                && std::equal(name.begin(), name.end(), element.begin(),
+                    [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+        });
+}
+
+static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size()
+        && std::equal(a.begin(), a.end(), b.begin(),
+            [](char x, char y)
+            {
+                return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+            });
+}
+
+bool isWellFormedHtml(std::string_view html)
+{
+    constexpr auto npos = std::string_view::npos;
+
+    std::vector<std::string_view> open;
+    open.reserve(64);
+
+    bool sawRoot = false;
+    std::size_t pos = 0;
+
+    while ((pos = html.find('<', pos)) != npos)
+    {
+        // comments, CDATA, doctypes and processing instructions
+        if (html.compare(pos, 4, "<!--") == 0)
+        {
+            const auto end = html.find("-->", pos + 4);
+            if (end == npos)
+            {
+                return false;
+            }
+
+            pos = end + 3;
+            continue;
+        }
+
+        if (html.compare(pos, 9, "<![CDATA[") == 0)
+        {
+            const auto end = html.find("]]>", pos + 9);
+            if (end == npos)
+            {
+                return false;
+            }
+
+            pos = end + 3;
+            continue;
+        }
+
+        if (pos + 1 < html.size() && (html[pos + 1] == '!' || html[pos + 1] == '?'))
+        {
+            const auto end = html.find('>', pos + 2);
+            if (end == npos)
+            {
+                return false;
+            }
+
+            pos = end + 1;
+            continue;
+        }
+
+        const bool closing = pos + 1 < html.size() && html[pos + 1] == '/';
+        const auto nameStart = pos + (closing ? 2 : 1);
+
+        auto nameEnd = nameStart;
+        while (nameEnd < html.size()
+            && (std::isalnum(static_cast<unsigned char>(html[nameEnd])) || html[nameEnd] == '-' || html[nameEnd] == ':'))
+        {
+            nameEnd++;
+        }
+
+        if (nameEnd == nameStart)
+        {
+            // a stray '<' which tidy would escape
+            return false;
+        }
+
+        const auto name = html.substr(nameStart, nameEnd - nameStart);
+
+        // find the end of the tag, '>' may appear inside quoted attribute values
+        auto end = nameEnd;
+        char quote = 0;
+        for (; end < html.size(); end++)
+        {
+            const char c = html[end];
+            if (quote)
+            {
+                if (c == quote)
+                {
+                    quote = 0;
+                }
+            }
+            else if (c == '"' || c == '\'')
+            {
+                quote = c;
+            }
+            else if (c == '>')
+            {
+                break;
+            }
+            else if (c == '<')
+            {
+                return false;
+            }
+        }
+
+        if (end >= html.size())
+        {
+            return false;
+        }
+
+        pos = end + 1;
+
+        if (closing)
+        {
+            if (open.empty() || !equalsIgnoreCase(open.back(), name))
+            {
+                return false;
+            }
+
+            open.pop_back();
+            continue;
+        }
+
+        if (html[end - 1] == '/')
+        {
+            continue;
+        }
+
+        if (isVoidElement(name))
+        {
+            // <br> rather than <br />
+            return false;
+        }
+
+        if (open.empty())
+        {
+            if (sawRoot || !equalsIgnoreCase(name, "html"))
+            {
+                return false;
+            }
+
+            sawRoot = true;
+        }
+
+        open.push_back(name);
+
+        if (equalsIgnoreCase(name, "script") || equalsIgnoreCase(name, "style"))
+        {
+            // their content is not markup, skip ahead to the end tag
+            auto close = pos;
+            while ((close = html.find("</", close)) != npos
+                && !equalsIgnoreCase(html.substr(close + 2, name.size()), name))
+            {
+                close += 2;
+            }
+
+            if (close == npos)
+            {
+                return false;
+            }
+
+            pos = close;
+        }
+    }
+
+    return sawRoot && open.empty();
+}
+
+TidyMetrics getTidyMetrics()
+{
+    TidyMetrics metrics;
+    metrics.tidied = g_tidyCount;
+    metrics.skipped = g_tidySkipped;
+    metrics.totalMicroseconds = g_tidyMicroseconds;
+    metrics.maxMicroseconds = g_tidyMaxMicroseconds;
+    return metrics;
+}
+
+void resetTidyMetrics()
+{
+    g_tidyCount = 0;
+    g_tidySkipped = 0;
+    g_tidyMicroseconds = 0;
+    g_tidyMaxMicroseconds = 0;
+}
+
 } // namespace
@@ -2,7 +2,15 @@
 // Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
 
 #pragma once
+#include <array>
+#include <deque>
+#include <functional>
+#include <future>
 #include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include "HttpCache.h"
 #include "StringMap.h"
 
 #include <curl/curl.h>
@@ -17,6 +25,7 @@ namespace owl
 
 const QString   DEFAULT_CONTENT_TYPE	= "application/x-www-form-urlencoded";
 const uint      DEFAULT_MAX_REDIRECTS	= 5;
+const uint      DEFAULT_MAX_CONCURRENT  = 6;     // concurrent transfers in the multi (async) mode
 
 struct WebClientConfig
 {
@@ -27,6 +36,32 @@ struct WebClientConfig
     QString encryptSeed;
 };
 
+// A curl share handle holding a cookie jar, plus the DNS and TLS session
+// caches. Every WebClient has one, several clients can be given the same one
+// so that a login made by any of them is seen by all of them
+class CookieJar final
+{
+    using Mutex = std::mutex;
+
+public:
+    CookieJar();
+    ~CookieJar();
+
+    CookieJar(const CookieJar&) = delete;
+    CookieJar& operator=(const CookieJar&) = delete;
+
+    CURLSH* handle() const { return _share; }
+
+private:
+    static void lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr);
+    static void unlock(CURL*, curl_lock_data data, void* userptr);
+
+    CURLSH*     _share = nullptr;
+    std::array<Mutex, CURL_LOCK_DATA_LAST> _mutexes;
+};
+
+using CookieJarPtr = std::shared_ptr<CookieJar>;
+
 class WebClient :  public QObject
 {
     Q_OBJECT
@@ -42,44 +77,78 @@ public:
         std::string     _data;
         std::string     _finalUrl;       // the final url that sent the response (redirects & rewrites)
 
+        mutable std::once_flag  _textOnce;
+        mutable QString         _text;   // _data decoded on the first call to text()
+
         public:
             Reply(long status)
                 : _status { status }
             {}
 
+            Reply(const Reply&) = delete;
+            Reply& operator=(const Reply&) = delete;
+
             long status() const { return _status; }
             void setStatus(long status) { _status = status; }
 
-            QString text() const { return QString::fromStdString(_data); }
-
-            std::string const data() { return _data; }
-            void setData(const std::string& data, std::size_t size) 
-            { 
-                _data.append(data.data(), size); 
+            // The body decoded as UTF-8, decoded once and then shared
+            const QString& text() const
+            {
+                std::call_once(_textOnce, [this]() { _text = QString::fromUtf8(_data.data(), static_cast<int>(_data.size())); });
+                return _text;
             }
 
+            // The raw body, valid as long as the reply is
+            std::string_view data() const { return _data; }
+
+            // The raw body as a QByteArray that does not copy it, valid as
+            // long as the reply is
+            QByteArray bytes() const { return QByteArray::fromRawData(_data.data(), static_cast<int>(_data.size())); }
+
+            // Takes ownership of the body, must be called before text()
+            void setData(std::string data) { _data = std::move(data); }
+
             std::string finalUrl() const { return _finalUrl; }
             void setFinalUrl(const std::string& finalUrl) { _finalUrl = finalUrl; }
     };
     using ReplyPtr = std::shared_ptr<Reply>;
 
+    // Invoked on the WebClient's transfer thread when an async request
+    // completes. The reply is nullptr when the request failed, in which case
+    // the error is available through the request's future
+    using ReplyCallback = std::function<void(ReplyPtr)>;
+
     enum Method
     {
         GET     = 1,
         POST    = 2
     };
 
+    // GET responses that carry an ETag or a Last-Modified header are kept in
+    // the HttpCache and revalidated with a conditional request the next time
+    // they are fetched. NOCACHE bypasses the cache entirely.
+    //
+    // Responses are cleaned up with tidy unless NOTIDY is given, or unless
+    // they are already well-formed (see isWellFormedHtml()). FORCETIDY runs
+    // tidy regardless
     enum Options
     {
         DEFAULT		= 0x0000,
         NOTIDY		= 0x0001,
         NOCACHE		= 0x0002,
-        NOENCRYPT   = 0x0004
+        NOENCRYPT   = 0x0004,
+        FORCETIDY   = 0x0008
     };
 
-    WebClient();
+    // the client gets a cookie jar of its own unless one is given
+    explicit WebClient(CookieJarPtr cookieJar = CookieJarPtr());
     virtual ~WebClient();
 
+    // the cache used for GET requests, HttpCache::instance() by default and
+    // nullptr to disable caching for this client
+    HttpCachePtr getCache() const;
+    void setCache(HttpCachePtr cache);
+
     bool getThrowOnFail() const { return _throwOnFail; }
     void setThrowOnFail(bool var) { _throwOnFail = var; }
 
@@ -100,6 +169,8 @@ public:
 
     void setConfig(const WebClientConfig& config);
 
+    CookieJarPtr getCookieJar() const { return _cookieJar; }
+
     void addSendCookie(const QString& key, const QString& value);
     void eraseSendCookies();
     void printCookies();
@@ -114,22 +185,83 @@ public:
     // Submits an HTTP POST and returns the result's string or an empty string
     QString UploadString(const QString& address, const QString& payload, uint options = Options::DEFAULT);
 
+    // As above for a payload that is already encoded, it is posted as is
+    QString UploadString(const QString& address, const QByteArray& payload, uint options = Options::DEFAULT);
+
     // Submits an HTTP POST and returns a reply object or nullptr
     ReplyPtr PostUrl(const QString& url, const QString& payload, uint options = Options::DEFAULT);
+    ReplyPtr PostUrl(const QString& url, const QByteArray& payload, uint options = Options::DEFAULT);
+
+    // Concurrent mode: requests are queued on a curl_multi handle driven by a
+    // transfer thread owned by this object. They share the cookie jar, headers,
+    // content type and user agent of the blocking calls above, but do not block
+    // on them (or on each other) and do not update getLastRequestUrl()
+    std::size_t getMaxConcurrentRequests() const;
+    void setMaxConcurrentRequests(std::size_t max);
+
+    // Queues an HTTP GET. The future throws if the request fails and
+    // throwOnFail is set, otherwise it yields nullptr
+    std::future<ReplyPtr> GetUrlAsync(const QString& url, uint options = Options::DEFAULT, ReplyCallback callback = {});
+
+    // Queues an HTTP POST, see GetUrlAsync()
+    std::future<ReplyPtr> PostUrlAsync(const QString& url, const QString& payload, uint options = Options::DEFAULT, ReplyCallback callback = {});
+    std::future<ReplyPtr> PostUrlAsync(const QString& url, const QByteArray& payload, uint options = Options::DEFAULT, ReplyCallback callback = {});
+
+    // Submits all urls concurrently and waits until every one has completed.
+    // The replies are in the same order as the urls
+    std::vector<ReplyPtr> GetUrls(const QStringList& urls, uint options = Options::DEFAULT);
 
 private:
+    struct AsyncRequest;
+    using AsyncRequestPtr = std::unique_ptr<AsyncRequest>;
+
     // If successful, will return a new object and release ownership to the caller
     // If unsucessful, throw an error OR return null if throwOnFail=false
     ReplyPtr doRequest(const QString& url,
-                           const QString& payload = QString(),
+                           const QByteArray& payload = QByteArray(),
                            Method method = Method::GET,
                            uint options = Options::DEFAULT);
 
-    curl_slist* setHeaders();
+    // the cache entry a request revalidates, if any
+    struct CacheLookup
+    {
+        QString             key;        // empty when the request is not cacheable
+        HttpCachePtr        cache;
+        HttpCache::EntryPtr entry;
+    };
+
+    // `buffer` is moved into the reply
+    ReplyPtr makeReply(CURL* curl, CURLcode result,
+                        std::string& buffer,
+                        const char* errbuf,
+                        const QString& url,
+                        uint options,
+                        bool throwOnFail,
+                        qint64 elapsed,
+                        const CacheLookup& cache,
+                        QString* lastUrl = nullptr);
+
+    void setRequestMethod(CURL* curl, const QString& url, const QByteArray& payload, Method method);
+
+    CacheLookup lookupCache(const QString& url, Method method, uint options);
+    void storeCache(CURL* curl, const CacheLookup& cache, const std::string& buffer, const char* finalUrl);
+
+    curl_slist* buildHeaders(const CacheLookup& cache);
+    curl_slist* setHeaders(const CacheLookup& cache);
     void unsetHeaders(curl_slist* headers);
     void initCurlSettings();
+    void initCurlDefaults(CURL* curl);
+
+    std::future<ReplyPtr> submitAsync(const QString& url, const QByteArray& payload,
+                                      Method method, uint options, ReplyCallback callback);
+
+    void runMulti();
+    void finishAsync(AsyncRequest& request, CURLcode result);
+    void failAsync(AsyncRequest& request, const QString& error);
+    void notifyAsync(AsyncRequest& request, ReplyPtr reply);
 
     Mutex               _curlMutex;
+    mutable Mutex       _settingsMutex;                         // guards the settings shared by both modes
 
     CURL*               _curl = nullptr;                        // the curl object
     std::string         _buffer;                                // buffer for response text
@@ -145,9 +277,41 @@ private:
     QString             _strEncyrptionKey;
     QString             _strEncryptionSeed;
 
+    std::string         _userAgent;                             // copied into async handles
+    std::string         _sendCookie;
+    HttpCachePtr        _cache;
+
+    // used by both the blocking handle and the async handles
+    CookieJarPtr        _cookieJar;
+
+    CURLM*              _multi = nullptr;
+    std::thread         _multiThread;
+    mutable Mutex       _multiMutex;                            // guards the pending queue, limit and stop flag
+    std::deque<AsyncRequestPtr>                 _pendingRequests;
+    std::unordered_map<CURL*, AsyncRequestPtr>  _activeRequests;  // only touched by _multiThread
+    std::size_t         _maxConcurrent = DEFAULT_MAX_CONCURRENT;
+    bool                _multiStop = false;
+
     std::shared_ptr<spdlog::logger>  _logger;
 };
 
 const std::string tidyHTML(const std::string& html);
 
+// Returns true if `html` is an <html> document whose elements are all closed
+// in order, with empty elements (<br />, <img />...) self-closed. Such a page
+// parses the same with or without tidy so it does not need to be tidied
+bool isWellFormedHtml(std::string_view html);
+
+// process wide counters of the work done by tidyHTML()
+struct TidyMetrics
+{
+    std::uint64_t   tidied = 0;                 // pages run through tidy
+    std::uint64_t   skipped = 0;                // pages that were already well-formed
+    std::uint64_t   totalMicroseconds = 0;      // time spent in tidy
+    std::uint64_t   maxMicroseconds = 0;        // slowest single page
+};
+
+TidyMetrics getTidyMetrics();
+void resetTidyMetrics();
+
 } // namespace
@@ -0,0 +1,354 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+#include "../src/Data/Board.h"
+#include "../src/Data/BoardManager.h"
+#include "../src/Parsers/Tapatalk.h"
+
+namespace
+{
+
+// a board whose root has `categories` categories of `forumsPerCategory` forums
+owl::BoardPtr makeBoard(int categories, int forumsPerCategory)
+{
+    auto board = std::make_shared<owl::Board>("https://www.amb.la");
+    board->setName("AMB");
+    board->setParser(std::make_shared<owl::Tapatalk4x>("https://www.amb.la"));
+    board->getOptions()->setOrAdd("rootId", "-1");
+    board->getOptions()->setOrAdd("displayOrder", static_cast<std::int32_t>(0));
+
+    auto root = owl::Forum::createRootForum("-1");
+    for (int i = 0; i < categories; i++)
+    {
+        auto category = std::make_shared<owl::Forum>(QString("c%1").arg(i));
+        category->setForumType(owl::Forum::CATEGORY);
+        category->setDisplayOrder(i);
+        root->addChild(category);
+        root->getForums().push_back(category);
+
+        for (int j = 0; j < forumsPerCategory; j++)
+        {
+            auto forum = std::make_shared<owl::Forum>(QString("f%1-%2").arg(i).arg(j));
+            forum->setForumType(owl::Forum::FORUM);
+            forum->setDisplayOrder(j);
+            forum->setVar("canPost", "1");
+            category->addChild(forum);
+            category->getForums().push_back(forum);
+        }
+    }
+
+    board->setRoot(root);
+    return board;
+}
+
+int countRows(const QString& dbFilename, const QString& sql)
+{
+    int count = -1;
+
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", "OwlTestCount");
+        db.setDatabaseName(dbFilename);
+        db.open();
+
+        QSqlQuery query(db);
+        if (query.exec(sql) && query.next())
+        {
+            count = query.value(0).toInt();
+        }
+    }
+
+    QSqlDatabase::removeDatabase("OwlTestCount");
+    return count;
+}
+
+bool execute(const QString& dbFilename, const QString& sql)
+{
+    bool ok = false;
+
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", "OwlTestExecute");
+        db.setDatabaseName(dbFilename);
+        ok = db.open() && QSqlQuery(db).exec(sql);
+    }
+
+    QSqlDatabase::removeDatabase("OwlTestExecute");
+    return ok;
+}
+
+// how createForumEntries() saved a tree before it used a transaction: each
+// forum and each variable is prepared and committed on its own
+void saveForumsOneByOne(QSqlDatabase& db, const owl::ForumPtr& parent)
+{
+    for (const auto& forum : parent->getForums())
+    {
+        QSqlQuery query(db);
+        query.prepare("INSERT INTO forums "
+            "(boardId, forumId, parentId, forumName, forumType, forumOrder) "
+            "VALUES (:boardId, :forumId, :parentId, :forumName, :forumType, :forumOrder)");
+
+        query.bindValue(":boardId", 1);
+        query.bindValue(":forumId", forum->getId());
+        query.bindValue(":parentId", parent->getId());
+        query.bindValue(":forumName", forum->getName());
+        query.bindValue(":forumType", forum->getForumTypeString());
+        query.bindValue(":forumOrder", forum->getDisplayOrder());
+        BOOST_REQUIRE(query.exec());
+
+        const int forumsId = query.lastInsertId().toInt();
+
+        QSqlQuery varsQuery(db);
+        varsQuery.prepare("INSERT INTO forumvars "
+            "(forumsid, name, value) "
+            "VALUES (:forumsid, :name, :value)");
+        varsQuery.bindValue(":forumsid", forumsId);
+
+        for (const auto& p : forum->getVars())
+        {
+            varsQuery.bindValue(":name", p.first);
+            varsQuery.bindValue(":value", p.second);
+            BOOST_REQUIRE(varsQuery.exec());
+        }
+
+        saveForumsOneByOne(db, forum);
+    }
+}
+
+// a new database in a temporary folder for BoardManager and its content store
+struct DatabaseFixture
+{
+    DatabaseFixture()
+    {
+        BOOST_REQUIRE(dir.isValid());
+
+        dbFilename = dir.filePath("owl.sqlite");
+        owl::BoardManager::instance()->initializeDatabase(dbFilename);
+    }
+
+    QTemporaryDir dir;
+    QString dbFilename;
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(BoardData, DatabaseFixture)
+
+BOOST_AUTO_TEST_CASE(contentStoreTest)
+{
+    auto store = owl::BoardManager::instance()->contentStore();
+    BOOST_REQUIRE(store);
+
+    auto forum = std::make_shared<owl::Forum>("10");
+    for (int i = 0; i < 3; i++)
+    {
+        auto thread = std::make_shared<owl::Thread>(QString::number(100 + i));
+        thread->setTitle(QString("Thread %1").arg(i));
+        thread->setHasUnread(i == 1);
+        forum->getThreads().push_back(thread);
+    }
+
+    auto thread = std::make_shared<owl::Thread>("100");
+    thread->setPerPage(2);
+    thread->setPageNumber(2);
+    thread->setPageCount(3);
+
+    for (int i = 3; i <= 4; i++)
+    {
+        auto post = std::make_shared<owl::Post>(QString::number(1000 + i));
+        post->setIndex(i);
+        post->setAuthor("author");
+        post->setText(QString("post %1").arg(i));
+        thread->getPosts().push_back(post);
+    }
+
+    store->storeThreads(1, forum);
+    store->storePosts(1, thread);
+    store->flush();
+
+    const auto threads = store->loadThreads(1, forum);
+    BOOST_REQUIRE_EQUAL(threads.size(), 3);
+    BOOST_CHECK_EQUAL(threads[2]->getTitle().toStdString(), "Thread 2");
+    BOOST_CHECK(threads[1]->hasUnread());
+
+    // other boards are separate
+    BOOST_CHECK(store->loadThreads(2, forum).isEmpty());
+
+    const auto posts = store->loadPosts(1, thread);
+    BOOST_REQUIRE_EQUAL(posts.size(), 2);
+    BOOST_CHECK_EQUAL(posts[0]->getIndex(), 3);
+    BOOST_CHECK_EQUAL(posts[1]->getText().toStdString(), "post 4");
+
+    // an incomplete page isn't returned
+    thread->setPageNumber(1);
+    BOOST_CHECK(store->loadPosts(1, thread).empty());
+
+    store->removeBoard(1);
+    store->flush();
+    BOOST_CHECK(store->loadThreads(1, forum).isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(contentSearchTest)
+{
+    auto store = owl::BoardManager::instance()->contentStore();
+    BOOST_REQUIRE(store);
+
+    if (!store->searchEnabled())
+    {
+        BOOST_TEST_MESSAGE("SQLite was built without FTS5, skipping");
+        return;
+    }
+
+    auto thread = std::make_shared<owl::Thread>("100");
+    thread->setTitle("Night owls");
+    thread->setPerPage(3);
+    thread->setPageNumber(1);
+    thread->setPageCount(1);
+
+    const QStringList texts
+    {
+        "[b]Owls[/b] hunt at night",
+        "<p>The <i>café</i> opens early</p>",
+        "[quote=Max Power;1]owls again[/quote]nothing to see"
+    };
+
+    for (int i = 0; i < texts.size(); i++)
+    {
+        auto post = std::make_shared<owl::Post>(QString::number(1000 + i));
+        post->setIndex(i + 1);
+        post->setAuthor(i == 1 ? "barista" : "birder");
+        post->setText(texts.at(i));
+        thread->getPosts().push_back(post);
+    }
+
+    store->storePosts(1, thread);
+    store->flush();
+
+    auto results = store->search("owls");
+    BOOST_REQUIRE_EQUAL(results.size(), 2u);
+    BOOST_CHECK_EQUAL(results[0].threadTitle.toStdString(), "Night owls");
+    BOOST_CHECK(results[0].snippet.contains(owl::SEARCH_MATCH_BEGIN));
+
+    // markup is not indexed and accents are ignored
+    BOOST_CHECK(store->search("hunt").size() == 1);
+    BOOST_CHECK(store->search("cafe").size() == 1);
+    BOOST_CHECK(store->search("p").empty());
+    BOOST_CHECK(store->search("author:barista").size() == 1);
+    BOOST_CHECK(store->search("owls", owl::DEFAULT_SEARCH_LIMIT, 2).empty());
+
+    // reloading the page replaces what was indexed
+    thread->getPosts().front()->setText("owls sleep during the day");
+    store->storePosts(1, thread);
+    store->flush();
+
+    BOOST_CHECK(store->search("hunt").empty());
+    BOOST_CHECK_EQUAL(store->search("owls").size(), 2u);
+
+    BOOST_CHECK_THROW(store->search("\"unbalanced"), owl::Exception);
+
+    store->removeBoard(1);
+    store->flush();
+    BOOST_CHECK(store->search("owls").empty());
+}
+
+BOOST_AUTO_TEST_CASE(createForumTreeTest)
+{
+    auto board = makeBoard(3, 4);
+    BOOST_REQUIRE(owl::BoardManager::instance()->createBoard(board));
+
+    const auto category = board->getRoot()->getForums().front();
+    const auto forum = category->getForums().front();
+    BOOST_CHECK(category->getDBId() > 0);
+    BOOST_CHECK(forum->getDBId() > category->getDBId());
+
+    BOOST_CHECK_EQUAL(countRows(dbFilename, "SELECT COUNT(*) FROM forums"), 15);
+    BOOST_CHECK_EQUAL(countRows(dbFilename, "SELECT COUNT(*) FROM forumvars"), 12);
+    BOOST_CHECK_EQUAL(countRows(dbFilename, "SELECT COUNT(*) FROM forums WHERE parentId='c0'"), 4);
+    BOOST_CHECK_EQUAL(countRows(dbFilename,
+        QString("SELECT COUNT(*) FROM forumvars WHERE forumsid=%1").arg(forum->getDBId())), 1);
+
+    // the tree is read back in the same shape
+    owl::BoardManager::instance()->loadBoards(false);
+    owl::BoardManager::instance()->waitForBoards();
+    BOOST_REQUIRE_EQUAL(owl::BoardManager::instance()->getBoardCount(), 1u);
+
+    const auto loaded = owl::BoardManager::instance()->boardByIndex(0);
+    const auto& categories = loaded->getRoot()->getForums();
+    BOOST_REQUIRE_EQUAL(categories.size(), 3);
+    BOOST_CHECK_EQUAL(categories[1]->getId().toStdString(), "c1");
+    BOOST_REQUIRE_EQUAL(categories[1]->getForums().size(), 4);
+
+    const auto loadedForum = categories[1]->getForums()[2];
+    BOOST_CHECK_EQUAL(loadedForum->getId().toStdString(), "f1-2");
+    BOOST_CHECK_EQUAL(loadedForum->getVar("canPost").toStdString(), "1");
+    BOOST_CHECK(loadedForum->getParent() == categories[1]);
+
+    owl::BoardManager::instance()->deleteBoard(loaded);
+}
+
+BOOST_AUTO_TEST_CASE(createForumTreeRollbackTest)
+{
+    // the forums are saved parents first, so the failure comes after
+    // most of the tree has been inserted
+    BOOST_REQUIRE(execute(dbFilename,
+        "CREATE TRIGGER failForum BEFORE INSERT ON forums WHEN NEW.forumId='f2-3' "
+        "BEGIN SELECT RAISE(ABORT, 'failForum'); END"));
+
+    auto board = makeBoard(3, 4);
+    BOOST_REQUIRE(owl::BoardManager::instance()->createBoard(board));
+
+    BOOST_CHECK_EQUAL(countRows(dbFilename, "SELECT COUNT(*) FROM forums"), 0);
+    BOOST_CHECK_EQUAL(countRows(dbFilename, "SELECT COUNT(*) FROM forumvars"), 0);
+
+    owl::BoardManager::instance()->deleteBoard(board);
+}
+
+// Run explicitly with --run_test=BoardData/createForumTreeBenchmark
+BOOST_AUTO_TEST_CASE(createForumTreeBenchmark, * boost::unit_test::disabled())
+{
+    // 1000 forums
+    auto board = makeBoard(40, 24);
+
+    // before, in a database of its own since the old code didn't use a
+    // write-ahead log either
+    const QString baselineFilename = dir.filePath("baseline.sqlite");
+    qint64 before = 0;
+
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", "OwlTestBaseline");
+        db.setDatabaseName(baselineFilename);
+        BOOST_REQUIRE(db.open());
+
+        QSqlQuery query(db);
+        BOOST_REQUIRE(query.exec("CREATE TABLE forums (id INTEGER PRIMARY KEY, boardId INTEGER, "
+            "forumId TEXT, parentId TEXT, forumName TEXT, forumType TEXT, forumOrder INTEGER)"));
+        BOOST_REQUIRE(query.exec("CREATE TABLE forumvars (forumvarid INTEGER PRIMARY KEY, "
+            "forumsid NUMERIC, name TEXT, value TEXT)"));
+
+        QElapsedTimer timer;
+        timer.start();
+        saveForumsOneByOne(db, board->getRoot());
+        before = timer.elapsed();
+    }
+
+    QSqlDatabase::removeDatabase("OwlTestBaseline");
+    BOOST_CHECK_EQUAL(countRows(baselineFilename, "SELECT COUNT(*) FROM forums"), 1000);
+
+    // after
+    QElapsedTimer timer;
+    timer.start();
+
+    BOOST_REQUIRE(owl::BoardManager::instance()->createBoard(board));
+    const auto after = timer.elapsed();
+
+    BOOST_CHECK_EQUAL(countRows(dbFilename, "SELECT COUNT(*) FROM forums"), 1000);
+    BOOST_TEST_MESSAGE("Saved a board of 1000 forums in " << after
+        << " ms, one statement and commit per row took " << before << " ms");
+
+    owl::BoardManager::instance()->deleteBoard(board);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+
+#include "../src/Parsers/LuaScriptCache.h"
+#include "../src/Utils/Exception.h"
+
+using namespace owl;
+
+namespace
+{
+
+// a parser script that appends a line to `runsFile` every time it is run
+QByteArray makeScript(const QString& name, const QString& runsFile)
+{
+    return QString(R"(
+parserName = "%1"
+parserPrettyName = "%1 parser"
+boardUrl = "http://www.example.com/%1/"
+
+local runs = io.open("%2", "a")
+runs:write("run\n")
+runs:close()
+
+Parser = {}
+Parser.__index = Parser
+
+function Parser.create(baseUrl)
+    local p = {}
+    setmetatable(p, Parser)
+    return p
+end
+)").arg(name).arg(runsFile).toUtf8();
+}
+
+void writeFile(const QString& filename, const QByteArray& text)
+{
+    QFile file(filename);
+    BOOST_REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(text);
+}
+
+int countRuns(const QString& runsFile)
+{
+    QFile file(runsFile);
+    return file.open(QIODevice::ReadOnly) ? file.readAll().count('\n') : 0;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LuaScriptCacheTests)
+
+BOOST_AUTO_TEST_CASE(scriptInfoTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    const QString cacheFolder = dir.filePath("cache");
+    const QString runsFile = dir.filePath("runs.txt");
+    const QString script = dir.filePath("alpha.lua");
+    writeFile(script, makeScript("alpha", runsFile));
+
+    {
+        LuaScriptCache cache(cacheFolder);
+        const auto info = cache.scriptInfo(script);
+        BOOST_CHECK_EQUAL(info.name.toStdString(), "alpha");
+        BOOST_CHECK_EQUAL(info.prettyName.toStdString(), "alpha parser");
+        BOOST_CHECK_EQUAL(info.url.toStdString(), "http://www.example.com/alpha/");
+        BOOST_CHECK_EQUAL(countRuns(runsFile), 1);
+
+        cache.save();
+    }
+
+    // an unchanged script is not run again
+    {
+        LuaScriptCache cache(cacheFolder);
+        BOOST_CHECK_EQUAL(cache.scriptInfo(script).name.toStdString(), "alpha");
+        BOOST_CHECK(cache.chunk(script) != nullptr);
+        BOOST_CHECK_EQUAL(countRuns(runsFile), 1);
+    }
+
+    // nor is a script that was only touched
+    {
+        QFile file(script);
+        BOOST_REQUIRE(file.open(QIODevice::ReadWrite));
+        BOOST_REQUIRE(file.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime));
+    }
+
+    {
+        LuaScriptCache cache(cacheFolder);
+        BOOST_CHECK_EQUAL(cache.scriptInfo(script).name.toStdString(), "alpha");
+        BOOST_CHECK_EQUAL(countRuns(runsFile), 1);
+        cache.save();
+    }
+
+    // a changed script is run again
+    writeFile(script, makeScript("beta", runsFile));
+
+    {
+        LuaScriptCache cache(cacheFolder);
+        BOOST_CHECK_EQUAL(cache.scriptInfo(script).name.toStdString(), "beta");
+        BOOST_CHECK_EQUAL(countRuns(runsFile), 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chunkTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    const QString script = dir.filePath("alpha.lua");
+    writeFile(script, makeScript("alpha", dir.filePath("runs.txt")));
+
+    // without a folder nothing is written to disk
+    LuaScriptCache cache;
+    const auto chunk = cache.chunk(script);
+    BOOST_REQUIRE(chunk != nullptr);
+    BOOST_CHECK(chunk == cache.chunk(script));
+    BOOST_CHECK_EQUAL(QDir(dir.path()).entryList(QDir::Files).size(), 1);
+
+    // the states of a pool load the chunk, not the file
+    BOOST_REQUIRE(QFile::remove(script));
+
+    LuaStatePool pool(script, "http://www.example.com/", 1, chunk);
+    BOOST_CHECK_NO_THROW(pool.acquire());
+
+    BOOST_CHECK_THROW(cache.scriptInfo(dir.filePath("missing.lua")), owl::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(badScriptTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    const QString script = dir.filePath("bad.lua");
+    writeFile(script, "parserName = ");
+
+    LuaScriptCache cache(dir.filePath("cache"));
+    BOOST_CHECK_THROW(cache.scriptInfo(script), owl::Exception);
+    BOOST_CHECK_THROW(cache.chunk(script), owl::Exception);
+}
+
+// Run explicitly with --run_test=LuaScriptCacheTests/startupBenchmark
+BOOST_AUTO_TEST_CASE(startupBenchmark, * boost::unit_test::disabled())
+{
+    constexpr int SCRIPT_COUNT = 50;
+
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    const QString runsFile = dir.filePath("runs.txt");
+
+    QStringList scripts;
+    for (int i = 0; i < SCRIPT_COUNT; i++)
+    {
+        const QString name = QString("parser%1").arg(i);
+        scripts.push_back(dir.filePath(name + ".lua"));
+        writeFile(scripts.back(), makeScript(name, runsFile));
+    }
+
+    // what discovery costs on the first start, every script is compiled and run
+    QElapsedTimer timer;
+    timer.start();
+    {
+        LuaScriptCache cache(dir.filePath("cache"));
+        for (const auto& script : scripts)
+        {
+            cache.scriptInfo(script);
+        }
+        cache.save();
+    }
+    const auto cold = timer.nsecsElapsed();
+
+    // and on the next ones, only the manifest is read
+    timer.restart();
+    {
+        LuaScriptCache cache(dir.filePath("cache"));
+        for (const auto& script : scripts)
+        {
+            cache.scriptInfo(script);
+        }
+    }
+    const auto warm = timer.nsecsElapsed();
+
+    BOOST_CHECK_EQUAL(countRuns(runsFile), SCRIPT_COUNT);
+
+    BOOST_TEST_MESSAGE("Discovered " << SCRIPT_COUNT << " parser scripts in "
+        << cold / 1000 << "us uncached, "
+        << warm / 1000 << "us cached");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,264 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <QtCore>
+
+#include "../src/Parsers/LuaStatePool.h"
+#include "../src/Utils/Exception.h"
+
+using namespace owl;
+
+namespace
+{
+
+const char* BASE_URL = "http://www.example.com/forums/";
+
+const char* PARSER_SCRIPT = R"(
+parserName = "test"
+
+Parser = {}
+Parser.__index = Parser
+
+function Parser.create(baseUrl)
+    local p = {}
+    setmetatable(p, Parser)
+    p.baseUrl = baseUrl
+    p.calls = 0
+    return p
+end
+
+function Parser:nextCall()
+    self.calls = self.calls + 1
+    return self.calls
+end
+)";
+
+QString writeScript(const QTemporaryDir& dir, const QByteArray& text)
+{
+    const QString filename = dir.filePath("parser.lua");
+
+    QFile file(filename);
+    BOOST_REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(text);
+
+    return filename;
+}
+
+// calls `Parser:nextCall()` on the state's object
+int nextCall(const LuaStatePool::Lease& lease)
+{
+    lua_State* L = lease.state();
+
+    lua_settop(L, 0);
+    lua_getglobal(L, "Parser");
+    lua_getfield(L, -1, "nextCall");
+    lua_rawgeti(L, LUA_REGISTRYINDEX, lease.object());
+    BOOST_REQUIRE_EQUAL(lua_pcall(L, 1, 1, 0), 0);
+
+    const int calls = static_cast<int>(lua_tonumber(L, -1));
+    lua_settop(L, 0);
+
+    return calls;
+}
+
+QString baseUrl(const LuaStatePool::Lease& lease)
+{
+    lua_State* L = lease.state();
+
+    lua_settop(L, 0);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, lease.object());
+    lua_getfield(L, -1, "baseUrl");
+
+    const QString url(lua_tostring(L, -1));
+    lua_settop(L, 0);
+
+    return url;
+}
+
+// runs `code` in the state and returns its first result as a string
+std::string run(const LuaStatePool::Lease& lease, const char* code)
+{
+    lua_State* L = lease.state();
+
+    lua_settop(L, 0);
+    const bool ok = luaL_dostring(L, code) == 0;
+
+    const std::string result = lua_isstring(L, 1) ? lua_tostring(L, 1) : std::string();
+    lua_settop(L, 0);
+
+    return ok ? result : "error: " + result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LuaStatePoolTests)
+
+BOOST_AUTO_TEST_CASE(leaseTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    LuaStatePool pool(writeScript(dir, PARSER_SCRIPT), BASE_URL, 2);
+    BOOST_CHECK_EQUAL(pool.size(), 0u);
+
+    {
+        const auto first = pool.acquire();
+        const auto second = pool.acquire();
+        BOOST_CHECK(first.state() != second.state());
+        BOOST_CHECK_EQUAL(pool.size(), 2u);
+
+        // the second state is loaded from the compiled chunk
+        BOOST_CHECK_EQUAL(baseUrl(first).toStdString(), BASE_URL);
+        BOOST_CHECK_EQUAL(baseUrl(second).toStdString(), BASE_URL);
+
+        // and has its own parser object
+        BOOST_CHECK_EQUAL(nextCall(first), 1);
+        BOOST_CHECK_EQUAL(nextCall(first), 2);
+        BOOST_CHECK_EQUAL(nextCall(second), 1);
+    }
+
+    // the state returned last is handed out first
+    const auto lease = pool.acquire();
+    BOOST_CHECK_EQUAL(nextCall(lease), 3);
+    BOOST_CHECK_EQUAL(pool.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(waitTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    LuaStatePool pool(writeScript(dir, PARSER_SCRIPT), BASE_URL, 1);
+
+    std::atomic_bool acquired { false };
+    std::thread waiter;
+
+    {
+        const auto lease = pool.acquire();
+
+        waiter = std::thread([&pool, &acquired]()
+            {
+                const auto lease = pool.acquire();
+                acquired = true;
+            });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        BOOST_CHECK(!acquired);
+    }
+
+    waiter.join();
+    BOOST_CHECK(acquired);
+    BOOST_CHECK_EQUAL(pool.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(badScriptTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    LuaStatePool pool(writeScript(dir, "Parser = {"), BASE_URL, 1);
+    BOOST_CHECK_THROW(pool.acquire(), owl::Exception);
+    BOOST_CHECK_EQUAL(pool.size(), 0u);
+
+    // a failed state does not take a slot of the pool
+    BOOST_CHECK_THROW(pool.acquire(), owl::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(pageClientTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    LuaStatePool pool(writeScript(dir, PARSER_SCRIPT), BASE_URL, 2);
+
+    WebClient* client = nullptr;
+    {
+        const auto first = pool.acquire();
+        const auto second = pool.acquire();
+
+        client = LuaStatePool::pageClient(first.state());
+        BOOST_REQUIRE(client != nullptr);
+        BOOST_CHECK(client != LuaStatePool::pageClient(second.state()));
+        BOOST_CHECK(client->getCookieJar() == pool.getCookieJar());
+
+        // the coroutines of a state use its client
+        lua_State* co = lua_newthread(first.state());
+        BOOST_CHECK(LuaStatePool::pageClient(co) == client);
+        lua_settop(first.state(), 0);
+    }
+
+    // and it is kept between leases
+    const auto lease = pool.acquire();
+    BOOST_CHECK(LuaStatePool::pageClient(lease.state()) == client);
+
+    lua_State* L = luaL_newstate();
+    BOOST_CHECK(LuaStatePool::pageClient(L) == nullptr);
+    lua_close(L);
+}
+
+BOOST_AUTO_TEST_CASE(parallelTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    LuaStatePool pool(writeScript(dir, PARSER_SCRIPT), BASE_URL, 1);
+    const auto lease = pool.acquire();
+
+    BOOST_CHECK_EQUAL(run(lease, R"(
+        local a, b, c = utils.parallel(
+            function() return "one" end,
+            function() end,
+            function() return "three", "ignored" end)
+        return a .. tostring(b) .. c)"), "onenilthree");
+
+    // tasks only yield on webclient requests
+    BOOST_CHECK(run(lease, "return utils.parallel(function() coroutine.yield() end)").rfind("error: ", 0) == 0);
+
+    // an error in a task is raised by utils.parallel()
+    BOOST_CHECK(run(lease, "return utils.parallel(function() error('task failed') end)").find("task failed") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(parallelRequestsTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    LuaStatePool pool(writeScript(dir, PARSER_SCRIPT), BASE_URL, 1);
+    const auto lease = pool.acquire();
+
+    // each task waits on its own transfer
+    BOOST_CHECK_EQUAL(run(lease, R"(
+        local client = webclient.new()
+        local fetch = function(url)
+            return function()
+                local html, status, isError = client:getRaw(url)
+                return tostring(status)
+            end
+        end
+        local a, b = utils.parallel(fetch("https://httpstat.us/200"), fetch("https://httpstat.us/404"))
+        return a .. "," .. b)"), "200,404");
+
+    // getAll returns the pages in the order of the urls, inside a task or not
+    const char* getAll = R"(
+        local client = webclient.new()
+        local pages = client:getAll({ "https://httpstat.us/201", "https://httpstat.us/202" }, true)
+        return pages[1].status .. "," .. pages[2].status .. "," .. tostring(pages[2].isError))";
+
+    BOOST_CHECK_EQUAL(run(lease, getAll), "201,202,false");
+    BOOST_CHECK_EQUAL(run(lease, (std::string("return utils.parallel(function() ") + getAll + " end)").c_str()), "201,202,false");
+
+    // so does utils.getWebPage()
+    BOOST_CHECK_EQUAL(run(lease, R"(
+        local a, b = utils.parallel(
+            function() local html, status = utils.getWebPage("https://httpstat.us/200") return status end,
+            function() local html, status = utils.getWebPage("https://httpstat.us/404") return status end)
+        return a .. "," .. b)"), "200,404");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,264 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+
+#include "../src/Parsers/LuaStatePool.h"
+#include "../src/Parsers/OwlLua.h"
+
+using namespace owl;
+
+namespace
+{
+
+const char* PARSER_SCRIPT = R"(
+parserName = "test"
+
+Parser = {}
+Parser.__index = Parser
+
+function Parser.create(baseUrl)
+    local p = {}
+    setmetatable(p, Parser)
+    return p
+end
+
+PAGE = [[
+<div id="posts">
+    <a class="user" href="/member/1" title="first">one</a>
+    <a href="/member/2">two</a>
+    <a class="user" href="/member/3" title="third">three</a>
+</div>
+]]
+)";
+
+// runs `code` in a state of `pool` and returns its first result as a string
+std::string run(LuaStatePool& pool, const std::string& code)
+{
+    const auto lease = pool.acquire();
+    lua_State* L = lease.state();
+
+    lua_settop(L, 0);
+    const bool ok = luaL_dostring(L, code.c_str()) == 0;
+
+    const std::string result = lua_isstring(L, 1) ? lua_tostring(L, 1) : std::string("nil");
+    lua_settop(L, 0);
+
+    return ok ? result : "error: " + result;
+}
+
+struct PoolFixture
+{
+    PoolFixture()
+    {
+        BOOST_REQUIRE(dir.isValid());
+
+        const QString filename = dir.filePath("parser.lua");
+        QFile file(filename);
+        BOOST_REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(PARSER_SCRIPT);
+        file.close();
+
+        pool = std::make_unique<LuaStatePool>(filename, "http://www.example.com/", 1);
+    }
+
+    QTemporaryDir dir;
+    std::unique_ptr<LuaStatePool> pool;
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(OwlLuaTests, PoolFixture)
+
+BOOST_AUTO_TEST_CASE(sgmlEachTest)
+{
+    const std::string each = R"(
+        local doc = sgml.new(PAGE)
+        local hrefs = {}
+        for tag in doc:each(%1) do
+            hrefs[#hrefs + 1] = tag:attribute("href")
+        end
+        return table.concat(hrefs, ","))";
+
+    const auto eachOf = [&each](const char* args)
+        {
+            return QString::fromStdString(each).arg(args).toStdString();
+        };
+
+    BOOST_CHECK_EQUAL(run(*pool, eachOf(R"("a")")), "/member/1,/member/2,/member/3");
+    BOOST_CHECK_EQUAL(run(*pool, eachOf(R"("A")")), "/member/1,/member/2,/member/3");
+    BOOST_CHECK_EQUAL(run(*pool, eachOf(R"("a", "title")")), "/member/1,/member/3");
+    BOOST_CHECK_EQUAL(run(*pool, eachOf(R"("a", "class", "user")")), "/member/1,/member/3");
+    BOOST_CHECK_EQUAL(run(*pool, eachOf(R"("a", "href", regexp.new("[23]$"))")), "/member/2,/member/3");
+    BOOST_CHECK_EQUAL(run(*pool, eachOf(R"("span")")), "");
+
+    // the same elements as getElementsByName()
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        local tags = doc:getElementsByName("a", "class", "user")
+        local i = 0
+        for tag in doc:each("a", "class", "user") do
+            i = i + 1
+            if not tag:compare(tags[i]) then return "mismatch" end
+        end
+        return i)"), "2");
+}
+
+BOOST_AUTO_TEST_CASE(sgmlFilterTest)
+{
+    // doc:each() matches what getElementsByName() returns for the same arguments
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        local function count(name, attribute, value)
+            local n = 0
+            for tag in doc:each(name, attribute, value) do n = n + 1 end
+            return n .. "/" .. #doc:getElementsByName(name, attribute, value)
+        end
+        return table.concat({
+            count("a", nil, nil),
+            count("A", nil, nil),
+            count("a", "class", "user"),
+            count("A", "href", nil),
+            count("a", nil, "/member/1"),
+            count("a", "", regexp.new("member")),
+            count("", nil, nil) }, ","))"), "3/3,3/3,2/2,0/0,0/0,0/0,0/0");
+
+    // names and values are read as UTF-8
+    BOOST_CHECK_EQUAL(run(*pool, "local doc = sgml.new('<a title=\"\xe6\x97\xa5\xe6\x9c\xac\">x</a>')\n"
+        "return #doc:getElementsByName('a', 'title', '\xe6\x97\xa5\xe6\x9c\xac')"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(sgmlFirstTest)
+{
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        return doc:first("a", "href", "/member/2"):attribute("href"))"), "/member/2");
+
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        return doc:first("a", "title"):attribute("title"))"), "first");
+
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        return tostring(doc:first("a", "class", "admin")))"), "nil");
+}
+
+BOOST_AUTO_TEST_CASE(sgmlAttributesTest)
+{
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        local attrs = doc:first("a"):attributes{ "href", "title", "rel" }
+        return attrs.href .. "|" .. attrs.title .. "|" .. attrs.rel)"), "/member/1|first|");
+
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        local count = 0
+        for name, value in pairs(doc:first("a"):attributes()) do
+            count = count + 1
+        end
+        return count)"), "3");
+
+    BOOST_CHECK(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        return doc:first("a"):attributes{ 1 })").rfind("error: ", 0) == 0);
+
+    // attributes are returned as UTF-8
+    BOOST_CHECK_EQUAL(run(*pool, "local doc = sgml.new('<a title=\"\xe6\x97\xa5\xe6\x9c\xac\">x</a>')\n"
+        "return doc:first('a'):attributes{ 'title' }.title .. doc:first('a'):attribute('title')"),
+        "\xe6\x97\xa5\xe6\x9c\xac\xe6\x97\xa5\xe6\x9c\xac");
+}
+
+BOOST_AUTO_TEST_CASE(sgmlSiblingsTest)
+{
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        local hrefs = {}
+        local tag = doc:first("a")
+        while tag do
+            if tag:name() == "a" then hrefs[#hrefs + 1] = tag:attribute("href") end
+            tag = tag:next()
+        end
+        return table.concat(hrefs, ","))"), "/member/1,/member/2,/member/3");
+
+    BOOST_CHECK_EQUAL(run(*pool, R"(
+        local doc = sgml.new(PAGE)
+        local last = doc:first("a", "href", "/member/3")
+        local tag = last:previous()
+        while tag and tag:name() ~= "a" do tag = tag:previous() end
+        return tag:attribute("href"))"), "/member/2");
+}
+
+BOOST_AUTO_TEST_CASE(replyBodyTest)
+{
+    // UTF-8, a NUL and a byte that is not valid UTF-8
+    const std::string body("<p>\xe6\x97\xa5\xe6\x9c\xac\0\xff</p>", 15);
+
+    auto reply = std::make_shared<WebClient::Reply>(200);
+    reply->setData(body);
+
+    {
+        const auto lease = pool->acquire();
+        lua_State* L = lease.state();
+        lua_settop(L, 0);
+
+        BOOST_REQUIRE_EQUAL(OwlLua::pushResponse(L, reply), 3);
+
+        std::size_t length = 0;
+        const char* html = lua_tolstring(L, 1, &length);
+        BOOST_CHECK_EQUAL(std::string(html, length), body);
+        BOOST_CHECK_EQUAL(lua_tointeger(L, 2), 200);
+        BOOST_CHECK(!lua_toboolean(L, 3));
+
+        lua_pushvalue(L, 1);
+        lua_setglobal(L, "html");
+        lua_settop(L, 0);
+    }
+
+    // the script sees the same bytes
+    BOOST_CHECK_EQUAL(run(*pool, R"(return #html .. "," .. html:byte(4) .. "," .. html:byte(10) .. "," .. html:byte(11))"),
+        "15,230,0,255");
+}
+
+// Run explicitly with --run_test=OwlLuaTests/sgmlBenchmark
+BOOST_AUTO_TEST_CASE(sgmlBenchmark, * boost::unit_test::disabled())
+{
+    const std::string result = run(*pool, R"(
+        local rows = {}
+        for i = 1, 5000 do
+            rows[#rows + 1] = string.format(
+                '<tr class="row"><td><a href="/thread/%d" title="thread %d">%d</a></td><td>%d</td></tr>', i, i, i, i)
+        end
+        local doc = sgml.new("<table>" .. table.concat(rows) .. "</table>")
+
+        local function time(fn)
+            local start = os.clock()
+            for i = 1, 20 do fn() end
+            return (os.clock() - start) * 1000 / 20
+        end
+
+        local tableTime = time(function()
+            for _, tag in ipairs(doc:getElementsByName("a", "href", nil)) do
+                local href, title = tag:attribute("href"), tag:attribute("title")
+            end
+        end)
+
+        local eachTime = time(function()
+            for tag in doc:each("a", "href") do
+                local attrs = tag:attributes{ "href", "title" }
+            end
+        end)
+
+        local indexTime = time(function() local tag = doc:getElementsByName("tr", "class", "row")[1] end)
+        local firstTime = time(function() local tag = doc:first("tr", "class", "row") end)
+
+        return string.format(
+            "getElementsByName+attribute %.2fms, each+attributes %.2fms, getElementsByName[1] %.2fms, first %.2fms",
+            tableTime, eachTime, indexTime, firstTime))");
+
+    BOOST_TEST_MESSAGE(result);
+    BOOST_CHECK(result.rfind("error: ", 0) != 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
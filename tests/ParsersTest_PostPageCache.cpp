@@ -0,0 +1,116 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+
+#include "../src/Parsers/ParserBase.h"
+#include "../src/Parsers/PostPageCache.h"
+
+using namespace owl;
+
+namespace
+{
+
+ThreadPtr makePage(const QString& threadId, int pageNumber)
+{
+    auto page = std::make_shared<Thread>(threadId);
+    page->setPageNumber(pageNumber);
+    page->getPosts().push_back(std::make_shared<Post>(QString("%1-%2").arg(threadId).arg(pageNumber)));
+    return page;
+}
+
+QString pageKey(const QString& threadId, int pageNumber)
+{
+    return PostPageCache::makeKey(threadId, ParserBase::PostListOptions::FIRST_POST, pageNumber, 25);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PostPageCacheTests)
+
+BOOST_AUTO_TEST_CASE(keyTest)
+{
+    BOOST_CHECK(pageKey("1", 2) != pageKey("1", 3));
+    BOOST_CHECK(pageKey("1", 2) != pageKey("2", 2));
+    BOOST_CHECK(pageKey("1", 2) != PostPageCache::makeKey("1", ParserBase::PostListOptions::FIRST_POST, 2, 50));
+
+    // the server picks the page of a FIRST_UNREAD request
+    BOOST_CHECK(PostPageCache::makeKey("1", ParserBase::PostListOptions::FIRST_UNREAD, 1, 25)
+        == PostPageCache::makeKey("1", ParserBase::PostListOptions::FIRST_UNREAD, 4, 25));
+}
+
+BOOST_AUTO_TEST_CASE(takeTest)
+{
+    PostPageCache cache;
+
+    const auto page = makePage("1", 2);
+    cache.insert(pageKey("1", 2), page);
+
+    BOOST_CHECK(cache.contains(pageKey("1", 2)));
+    BOOST_CHECK(!cache.contains(pageKey("1", 3)));
+    BOOST_CHECK(!cache.take(pageKey("1", 3)));
+
+    // a page is handed out once
+    BOOST_CHECK(cache.take(pageKey("1", 2)) == page);
+    BOOST_CHECK(!cache.take(pageKey("1", 2)));
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+
+    cache.insert(pageKey("1", 2), ThreadPtr());
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(evictionTest)
+{
+    PostPageCache cache(3);
+
+    for (int i = 1; i <= 5; i++)
+    {
+        cache.insert(pageKey("1", i), makePage("1", i));
+    }
+
+    // the oldest pages are evicted first
+    BOOST_CHECK_EQUAL(cache.size(), 3);
+    BOOST_CHECK(!cache.contains(pageKey("1", 1)));
+    BOOST_CHECK(!cache.contains(pageKey("1", 2)));
+    BOOST_CHECK(cache.contains(pageKey("1", 5)));
+
+    // reinserting a page makes it the newest
+    cache.insert(pageKey("1", 3), makePage("1", 3));
+    cache.insert(pageKey("1", 6), makePage("1", 6));
+    BOOST_CHECK(cache.contains(pageKey("1", 3)));
+    BOOST_CHECK(!cache.contains(pageKey("1", 4)));
+
+    cache.setCapacity(1);
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+    BOOST_CHECK(cache.contains(pageKey("1", 6)));
+}
+
+BOOST_AUTO_TEST_CASE(removeTest)
+{
+    PostPageCache cache;
+    cache.insert(pageKey("1", 1), makePage("1", 1));
+    cache.insert(pageKey("1", 2), makePage("1", 2));
+    cache.insert(pageKey("2", 1), makePage("2", 1));
+
+    cache.removeThread("1");
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+    BOOST_CHECK(cache.contains(pageKey("2", 1)));
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(expiryTest)
+{
+    // every page is already stale
+    PostPageCache cache(DEFAULT_POST_PAGE_CACHE_SIZE, -1);
+    cache.insert(pageKey("1", 1), makePage("1", 1));
+
+    BOOST_CHECK(!cache.contains(pageKey("1", 1)));
+    BOOST_CHECK(!cache.take(pageKey("1", 1)));
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,252 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+#include <QDomDocument>
+
+#include "../src/Parsers/XmlRpcDecoder.h"
+#include "../src/Parsers/xrvariant.h"
+#include "../src/Utils/Exception.h"
+
+using namespace owl;
+
+namespace
+{
+
+QString makeResponse(const QString& value)
+{
+    return QString(R"(<?xml version="1.0"?><methodResponse><params><param><value>%1</value></param></params></methodResponse>)")
+        .arg(value);
+}
+
+QString makeMember(const QString& name, const QString& value)
+{
+    return QString("<member><name>%1</name><value>%2</value></member>").arg(name, value);
+}
+
+// the struct of a get_thread response with `count` posts
+QString makeThreadStruct(int count)
+{
+    QString posts;
+    for (int i = 0; i < count; i++)
+    {
+        const QString content = QString("Post number %1 with a [b]bit[/b] of text. ").repeated(20).arg(i);
+
+        posts += "<value><struct>"
+            + makeMember("post_id", QString("<string>%1</string>").arg(1000 + i))
+            + makeMember("post_title", "<base64>" + QString("Re: A thread title").toUtf8().toBase64() + "</base64>")
+            + makeMember("post_content", "<base64>" + content.toUtf8().toBase64() + "</base64>")
+            + makeMember("post_author_id", QString("<string>%1</string>").arg(i % 17))
+            + makeMember("post_author_name", "<base64>" + QString("user%1").arg(i % 17).toUtf8().toBase64() + "</base64>")
+            + makeMember("icon_url", "<string>https://example.com/avatar.png</string>")
+            + makeMember("post_time", "<dateTime.iso8601>20230115T10:30:00+00:00</dateTime.iso8601>")
+            + makeMember("timestamp", QString("<string>%1</string>").arg(1673778600 + i))
+            + makeMember("can_edit", "<boolean>0</boolean>")
+            + makeMember("attachments", "<array><data></data></array>")
+            + "</struct></value>";
+    }
+
+    return "<struct>"
+        + makeMember("total_post_num", QString("<int>%1</int>").arg(count))
+        + makeMember("topic_title", "<base64>" + QString("A thread title").toUtf8().toBase64() + "</base64>")
+        + makeMember("posts", "<array><data>" + posts + "</data></array>")
+        + "</struct>";
+}
+
+// a get_thread response with `count` posts
+QString makeThreadResponse(int count)
+{
+    return makeResponse(makeThreadStruct(count));
+}
+
+class PostCollector : public XmlRpcRecordVisitor
+{
+public:
+    void beginRecord() override
+    {
+        _current.clear();
+    }
+
+    bool wantsField(const QString& name) const override
+    {
+        return name != "post_content";
+    }
+
+    void field(const QString& name, QVariant value) override
+    {
+        _current.insert(name, value);
+    }
+
+    void endRecord() override
+    {
+        records.push_back(_current);
+    }
+
+    QList<QVariantMap> records;
+
+private:
+    QVariantMap _current;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(XmlRpcDecoderTests)
+
+BOOST_AUTO_TEST_CASE(scalarTest)
+{
+    BOOST_CHECK_EQUAL(XmlRpcDecoder(makeResponse("<int>42</int>")).decode().toInt(), 42);
+    BOOST_CHECK_EQUAL(XmlRpcDecoder(makeResponse("<i4>-7</i4>")).decode().toInt(), -7);
+    BOOST_CHECK_EQUAL(XmlRpcDecoder(makeResponse("<double>1.5</double>")).decode().toDouble(), 1.5);
+    BOOST_CHECK(XmlRpcDecoder(makeResponse("<boolean>1</boolean>")).decode().toBool());
+    BOOST_CHECK(!XmlRpcDecoder(makeResponse("<boolean>maybe</boolean>")).decode().isValid());
+
+    BOOST_CHECK(XmlRpcDecoder(makeResponse("<string>a &amp; b</string>")).decode().toString() == "a & b");
+    BOOST_CHECK(XmlRpcDecoder(makeResponse("untyped")).decode().toString() == "untyped");
+    BOOST_CHECK(XmlRpcDecoder(makeResponse("\n  <string>x</string>\n")).decode().toString() == "x");
+
+    const auto bytes = XmlRpcDecoder(makeResponse("<base64>aGVsbG8=</base64>")).decode();
+    BOOST_CHECK(bytes.type() == QVariant::ByteArray);
+    BOOST_CHECK(bytes.toByteArray() == "hello");
+
+    const auto dt = XmlRpcDecoder(makeResponse("<dateTime.iso8601>20230115T10:30:00</dateTime.iso8601>")).decode();
+    BOOST_CHECK(dt.toDateTime() == QDateTime(QDate(2023, 1, 15), QTime(10, 30)));
+
+    BOOST_CHECK(!XmlRpcDecoder("<methodResponse></methodResponse>").decode().isValid());
+}
+
+BOOST_AUTO_TEST_CASE(compositeTest)
+{
+    const auto value = XmlRpcDecoder(makeResponse("<struct>"
+        + makeMember("result", "<boolean>1</boolean>")
+        + makeMember("list", "<array><data><value><int>1</int></value><value>two</value></data></array>")
+        + makeMember("nested", "<struct>" + makeMember("a", "<int>3</int>") + "</struct>")
+        + "</struct>")).decode();
+
+    BOOST_REQUIRE(value.type() == QVariant::Map);
+
+    const auto map = value.toMap();
+    BOOST_CHECK(map["result"].toBool());
+
+    const auto list = map["list"].toList();
+    BOOST_REQUIRE_EQUAL(list.size(), 2);
+    BOOST_CHECK_EQUAL(list[0].toInt(), 1);
+    BOOST_CHECK(list[1].toString() == "two");
+
+    BOOST_CHECK_EQUAL(map["nested"].toMap()["a"].toInt(), 3);
+
+    // like XRVariant an array holding an invalid value is invalid
+    const auto invalid = XmlRpcDecoder(makeResponse(
+        "<array><data><value><int>1</int></value><value><boolean>x</boolean></value></data></array>")).decode();
+    BOOST_CHECK(!invalid.isValid());
+}
+
+BOOST_AUTO_TEST_CASE(faultTest)
+{
+    const auto fault = XmlRpcDecoder(R"(<?xml version="1.0"?><methodResponse><fault><value><struct>)"
+        + makeMember("faultCode", "<int>4</int>")
+        + makeMember("faultString", "<string>Too many parameters.</string>")
+        + "</struct></value></fault></methodResponse>").decode();
+
+    BOOST_CHECK_EQUAL(fault.toMap()["faultCode"].toInt(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(malformedTest)
+{
+    BOOST_CHECK_THROW(XmlRpcDecoder("<methodResponse><params><param><value><int>1</value>").decode(), owl::Exception);
+    BOOST_CHECK_THROW(XmlRpcDecoder("this is not xml <").decode(), owl::Exception);
+    BOOST_CHECK_THROW(XRVariant(QString("<value><string>truncated")), owl::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(visitorTest)
+{
+    PostCollector collector;
+    const auto response = XmlRpcDecoder(makeThreadResponse(3)).decodeStruct("posts", collector);
+
+    BOOST_REQUIRE(response.has_value());
+    BOOST_CHECK_EQUAL(response->value("total_post_num").toInt(), 3);
+    BOOST_CHECK(response->contains("posts"));
+    BOOST_CHECK(response->value("posts").toList().isEmpty());
+
+    BOOST_REQUIRE_EQUAL(collector.records.size(), 3);
+    BOOST_CHECK(collector.records[1]["post_id"].toString() == "1001");
+    BOOST_CHECK(collector.records[1]["post_author_name"].toString() == "user1");
+    BOOST_CHECK(!collector.records[1].contains("post_content"));
+
+    // a value that isn't a struct
+    PostCollector unused;
+    BOOST_CHECK(!XmlRpcDecoder(makeResponse("<int>1</int>")).decodeStruct("posts", unused).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(xrvariantTest)
+{
+    // the DOM based and streaming decoders must agree on every param
+    const QString xml = QString(R"(<?xml version="1.0"?><methodResponse><params>)"
+        "<param><value>%1</value></param>"
+        "<param><value><int>42</int></value></param>"
+        "<param><value><array><data><value><string>a</string></value><value><boolean>1</boolean></value></data></array></value></param>"
+        "<param><value>untyped</value></param>"
+        "</params></methodResponse>")
+        .arg(makeThreadStruct(5));
+
+    QDomDocument doc;
+    BOOST_REQUIRE(doc.setContent(xml));
+
+    const QDomNodeList params = doc.elementsByTagName("param");
+    BOOST_REQUIRE_EQUAL(params.size(), 4);
+
+    for (int i = 0; i < params.size(); i++)
+    {
+        QDomElement element = params.at(i).firstChildElement("value");
+
+        QString value;
+        QTextStream stream(&value);
+        element.save(stream, -1);
+        stream.flush();
+
+        const XRVariant fromDom(element);
+        const XRVariant fromStream(value);
+
+        BOOST_CHECK_MESSAGE(fromDom == fromStream, "param " << i << " differs");
+    }
+
+    // and the first param is what a whole response decodes to
+    QDomElement first = doc.elementsByTagName("value").at(0).toElement();
+    BOOST_CHECK(XRVariant(first) == XRVariant(xml));
+}
+
+// Run explicitly with --run_test=XmlRpcDecoderTests/decodeBenchmark
+BOOST_AUTO_TEST_CASE(decodeBenchmark, * boost::unit_test::disabled())
+{
+    const QString xml = makeThreadResponse(100);
+    constexpr int iterations = 50;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        QDomDocument doc;
+        doc.setContent(xml);
+        QDomElement element = doc.elementsByTagName("value").at(0).toElement();
+        const XRVariant value(element);
+        BOOST_CHECK_EQUAL(value.toMap()["posts"].toList().size(), 100);
+    }
+
+    const auto domElapsed = timer.restart();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        PostCollector collector;
+        XmlRpcDecoder(xml).decodeStruct("posts", collector);
+        BOOST_CHECK_EQUAL(collector.records.size(), 100);
+    }
+
+    const auto streamElapsed = timer.elapsed();
+
+    BOOST_TEST_MESSAGE("Decoded " << xml.size() / 1024 << " KB " << iterations << " times: DOM "
+        << domElapsed << " ms, streaming " << streamElapsed << " ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+
+#include "../src/Utils/Exception.h"
+
+using namespace owl;
+
+namespace
+{
+
+// reports the exception thrown by `fn` to a future the way the parsers'
+// request queue does
+template<typename ThrowT>
+QFuture<QVariant> failedFuture(ThrowT fn)
+{
+    QFutureInterface<QVariant> promise;
+    promise.reportStarted();
+
+    try
+    {
+        fn();
+    }
+    catch (const owl::Exception& ex)
+    {
+        promise.reportException(ex);
+    }
+
+    promise.reportFinished();
+    return promise.future();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ExceptionTests)
+
+BOOST_AUTO_TEST_CASE(futureTest)
+{
+    auto future = failedFuture([]() { OWL_THROW_EXCEPTION(Exception("request failed")); });
+
+    try
+    {
+        future.waitForFinished();
+        BOOST_FAIL("the future did not rethrow");
+    }
+    catch (const owl::Exception& ex)
+    {
+        BOOST_CHECK_EQUAL(ex.message().toStdString(), "request failed");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(futureSubclassTest)
+{
+    auto future = failedFuture([]()
+        {
+            OWL_THROW_EXCEPTION(WebException("not found", "http://www.example.com/", 404));
+        });
+
+    try
+    {
+        future.waitForFinished();
+        BOOST_FAIL("the future did not rethrow");
+    }
+    catch (const owl::WebException& ex)
+    {
+        BOOST_CHECK_EQUAL(ex.message().toStdString(), "not found");
+        BOOST_CHECK_EQUAL(ex.lastUrl().toStdString(), "http://www.example.com/");
+        BOOST_CHECK_EQUAL(ex.statuscode(), 404);
+    }
+
+    future = failedFuture([]() { OWL_THROW_EXCEPTION(LuaException("bad script")); });
+    BOOST_CHECK_THROW(future.waitForFinished(), owl::LuaException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,176 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+#include <QTemporaryDir>
+
+#include "../src/Utils/HttpCache.h"
+
+using namespace owl;
+
+namespace
+{
+
+HttpCache::Entry makeEntry(const QString& url, const std::string& body)
+{
+    HttpCache::Entry entry;
+    entry.key = HttpCache::makeKey("GET", url);
+    entry.finalUrl = url;
+    entry.etag = "\"abc123\"";
+    entry.lastModified = "Wed, 21 Oct 2015 07:28:00 GMT";
+    entry.body = body;
+    return entry;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(HttpCacheTests)
+
+BOOST_AUTO_TEST_CASE(storeAndFindTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    HttpCache cache(dir.path());
+    const auto entry = makeEntry("https://example.com/thread/1", "<html>page one</html>");
+
+    BOOST_CHECK(cache.find(entry.key) == nullptr);
+
+    cache.store(entry);
+
+    const auto found = cache.find(entry.key);
+    BOOST_REQUIRE(found != nullptr);
+    BOOST_CHECK(found->body == entry.body);
+    BOOST_CHECK(found->etag == entry.etag);
+    BOOST_CHECK(found->lastModified == entry.lastModified);
+    BOOST_CHECK(found->stored.isValid());
+
+    // the method is part of the key
+    BOOST_CHECK(cache.find(HttpCache::makeKey("POST", "https://example.com/thread/1")) == nullptr);
+
+    cache.remove(entry.key);
+    BOOST_CHECK(cache.find(entry.key) == nullptr);
+    BOOST_CHECK_EQUAL(cache.diskSize(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(persistenceTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    const auto entry = makeEntry("https://example.com/thread/2", "<html>page two</html>");
+
+    {
+        HttpCache cache(dir.path());
+        cache.store(entry);
+    }
+
+    // a new instance only has the disk to go by
+    HttpCache cache(dir.path());
+    const auto found = cache.find(entry.key);
+    BOOST_REQUIRE(found != nullptr);
+    BOOST_CHECK(found->body == entry.body);
+    BOOST_CHECK(found->finalUrl == entry.finalUrl);
+}
+
+BOOST_AUTO_TEST_CASE(evictionTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    const std::string body(10000, 'x');
+
+    // room for two bodies in memory and about three on disk
+    HttpCache cache(dir.path(), 35000, 20000);
+
+    const auto first = makeEntry("https://example.com/1", body);
+    const auto second = makeEntry("https://example.com/2", body);
+    const auto third = makeEntry("https://example.com/3", body);
+    const auto fourth = makeEntry("https://example.com/4", body);
+
+    cache.store(first);
+    cache.store(second);
+    cache.store(third);
+    BOOST_CHECK(cache.memorySize() <= 20000);
+
+    // make the first one the most recently used
+    BOOST_CHECK(cache.find(first.key) != nullptr);
+
+    cache.store(fourth);
+    BOOST_CHECK(cache.diskSize() <= 35000);
+
+    BOOST_CHECK(cache.find(first.key) != nullptr);
+    BOOST_CHECK(cache.find(second.key) == nullptr);
+    BOOST_CHECK(cache.find(fourth.key) != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(clearTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    HttpCache cache(dir.path());
+
+    const auto forumA = makeEntry("https://forum-a.com/thread/1", "a");
+    const auto forumB = makeEntry("https://forum-b.com/thread/1", "b");
+
+    cache.store(forumA);
+    cache.store(forumB);
+
+    cache.clear("https://forum-a.com");
+    BOOST_CHECK(cache.find(forumA.key) == nullptr);
+    BOOST_CHECK(cache.find(forumB.key) != nullptr);
+
+    cache.clear();
+    BOOST_CHECK(cache.find(forumB.key) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(concurrentTest)
+{
+    QTemporaryDir dir;
+    BOOST_REQUIRE(dir.isValid());
+
+    // small enough that the threads keep evicting each other's entries
+    HttpCache cache(dir.path(), 50000, 10000);
+
+    // Boost.Test assertions aren't thread safe, count in the workers instead
+    std::atomic<int> mangled = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&cache, &mangled, t]()
+        {
+            for (int i = 0; i < 50; i++)
+            {
+                const auto entry = makeEntry(QString("https://example.com/%1/%2").arg(t).arg(i % 10),
+                    std::string(5000, static_cast<char>('a' + t)));
+
+                cache.store(entry);
+
+                // another thread may have evicted it, but never mangled it
+                if (auto found = cache.find(entry.key); found && found->body != entry.body)
+                {
+                    mangled++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(mangled.load(), 0);
+    BOOST_CHECK(cache.diskSize() <= 50000);
+    BOOST_CHECK(cache.memorySize() <= 10000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
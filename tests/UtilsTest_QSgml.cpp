@@ -12,6 +12,228 @@
 
 namespace data = boost::unit_test::data;
 
+namespace
+{
+
+// QSgml::String2Sgml() as it was before the single-pass tokenizer, kept as
+// the baseline of parseBenchmark. The tags are heap allocated and owned by
+// their parents, the attributes are parsed by QSgmlTag's constructor
+class LegacySgml
+{
+public:
+    LegacySgml()
+        : DocTag(new QSgmlTag("DocTag", QSgmlTag::eVirtualBeginTag, nullptr)),
+          EndTag(new QSgmlTag("EndTag", QSgmlTag::eVirtualEndTag, DocTag))
+    {
+        DocTag->Children.append(EndTag);
+        tagExeption.append("script");
+        tagExeption.append("style");
+    }
+
+    ~LegacySgml()
+    {
+        delete DocTag;
+    }
+
+    QSgmlTag* DocTag;
+    QSgmlTag* EndTag;
+
+    void String2Sgml(const QString SgmlString)
+    {
+        QSgmlTag* LastTag = DocTag;
+        int iPos = 0;
+        int iStart = 0;
+        int iEnd = 0;
+
+        DocTag->Children.clear();
+
+        do
+        {
+            for (const QString& sName : tagExeption)
+            {
+                if (LastTag->Name.toLower() == sName)
+                {
+                    iPos = SgmlString.toLower().indexOf("</" + sName, iPos);
+                    iPos--;
+                }
+            }
+
+            iPos = SgmlString.indexOf("<", iPos);
+            if (iPos == -1)
+            {
+                LastTag->Children.append(EndTag);
+                break;
+            }
+            else if (iPos > iEnd + 1)
+            {
+                HandleCdata(SgmlString, LastTag, iStart, iEnd, iPos);
+            }
+
+            if (SgmlString.at(iPos + 1) == '!' && SgmlString.at(iPos + 2) == '-' && SgmlString.at(iPos + 3) == '-')
+            {
+                HandleComment(SgmlString, LastTag, iStart, iEnd, iPos);
+            }
+            else if (SgmlString.at(iPos + 1) == '!')
+            {
+                HandleDoctype(SgmlString, LastTag, iStart, iEnd, iPos);
+            }
+            else if (SgmlString.at(iPos + 1) == '/')
+            {
+                HandleEndTag(SgmlString, LastTag, iStart, iEnd, iPos);
+            }
+            else
+            {
+                HandleStartTag(SgmlString, LastTag, iStart, iEnd, iPos);
+            }
+        } while (iPos != -1);
+    }
+
+private:
+    QList<QString> tagExeption;
+
+    static void FindEnd(const QString& HtmlString, int& iPos)
+    {
+        for (; iPos < HtmlString.length(); iPos++)
+        {
+            if (HtmlString.at(iPos) == '>')
+            {
+                return;
+            }
+            if (HtmlString.at(iPos) == '\'')
+            {
+                iPos = HtmlString.indexOf("\'", iPos + 1);
+            }
+            if (HtmlString.at(iPos) == '\"')
+            {
+                iPos = HtmlString.indexOf("\"", iPos + 1);
+            }
+        }
+        iPos = -1;
+    }
+
+    static void MoveChildren(QSgmlTag* Source, QSgmlTag* Dest)
+    {
+        const int iCount = Source->Children.count();
+        for (int i = 0; i < iCount; i++)
+        {
+            Source->Children[0]->Parent = Dest;
+            Dest->resetLevel();
+            Dest->Children.append(Source->Children[0]);
+            Source->Children.removeFirst();
+        }
+    }
+
+    static void HandleCdata(QString SgmlString, QSgmlTag*& pLastTag, int& iStart, int& iEnd, int& iPos)
+    {
+        QRegExp qNoWhitSpace("(\\S)");
+
+        iStart = iEnd + 1;
+        iEnd = iPos;
+        const QString sDummy = SgmlString.mid(iStart, iEnd - iStart).trimmed();
+        if (sDummy.contains(qNoWhitSpace))
+        {
+            pLastTag->Children.append(new QSgmlTag(sDummy, QSgmlTag::eCdata, pLastTag));
+        }
+    }
+
+    static void HandleComment(QString SgmlString, QSgmlTag*& pLastTag, int& iStart, int& iEnd, int& iPos)
+    {
+        iPos += 4;
+        iStart = iPos;
+        iPos = SgmlString.indexOf("-->", iPos);
+        iEnd = iPos;
+
+        const QString sDummy = SgmlString.mid(iStart, iEnd - iStart).trimmed();
+        pLastTag->Children.append(new QSgmlTag(sDummy, QSgmlTag::eComment, pLastTag));
+        iEnd += 2;
+        iPos = iEnd;
+    }
+
+    static void HandleDoctype(QString SgmlString, QSgmlTag*& pLastTag, int& iStart, int& iEnd, int& iPos)
+    {
+        iStart = iPos;
+        FindEnd(SgmlString, iPos);
+        iEnd = iPos;
+
+        const QString sDummy = SgmlString.mid(iStart + 2, iEnd - iStart - 2).trimmed();
+        pLastTag->Children.append(new QSgmlTag(sDummy, QSgmlTag::eDoctype, pLastTag));
+    }
+
+    void HandleEndTag(QString SgmlString, QSgmlTag*& pLastTag, int& iStart, int& iEnd, int& iPos)
+    {
+        iStart = iPos;
+        FindEnd(SgmlString, iPos);
+        iEnd = iPos;
+
+        const QString sDummy = SgmlString.mid(iStart + 1, iEnd - iStart - 1).trimmed();
+        const QSgmlTag endTag(sDummy, QSgmlTag::eEndTag, pLastTag);
+
+        QSgmlTag* pDummyTag = pLastTag;
+        while (pDummyTag->Name != endTag.Name && pDummyTag->Parent != nullptr)
+        {
+            pDummyTag = pDummyTag->Parent;
+        }
+
+        if (pDummyTag->Parent != nullptr)
+        {
+            while (pLastTag != pDummyTag)
+            {
+                pLastTag->Type = QSgmlTag::eStandalone;
+                MoveChildren(pLastTag, pLastTag->Parent);
+                pLastTag = pLastTag->Parent;
+            }
+
+            if (pLastTag->Children.count() == 0)
+            {
+                pLastTag->Type = QSgmlTag::eStartEmpty;
+            }
+            pLastTag = pLastTag->Parent;
+        }
+        else
+        {
+            pLastTag->Children.append(EndTag);
+            iPos = -1;
+        }
+    }
+
+    static void HandleStartTag(QString SgmlString, QSgmlTag*& pLastTag, int& iStart, int& iEnd, int& iPos)
+    {
+        iStart = iPos;
+        FindEnd(SgmlString, iPos);
+        iEnd = iPos;
+        QString sDummy = SgmlString.mid(iStart + 1, iEnd - iStart - 1).trimmed();
+
+        if (SgmlString.at(iEnd - 1) == '/')
+        {
+            sDummy = sDummy.left(sDummy.count() - 1);
+            pLastTag->Children.append(new QSgmlTag(sDummy, QSgmlTag::eStandalone, pLastTag));
+        }
+        else
+        {
+            QSgmlTag* pTag = new QSgmlTag(sDummy, QSgmlTag::eStartTag, pLastTag);
+            pLastTag->Children.append(pTag);
+            pLastTag = pTag;
+        }
+    }
+};
+
+// the number of tags under `tag` with the name and attribute value
+int countTags(const QSgmlTag* tag, const QString& name, const QString& atrName, const QString& atrValue)
+{
+    int count = 0;
+    for (const QSgmlTag* child : tag->Children)
+    {
+        if (child->Name == name && child->Attributes.value(atrName) == atrValue)
+        {
+            count++;
+        }
+        count += countTags(child, name, atrName, atrValue);
+    }
+    return count;
+}
+
+} // namespace
+
 BOOST_AUTO_TEST_SUITE(QSgmlTest)
 
 std::tuple<std::string> htmlData[] = 
@@ -25,4 +247,184 @@ BOOST_DATA_TEST_CASE(testParse, data::make(htmlData), htmlText)
     BOOST_CHECK(doc.parse(QString::fromStdString(htmlText)));
 }
 
+BOOST_AUTO_TEST_CASE(testStructure)
+{
+    const QString html = R"(<!DOCTYPE html>
+<html>
+<head><title>Thread</title><script>if (a < b) { document.write("</div>"); }</script></head>
+<BODY class='main'>
+    <div id="posts" data-count=2>
+        <p>first<br/>line</p>
+        <!-- a comment -->
+        <p title="a > b">second</p>
+    </div>
+</body>
+</html>)";
+
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse(html));
+
+    // names are lower case, attributes keep their values
+    auto bodies = doc.getElementsByName("body");
+    BOOST_REQUIRE_EQUAL(bodies.size(), 1);
+    BOOST_CHECK(bodies.at(0)->Attributes.value("class") == "main");
+
+    auto divs = doc.getElementsByName("div", "id", "posts");
+    BOOST_REQUIRE_EQUAL(divs.size(), 1);
+    BOOST_CHECK(divs.at(0)->Attributes.value("data-count") == "2");
+
+    // the script's content is not parsed
+    BOOST_CHECK_EQUAL(doc.getElementsByName("div").size(), 1);
+    auto scripts = doc.getElementsByName("script");
+    BOOST_REQUIRE_EQUAL(scripts.size(), 1);
+    BOOST_CHECK(doc.getInnerHtml(scripts.at(0)).contains("</div>"));
+
+    auto paras = doc.getElementsByName("p");
+    BOOST_REQUIRE_EQUAL(paras.size(), 2);
+    BOOST_CHECK(paras.at(1)->Attributes.value("title") == "a > b");
+    BOOST_CHECK(doc.getText(paras.at(0)) == "firstline");
+    BOOST_CHECK(doc.getOuterHtml(paras.at(1)) == R"(<p title="a > b">second</p>)");
+    BOOST_CHECK(paras.at(0)->Parent == divs.at(0));
+    BOOST_CHECK_EQUAL(paras.at(0)->Level, divs.at(0)->Level + 1);
+}
+
+BOOST_AUTO_TEST_CASE(testMalformed)
+{
+    QSgml doc;
+
+    // unclosed tags become standalone, stray end tags are ignored
+    BOOST_REQUIRE(doc.parse("<html><body><div><p>one<p>two</div></span><div>three</div></body></html>"));
+
+    auto divs = doc.getElementsByName("div");
+    BOOST_REQUIRE_EQUAL(divs.size(), 2);
+    BOOST_CHECK(doc.getText(divs.at(1)) == "three");
+
+    auto paras = doc.getElementsByName("p");
+    BOOST_REQUIRE_EQUAL(paras.size(), 2);
+    BOOST_CHECK(paras.at(0)->Type == QSgmlTag::eStandalone);
+    BOOST_CHECK(paras.at(0)->Parent == divs.at(0));
+    BOOST_CHECK_EQUAL(paras.at(0)->Level, divs.at(0)->Level + 1);
+
+    // parsing again releases the previous document
+    BOOST_REQUIRE(doc.parse("<html><body>1 < 2</body></html>"));
+    BOOST_CHECK_EQUAL(doc.getElementsByName("div").size(), 0);
+    BOOST_CHECK(doc.getText(doc.getElementsByName("body").at(0)) == "1 < 2");
+}
+
+BOOST_AUTO_TEST_CASE(testSiblings)
+{
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse("<ul><li>one</li><li>two</li><li>three</li></ul>"));
+
+    auto items = doc.getElementsByName("li");
+    BOOST_REQUIRE_EQUAL(items.size(), 3);
+
+    BOOST_CHECK(items.at(0)->getPreviousSibling() == nullptr);
+    BOOST_CHECK(items.at(0)->getNextSibling() == items.at(1));
+    BOOST_CHECK(items.at(2)->getPreviousSibling() == items.at(1));
+    BOOST_CHECK(items.at(2)->getNextSibling() == nullptr);
+    BOOST_CHECK(items.at(1)->getPrevious() == items.at(0));
+    BOOST_CHECK(&items.at(1)->getPreviousElement() == items.at(0)->Children.at(0));
+
+    // the siblings are still found after the list was changed directly
+    QSgmlTag* list = items.at(0)->Parent;
+    list->Children.removeAt(1);
+    BOOST_CHECK(items.at(0)->getNextSibling() == items.at(2));
+    BOOST_CHECK(items.at(2)->getPreviousSibling() == items.at(0));
+    BOOST_CHECK(items.at(1)->getNextSibling() == nullptr);
+
+    QSgmlTag* added = list->addChild("li", QSgmlTag::eStartTag);
+    BOOST_REQUIRE(added != nullptr);
+    BOOST_CHECK(items.at(2)->getNextSibling() == added);
+    BOOST_CHECK(added->getPreviousSibling() == items.at(2));
+}
+
+// Run explicitly with --run_test=QSgmlTest/siblingBenchmark
+BOOST_AUTO_TEST_CASE(siblingBenchmark, * boost::unit_test::disabled())
+{
+    QString html = "<html><body><ol>";
+    for (int i = 0; i < 20000; i++)
+    {
+        html += QString("<li>%1</li>").arg(i);
+    }
+    html += "</ol></body></html>";
+
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse(html));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int siblings = 0;
+    for (QSgmlTag* tag = doc.getElementsByName("li").at(0); tag != nullptr; tag = tag->getNextSibling())
+    {
+        siblings++;
+    }
+
+    const auto siblingTime = timer.restart();
+
+    int elements = 0;
+    for (QSgmlTag* tag = doc.DocTag; tag->Type != QSgmlTag::eVirtualEndTag; tag = &tag->getNextElement())
+    {
+        elements++;
+    }
+
+    const auto elementTime = timer.elapsed();
+    BOOST_CHECK_EQUAL(siblings, 20000);
+
+    BOOST_TEST_MESSAGE("Walked " << siblings << " siblings in " << siblingTime << " ms and "
+        << elements << " elements in " << elementTime << " ms");
+}
+
+// Run explicitly with --run_test=QSgmlTest/parseBenchmark
+BOOST_AUTO_TEST_CASE(parseBenchmark, * boost::unit_test::disabled())
+{
+    // roughly the size of a long XenForo thread page
+    QString html = "<html><head><title>Benchmark</title></head><body><ol class=\"messageList\">";
+    for (int i = 0; i < 2000; i++)
+    {
+        html += QString(R"(<li id="post-%1" class="message" data-author="user%1">)"
+            R"(<div class="messageInfo"><div class="messageContent"><article>)"
+            R"(<blockquote class="messageText">Post number %1 with <b>some</b> <a href="/posts/%1/">markup</a><br />)"
+            R"(and a second line</blockquote></article></div></div>)"
+            R"(<div class="messageMeta"><span class="DateTime" title="Jan 1, 2020 at %1 PM">Jan 1</span></div></li>)").arg(i);
+    }
+    html += "</ol></body></html>";
+
+    constexpr int iterations = 10;
+
+    // before
+    QElapsedTimer timer;
+    timer.start();
+
+    int legacyFound = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        LegacySgml doc;
+        doc.String2Sgml(html);
+        legacyFound = countTags(doc.DocTag, "li", "class", "message");
+    }
+
+    const auto before = timer.elapsed();
+    BOOST_CHECK_EQUAL(legacyFound, 2000);
+
+    // after
+    timer.restart();
+
+    int found = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        QSgml doc;
+        doc.parse(html);
+        found = countTags(doc.DocTag, "li", "class", "message");
+    }
+
+    const auto after = timer.elapsed();
+    BOOST_CHECK_EQUAL(found, 2000);
+
+    BOOST_TEST_MESSAGE("Parsed " << html.size() / 1024 << " KB " << iterations
+        << " times in " << after << " ms (" << after / iterations << " ms per page), "
+        << "the old String2Sgml took " << before << " ms (" << before / iterations << " ms per page)");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Owl - www.owlclient.com
+// Copyright (c) 2012-2023, Adalid Claure <aclaure@gmail.com>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QtCore>
+
+#include "../src/Utils/Exception.h"
+#include "../src/Utils/QSgml.h"
+#include "../src/Utils/QSgmlTag.h"
+#include "../src/Utils/SgmlSelector.h"
+
+using namespace owl;
+
+namespace
+{
+
+const QString threadListHtml = R"(<html><body>
+<ol id="threads" class="discussionList">
+    <li id="thread-1" class="discussionListItem visible sticky">
+        <a class="PreviewTooltip" href="threads/1">First</a>
+        <a class="username" href="members/alice">alice</a>
+        <div class="listBlock lastPost"><a class="username" href="members/bob">bob</a></div>
+    </li>
+    <li id="thread-2" class="discussionListItem visible">
+        <a class="PreviewTooltip" href="threads/2/unread">Second</a>
+        <a class="username-link" href="members/carol">carol</a>
+        <div class="listBlock lastPost"><a class="username" href="members/dave">dave</a></div>
+    </li>
+</ol>
+<div class="PageNav" data-page="1" data-last="3"></div>
+<ol class="messageList"><li id="post-10">one</li><li id="post-x">two</li><li id="post-11">three</li></ol>
+</body></html>)";
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SgmlSelectorTests)
+
+BOOST_AUTO_TEST_CASE(simpleSelectorTest)
+{
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse(threadListHtml));
+
+    const auto items = owl::select(doc, "li.discussionListItem");
+    BOOST_REQUIRE_EQUAL(items.size(), 2);
+    BOOST_CHECK(items.at(0)->getArgValue("id") == "thread-1");
+    BOOST_CHECK(items.at(1)->getArgValue("id") == "thread-2");
+
+    BOOST_CHECK_EQUAL(owl::select(doc, ".sticky").size(), 1);
+    BOOST_CHECK_EQUAL(owl::select(doc, "li.visible.sticky").size(), 1);
+    BOOST_CHECK_EQUAL(owl::select(doc, "div.discussionListItem").size(), 0);
+
+    const auto pageNav = owl::selectFirst(doc, "div.PageNav");
+    BOOST_REQUIRE(pageNav != nullptr);
+    BOOST_CHECK(pageNav->getArgValue("data-last") == "3");
+
+    const auto thread = owl::selectFirst(doc, "#thread-2");
+    BOOST_REQUIRE(thread != nullptr);
+    BOOST_CHECK(thread->getArgValue("class").contains("visible"));
+    BOOST_CHECK(owl::selectFirst(doc, "#thread-3") == nullptr);
+
+    // class tokens are matched as a whole, unlike a substring regexp
+    BOOST_CHECK_EQUAL(owl::select(doc, "a.username").size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(attributeSelectorTest)
+{
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse(threadListHtml));
+
+    BOOST_CHECK_EQUAL(owl::select(doc, "li[id%=post-\\d+]").size(), 2);
+    BOOST_CHECK_EQUAL(owl::select(doc, "li[id^=post-]").size(), 3);
+    BOOST_CHECK_EQUAL(owl::select(doc, "a[href$=unread]").size(), 1);
+    BOOST_CHECK_EQUAL(owl::select(doc, "a[href*='members/']").size(), 4);
+    BOOST_CHECK_EQUAL(owl::select(doc, "[class~=lastPost]").size(), 2);
+    BOOST_CHECK_EQUAL(owl::select(doc, "div[data-page=\"1\"]").size(), 1);
+    BOOST_CHECK_EQUAL(owl::select(doc, "div[data-missing]").size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(descendantSelectorTest)
+{
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse(threadListHtml));
+
+    const auto lastPosters = owl::select(doc, "ol#threads div.lastPost a.username");
+    BOOST_REQUIRE_EQUAL(lastPosters.size(), 2);
+    BOOST_CHECK(doc.getText(lastPosters.at(0)) == "bob");
+    BOOST_CHECK(doc.getText(lastPosters.at(1)) == "dave");
+
+    BOOST_CHECK_EQUAL(owl::select(doc, "ol.messageList a").size(), 0);
+
+    // scoped to a subtree, never past its end
+    const auto items = owl::select(doc, "li.discussionListItem");
+    BOOST_REQUIRE_EQUAL(items.size(), 2);
+
+    const auto author = owl::selectFirst(items.at(1), "a.username");
+    BOOST_REQUIRE(author != nullptr);
+    BOOST_CHECK(doc.getText(author) == "dave");
+
+    BOOST_CHECK(owl::selectFirst(items.at(0), "div.PageNav") == nullptr);
+    BOOST_CHECK_EQUAL(owl::select(items.at(0), "a").size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(compileTest)
+{
+    const auto first = SgmlSelector::compile("li.discussionListItem a.username");
+    const auto second = SgmlSelector::compile("li.discussionListItem a.username");
+    BOOST_CHECK(first == second);
+
+    BOOST_CHECK_THROW(SgmlSelector::compile(""), owl::Exception);
+    BOOST_CHECK_THROW(SgmlSelector::compile("li."), owl::Exception);
+    BOOST_CHECK_THROW(SgmlSelector::compile("li[id"), owl::Exception);
+    BOOST_CHECK_THROW(SgmlSelector::compile("li[id%=(]"), owl::Exception);
+    BOOST_CHECK_THROW(SgmlSelector::compile("li > a"), owl::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(indexTest)
+{
+    QSgml doc;
+    BOOST_REQUIRE(doc.parse(threadListHtml));
+
+    BOOST_CHECK_EQUAL(doc.getClassIndex().value("visible").size(), 2);
+    BOOST_CHECK_EQUAL(doc.getIdIndex().value("post-11").size(), 1);
+
+    // a new parse drops the old tables
+    BOOST_REQUIRE(doc.parse("<html><body><p class=\"visible\">x</p></body></html>"));
+    BOOST_CHECK_EQUAL(doc.getClassIndex().value("visible").size(), 1);
+    BOOST_CHECK(doc.getIdIndex().isEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
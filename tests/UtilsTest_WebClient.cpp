@@ -6,6 +6,7 @@
 #include <boost/test/data/test_case.hpp>
 
 #include <iostream>
+#include <stdexcept>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -66,6 +67,75 @@ BOOST_DATA_TEST_CASE(statusTests, data::make(statusData), url, expectedResponse,
     BOOST_CHECK_EQUAL(reply->status(), expectedStatus);
 }
 
+BOOST_AUTO_TEST_CASE(concurrentStatusTest)
+{
+    owl::WebClient client;
+    client.setThrowOnFail(false);
+    client.setMaxConcurrentRequests(3);
+
+    QStringList urls;
+    for (const auto& data : statusData)
+    {
+        urls.push_back(QString::fromLatin1(std::get<0>(data)));
+    }
+
+    const auto replies = client.GetUrls(urls, owl::WebClient::NOTIDY | owl::WebClient::NOCACHE);
+    BOOST_REQUIRE_EQUAL(replies.size(), std::size(statusData));
+
+    for (std::size_t i = 0; i < replies.size(); ++i)
+    {
+        BOOST_REQUIRE(replies[i] != nullptr);
+        BOOST_CHECK_EQUAL(replies[i]->text().toStdString(), std::get<1>(statusData[i]));
+        BOOST_CHECK_EQUAL(replies[i]->status(), std::get<2>(statusData[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(asyncCallbackTest)
+{
+    owl::WebClient client;
+    client.setThrowOnFail(true);
+
+    std::promise<long> callbackStatus;
+    auto future = client.GetUrlAsync("https://httpstat.us/200",
+        owl::WebClient::NOTIDY | owl::WebClient::NOCACHE,
+        [&callbackStatus](owl::WebClient::ReplyPtr reply)
+        {
+            callbackStatus.set_value(reply ? reply->status() : -1);
+        });
+
+    auto reply = future.get();
+    BOOST_REQUIRE(reply != nullptr);
+    BOOST_CHECK_EQUAL(reply->status(), 200);
+    BOOST_CHECK_EQUAL(callbackStatus.get_future().get(), 200);
+
+    // with throwOnFail the error surfaces through the future
+    auto failed = client.GetUrlAsync("https://httpstat.us/404",
+        owl::WebClient::NOTIDY | owl::WebClient::NOCACHE);
+    BOOST_CHECK_THROW(failed.get(), owl::WebException);
+}
+
+BOOST_AUTO_TEST_CASE(asyncCallbackThrowsTest)
+{
+    std::future<owl::WebClient::ReplyPtr> future;
+
+    {
+        owl::WebClient client;
+        client.setThrowOnFail(true);
+
+        // a non-routable address, so the request is normally still in flight
+        // and gets cancelled when the client is destroyed
+        future = client.GetUrlAsync("http://10.255.255.1/",
+            owl::WebClient::NOTIDY | owl::WebClient::NOCACHE,
+            [](owl::WebClient::ReplyPtr)
+            {
+                throw std::runtime_error("callback failed");
+            });
+    }
+
+    // the throwing callback must not take down the worker thread
+    BOOST_CHECK_THROW(future.get(), owl::WebException);
+}
+
 // [0] - the initial url
 // [1] - the expected finalUrl
 std::tuple<const char*, const char*> redirectData[]
@@ -215,14 +285,31 @@ BOOST_DATA_TEST_CASE(rawDataTest, data::make(rawData), url, expectedHash)
 
     auto reply = client.GetUrl(QString::fromLatin1(url), owl::WebClient::NOTIDY);
 
-    QByteArray byteArray(reply->data().c_str(), 
-        static_cast<uint>(reply->data().size()));
-    const QByteArray hash = QCryptographicHash::hash(byteArray, QCryptographicHash::Sha1);
+    BOOST_REQUIRE(reply != nullptr);
+
+    const QByteArray hash = QCryptographicHash::hash(reply->bytes(), QCryptographicHash::Sha1);
     const QString result = QString{ hash.toHex() }.toUpper();
 
-    BOOST_REQUIRE(reply != nullptr);
     BOOST_CHECK_EQUAL(reply->status(), 200);
     BOOST_CHECK_EQUAL(result.toStdString(), expectedHash);
 }
 
+std::tuple<const char*, bool> wellFormedData[]
+{
+    { R"(<!DOCTYPE html><html><head><title>t</title></head><body><p>one<br />two</p></body></html>)", true },
+    { R"(<html><body><!-- <div> --><script>if (a < b && c > d) { x = "</div>"; }</script></body></html>)", true },
+    { R"(<HTML><Body><a href="x?a=1&b=>2">link</a></body></html>)", true },
+    { R"(<html><body><p>one<br>two</p></body></html>)", false },
+    { R"(<html><body><div><p>unclosed</div></body></html>)", false },
+    { R"(<html><body><p>stray </p></div></body></html>)", false },
+    { R"(<html><body>1 < 2</body></html>)", false },
+    { R"(<div>no root</div>)", false },
+    { R"(just text)", false }
+};
+
+BOOST_DATA_TEST_CASE(wellFormedHtmlTest, data::make(wellFormedData), html, expected)
+{
+    BOOST_CHECK_EQUAL(owl::isWellFormedHtml(html), expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()